@@ -120,6 +120,30 @@ aql_add_attribute(aql_adt_t *adt, char *name, domain_t domain,
   return DB_OK;
 }
 
+db_result_t
+aql_add_group_attribute(aql_adt_t *adt, char *name)
+{
+  aql_attribute_t *attr;
+  int i;
+
+  /* Group by a projected attribute if there is one. */
+  for(i = 0; i < AQL_ATTRIBUTE_COUNT(adt); i++) {
+    attr = &adt->attributes[i];
+    if(adt->aggregators[i] == AQL_NONE && strcmp(attr->name, name) == 0) {
+      attr->flags |= ATTRIBUTE_FLAG_GROUP;
+      return DB_OK;
+    }
+  }
+
+  if(DB_ERROR(aql_add_attribute(adt, name, DOMAIN_UNSPECIFIED, 0, 0))) {
+    return DB_LIMIT_ERROR;
+  }
+  adt->attributes[adt->attribute_count - 1].flags =
+    ATTRIBUTE_FLAG_NO_STORE | ATTRIBUTE_FLAG_GROUP;
+
+  return DB_OK;
+}
+
 db_result_t
 aql_add_value(aql_adt_t *adt, domain_t domain, void *value_ptr)
 {
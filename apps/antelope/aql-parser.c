@@ -479,6 +479,22 @@ PARSER(join)
   RETURN(OK);
 }
 
+#if DB_FEATURE_GROUP_BY
+PARSER(group)
+{
+  CONSUME(BY);
+  CONSUME(IDENTIFIER);
+
+  PRINTF("Group by attribute %s\n", VALUE);
+  if(DB_ERROR(AQL_ADD_GROUP_ATTRIBUTE(adt, VALUE))) {
+    RETURN(SYNTAX_ERROR);
+  }
+  AQL_SET_FLAG(adt, AQL_FLAG_GROUP | AQL_FLAG_AGGREGATE);
+
+  RETURN(OK);
+}
+#endif /* DB_FEATURE_GROUP_BY */
+
 PARSER(select)
 {
   AQL_SET_TYPE(adt, AQL_TYPE_SELECT);
@@ -502,6 +518,20 @@ PARSER(select)
     }
 
     AQL_SET_CONDITION(adt, &p);
+#if DB_FEATURE_GROUP_BY
+    NEXT;
+    if(TOKEN == GROUP) {
+      if(!PARSE(group)) {
+        RETURN(SYNTAX_ERROR);
+      }
+    } else {
+      REWIND;
+    }
+  } else if(TOKEN == GROUP) {
+    if(!PARSE(group)) {
+      RETURN(SYNTAX_ERROR);
+    }
+#endif /* DB_FEATURE_GROUP_BY */
   } else {
     REWIND;
     RETURN(OK);
@@ -642,6 +672,9 @@ PARSER_TOKEN(index_type)
   case MAXHEAP:
     type = INDEX_MAXHEAP;
     break;
+  case BPTREE:
+    type = INDEX_BPTREE;
+    break;
   case MEMHASH:
     type = INDEX_MEMHASH;
     break;
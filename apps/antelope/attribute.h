@@ -56,6 +56,7 @@ typedef enum {
 #define ATTRIBUTE_FLAG_INVALID		0x2
 #define ATTRIBUTE_FLAG_PRIMARY_KEY	0x4
 #define ATTRIBUTE_FLAG_UNIQUE		0x8
+#define ATTRIBUTE_FLAG_GROUP		0x10
 
 struct attribute {
   struct attribute *next;
@@ -49,6 +49,21 @@
 #define DB_FEATURE_JOIN			1
 #endif /* DB_FEATURE_JOIN */
 
+/* Support hash joins, which also work on attributes without indexes. */
+#ifndef DB_FEATURE_HASH_JOIN
+#define DB_FEATURE_HASH_JOIN		0
+#endif /* DB_FEATURE_HASH_JOIN */
+
+/* Compile selection predicates before evaluating them for each tuple. */
+#ifndef DB_FEATURE_LVM_COMPILER
+#define DB_FEATURE_LVM_COMPILER		0
+#endif /* DB_FEATURE_LVM_COMPILER */
+
+/* Support aggregation of selections into groups (GROUP BY). */
+#ifndef DB_FEATURE_GROUP_BY
+#define DB_FEATURE_GROUP_BY		0
+#endif /* DB_FEATURE_GROUP_BY */
+
 /* Support tuple removals. */
 #ifndef DB_FEATURE_REMOVE
 #define DB_FEATURE_REMOVE		1
@@ -110,6 +125,13 @@
 #define DB_VM_BYTECODE_SIZE		128
 #endif /* DB_VM_BYTECODE_SIZE */
 
+/* The maximum number of tuples that a selection may scan in one call
+   to db_process() while looking for a tuple that satisfies the
+   predicate. */
+#ifndef DB_SELECT_BATCH_SIZE
+#define DB_SELECT_BATCH_SIZE		1
+#endif /* DB_SELECT_BATCH_SIZE */
+
 /*----------------------------------------------------------------------------*/
 
 /* Language options. */
@@ -206,6 +228,60 @@
 #define DB_HEAP_CACHE_LIMIT		1
 #endif /* DB_HEAP_CACHE_LIMIT */
 
+/* The maximum number of B+-tree indexes. */
+#ifndef DB_BPTREE_INDEX_LIMIT
+#define DB_BPTREE_INDEX_LIMIT		1
+#endif /* DB_BPTREE_INDEX_LIMIT */
+
+/* The size of a B+-tree node in storage. */
+#ifndef DB_BPTREE_NODE_SIZE
+#define DB_BPTREE_NODE_SIZE		128
+#endif /* DB_BPTREE_NODE_SIZE */
+
+/* The maximum number of nodes in a B+-tree index. */
+#ifndef DB_BPTREE_NODE_LIMIT
+#define DB_BPTREE_NODE_LIMIT		1024
+#endif /* DB_BPTREE_NODE_LIMIT */
+
+/* The number of B+-tree nodes cached in memory. */
+#ifndef DB_BPTREE_CACHE_LIMIT
+#define DB_BPTREE_CACHE_LIMIT		4
+#endif /* DB_BPTREE_CACHE_LIMIT */
+
+/*----------------------------------------------------------------------------*/
+
+/* Join options. */
+
+/* The maximum number of tuples held in memory by a hash join. */
+#ifndef DB_HASH_JOIN_LIMIT
+#define DB_HASH_JOIN_LIMIT		32
+#endif /* DB_HASH_JOIN_LIMIT */
+
+/* The memory reserved for the tuples held by a hash join. */
+#ifndef DB_HASH_JOIN_BUFFER_SIZE
+#define DB_HASH_JOIN_BUFFER_SIZE	512
+#endif /* DB_HASH_JOIN_BUFFER_SIZE */
+
+/* The number of hash buckets used by a hash join. */
+#ifndef DB_HASH_JOIN_BUCKETS
+#define DB_HASH_JOIN_BUCKETS		16
+#endif /* DB_HASH_JOIN_BUCKETS */
+
+/*----------------------------------------------------------------------------*/
+
+/* Aggregation options. */
+
+/* The maximum number of groups held in memory by a GROUP BY query.
+   Further groups are spilled to a file and aggregated in later passes. */
+#ifndef DB_GROUP_LIMIT
+#define DB_GROUP_LIMIT			16
+#endif /* DB_GROUP_LIMIT */
+
+/* The number of hash buckets used for finding groups in memory. */
+#ifndef DB_GROUP_BUCKETS
+#define DB_GROUP_BUCKETS		8
+#endif /* DB_GROUP_BUCKETS */
+
 /*----------------------------------------------------------------------------*/
 
 /* LVM options. */
@@ -219,7 +295,7 @@
 /* The maximum variable identifier number in the LVM. The default 
    value corresponds to the highest attribute ID. */
 #ifndef LVM_MAX_VARIABLE_ID
-#define LVM_MAX_VARIABLE_ID		AQL_ATTRIBUTE_LIMIT - 1
+#define LVM_MAX_VARIABLE_ID		(AQL_ATTRIBUTE_LIMIT - 1)
 #endif /* LVM_MAX_VARIABLE_ID */
 
 /* Specify whether floats should be used or not inside the LVM. */
@@ -227,5 +303,11 @@
 #define LVM_USE_FLOATS			DB_FEATURE_FLOATS
 #endif /* LVM_USE_FLOATS */
 
+/* The maximum number of comparisons in a predicate that the LVM
+   compiler turns into a flat filter program. */
+#ifndef LVM_MAX_FILTER_TERMS
+#define LVM_MAX_FILTER_TERMS		8
+#endif /* LVM_MAX_FILTER_TERMS */
+
 
 #endif /* !DB_OPTIONS_H */
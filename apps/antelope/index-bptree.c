@@ -0,0 +1,723 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *     A B+-tree index for flash memory.
+ *
+ *     The tree is stored in a single file that is divided into nodes of
+ *     DB_BPTREE_NODE_SIZE bytes. Leaf nodes hold sorted (key, tuple ID)
+ *     pairs and are linked from left to right, so a range query descends
+ *     once to the first matching key and then scans consecutive leaves.
+ *     Inner nodes hold separator keys and route searches to the leaves.
+ *
+ *     Nodes are read through a small write-through cache that keeps the
+ *     most recently used nodes in memory. The upper levels of the tree
+ *     are visited by every search and therefore tend to stay cached.
+ *
+ *     Keys that arrive in ascending order, which is the common case for
+ *     time stamps and for loading an index from an existing relation,
+ *     are appended to the rightmost leaf. When such a node fills up, a
+ *     new empty node is started instead of moving half of the entries,
+ *     so sequential loads produce fully packed nodes.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "cfs/cfs.h"
+#include "lib/memb.h"
+
+#include "db-options.h"
+#include "index.h"
+#include "result.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+/* Node 0 holds the tree metadata, so its ID doubles as a null node. */
+#define NO_NODE		0
+#define MAX_HEIGHT	16
+
+typedef int32_t bptree_key_t;
+typedef uint16_t bptree_node_id_t;
+
+struct bptree_entry {
+  bptree_key_t key;
+  tuple_id_t value;
+};
+
+#define NODE_HEADER_SIZE	4
+#define LEAF_CAPACITY	\
+  ((DB_BPTREE_NODE_SIZE - NODE_HEADER_SIZE) / sizeof(struct bptree_entry))
+#define INNER_CAPACITY	\
+  ((DB_BPTREE_NODE_SIZE - NODE_HEADER_SIZE - sizeof(bptree_node_id_t)) / \
+   (sizeof(bptree_key_t) + sizeof(bptree_node_id_t)))
+
+struct bptree_node {
+  uint8_t leaf;
+  uint8_t count;
+  /* The next leaf to the right. Not used in inner nodes. */
+  bptree_node_id_t next;
+  union {
+    struct bptree_entry entries[LEAF_CAPACITY];
+    struct {
+      bptree_key_t keys[INNER_CAPACITY];
+      bptree_node_id_t children[INNER_CAPACITY + 1];
+    } inner;
+  } u;
+};
+
+struct bptree_meta {
+  bptree_node_id_t root;
+  bptree_node_id_t node_count;
+  uint8_t height;
+};
+
+struct bptree {
+  db_storage_id_t fd;
+  struct bptree_meta meta;
+};
+typedef struct bptree bptree_t;
+
+struct node_cache {
+  bptree_t *tree;
+  bptree_node_id_t node_id;
+  uint16_t last_use;
+  struct bptree_node node;
+};
+
+static struct node_cache node_cache[DB_BPTREE_CACHE_LIMIT];
+static uint16_t cache_clock;
+
+static db_result_t create(index_t *);
+static db_result_t destroy(index_t *);
+static db_result_t load(index_t *);
+static db_result_t release(index_t *);
+static db_result_t insert(index_t *, attribute_value_t *, tuple_id_t);
+static db_result_t delete(index_t *, attribute_value_t *);
+static tuple_id_t get_next(index_iterator_t *);
+
+index_api_t index_bptree = {
+  INDEX_BPTREE,
+  INDEX_API_EXTERNAL | INDEX_API_RANGE_QUERIES,
+  create,
+  destroy,
+  load,
+  release,
+  insert,
+  delete,
+  get_next
+};
+
+MEMB(bptrees, bptree_t, DB_BPTREE_INDEX_LIMIT);
+
+static bptree_key_t
+value_to_key(attribute_value_t *value)
+{
+  long key;
+
+  key = db_value_to_long(value);
+  if(key < INT32_MIN) {
+    return INT32_MIN;
+  } else if(key > INT32_MAX) {
+    return INT32_MAX;
+  }
+  return (bptree_key_t)key;
+}
+
+static struct node_cache *
+get_cache(bptree_t *tree, bptree_node_id_t node_id)
+{
+  int i;
+
+  for(i = 0; i < DB_BPTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree && node_cache[i].node_id == node_id) {
+      return &node_cache[i];
+    }
+  }
+  return NULL;
+}
+
+static struct node_cache *
+get_cache_free(void)
+{
+  int i;
+  struct node_cache *victim;
+
+  /* Pick an unused entry, or else the least recently used one. */
+  victim = &node_cache[0];
+  for(i = 0; i < DB_BPTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == NULL) {
+      return &node_cache[i];
+    }
+    if((uint16_t)(cache_clock - node_cache[i].last_use) >
+       (uint16_t)(cache_clock - victim->last_use)) {
+      victim = &node_cache[i];
+    }
+  }
+  return victim;
+}
+
+static void
+invalidate_cache(bptree_t *tree)
+{
+  int i;
+
+  for(i = 0; i < DB_BPTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree) {
+      node_cache[i].tree = NULL;
+    }
+  }
+}
+
+/*
+ * Returns a pointer to a cached copy of a node. The pointer is valid
+ * until the next call to a function that accesses the node cache.
+ */
+static const struct bptree_node *
+get_node(bptree_t *tree, bptree_node_id_t node_id)
+{
+  struct node_cache *cache;
+
+  cache = get_cache(tree, node_id);
+  if(cache == NULL) {
+    cache = get_cache_free();
+    cache->tree = NULL;
+    if(DB_ERROR(storage_read(tree->fd, &cache->node,
+                             (unsigned long)node_id * DB_BPTREE_NODE_SIZE,
+                             sizeof(cache->node)))) {
+      PRINTF("DB: Failed to read B+-tree node %u\n", (unsigned)node_id);
+      return NULL;
+    }
+    cache->tree = tree;
+    cache->node_id = node_id;
+  }
+  cache->last_use = ++cache_clock;
+  return &cache->node;
+}
+
+static int
+read_node(bptree_t *tree, bptree_node_id_t node_id, struct bptree_node *node)
+{
+  const struct bptree_node *cached;
+
+  cached = get_node(tree, node_id);
+  if(cached == NULL) {
+    return 0;
+  }
+  memcpy(node, cached, sizeof(*node));
+  return 1;
+}
+
+static int
+write_node(bptree_t *tree, bptree_node_id_t node_id, struct bptree_node *node)
+{
+  struct node_cache *cache;
+
+  cache = get_cache(tree, node_id);
+  if(DB_ERROR(storage_write(tree->fd, node,
+                            (unsigned long)node_id * DB_BPTREE_NODE_SIZE,
+                            sizeof(*node)))) {
+    PRINTF("DB: Failed to write B+-tree node %u\n", (unsigned)node_id);
+    if(cache != NULL) {
+      cache->tree = NULL;
+    }
+    return 0;
+  }
+
+  if(cache == NULL) {
+    cache = get_cache_free();
+    cache->tree = tree;
+    cache->node_id = node_id;
+  }
+  cache->last_use = ++cache_clock;
+  memcpy(&cache->node, node, sizeof(*node));
+  return 1;
+}
+
+static int
+write_meta(bptree_t *tree)
+{
+  return DB_SUCCESS(storage_write(tree->fd, &tree->meta, 0,
+                                  sizeof(tree->meta)));
+}
+
+/*
+ * Returns the position of the first key that is greater than the
+ * given key if upper is set, or otherwise not smaller than it.
+ */
+static int
+leaf_position(const struct bptree_node *node, bptree_key_t key, int upper)
+{
+  int low, high, mid;
+
+  low = 0;
+  high = node->count;
+  while(low < high) {
+    mid = (low + high) / 2;
+    if(node->u.entries[mid].key < key ||
+       (upper && node->u.entries[mid].key == key)) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+static int
+inner_position(const struct bptree_node *node, bptree_key_t key, int upper)
+{
+  int low, high, mid;
+
+  low = 0;
+  high = node->count;
+  while(low < high) {
+    mid = (low + high) / 2;
+    if(node->u.inner.keys[mid] < key ||
+       (upper && node->u.inner.keys[mid] == key)) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+/* Finds the leftmost leaf that can hold the given key. */
+static bptree_node_id_t
+find_leaf(bptree_t *tree, bptree_key_t key)
+{
+  const struct bptree_node *node;
+  bptree_node_id_t node_id;
+  int level;
+
+  node_id = tree->meta.root;
+  for(level = 1; level < tree->meta.height; level++) {
+    node = get_node(tree, node_id);
+    if(node == NULL) {
+      return NO_NODE;
+    }
+    node_id = node->u.inner.children[inner_position(node, key, 0)];
+  }
+  return node_id;
+}
+
+static db_result_t
+create(index_t *index)
+{
+  char *filename;
+  bptree_t *tree;
+  struct bptree_node root;
+
+  filename = storage_generate_file("bptree",
+                (unsigned long)DB_BPTREE_NODE_LIMIT * DB_BPTREE_NODE_SIZE);
+  if(filename == NULL) {
+    PRINTF("DB: Failed to generate a B+-tree index file\n");
+    return DB_INDEX_ERROR;
+  }
+  memcpy(index->descriptor_file, filename, sizeof(index->descriptor_file));
+
+  tree = memb_alloc(&bptrees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->fd = storage_open(index->descriptor_file);
+  if(tree->fd < 0) {
+    memb_free(&bptrees, tree);
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_STORAGE_ERROR;
+  }
+
+  /* A new tree consists of a single empty leaf. */
+  tree->meta.root = 1;
+  tree->meta.node_count = 2;
+  tree->meta.height = 1;
+  memset(&root, 0, sizeof(root));
+  root.leaf = 1;
+
+  if(!write_node(tree, tree->meta.root, &root) || !write_meta(tree)) {
+    invalidate_cache(tree);
+    storage_close(tree->fd);
+    memb_free(&bptrees, tree);
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_STORAGE_ERROR;
+  }
+
+  index->opaque_data = tree;
+
+  PRINTF("DB: Created a B+-tree with %u entries per leaf and %u keys per inner node\n",
+         (unsigned)LEAF_CAPACITY, (unsigned)INNER_CAPACITY);
+
+  return DB_OK;
+}
+
+static db_result_t
+destroy(index_t *index)
+{
+  if(index->opaque_data != NULL) {
+    release(index);
+  }
+  cfs_remove(index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+load(index_t *index)
+{
+  bptree_t *tree;
+
+  tree = memb_alloc(&bptrees);
+  if(tree == NULL) {
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->fd = storage_open(index->descriptor_file);
+  if(tree->fd < 0) {
+    memb_free(&bptrees, tree);
+    return DB_STORAGE_ERROR;
+  }
+
+  if(DB_ERROR(storage_read(tree->fd, &tree->meta, 0, sizeof(tree->meta))) ||
+     tree->meta.height == 0 || tree->meta.height > MAX_HEIGHT) {
+    storage_close(tree->fd);
+    memb_free(&bptrees, tree);
+    return DB_STORAGE_ERROR;
+  }
+
+  index->opaque_data = tree;
+
+  PRINTF("DB: Loaded a B+-tree of height %u with %u nodes\n",
+         (unsigned)tree->meta.height, (unsigned)tree->meta.node_count);
+
+  return DB_OK;
+}
+
+static db_result_t
+release(index_t *index)
+{
+  bptree_t *tree;
+
+  tree = index->opaque_data;
+  invalidate_cache(tree);
+  storage_close(tree->fd);
+  memb_free(&bptrees, tree);
+  index->opaque_data = NULL;
+  return DB_OK;
+}
+
+static db_result_t
+insert(index_t *index, attribute_value_t *value, tuple_id_t tuple_id)
+{
+  bptree_t *tree;
+  const struct bptree_node *cached;
+  struct bptree_node node;
+  struct bptree_node sibling;
+  bptree_node_id_t path[MAX_HEIGHT];
+  uint8_t positions[MAX_HEIGHT];
+  bptree_node_id_t node_id;
+  bptree_node_id_t new_id;
+  bptree_key_t key;
+  bptree_key_t separator;
+  int level;
+  int pos;
+  int split;
+  int total;
+  int append;
+
+  tree = index->opaque_data;
+  key = value_to_key(value);
+
+  /* Descend to the leaf, remembering the path for splits. */
+  node_id = tree->meta.root;
+  append = 1;
+  for(level = 0; level < tree->meta.height - 1; level++) {
+    cached = get_node(tree, node_id);
+    if(cached == NULL) {
+      return DB_STORAGE_ERROR;
+    }
+    pos = inner_position(cached, key, 1);
+    append &= pos == cached->count;
+    path[level] = node_id;
+    positions[level] = pos;
+    node_id = cached->u.inner.children[pos];
+  }
+
+  if(!read_node(tree, node_id, &node)) {
+    return DB_STORAGE_ERROR;
+  }
+  pos = leaf_position(&node, key, 1);
+  append &= pos == node.count;
+
+  if(node.count < LEAF_CAPACITY) {
+    memmove(&node.u.entries[pos + 1], &node.u.entries[pos],
+            (node.count - pos) * sizeof(node.u.entries[0]));
+    node.u.entries[pos].key = key;
+    node.u.entries[pos].value = tuple_id;
+    node.count++;
+    return write_node(tree, node_id, &node) ? DB_OK : DB_STORAGE_ERROR;
+  }
+
+  /*
+   * The leaf must be split. Check beforehand that every level can be
+   * split, so that a full index is not left in an inconsistent state.
+   */
+  if(tree->meta.height >= MAX_HEIGHT ||
+     tree->meta.node_count + tree->meta.height + 1 > DB_BPTREE_NODE_LIMIT) {
+    PRINTF("DB: The B+-tree is full\n");
+    return DB_INDEX_ERROR;
+  }
+
+  {
+    struct bptree_entry entries[LEAF_CAPACITY + 1];
+
+    memcpy(entries, node.u.entries, pos * sizeof(entries[0]));
+    entries[pos].key = key;
+    entries[pos].value = tuple_id;
+    memcpy(&entries[pos + 1], &node.u.entries[pos],
+           (node.count - pos) * sizeof(entries[0]));
+    total = node.count + 1;
+    split = append ? node.count : total / 2;
+
+    new_id = tree->meta.node_count++;
+    memset(&sibling, 0, sizeof(sibling));
+    sibling.leaf = 1;
+    sibling.count = total - split;
+    sibling.next = node.next;
+    memcpy(sibling.u.entries, &entries[split],
+           sibling.count * sizeof(entries[0]));
+
+    node.count = split;
+    node.next = new_id;
+    memcpy(node.u.entries, entries, split * sizeof(entries[0]));
+    separator = sibling.u.entries[0].key;
+  }
+
+  if(!write_node(tree, new_id, &sibling) ||
+     !write_node(tree, node_id, &node)) {
+    return DB_STORAGE_ERROR;
+  }
+
+  /* Insert the separator into the parents, splitting them as needed. */
+  for(level = tree->meta.height - 2; level >= 0; level--) {
+    node_id = path[level];
+    pos = positions[level];
+    if(!read_node(tree, node_id, &node)) {
+      return DB_STORAGE_ERROR;
+    }
+
+    if(node.count < INNER_CAPACITY) {
+      memmove(&node.u.inner.keys[pos + 1], &node.u.inner.keys[pos],
+              (node.count - pos) * sizeof(node.u.inner.keys[0]));
+      memmove(&node.u.inner.children[pos + 2], &node.u.inner.children[pos + 1],
+              (node.count - pos) * sizeof(node.u.inner.children[0]));
+      node.u.inner.keys[pos] = separator;
+      node.u.inner.children[pos + 1] = new_id;
+      node.count++;
+      if(!write_node(tree, node_id, &node)) {
+        return DB_STORAGE_ERROR;
+      }
+      return write_meta(tree) ? DB_OK : DB_STORAGE_ERROR;
+    }
+
+    {
+      bptree_key_t keys[INNER_CAPACITY + 1];
+      bptree_node_id_t children[INNER_CAPACITY + 2];
+
+      memcpy(keys, node.u.inner.keys, pos * sizeof(keys[0]));
+      keys[pos] = separator;
+      memcpy(&keys[pos + 1], &node.u.inner.keys[pos],
+             (node.count - pos) * sizeof(keys[0]));
+      memcpy(children, node.u.inner.children, (pos + 1) * sizeof(children[0]));
+      children[pos + 1] = new_id;
+      memcpy(&children[pos + 2], &node.u.inner.children[pos + 1],
+             (node.count - pos) * sizeof(children[0]));
+      total = node.count + 1;
+
+      /* The key at the split position moves up to the parent. */
+      split = append ? node.count : total / 2;
+      separator = keys[split];
+      new_id = tree->meta.node_count++;
+
+      memset(&sibling, 0, sizeof(sibling));
+      sibling.count = total - split - 1;
+      memcpy(sibling.u.inner.keys, &keys[split + 1],
+             sibling.count * sizeof(keys[0]));
+      memcpy(sibling.u.inner.children, &children[split + 1],
+             (sibling.count + 1) * sizeof(children[0]));
+
+      node.count = split;
+      memcpy(node.u.inner.keys, keys, split * sizeof(keys[0]));
+      memcpy(node.u.inner.children, children, (split + 1) * sizeof(children[0]));
+    }
+
+    if(!write_node(tree, new_id, &sibling) ||
+       !write_node(tree, node_id, &node)) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  /* The root was split, so the tree grows by one level. */
+  memset(&node, 0, sizeof(node));
+  node.count = 1;
+  node.u.inner.keys[0] = separator;
+  node.u.inner.children[0] = tree->meta.root;
+  node.u.inner.children[1] = new_id;
+  node_id = tree->meta.node_count++;
+  if(!write_node(tree, node_id, &node)) {
+    return DB_STORAGE_ERROR;
+  }
+  tree->meta.root = node_id;
+  tree->meta.height++;
+
+  return write_meta(tree) ? DB_OK : DB_STORAGE_ERROR;
+}
+
+static db_result_t
+delete(index_t *index, attribute_value_t *value)
+{
+  bptree_t *tree;
+  struct bptree_node node;
+  bptree_node_id_t node_id;
+  bptree_key_t key;
+  int start, end;
+  int last;
+  int found;
+
+  tree = index->opaque_data;
+  key = value_to_key(value);
+  found = 0;
+
+  /*
+   * Remove all entries with the key. Nodes are not merged when they
+   * become sparse; an emptied leaf simply stays in the leaf chain.
+   */
+  for(node_id = find_leaf(tree, key); node_id != NO_NODE; node_id = node.next) {
+    if(!read_node(tree, node_id, &node)) {
+      return DB_STORAGE_ERROR;
+    }
+    start = leaf_position(&node, key, 0);
+    end = leaf_position(&node, key, 1);
+    last = end < node.count;
+    if(end > start) {
+      memmove(&node.u.entries[start], &node.u.entries[end],
+              (node.count - end) * sizeof(node.u.entries[0]));
+      node.count -= end - start;
+      if(!write_node(tree, node_id, &node)) {
+        return DB_STORAGE_ERROR;
+      }
+      found = 1;
+    }
+    if(last) {
+      break;
+    }
+  }
+
+  return found ? DB_OK : DB_INDEX_ERROR;
+}
+
+static tuple_id_t
+get_next(index_iterator_t *iterator)
+{
+  static struct {
+    index_iterator_t *iterator;
+    tuple_id_t next_item_no;
+    bptree_node_id_t leaf;
+    uint8_t position;
+  } cursor;
+  bptree_t *tree;
+  const struct bptree_node *node;
+  bptree_key_t min;
+  bptree_key_t max;
+  tuple_id_t skip;
+
+  tree = iterator->index->opaque_data;
+  min = value_to_key(&iterator->min_value);
+  max = value_to_key(&iterator->max_value);
+
+  skip = 0;
+  if(cursor.iterator != iterator ||
+     cursor.next_item_no != iterator->next_item_no ||
+     iterator->next_item_no == 0) {
+    /*
+     * Start at the first key in the range. If another iteration has
+     * used the cursor in between, skip the items that have already
+     * been returned.
+     */
+    cursor.iterator = iterator;
+    cursor.next_item_no = iterator->next_item_no;
+    cursor.leaf = find_leaf(tree, min);
+    if(cursor.leaf == NO_NODE) {
+      return INVALID_TUPLE;
+    }
+    node = get_node(tree, cursor.leaf);
+    if(node == NULL) {
+      cursor.leaf = NO_NODE;
+      return INVALID_TUPLE;
+    }
+    cursor.position = leaf_position(node, min, 0);
+    skip = iterator->next_item_no;
+  }
+
+  while(cursor.leaf != NO_NODE) {
+    node = get_node(tree, cursor.leaf);
+    if(node == NULL) {
+      break;
+    }
+    for(; cursor.position < node->count; cursor.position++) {
+      if(node->u.entries[cursor.position].key > max) {
+        cursor.leaf = NO_NODE;
+        return INVALID_TUPLE;
+      }
+      if(skip > 0) {
+        skip--;
+        continue;
+      }
+      cursor.next_item_no = ++iterator->next_item_no;
+      return node->u.entries[cursor.position++].value;
+    }
+    cursor.leaf = node->next;
+    cursor.position = 0;
+  }
+
+  cursor.leaf = NO_NODE;
+  return INVALID_TUPLE;
+}
@@ -43,7 +43,8 @@ typedef enum {
   INDEX_NONE = 0,
   INDEX_INLINE = 1,
   INDEX_MEMHASH = 2,
-  INDEX_MAXHEAP = 3
+  INDEX_MAXHEAP = 3,
+  INDEX_BPTREE = 4
 } index_type_t;
 
 #define INDEX_READY		0x00
@@ -96,6 +97,7 @@ typedef struct index_api index_api_t;
 
 extern index_api_t index_inline;
 extern index_api_t index_maxheap;
+extern index_api_t index_bptree;
 extern index_api_t index_memhash;
 
 void index_init(void);
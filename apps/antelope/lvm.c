@@ -82,10 +82,29 @@ typedef struct derivation derivation_t;
 
 /* Registered variables for a LVM expression. Their values may be 
    changed between executions of the expression. */
-static variable_t variables[LVM_MAX_VARIABLE_ID - 1];
+static variable_t variables[LVM_MAX_VARIABLE_ID];
 
 /* Range derivations of variables that are used for index searches. */
-static derivation_t derivations[LVM_MAX_VARIABLE_ID - 1];
+static derivation_t derivations[LVM_MAX_VARIABLE_ID];
+
+#if DB_FEATURE_LVM_COMPILER
+#define LVM_COMPILED_NONE	0
+#define LVM_COMPILED_FILTER	1
+
+/*
+ * A predicate that is a conjunction of comparisons between variables
+ * and constants is compiled into a flat list of such comparisons,
+ * which is evaluated without walking the bytecode.
+ */
+struct filter_term {
+  operator_t op;
+  variable_id_t id;
+  long value;
+};
+
+static struct filter_term filter[LVM_MAX_FILTER_TERMS];
+static uint8_t filter_length;
+#endif /* DB_FEATURE_LVM_COMPILER */
 
 #if DEBUG
 static void
@@ -144,6 +163,70 @@ get_type(lvm_instance_t *p)
   return node_type;
 }
 
+/* Returns the operator that gives the same result when the operands
+   of a comparison change places. */
+static operator_t
+mirror_operator(operator_t op)
+{
+  switch(op) {
+  case LVM_GE:
+    return LVM_LE;
+  case LVM_GEQ:
+    return LVM_LEQ;
+  case LVM_LE:
+    return LVM_GE;
+  case LVM_LEQ:
+    return LVM_GEQ;
+  default:
+    return op;
+  }
+}
+
+/* Moves the instruction pointer past the current node and its operands,
+   and clears the constant flag if any of them is not constant. */
+static lvm_status_t
+skip_node(lvm_instance_t *p, int *constant)
+{
+  node_type_t type;
+  operator_t *operator;
+  operand_t operand;
+  lvm_status_t r;
+  int i;
+  int arguments;
+
+  if(p->ip >= p->end) {
+    return EXECUTION_ERROR;
+  }
+
+  type = get_type(p);
+  switch(type) {
+  case LVM_OPERAND:
+    get_operand(p, &operand);
+    if(operand.type == LVM_VARIABLE) {
+      *constant = 0;
+    }
+    return TRUE;
+  case LVM_CMP_OP:
+    *constant = 0;
+    break;
+  case LVM_ARITH_OP:
+    break;
+  default:
+    return SEMANTIC_ERROR;
+  }
+
+  operator = get_operator(p);
+  arguments = *operator == LVM_NOT ? 1 : 2;
+  for(i = 0; i < arguments; i++) {
+    r = skip_node(p, constant);
+    if(LVM_ERROR(r)) {
+      return r;
+    }
+  }
+
+  return TRUE;
+}
+
 static long
 operand_to_long(operand_t *operand)
 {
@@ -306,6 +389,9 @@ lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size)
   p->end = 0;
   p->ip = 0;
   p->error = 0;
+#if DB_FEATURE_LVM_COMPILER
+  p->compiled = LVM_COMPILED_NONE;
+#endif /* DB_FEATURE_LVM_COMPILER */
 
   memset(variables, 0, sizeof(variables));
   memset(derivations, 0, sizeof(derivations));
@@ -376,6 +462,215 @@ lvm_set_type(lvm_instance_t *p, node_type_t type)
   p->end += sizeof(type);
 }
 
+#if DB_FEATURE_LVM_COMPILER
+static lvm_status_t
+fold_node(lvm_instance_t *p, lvm_ip_t *out)
+{
+  lvm_ip_t start;
+  node_type_t type;
+  operator_t *operator;
+  operand_t result;
+  lvm_status_t r;
+  int constant;
+  int i;
+  int arguments;
+
+  start = p->ip;
+  constant = 1;
+  r = skip_node(p, &constant);
+  if(LVM_ERROR(r)) {
+    return r;
+  }
+  p->ip = start;
+
+  /*
+   * The folded code is never longer than the original code, so it can
+   * be written over the part of the code that has already been read.
+   */
+  type = get_type(p);
+  if(type == LVM_ARITH_OP && constant) {
+    operator = get_operator(p);
+    if(!LVM_ERROR(eval_expr(p, *operator, &result))) {
+      type = LVM_OPERAND;
+      memcpy(&p->code[*out], &type, sizeof(type));
+      memcpy(&p->code[*out + sizeof(type)], &result, sizeof(result));
+      *out += sizeof(type) + sizeof(result);
+      return TRUE;
+    }
+    p->ip = start + sizeof(type);
+  }
+
+  if(type == LVM_OPERAND) {
+    p->ip += sizeof(operand_t);
+    memmove(&p->code[*out], &p->code[start], p->ip - start);
+    *out += p->ip - start;
+    return TRUE;
+  }
+
+  operator = get_operator(p);
+  arguments = *operator == LVM_NOT ? 1 : 2;
+  memmove(&p->code[*out], &p->code[start], p->ip - start);
+  *out += p->ip - start;
+
+  for(i = 0; i < arguments; i++) {
+    r = fold_node(p, out);
+    if(LVM_ERROR(r)) {
+      return r;
+    }
+  }
+
+  return TRUE;
+}
+
+static int
+compile_filter(lvm_instance_t *p)
+{
+  operator_t operator;
+  operand_t operand[2];
+  struct filter_term *term;
+  int i;
+
+  if(get_type(p) != LVM_CMP_OP) {
+    return 0;
+  }
+
+  operator = *get_operator(p);
+  if(operator == LVM_AND) {
+    return compile_filter(p) && compile_filter(p);
+  } else if(IS_CONNECTIVE(operator) || filter_length == LVM_MAX_FILTER_TERMS) {
+    return 0;
+  }
+
+  for(i = 0; i < 2; i++) {
+    if(get_type(p) != LVM_OPERAND) {
+      return 0;
+    }
+    get_operand(p, &operand[i]);
+  }
+
+  /* Put the variable on the left side of the comparison. */
+  term = &filter[filter_length];
+  if(operand[0].type == LVM_VARIABLE && operand[1].type == LVM_LONG) {
+    term->op = operator;
+    term->id = operand[0].value.id;
+    term->value = operand[1].value.l;
+  } else if(operand[0].type == LVM_LONG && operand[1].type == LVM_VARIABLE) {
+    term->op = mirror_operator(operator);
+    term->id = operand[1].value.id;
+    term->value = operand[0].value.l;
+  } else {
+    return 0;
+  }
+
+  if(term->id >= LVM_MAX_VARIABLE_ID ||
+     variables[term->id].type != LVM_LONG) {
+    return 0;
+  }
+
+  filter_length++;
+  return 1;
+}
+
+static lvm_status_t
+execute_filter(void)
+{
+  struct filter_term *term;
+  long value;
+
+  for(term = filter; term < &filter[filter_length]; term++) {
+    value = variables[term->id].value.l;
+    switch(term->op) {
+    case LVM_EQ:
+      if(value != term->value) {
+        return FALSE;
+      }
+      break;
+    case LVM_NEQ:
+      if(value == term->value) {
+        return FALSE;
+      }
+      break;
+    case LVM_GE:
+      if(value <= term->value) {
+        return FALSE;
+      }
+      break;
+    case LVM_GEQ:
+      if(value < term->value) {
+        return FALSE;
+      }
+      break;
+    case LVM_LE:
+      if(value >= term->value) {
+        return FALSE;
+      }
+      break;
+    case LVM_LEQ:
+      if(value > term->value) {
+        return FALSE;
+      }
+      break;
+    default:
+      return EXECUTION_ERROR;
+    }
+  }
+
+  return TRUE;
+}
+
+/*
+ * Prepares the code for repeated execution. Arithmetic on constants
+ * is folded into single operands, which also lets lvm_derive() find
+ * ranges in expressions such as "a > 10 * 60". If the predicate is a
+ * conjunction of comparisons between variables and constants,
+ * lvm_execute() will evaluate the flat filter program instead of
+ * the code.
+ */
+lvm_status_t
+lvm_compile(lvm_instance_t *p)
+{
+  lvm_ip_t out;
+  lvm_status_t r;
+
+  p->compiled = LVM_COMPILED_NONE;
+
+  p->ip = 0;
+  out = 0;
+  r = fold_node(p, &out);
+  if(LVM_ERROR(r)) {
+    return r;
+  }
+  p->end = out;
+
+  p->ip = 0;
+  filter_length = 0;
+  if(compile_filter(p)) {
+    PRINTF("Compiled the predicate into %u filter terms\n",
+           (unsigned)filter_length);
+    p->compiled = LVM_COMPILED_FILTER;
+  }
+  p->ip = 0;
+
+  return TRUE;
+}
+
+lvm_status_t
+lvm_get_variable_id(char *name, variable_id_t *id)
+{
+  *id = lookup(name);
+  if(*id >= LVM_MAX_VARIABLE_ID || variables[*id].name[0] == '\0') {
+    return INVALID_IDENTIFIER;
+  }
+  return TRUE;
+}
+
+void
+lvm_set_variable_id_value(variable_id_t id, operand_value_t value)
+{
+  variables[id].value = value;
+}
+#endif /* DB_FEATURE_LVM_COMPILER */
+
 lvm_status_t
 lvm_execute(lvm_instance_t *p)
 {
@@ -383,6 +678,12 @@ lvm_execute(lvm_instance_t *p)
   operator_t *operator;
   lvm_status_t status;
 
+#if DB_FEATURE_LVM_COMPILER
+  if(p->compiled == LVM_COMPILED_FILTER) {
+    return execute_filter();
+  }
+#endif /* DB_FEATURE_LVM_COMPILER */
+
   p->ip = 0;
   status = EXECUTION_ERROR;
   type = get_type(p);
@@ -542,14 +843,10 @@ create_union(derivation_t *result, derivation_t *d1, derivation_t *d2)
   int i;
 
   for(i = 0; i < LVM_MAX_VARIABLE_ID; i++) {
-    if(!d1[i].derived && !d2[i].derived) {
+    if(!d1[i].derived || !d2[i].derived) {
+      /* A variable that is unconstrained in one of the operands
+         is unconstrained in the union. */
       continue;
-    } else if(d1[i].derived && !d2[i].derived) {
-      result[i].min.l = d1[i].min.l;
-      result[i].max.l = d1[i].max.l;
-    } else if(!d1[i].derived && d2[i].derived) {
-      result[i].min.l = d2[i].min.l;
-      result[i].max.l = d2[i].max.l;
     } else {
       /* Both derivations have been made; create a
          union of the ranges. */
@@ -579,6 +876,38 @@ create_union(derivation_t *result, derivation_t *d1, derivation_t *d2)
 #endif /* DEBUG */
 }
 
+static int derive_relation(lvm_instance_t *, derivation_t *);
+
+/*
+ * Derives ranges from one operand of a logical connective. Ranges
+ * cannot be derived from all comparisons (e.g., "a <> 1"), but such an
+ * operand of an AND does not prevent ranges from being derived from
+ * the other operand. Returns 1 if a derivation was made, 0 if the
+ * operand was skipped, and -1 on failure.
+ */
+static int
+derive_operand(lvm_instance_t *p, operator_t connective,
+               derivation_t *local_derivations)
+{
+  lvm_ip_t start;
+  int constant;
+
+  start = p->ip;
+  if(!LVM_ERROR(derive_relation(p, local_derivations))) {
+    return 1;
+  }
+
+  memset(local_derivations, 0, sizeof(derivation_t) * LVM_MAX_VARIABLE_ID);
+  if(connective == LVM_AND) {
+    p->ip = start;
+    if(!LVM_ERROR(skip_node(p, &constant))) {
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
 static int
 derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
 {
@@ -589,6 +918,8 @@ derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
   int variable_id;
   operand_value_t *value;
   derivation_t *derivation;
+  int derived[2];
+  operator_t op;
 
   type = get_type(p);
   operator = get_operator(p);
@@ -606,8 +937,12 @@ derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
     memset(d1, 0, sizeof(d1));
     memset(d2, 0, sizeof(d2));
 
-    if(LVM_ERROR(derive_relation(p, d1)) ||
-       LVM_ERROR(derive_relation(p, d2))) {
+    derived[0] = derive_operand(p, *operator, d1);
+    if(derived[0] < 0) {
+      return DERIVATION_ERROR;
+    }
+    derived[1] = derive_operand(p, *operator, d2);
+    if(derived[1] < 0 || (derived[0] == 0 && derived[1] == 0)) {
       return DERIVATION_ERROR;
     }
 
@@ -644,6 +979,8 @@ derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
   } else {
     variable_id = operand[1].value.id;
     value = &operand[0].value;
+    op = mirror_operator(*operator);
+    operator = &op;
   }
 
   if(variable_id >= LVM_MAX_VARIABLE_ID) {
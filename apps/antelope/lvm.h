@@ -69,6 +69,9 @@ struct lvm_instance {
   lvm_ip_t end;
   lvm_ip_t ip;
   unsigned error;
+#if DB_FEATURE_LVM_COMPILER
+  uint8_t compiled;
+#endif /* DB_FEATURE_LVM_COMPILER */
 };
 typedef struct lvm_instance lvm_instance_t;
 
@@ -130,6 +133,11 @@ void lvm_print_derivations(lvm_instance_t *p);
 lvm_status_t lvm_execute(lvm_instance_t *p);
 lvm_status_t lvm_register_variable(char *name, operand_type_t type);
 lvm_status_t lvm_set_variable_value(char *name, operand_value_t value);
+#if DB_FEATURE_LVM_COMPILER
+lvm_status_t lvm_compile(lvm_instance_t *p);
+lvm_status_t lvm_get_variable_id(char *name, variable_id_t *id);
+void lvm_set_variable_id_value(variable_id_t id, operand_value_t value);
+#endif /* DB_FEATURE_LVM_COMPILER */
 void lvm_print_code(lvm_instance_t *p);
 lvm_ip_t lvm_jump_to_operand(lvm_instance_t *p);
 lvm_ip_t lvm_shift_for_operator(lvm_instance_t *p, lvm_ip_t end);
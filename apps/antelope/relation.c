@@ -37,6 +37,7 @@
 #include <limits.h>
 #include <string.h>
 
+#include "cfs/cfs.h"
 #include "lib/crc16.h"
 #include "lib/list.h"
 #include "lib/memb.h"
@@ -64,10 +65,32 @@ struct source_dest_map {
   attribute_t *to_attr;
   unsigned from_offset;
   unsigned to_offset;
+#if DB_FEATURE_LVM_COMPILER
+  variable_id_t variable_id;
+#endif /* DB_FEATURE_LVM_COMPILER */
 };
 
 static struct source_dest_map attr_map[AQL_ATTRIBUTE_LIMIT];
 
+#if DB_FEATURE_LVM_COMPILER
+#define NO_VARIABLE	0xff
+
+/*
+ * The ranges that lvm_derive() finds for the attributes of a selection
+ * hold for every tuple that satisfies the predicate. Tuples outside of
+ * them are discarded before any LVM variable is set.
+ */
+struct row_bound {
+  unsigned offset;
+  domain_t domain;
+  long min;
+  long max;
+};
+
+static struct row_bound row_bounds[AQL_ATTRIBUTE_LIMIT];
+static uint8_t row_bound_count;
+#endif /* DB_FEATURE_LVM_COMPILER */
+
 #if DB_FEATURE_JOIN
 /*
  * The source_map structure is used for mapping attributes to
@@ -81,6 +104,77 @@ struct source_map {
 static struct source_map source_map[AQL_ATTRIBUTE_LIMIT];
 #endif /* DB_FEATURE_JOIN */
 
+#if DB_FEATURE_HASH_JOIN
+/*
+ * A hash join loads the inner relation into memory one chunk at a
+ * time, and scans the outer relation once per chunk. The tuples of a
+ * chunk are chained from hash buckets by the value of the join
+ * attribute.
+ */
+#if DB_HASH_JOIN_LIMIT > 255
+#error "DB_HASH_JOIN_LIMIT must not exceed 255."
+#endif
+
+#define HASH_JOIN_END			0xff
+#define HASH_JOIN_BUCKET(key)	((unsigned long)(key) % DB_HASH_JOIN_BUCKETS)
+
+static unsigned char hash_join_buffer[DB_HASH_JOIN_BUFFER_SIZE];
+static long hash_join_keys[DB_HASH_JOIN_LIMIT];
+static uint8_t hash_join_next[DB_HASH_JOIN_LIMIT];
+static uint8_t hash_join_buckets[DB_HASH_JOIN_BUCKETS];
+static uint8_t hash_join_match;
+static uint8_t hash_join_last_chunk;
+static long hash_join_key;
+static tuple_id_t hash_join_next_tuple;
+#endif /* DB_FEATURE_HASH_JOIN */
+
+#if DB_FEATURE_GROUP_BY
+/*
+ * A grouped selection aggregates into a hash table of groups in
+ * memory. When the table is full, the partial aggregates of tuples
+ * that belong to other groups are spilled to a file. Once the groups
+ * in memory have been returned, the spilled aggregates are read back
+ * and merged in the same way, until no aggregates are spilled.
+ */
+#if DB_GROUP_LIMIT > 255
+#error "DB_GROUP_LIMIT must not exceed 255."
+#endif
+
+#define GROUP_END			0xff
+#define GROUP_BUCKET(key)		((unsigned long)(key) % DB_GROUP_BUCKETS)
+
+#define GROUP_PHASE_SCAN		0
+#define GROUP_PHASE_EMIT		1
+#define GROUP_PHASE_MERGE		2
+#define GROUP_PHASE_DONE		3
+
+struct group {
+  long key;
+  long count;
+  long values[AQL_ATTRIBUTE_LIMIT];
+};
+
+struct group_spill {
+  char filename[DB_MAX_FILENAME_LENGTH];
+  db_storage_id_t fd;
+  tuple_id_t count;
+};
+
+static struct group groups[DB_GROUP_LIMIT];
+static uint8_t group_next[DB_GROUP_LIMIT];
+static uint8_t group_buckets[DB_GROUP_BUCKETS];
+static uint8_t group_count;
+static uint8_t group_phase;
+static uint8_t group_emitted;
+static tuple_id_t group_spill_position;
+static tuple_id_t group_spill_limit;
+static struct group_spill group_input;
+static struct group_spill group_output;
+static void *group_handle;
+#endif /* DB_FEATURE_GROUP_BY */
+
+static long aggregation_count;
+
 static unsigned char row[DB_MAX_ATTRIBUTES_PER_RELATION * DB_MAX_ELEMENT_SIZE];
 static unsigned char extra_row[DB_MAX_ATTRIBUTES_PER_RELATION * DB_MAX_ELEMENT_SIZE];
 static unsigned char result_row[AQL_ATTRIBUTE_LIMIT * DB_MAX_ELEMENT_SIZE];
@@ -547,46 +641,75 @@ relation_insert(relation_t *rel, attribute_value_t *values)
   return storage_put_row(rel, record);
 }
 
-static void
-aggregate(attribute_t *attr, attribute_value_t *value)
+static long
+initial_aggregate(uint8_t aggregator)
 {
-  long long_value;
-
-  switch(value->domain) {
-  case DOMAIN_INT:
-    long_value = VALUE_INT(value);
-    break;
-  case DOMAIN_LONG:
-    long_value = VALUE_LONG(value);
-    break;
+  switch(aggregator) {
+  case AQL_MAX:
+    return LONG_MIN;
+  case AQL_MIN:
+    return LONG_MAX;
   default:
-    return;
+    return 0;
   }
+}
 
-  switch(attr->aggregator) {
+static long
+update_aggregate(uint8_t aggregator, long aggregation_value, long value)
+{
+  switch(aggregator) {
   case AQL_COUNT:
-    attr->aggregation_value++;
-    break;
+    return aggregation_value + 1;
   case AQL_SUM:
-    attr->aggregation_value += long_value;
-    break;
   case AQL_MEAN:
-    break;
-  case AQL_MEDIAN:
-    break;
+    /* The mean is calculated from the sum when the result is
+       generated. */
+    return aggregation_value + value;
   case AQL_MAX:
-    if(long_value > attr->aggregation_value) {
-      attr->aggregation_value = long_value;
-    }
-    break;
+    return value > aggregation_value ? value : aggregation_value;
   case AQL_MIN:
-    if(long_value < attr->aggregation_value) {
-      attr->aggregation_value = long_value;
-    }
-    break;
+    return value < aggregation_value ? value : aggregation_value;
   default:
-    break;
+    return aggregation_value;
+  }
+}
+
+static long
+final_aggregate(uint8_t aggregator, long aggregation_value, long count)
+{
+  if(aggregator == AQL_MEAN) {
+    return count > 0 ? aggregation_value / count : 0;
+  }
+  return aggregation_value;
+}
+
+static long
+aggregate(uint8_t aggregator, long aggregation_value,
+          attribute_value_t *value)
+{
+  if(aggregator != AQL_COUNT &&
+     value->domain != DOMAIN_INT && value->domain != DOMAIN_LONG) {
+    return aggregation_value;
+  }
+  return update_aggregate(aggregator, aggregation_value,
+                          db_value_to_long(value));
+}
+
+static void
+store_long(unsigned char *ptr, attribute_t *attr, long value)
+{
+  attribute_value_t long_value;
+
+  /* Aggregates are stored in the space of the aggregated attribute,
+     which may be larger than the integer domain of the result. */
+  memset(ptr, 0, attr->element_size);
+  long_value.domain = attr->domain;
+  if(attr->domain == DOMAIN_LONG) {
+    VALUE_LONG(&long_value) = value;
+  } else {
+    VALUE_INT(&long_value) = value;
   }
+  db_value_to_phy(ptr, attr, &long_value);
 }
 
 static db_result_t
@@ -627,6 +750,74 @@ generate_attribute_map(struct source_dest_map *attr_map, unsigned attribute_coun
   return DB_OK;
 }
 
+static long
+row_value(domain_t domain, unsigned char *from_ptr)
+{
+  if(domain == DOMAIN_INT) {
+    return from_ptr[0] << 8 | from_ptr[1];
+  }
+  return (uint32_t)from_ptr[0] << 24 |
+         (uint32_t)from_ptr[1] << 16 |
+         (uint32_t)from_ptr[2] << 8 |
+         from_ptr[3];
+}
+
+#if DB_FEATURE_LVM_COMPILER
+static void
+prepare_row_filter(unsigned attribute_count, lvm_instance_t *lvm_instance,
+                   int use_bounds)
+{
+  struct source_dest_map *attr_map_ptr;
+  struct row_bound *bound;
+  attribute_t *attr;
+  operand_value_t min;
+  operand_value_t max;
+
+  row_bound_count = 0;
+  for(attr_map_ptr = attr_map;
+      attr_map_ptr < attr_map + attribute_count;
+      attr_map_ptr++) {
+    attr = attr_map_ptr->to_attr;
+
+    /* Resolve the LVM variable of the attribute once, rather than
+       looking it up by name for each tuple. */
+    if(lvm_instance == NULL ||
+       (attr->domain != DOMAIN_INT && attr->domain != DOMAIN_LONG) ||
+       LVM_ERROR(lvm_get_variable_id(attr->name, &attr_map_ptr->variable_id))) {
+      attr_map_ptr->variable_id = NO_VARIABLE;
+      continue;
+    }
+
+    if(use_bounds &&
+       !LVM_ERROR(lvm_get_derived_range(lvm_instance, attr->name, &min, &max)) &&
+       (min.l != LONG_MIN || max.l != LONG_MAX)) {
+      bound = &row_bounds[row_bound_count++];
+      bound->offset = attr_map_ptr->from_offset;
+      bound->domain = attr->domain;
+      bound->min = min.l;
+      bound->max = max.l;
+      PRINTF("DB: Filtering rows on %s in (%ld,%ld)\n", attr->name,
+             bound->min, bound->max);
+    }
+  }
+}
+
+static int
+row_within_bounds(unsigned char *row_ptr)
+{
+  struct row_bound *bound;
+  long value;
+
+  for(bound = row_bounds; bound < &row_bounds[row_bound_count]; bound++) {
+    value = row_value(bound->domain, row_ptr + bound->offset);
+    if(value < bound->min || value > bound->max) {
+      return 0;
+    }
+  }
+  return 1;
+}
+#endif /* DB_FEATURE_LVM_COMPILER */
+
 static void
 select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
 {
@@ -654,10 +845,13 @@ select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
              attr->name, range + 1);
 
       if(range <= min_range) {
+        min_range = range;
         index = attr->index;
+        /* Unbounded ends of the range must survive the conversion
+           to the integer value that the index API expects. */
         av_min.domain = av_max.domain = DOMAIN_INT;
-        VALUE_LONG(&av_min) = min.l;
-        VALUE_LONG(&av_max) = max.l;
+        VALUE_INT(&av_min) = min.l < INT_MIN ? INT_MIN : min.l;
+        VALUE_INT(&av_max) = max.l > INT_MAX ? INT_MAX : max.l;
       }
     }
   }
@@ -677,6 +871,9 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
   relation_t *result_rel;
   unsigned attribute_count;
   attribute_t *attr;
+#if DB_FEATURE_LVM_COMPILER
+  int derived;
+#endif /* DB_FEATURE_LVM_COMPILER */
 
   result_rel = handle->result_rel;
 
@@ -696,13 +893,29 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
     return DB_IMPLEMENTATION_ERROR;
   }
 
+#if DB_FEATURE_LVM_COMPILER
+  derived = 0;
+  if(adt->lvm_instance != NULL) {
+    lvm_compile(adt->lvm_instance);
+  }
+#endif /* DB_FEATURE_LVM_COMPILER */
+
   if(adt->lvm_instance != NULL) {
     /* Try to establish acceptable ranges for the attribute values. */
     if(!LVM_ERROR(lvm_derive(adt->lvm_instance))) {
       select_index(handle, adt->lvm_instance);
+#if DB_FEATURE_LVM_COMPILER
+      derived = 1;
+#endif /* DB_FEATURE_LVM_COMPILER */
     }
   }
 
+#if DB_FEATURE_LVM_COMPILER
+  /* The ranges are not valid for selections that invert the predicate. */
+  prepare_row_filter(attribute_count, adt->lvm_instance,
+                     derived && !(AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC));
+#endif /* DB_FEATURE_LVM_COMPILER */
+
   handle->flags |= DB_HANDLE_FLAG_PROCESSING;
 
   return DB_OK;
@@ -731,8 +944,248 @@ relation_process_remove(void *handle_ptr)
 }
 #endif
 
-db_result_t
-relation_process_select(void *handle_ptr)
+#if DB_FEATURE_GROUP_BY
+static void
+close_group_spill(struct group_spill *spill)
+{
+  if(spill->filename[0] != '\0') {
+    storage_close(spill->fd);
+    cfs_remove(spill->filename);
+    spill->filename[0] = '\0';
+  }
+  spill->count = 0;
+}
+
+static void
+clear_groups(void)
+{
+  memset(group_buckets, GROUP_END, sizeof(group_buckets));
+  group_count = 0;
+  group_emitted = 0;
+}
+
+static void
+reset_groups(void)
+{
+  close_group_spill(&group_input);
+  close_group_spill(&group_output);
+  clear_groups();
+  group_phase = GROUP_PHASE_SCAN;
+}
+
+static void
+merge_group(struct group *dst, struct group *src, unsigned attribute_count)
+{
+  uint8_t aggregator;
+  unsigned i;
+
+  dst->count += src->count;
+  for(i = 0; i < attribute_count; i++) {
+    aggregator = attr_map[i].to_attr->aggregator;
+    if(aggregator == AQL_COUNT) {
+      dst->values[i] += src->values[i];
+    } else {
+      dst->values[i] = update_aggregate(aggregator, dst->values[i],
+                                        src->values[i]);
+    }
+  }
+}
+
+static db_result_t
+spill_group(struct group *group)
+{
+  char *filename;
+  tuple_id_t reserve;
+
+  if(group_output.filename[0] == '\0') {
+    /* At most the inputs that did not fit in memory are spilled. The
+       file starts at one table of groups and grows when written past
+       its end. */
+    reserve = group_spill_limit > DB_GROUP_LIMIT ?
+      group_spill_limit - DB_GROUP_LIMIT : 1;
+    if(reserve > DB_GROUP_LIMIT) {
+      reserve = DB_GROUP_LIMIT;
+    }
+    filename = storage_generate_file("group",
+                 (unsigned long)reserve * sizeof(*group));
+    if(filename == NULL) {
+      return DB_STORAGE_ERROR;
+    }
+    memcpy(group_output.filename, filename, sizeof(group_output.filename));
+    group_output.fd = storage_open(group_output.filename);
+    if(group_output.fd < 0) {
+      cfs_remove(group_output.filename);
+      group_output.filename[0] = '\0';
+      return DB_STORAGE_ERROR;
+    }
+    group_output.count = 0;
+    PRINTF("DB: Spilling groups to %s\n", group_output.filename);
+  }
+
+  if(DB_ERROR(storage_write(group_output.fd, group,
+                            (unsigned long)group_output.count * sizeof(*group),
+                            sizeof(*group)))) {
+    return DB_STORAGE_ERROR;
+  }
+  group_output.count++;
+
+  return DB_OK;
+}
+
+static db_result_t
+add_group(struct group *group, unsigned attribute_count)
+{
+  unsigned bucket;
+  uint8_t i;
+
+  bucket = GROUP_BUCKET(group->key);
+  for(i = group_buckets[bucket]; i != GROUP_END; i = group_next[i]) {
+    if(groups[i].key == group->key) {
+      merge_group(&groups[i], group, attribute_count);
+      return DB_OK;
+    }
+  }
+
+  if(group_count == DB_GROUP_LIMIT) {
+    return spill_group(group);
+  }
+
+  memcpy(&groups[group_count], group, sizeof(*group));
+  group_next[group_count] = group_buckets[bucket];
+  group_buckets[bucket] = group_count++;
+
+  return DB_OK;
+}
+
+/* Aggregates the current row into its group. */
+static db_result_t
+group_row(unsigned attribute_count)
+{
+  struct source_dest_map *attr_map_ptr;
+  attribute_t *result_attr;
+  attribute_value_t value;
+  struct group group;
+  unsigned i;
+
+  group.count = 1;
+  for(i = 0; i < attribute_count; i++) {
+    attr_map_ptr = &attr_map[i];
+    result_attr = attr_map_ptr->to_attr;
+    if(DB_ERROR(db_phy_to_value(&value, attr_map_ptr->from_attr,
+                                row + attr_map_ptr->from_offset))) {
+      return DB_TYPE_ERROR;
+    }
+
+    if(result_attr->flags & ATTRIBUTE_FLAG_GROUP) {
+      group.key = db_value_to_long(&value);
+    }
+    group.values[i] = aggregate(result_attr->aggregator,
+                                initial_aggregate(result_attr->aggregator),
+                                &value);
+  }
+
+  return add_group(&group, attribute_count);
+}
+
+static db_result_t
+emit_group(db_handle_t *handle, struct group *group)
+{
+  struct source_dest_map *attr_map_ptr;
+  attribute_t *result_attr;
+  unsigned char *to_ptr;
+  unsigned i;
+
+  for(i = 0; i < handle->result_rel->attribute_count; i++) {
+    attr_map_ptr = &attr_map[i];
+    result_attr = attr_map_ptr->to_attr;
+    to_ptr = result_row + attr_map_ptr->to_offset;
+
+    if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
+      continue;
+    }
+
+    if(result_attr->flags & ATTRIBUTE_FLAG_GROUP) {
+      store_long(to_ptr, result_attr, group->key);
+    } else {
+      store_long(to_ptr, result_attr,
+                      final_aggregate(result_attr->aggregator,
+                                      group->values[i], group->count));
+    }
+  }
+
+  if(AQL_GET_FLAGS((aql_adt_t *)handle->adt) & AQL_FLAG_ASSIGN) {
+    if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
+      PRINTF("DB: Failed to store a row in the result relation!\n");
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  handle->current_row++;
+  return DB_GOT_ROW;
+}
+
+/* Returns the groups after the relation has been scanned. */
+static db_result_t
+process_groups(db_handle_t *handle)
+{
+  struct group group;
+  unsigned attribute_count;
+
+  attribute_count = handle->result_rel->attribute_count;
+
+  if(group_phase == GROUP_PHASE_MERGE) {
+    if(group_spill_position < group_input.count) {
+      if(DB_ERROR(storage_read(group_input.fd, &group,
+                               (unsigned long)group_spill_position * sizeof(group),
+                               sizeof(group)))) {
+        return DB_STORAGE_ERROR;
+      }
+      group_spill_position++;
+      return add_group(&group, attribute_count);
+    }
+    group_phase = GROUP_PHASE_EMIT;
+  }
+
+  if(group_phase == GROUP_PHASE_EMIT) {
+    if(group_emitted < group_count) {
+      return emit_group(handle, &groups[group_emitted++]);
+    }
+
+    if(group_output.count == 0) {
+      reset_groups();
+      group_phase = GROUP_PHASE_DONE;
+      return DB_FINISHED;
+    }
+
+    /* Aggregate the spilled groups in another pass. */
+    PRINTF("DB: Merging %u spilled groups\n", (unsigned)group_output.count);
+    close_group_spill(&group_input);
+    memcpy(&group_input, &group_output, sizeof(group_input));
+    group_output.filename[0] = '\0';
+    group_output.count = 0;
+    group_spill_position = 0;
+    group_spill_limit = group_input.count;
+    clear_groups();
+    group_phase = GROUP_PHASE_MERGE;
+    return DB_OK;
+  }
+
+  return DB_FINISHED;
+}
+
+/* Removes the spill files of a grouped selection that is abandoned. */
+void
+relation_release_groups(void *handle_ptr)
+{
+  if(group_handle == handle_ptr) {
+    reset_groups();
+    group_handle = NULL;
+  }
+}
+#endif /* DB_FEATURE_GROUP_BY */
+
+static db_result_t
+select_row(void *handle_ptr)
 {
   db_handle_t *handle;
   aql_adt_t *adt;
@@ -743,7 +1196,6 @@ relation_process_select(void *handle_ptr)
   unsigned char *from_ptr;
   unsigned char *to_ptr;
   operand_value_t operand_value;
-  uint8_t intbuf[2];
   attribute_value_t value;
   lvm_status_t wanted_result;
 
@@ -753,6 +1205,12 @@ relation_process_select(void *handle_ptr)
   attribute_count = handle->result_rel->attribute_count;
   attr_map_end = attr_map + attribute_count;
 
+#if DB_FEATURE_GROUP_BY
+  if(group_phase != GROUP_PHASE_SCAN) {
+    return process_groups(handle);
+  }
+#endif /* DB_FEATURE_GROUP_BY */
+
   if(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) {
     handle->tuple_id = index_get_next(&handle->index_iterator);
     if(handle->tuple_id == INVALID_TUPLE) {
@@ -783,22 +1241,30 @@ relation_process_select(void *handle_ptr)
     return DB_FINISHED;
   }
 
+#if DB_FEATURE_LVM_COMPILER
+  if(!row_within_bounds(row)) {
+    return DB_OK;
+  }
+#endif /* DB_FEATURE_LVM_COMPILER */
+
   /* Process the attributes in the result relation. */
   for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
     from_ptr = row + attr_map_ptr->from_offset;
     result_attr = attr_map_ptr->to_attr;
 
     /* Update the internal state of the PLE. */
-    if(result_attr->domain == DOMAIN_INT) {
-      operand_value.l = from_ptr[0] << 8 | from_ptr[1];
-      lvm_set_variable_value(result_attr->name, operand_value);
-    } else if(result_attr->domain == DOMAIN_LONG) {
-      operand_value.l = (uint32_t)from_ptr[0] << 24 |
-                        (uint32_t)from_ptr[1] << 16 |
-                        (uint32_t)from_ptr[2] << 8 |
-                        from_ptr[3];
+#if DB_FEATURE_LVM_COMPILER
+    if(attr_map_ptr->variable_id != NO_VARIABLE) {
+      operand_value.l = row_value(result_attr->domain, from_ptr);
+      lvm_set_variable_id_value(attr_map_ptr->variable_id, operand_value);
+    }
+#else /* DB_FEATURE_LVM_COMPILER */
+    if(result_attr->domain == DOMAIN_INT ||
+       result_attr->domain == DOMAIN_LONG) {
+      operand_value.l = row_value(result_attr->domain, from_ptr);
       lvm_set_variable_value(result_attr->name, operand_value);
     }
+#endif /* DB_FEATURE_LVM_COMPILER */
 
     if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
       /* The attribute is used just for the predicate,
@@ -821,14 +1287,23 @@ relation_process_select(void *handle_ptr)
   /* Check whether the given predicate is true for this tuple. */
   if(adt->lvm_instance == NULL ||
      lvm_execute(adt->lvm_instance) == wanted_result) {
+#if DB_FEATURE_GROUP_BY
+    if(AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP) {
+      return group_row(attribute_count);
+    }
+#endif /* DB_FEATURE_GROUP_BY */
     if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
+      aggregation_count++;
       for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
         from_ptr = row + attr_map_ptr->from_offset;
-        result = db_phy_to_value(&value, attr_map_ptr->to_attr, from_ptr);
+        result = db_phy_to_value(&value, attr_map_ptr->from_attr, from_ptr);
         if(DB_ERROR(result)) {
 	  return result;
         }
-        aggregate(attr_map_ptr->to_attr, &value);
+        result_attr = attr_map_ptr->to_attr;
+        result_attr->aggregation_value = aggregate(result_attr->aggregator,
+                                                   result_attr->aggregation_value,
+                                                   &value);
       }
     } else {
       if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
@@ -845,15 +1320,22 @@ relation_process_select(void *handle_ptr)
   return DB_OK;
 
 end_aggregation:
+#if DB_FEATURE_GROUP_BY
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP) {
+    group_phase = GROUP_PHASE_EMIT;
+    return process_groups(handle);
+  }
+#endif /* DB_FEATURE_GROUP_BY */
+
   /* Generate aggregated result if requested. */
   for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
     result_attr = attr_map_ptr->to_attr;
     to_ptr = result_row + attr_map_ptr->to_offset;
 
-    intbuf[0] = result_attr->aggregation_value >> 8;
-    intbuf[1] = result_attr->aggregation_value & 0xff;
-    from_ptr = intbuf;
-    memcpy(to_ptr, from_ptr, result_attr->element_size);
+    store_long(to_ptr, result_attr,
+                    final_aggregate(result_attr->aggregator,
+                                    result_attr->aggregation_value,
+                                    aggregation_count));
   }
 
   if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
@@ -869,6 +1351,21 @@ end_aggregation:
   return DB_GOT_ROW;
 }
 
+db_result_t
+relation_process_select(void *handle_ptr)
+{
+  db_result_t result;
+  unsigned scanned;
+
+  /* Scan a batch of tuples while none of them is part of the result. */
+  scanned = 0;
+  do {
+    result = select_row(handle_ptr);
+  } while(result == DB_OK && ++scanned < DB_SELECT_BATCH_SIZE);
+
+  return result;
+}
+
 db_result_t
 relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
 {
@@ -880,6 +1377,7 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
   attribute_t *attr;
   int i;
   int normal_attributes;
+  int aggregated_attributes;
 
   adt = (aql_adt_t *)adt_ptr;
 
@@ -903,7 +1401,8 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     return DB_ALLOCATION_ERROR;
   }
 
-  for(i = normal_attributes = 0; i < AQL_ATTRIBUTE_COUNT(adt); i++) {
+  normal_attributes = aggregated_attributes = 0;
+  for(i = 0; i < AQL_ATTRIBUTE_COUNT(adt); i++) {
     attribute_name = adt->attributes[i].name;
 
     attr = relation_attribute_get(rel, attribute_name);
@@ -918,7 +1417,8 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
 
     attr = relation_attribute_add(handle->result_rel, dir,
 				  attribute_name, 
-				  adt->aggregators[i] ? DOMAIN_INT : attr->domain,
+				  adt->aggregators[i] && attr->domain != DOMAIN_LONG ?
+				    DOMAIN_INT : attr->domain,
 				  attr->element_size);
     if(attr == NULL) {
       PRINTF("DB: Failed to add a result attribute\n");
@@ -927,31 +1427,38 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     }
 
     attr->aggregator = adt->aggregators[i];
-    switch(attr->aggregator) {
-    case AQL_NONE:
-      if(!(adt->attributes[i].flags & ATTRIBUTE_FLAG_NO_STORE)) {
-        /* Only count attributes projected into the result set. */
-        normal_attributes++;
-      }
-      break;
-    case AQL_MAX:
-      attr->aggregation_value = LONG_MIN;
-      break;
-    case AQL_MIN:
-      attr->aggregation_value = LONG_MAX;
-      break;
-    default:
-      attr->aggregation_value = 0;
-      break;
+    attr->aggregation_value = initial_aggregate(attr->aggregator);
+    if(attr->aggregator == AQL_NONE &&
+       !(adt->attributes[i].flags &
+         (ATTRIBUTE_FLAG_NO_STORE | ATTRIBUTE_FLAG_GROUP))) {
+      /* Only count attributes projected into the result set. The
+         attribute to group by is projected along with the aggregates. */
+      normal_attributes++;
+    } else if(attr->aggregator != AQL_NONE) {
+      aggregated_attributes++;
     }
 
     attr->flags = adt->attributes[i].flags;
+#if DB_FEATURE_GROUP_BY
+    if((attr->flags & ATTRIBUTE_FLAG_GROUP) &&
+       attr->domain != DOMAIN_INT && attr->domain != DOMAIN_LONG) {
+      PRINTF("DB: Cannot group by attribute %s\n", attr->name);
+      relation_release(handle->result_rel);
+      return DB_TYPE_ERROR;
+    }
+#endif /* DB_FEATURE_GROUP_BY */
   }
+  aggregation_count = 0;
+#if DB_FEATURE_GROUP_BY
+  reset_groups();
+  group_spill_limit = relation_cardinality(rel);
+  group_handle = handle;
+#endif /* DB_FEATURE_GROUP_BY */
 
   /* Preclude mixes of normal attributes and aggregated ones in 
-     selection results. */
-  if(normal_attributes > 0 &&
-     handle->result_rel->attribute_count > normal_attributes) {
+     selection results. Attributes used only in the predicate are
+     neither. */
+  if(normal_attributes > 0 && aggregated_attributes > 0) {
      return DB_RELATIONAL_ERROR;
   }
 
@@ -959,48 +1466,219 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
 }
 
 #if DB_FEATURE_JOIN
+static db_result_t
+emit_join_row(db_handle_t *handle)
+{
+  relation_t *join_rel;
+  unsigned char *join_next_attribute_ptr;
+  size_t element_size;
+  int i;
+
+  join_rel = handle->join_rel;
+
+  /* Use the source attribute map to fill in the physical representation
+     of the resulting tuple. */
+  join_next_attribute_ptr = join_row;
+
+  for(i = 0; i < join_rel->attribute_count; i++) {
+    element_size = source_map[i].attr->element_size;
+
+    memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
+    join_next_attribute_ptr += element_size;
+  }
+
+  if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
+    if(DB_ERROR(storage_put_row(join_rel, join_row))) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  handle->current_row++;
+  return DB_GOT_ROW;
+}
+
+#if DB_FEATURE_HASH_JOIN
+static tuple_id_t
+hash_join_capacity(relation_t *rel)
+{
+  tuple_id_t capacity;
+
+  if(rel->row_length == 0) {
+    return 0;
+  }
+
+  capacity = DB_HASH_JOIN_BUFFER_SIZE / rel->row_length;
+  return capacity < DB_HASH_JOIN_LIMIT ? capacity : DB_HASH_JOIN_LIMIT;
+}
+
+static db_result_t
+load_hash_join_chunk(relation_t *rel, attribute_t *attr, tuple_id_t *count)
+{
+  db_result_t result;
+  attribute_value_t value;
+  unsigned char *tuple;
+  tuple_id_t capacity;
+  unsigned bucket;
+  uint8_t i;
+
+  memset(hash_join_buckets, HASH_JOIN_END, sizeof(hash_join_buckets));
+  capacity = hash_join_capacity(rel);
+
+  for(i = 0; i < capacity; i++) {
+    tuple = &hash_join_buffer[i * rel->row_length];
+    result = storage_get_row(rel, &hash_join_next_tuple, tuple);
+    if(DB_ERROR(result)) {
+      PRINTF("DB: Failed to get a row in relation %s!\n", rel->name);
+      return result;
+    } else if(result == DB_FINISHED) {
+      hash_join_last_chunk = 1;
+      break;
+    }
+    hash_join_next_tuple++;
+
+    if(DB_ERROR(relation_get_value(rel, attr, tuple, &value))) {
+      return DB_IMPLEMENTATION_ERROR;
+    }
+    hash_join_keys[i] = db_value_to_long(&value);
+
+    bucket = HASH_JOIN_BUCKET(hash_join_keys[i]);
+    hash_join_next[i] = hash_join_buckets[bucket];
+    hash_join_buckets[bucket] = i;
+  }
+
+  PRINTF("DB: Loaded %u tuples of relation %s for a hash join\n",
+         (unsigned)i, rel->name);
+
+  *count = i;
+  return DB_OK;
+}
+
+static db_result_t
+process_hash_join(db_handle_t *handle,
+                  relation_t *outer_rel, attribute_t *outer_attr,
+                  unsigned char *outer_row,
+                  relation_t *inner_rel, attribute_t *inner_attr,
+                  unsigned char *inner_row)
+{
+  db_result_t result;
+  attribute_value_t value;
+  tuple_id_t count;
+  uint8_t i;
+
+  for(;;) {
+    if(handle->flags & DB_HANDLE_FLAG_INDEX_STEP) {
+      /* Each scan of the outer relation starts with a new chunk of
+         the inner relation. */
+      if(handle->tuple_id == 0) {
+        if(hash_join_last_chunk) {
+          return DB_FINISHED;
+        }
+        result = load_hash_join_chunk(inner_rel, inner_attr, &count);
+        if(DB_ERROR(result)) {
+          return result;
+        } else if(count == 0) {
+          return DB_FINISHED;
+        }
+      }
+
+      result = storage_get_row(outer_rel, &handle->tuple_id, outer_row);
+      if(DB_ERROR(result)) {
+        PRINTF("DB: Failed to get a row in relation %s!\n", outer_rel->name);
+        return result;
+      } else if(result == DB_FINISHED) {
+        handle->tuple_id = 0;
+        continue;
+      }
+      handle->tuple_id++;
+
+      if(DB_ERROR(relation_get_value(outer_rel, outer_attr, outer_row, &value))) {
+        PRINTF("DB: Failed to get a value of the attribute \"%s\" to join on\n",
+               outer_attr->name);
+        return DB_IMPLEMENTATION_ERROR;
+      }
+      hash_join_key = db_value_to_long(&value);
+      hash_join_match = hash_join_buckets[HASH_JOIN_BUCKET(hash_join_key)];
+      handle->flags &= ~DB_HANDLE_FLAG_INDEX_STEP;
+    }
+
+    while(hash_join_match != HASH_JOIN_END) {
+      i = hash_join_match;
+      hash_join_match = hash_join_next[i];
+      if(hash_join_keys[i] == hash_join_key) {
+        memcpy(inner_row, &hash_join_buffer[i * inner_rel->row_length],
+               inner_rel->row_length);
+        return emit_join_row(handle);
+      }
+    }
+
+    handle->flags |= DB_HANDLE_FLAG_INDEX_STEP;
+  }
+}
+#endif /* DB_FEATURE_HASH_JOIN */
+
 db_result_t
 relation_process_join(void *handle_ptr)
 {
   db_handle_t *handle;
   db_result_t result;
-  relation_t *left_rel;
-  relation_t *right_rel;
-  relation_t *join_rel;
-  unsigned char *join_next_attribute_ptr;
-  size_t element_size;
-  tuple_id_t right_tuple_id;
+  relation_t *outer_rel;
+  relation_t *inner_rel;
+  attribute_t *outer_attr;
+  attribute_t *inner_attr;
+  unsigned char *outer_row;
+  unsigned char *inner_row;
+  tuple_id_t inner_tuple_id;
   attribute_value_t value;
-  int i;
 
   handle = (db_handle_t *)handle_ptr;
-  left_rel = handle->left_rel;
-  right_rel = handle->right_rel;
-  join_rel = handle->join_rel;
+
+  /* The planner may have chosen the left relation as the inner one. */
+  if(handle->flags & DB_HANDLE_FLAG_JOIN_SWAPPED) {
+    outer_rel = handle->right_rel;
+    outer_attr = handle->right_join_attr;
+    outer_row = right_row;
+    inner_rel = handle->left_rel;
+    inner_attr = handle->left_join_attr;
+    inner_row = left_row;
+  } else {
+    outer_rel = handle->left_rel;
+    outer_attr = handle->left_join_attr;
+    outer_row = left_row;
+    inner_rel = handle->right_rel;
+    inner_attr = handle->right_join_attr;
+    inner_row = right_row;
+  }
+
+#if DB_FEATURE_HASH_JOIN
+  if(handle->flags & DB_HANDLE_FLAG_HASH_JOIN) {
+    return process_hash_join(handle, outer_rel, outer_attr, outer_row,
+                             inner_rel, inner_attr, inner_row);
+  }
+#endif /* DB_FEATURE_HASH_JOIN */
 
   if(!(handle->flags & DB_HANDLE_FLAG_INDEX_STEP)) {
     goto inner_loop;
   }
 
   /* Equi-join for indexed attributes only. In the outer loop, we iterate over
-     each tuple in the left relation. */
+     each tuple in the outer relation. */
   for(handle->tuple_id = 0;; handle->tuple_id++) {
-    result = storage_get_row(left_rel, &handle->tuple_id, left_row);
+    result = storage_get_row(outer_rel, &handle->tuple_id, outer_row);
     if(DB_ERROR(result)) {
-      PRINTF("DB: Failed to get a row in left relation %s!\n", left_rel->name);
+      PRINTF("DB: Failed to get a row in outer relation %s!\n", outer_rel->name);
       return result;
     } else if(result == DB_FINISHED) {
       return DB_FINISHED;
     }
 
-    if(DB_ERROR(relation_get_value(left_rel, handle->left_join_attr, left_row, &value))) {
+    if(DB_ERROR(relation_get_value(outer_rel, outer_attr, outer_row, &value))) {
       PRINTF("DB: Failed to get a value of the attribute \"%s\" to join on\n",
-	handle->left_join_attr->name);
+	outer_attr->name);
       return DB_IMPLEMENTATION_ERROR;
     }
 
     if(DB_ERROR(index_get_iterator(&handle->index_iterator, 
-                                   handle->right_join_attr->index, 
+                                   inner_attr->index, 
                                    &value, &value))) { 
       PRINTF("DB: Failed to get an index iterator\n");
       return DB_INDEX_ERROR;
@@ -1011,44 +1689,26 @@ relation_process_join(void *handle_ptr)
        join attribute. The index component provides an iterator for this purpose. */
 inner_loop:
     for(;;) {
-      /* Get all rows matching the attribute value in the right relation. */
-      right_tuple_id = index_get_next(&handle->index_iterator);
-      if(right_tuple_id == INVALID_TUPLE) {
-        /* Exclude this row from the left relation in the result,
+      /* Get all rows matching the attribute value in the inner relation. */
+      inner_tuple_id = index_get_next(&handle->index_iterator);
+      if(inner_tuple_id == INVALID_TUPLE) {
+        /* Exclude this row from the outer relation in the result,
            and step to the next value in the index iteration. */
         handle->flags |= DB_HANDLE_FLAG_INDEX_STEP;
         break;
       }
 
-      result = storage_get_row(right_rel, &right_tuple_id, right_row);
+      result = storage_get_row(inner_rel, &inner_tuple_id, inner_row);
       if(DB_ERROR(result)) {
-        PRINTF("DB: Failed to get a row in right relation %s!\n", right_rel->name);
+        PRINTF("DB: Failed to get a row in inner relation %s!\n", inner_rel->name);
         return result;
       } else if(result == DB_FINISHED) {
 	PRINTF("DB: The index refers to an invalid row: %lu\n",
-	       (unsigned long)right_tuple_id);
+	       (unsigned long)inner_tuple_id);
         return DB_IMPLEMENTATION_ERROR;
       }
 
-      /* Use the source attribute map to fill in the physical representation
-	 of the resulting tuple. */
-      join_next_attribute_ptr = join_row;
-
-      for(i = 0; i < join_rel->attribute_count; i++) {
-	element_size = source_map[i].attr->element_size;
-
-	memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
-	join_next_attribute_ptr += element_size;
-      }
-
-      if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
-        if(DB_ERROR(storage_put_row(join_rel, join_row))) {
-          return DB_STORAGE_ERROR;
-        }
-      }
-
-      handle->current_row++;
-      return DB_GOT_ROW;
+      return emit_join_row(handle);
     }
   }
 
@@ -1107,6 +1767,121 @@ generate_join_result(db_handle_t *handle)
   return DB_OK;
 }
 
+static unsigned long
+scale_cost(tuple_id_t tuples, unsigned long factor)
+{
+  if(factor != 0 && tuples > ULONG_MAX / factor) {
+    return ULONG_MAX;
+  }
+  return (unsigned long)tuples * factor;
+}
+
+#if DB_FEATURE_HASH_JOIN
+static int
+hash_join_cost(relation_t *inner_rel, tuple_id_t inner_cardinality,
+               tuple_id_t outer_cardinality, unsigned long *cost)
+{
+  tuple_id_t capacity;
+  unsigned long chunks;
+
+  capacity = hash_join_capacity(inner_rel);
+  if(capacity == 0) {
+    return 0;
+  }
+
+  chunks = inner_cardinality / capacity;
+  if(chunks == 0 || inner_cardinality % capacity != 0) {
+    chunks++;
+  }
+  *cost = scale_cost(outer_cardinality, chunks);
+  if(*cost < ULONG_MAX - inner_cardinality) {
+    *cost += inner_cardinality;
+  }
+  return 1;
+}
+#endif /* DB_FEATURE_HASH_JOIN */
+
+/*
+ * Chooses the join method with the lowest estimated cost, counted in
+ * tuples read. An index nested-loop join reads the outer relation once
+ * and looks up each of its values in the index of the inner relation;
+ * a lookup is assumed to cost as much as reading DB_INDEX_COST tuples.
+ * A hash join reads the inner relation once, in chunks that fit in
+ * memory, and reads the outer relation once per chunk. Hash join keys
+ * are integers, so other attributes can only be joined through an index.
+ */
+static db_result_t
+plan_join(db_handle_t *handle)
+{
+  tuple_id_t left_cardinality;
+  tuple_id_t right_cardinality;
+  unsigned long cost;
+  unsigned long best_cost;
+  uint8_t best_flags;
+  int found;
+
+  left_cardinality = relation_cardinality(handle->left_rel);
+  right_cardinality = relation_cardinality(handle->right_rel);
+  if(left_cardinality == INVALID_TUPLE || right_cardinality == INVALID_TUPLE) {
+    return DB_STORAGE_ERROR;
+  }
+
+  found = 0;
+  best_cost = ULONG_MAX;
+  best_flags = 0;
+
+  if(index_exists(handle->right_join_attr)) {
+    best_cost = scale_cost(left_cardinality, DB_INDEX_COST);
+    found = 1;
+  }
+
+  if(index_exists(handle->left_join_attr)) {
+    cost = scale_cost(right_cardinality, DB_INDEX_COST);
+    if(!found || cost < best_cost) {
+      best_cost = cost;
+      best_flags = DB_HANDLE_FLAG_JOIN_SWAPPED;
+      found = 1;
+    }
+  }
+
+#if DB_FEATURE_HASH_JOIN
+  if((handle->left_join_attr->domain == DOMAIN_INT ||
+      handle->left_join_attr->domain == DOMAIN_LONG) &&
+     (handle->right_join_attr->domain == DOMAIN_INT ||
+      handle->right_join_attr->domain == DOMAIN_LONG)) {
+    if(hash_join_cost(handle->right_rel, right_cardinality,
+                      left_cardinality, &cost) &&
+       (!found || cost < best_cost)) {
+      best_cost = cost;
+      best_flags = DB_HANDLE_FLAG_HASH_JOIN;
+      found = 1;
+    }
+
+    if(hash_join_cost(handle->left_rel, left_cardinality,
+                      right_cardinality, &cost) &&
+       (!found || cost < best_cost)) {
+      best_cost = cost;
+      best_flags = DB_HANDLE_FLAG_HASH_JOIN | DB_HANDLE_FLAG_JOIN_SWAPPED;
+      found = 1;
+    }
+  }
+#endif /* DB_FEATURE_HASH_JOIN */
+
+  if(!found) {
+    PRINTF("DB: The attribute to join on is not indexed\n");
+    return DB_INDEX_ERROR;
+  }
+
+  PRINTF("DB: Joining with %s as the inner relation using %s (cost %lu)\n",
+         best_flags & DB_HANDLE_FLAG_JOIN_SWAPPED ?
+         handle->left_rel->name : handle->right_rel->name,
+         best_flags & DB_HANDLE_FLAG_HASH_JOIN ? "a hash join" : "an index",
+         best_cost);
+
+  handle->flags |= best_flags;
+  return DB_OK;
+}
+
 db_result_t
 relation_join(void *query_result, void *adt_ptr)
 {
@@ -1120,6 +1895,7 @@ relation_join(void *query_result, void *adt_ptr)
   int i;
   char *attribute_name;
   attribute_t *attr;
+  db_result_t result;
 
   adt = (aql_adt_t *)adt_ptr;
 
@@ -1136,17 +1912,6 @@ relation_join(void *query_result, void *adt_ptr)
     name = RESULT_RELATION;
     dir = DB_MEMORY;
   }
-  relation_remove(name, 1);
-  relation_create(name, dir);
-  join_rel = relation_load(name);
-  handle->result_rel = join_rel;
-
-  if(join_rel == NULL) {
-    PRINTF("DB: Failed to create a join relation!\n");
-    return DB_ALLOCATION_ERROR;
-  }
-
-  handle->join_rel = handle->result_rel = join_rel;
   left_rel = handle->left_rel;
   right_rel = handle->right_rel;
 
@@ -1158,11 +1923,29 @@ relation_join(void *query_result, void *adt_ptr)
     return DB_RELATIONAL_ERROR;
   }
 
-  if(!index_exists(handle->right_join_attr)) {
-    PRINTF("DB: The attribute to join on is not indexed\n");
-    return DB_INDEX_ERROR;
+  /* Plan the join before replacing any existing result relation. */
+  result = plan_join(handle);
+  if(DB_ERROR(result)) {
+    return result;
   }
 
+  relation_remove(name, 1);
+  relation_create(name, dir);
+  join_rel = relation_load(name);
+  handle->result_rel = join_rel;
+
+  if(join_rel == NULL) {
+    PRINTF("DB: Failed to create a join relation!\n");
+    return DB_ALLOCATION_ERROR;
+  }
+
+  handle->join_rel = handle->result_rel = join_rel;
+
+#if DB_FEATURE_HASH_JOIN
+  hash_join_next_tuple = 0;
+  hash_join_last_chunk = 0;
+#endif /* DB_FEATURE_HASH_JOIN */
+
   /*
    * Define the resulting relation. We start from 1 when counting attributes
    * because the first attribute is only the one to join, and is not included
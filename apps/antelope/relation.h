@@ -97,6 +97,9 @@ db_result_t relation_remove(char *, int);
 db_result_t relation_insert(relation_t *, attribute_value_t *);
 db_result_t relation_select(void *, relation_t *, void *);
 db_result_t relation_join(void *, void *);
+#if DB_FEATURE_GROUP_BY
+void relation_release_groups(void *);
+#endif /* DB_FEATURE_GROUP_BY */
 tuple_id_t relation_cardinality(relation_t *);
 
 #endif /* RELATION_H */
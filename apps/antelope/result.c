@@ -178,6 +178,9 @@ db_free(db_handle_t *handle)
   if(handle->right_rel != NULL) {
     relation_release(handle->right_rel);
   }
+#if DB_FEATURE_GROUP_BY
+  relation_release_groups(handle);
+#endif /* DB_FEATURE_GROUP_BY */
 
   handle->flags = 0;
 
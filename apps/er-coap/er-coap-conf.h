@@ -43,6 +43,16 @@
 #define COAP_LINK_FORMAT_FILTERING     0
 #define COAP_PROXY_OPTION_PROCESSING   0
 
+/* Only record where the path and query options are when parsing, and decode them when first read */
+#ifndef COAP_LAZY_OPTIONS
+#define COAP_LAZY_OPTIONS              0
+#endif /* COAP_LAZY_OPTIONS */
+
+/* Serialize responses with only Content-Format, Observe, Max-Age, ETag, Block2 and Size2 options directly */
+#ifndef COAP_SERIALIZE_FAST_PATH
+#define COAP_SERIALIZE_FAST_PATH       0
+#endif /* COAP_SERIALIZE_FAST_PATH */
+
 /* Listening port for the CoAP REST Engine */
 #ifndef COAP_SERVER_PORT
 #define COAP_SERVER_PORT               COAP_DEFAULT_PORT
@@ -65,10 +75,60 @@
 
 /* Number of observer slots (each takes abot xxx bytes) */
 #ifndef COAP_MAX_OBSERVERS
-#define COAP_MAX_OBSERVERS    COAP_MAX_OPEN_TRANSACTIONS - 1
+#define COAP_MAX_OBSERVERS    (COAP_MAX_OPEN_TRANSACTIONS - 1)
 #endif /* COAP_MAX_OBSERVERS */
 
+/* Fairness caps on the slots a single client (address and port) may hold, 0 for no cap */
+#ifndef COAP_MAX_TRANSACTIONS_PER_CLIENT
+#define COAP_MAX_TRANSACTIONS_PER_CLIENT 0
+#endif /* COAP_MAX_TRANSACTIONS_PER_CLIENT */
+
+#ifndef COAP_MAX_OBSERVERS_PER_CLIENT
+#define COAP_MAX_OBSERVERS_PER_CLIENT  0
+#endif /* COAP_MAX_OBSERVERS_PER_CLIENT */
+
+/* Hash transactions by MID and client, and observers by client, instead of walking lists */
+#ifndef COAP_TABLE_INDEX
+#define COAP_TABLE_INDEX               0
+#endif /* COAP_TABLE_INDEX */
+
+/* Number of hash buckets of the transaction and observer indices, at least one */
+#ifndef COAP_TRANSACTION_BUCKETS
+#if COAP_MAX_OPEN_TRANSACTIONS > 1
+#define COAP_TRANSACTION_BUCKETS       COAP_MAX_OPEN_TRANSACTIONS
+#else
+#define COAP_TRANSACTION_BUCKETS       1
+#endif
+#endif /* COAP_TRANSACTION_BUCKETS */
+
+#ifndef COAP_OBSERVER_BUCKETS
+#if COAP_MAX_OBSERVERS > 1
+#define COAP_OBSERVER_BUCKETS          COAP_MAX_OBSERVERS
+#else
+#define COAP_OBSERVER_BUCKETS          1
+#endif
+#endif /* COAP_OBSERVER_BUCKETS */
+
+#if COAP_TRANSACTION_BUCKETS < 1 || COAP_OBSERVER_BUCKETS < 1
+#error "COAP_TRANSACTION_BUCKETS and COAP_OBSERVER_BUCKETS must be at least 1"
+#endif
+
+/* Count transactions and observers that were refused for lack of slots */
+#ifndef COAP_STATS
+#define COAP_STATS                     0
+#endif /* COAP_STATS */
+
 /* Interval in notifies in which NON notifies are changed to CON notifies to check client. */
 #define COAP_OBSERVE_REFRESH_INTERVAL  20
 
+/* Run the GET handler and serialize a notification once for all observers of a change */
+#ifndef COAP_OBSERVE_BATCH
+#define COAP_OBSERVE_BATCH             0
+#endif /* COAP_OBSERVE_BATCH */
+
+/* Minimum clock ticks between two notifications sent, 0 to send them at once */
+#ifndef COAP_OBSERVE_PACING_INTERVAL
+#define COAP_OBSERVE_PACING_INTERVAL   0
+#endif /* COAP_OBSERVE_PACING_INTERVAL */
+
 #endif /* ER_COAP_CONF_H_ */
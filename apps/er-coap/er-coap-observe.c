@@ -55,17 +55,79 @@
 /*---------------------------------------------------------------------------*/
 MEMB(observers_memb, coap_observer_t, COAP_MAX_OBSERVERS);
 LIST(observers_list);
+#if COAP_OBSERVE_BATCH
+/* Notification serialized without Token and Observe option */
+static uint8_t template[COAP_MAX_PACKET_SIZE + 1];
+static size_t template_len;
+#endif /* COAP_OBSERVE_BATCH */
+#if COAP_TABLE_INDEX
+static coap_observer_t *observers_by_client[COAP_OBSERVER_BUCKETS];
+#endif /* COAP_TABLE_INDEX */
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
+/*
+ * Iterate over the observers that may belong to a client. With the index,
+ * these are the observers in the bucket of the client; otherwise all.
+ */
+static coap_observer_t *
+first_of_client(uip_ipaddr_t *addr, uint16_t port)
+{
+#if COAP_TABLE_INDEX
+  return observers_by_client[coap_client_hash(addr, port)
+                             % COAP_OBSERVER_BUCKETS];
+#else /* COAP_TABLE_INDEX */
+  return (coap_observer_t *)list_head(observers_list);
+#endif /* COAP_TABLE_INDEX */
+}
+/*---------------------------------------------------------------------------*/
+static coap_observer_t *
+next_of_client(coap_observer_t *o)
+{
+#if COAP_TABLE_INDEX
+  return o->client_next;
+#else /* COAP_TABLE_INDEX */
+  return o->next;
+#endif /* COAP_TABLE_INDEX */
+}
+/*---------------------------------------------------------------------------*/
+#if COAP_MAX_OBSERVERS_PER_CLIENT
+static int
+client_observers(uip_ipaddr_t *addr, uint16_t port)
+{
+  coap_observer_t *obs;
+  int count = 0;
+
+  for(obs = first_of_client(addr, port); obs; obs = next_of_client(obs)) {
+    if(uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port) {
+      count++;
+    }
+  }
+  return count;
+}
+#endif /* COAP_MAX_OBSERVERS_PER_CLIENT */
+/*---------------------------------------------------------------------------*/
 static coap_observer_t *
 add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
              size_t token_len, const char *uri, int uri_len)
 {
+  coap_observer_t *o;
+#if COAP_TABLE_INDEX
+  coap_observer_t **bucket;
+#endif /* COAP_TABLE_INDEX */
+
   /* Remove existing observe relationship, if any. */
   coap_remove_observer_by_uri(addr, port, uri);
 
-  coap_observer_t *o = memb_alloc(&observers_memb);
+#if COAP_MAX_OBSERVERS_PER_CLIENT
+  if(client_observers(addr, port) >= COAP_MAX_OBSERVERS_PER_CLIENT) {
+    PRINTF("Observer limit reached for client\n");
+    COAP_STAT(coap_stats.observers_client_cap++);
+    return NULL;
+  }
+#endif /* COAP_MAX_OBSERVERS_PER_CLIENT */
+
+  o = memb_alloc(&observers_memb);
 
   if(o) {
     int max = sizeof(o->url) - 1;
@@ -79,24 +141,55 @@ add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
     o->token_len = token_len;
     memcpy(o->token, token, token_len);
     o->last_mid = 0;
+#if COAP_OBSERVE_PACING_INTERVAL
+    o->pending = NULL;
+#endif /* COAP_OBSERVE_PACING_INTERVAL */
 
     PRINTF("Adding observer (%u/%u) for /%s [0x%02X%02X]\n",
            list_length(observers_list) + 1, COAP_MAX_OBSERVERS,
            o->url, o->token[0], o->token[1]);
     list_add(observers_list, o);
+#if COAP_TABLE_INDEX
+    bucket = &observers_by_client[coap_client_hash(addr, port)
+                                  % COAP_OBSERVER_BUCKETS];
+    o->client_next = *bucket;
+    *bucket = o;
+#endif /* COAP_TABLE_INDEX */
+  } else {
+    COAP_STAT(coap_stats.observers_full++);
   }
 
   return o;
 }
 /*---------------------------------------------------------------------------*/
+list_t
+coap_get_observers(void)
+{
+  return observers_list;
+}
+/*---------------------------------------------------------------------------*/
 /*- Removal -----------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
 void
 coap_remove_observer(coap_observer_t *o)
 {
+#if COAP_TABLE_INDEX
+  coap_observer_t **p;
+#endif /* COAP_TABLE_INDEX */
+
   PRINTF("Removing observer for /%s [0x%02X%02X]\n", o->url, o->token[0],
          o->token[1]);
 
+#if COAP_TABLE_INDEX
+  for(p = &observers_by_client[coap_client_hash(&o->addr, o->port)
+                               % COAP_OBSERVER_BUCKETS];
+      *p != NULL; p = &(*p)->client_next) {
+    if(*p == o) {
+      *p = o->client_next;
+      break;
+    }
+  }
+#endif /* COAP_TABLE_INDEX */
   memb_free(&observers_memb, o);
   list_remove(observers_list, o);
 }
@@ -106,9 +199,10 @@ coap_remove_observer_by_client(uip_ipaddr_t *addr, uint16_t port)
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+  for(obs = first_of_client(addr, port); obs; obs = next) {
+    next = next_of_client(obs);
     PRINTF("Remove check client ");
     PRINT6ADDR(addr);
     PRINTF(":%u\n", port);
@@ -126,9 +220,10 @@ coap_remove_observer_by_token(uip_ipaddr_t *addr, uint16_t port,
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+  for(obs = first_of_client(addr, port); obs; obs = next) {
+    next = next_of_client(obs);
     PRINTF("Remove check Token 0x%02X%02X\n", token[0], token[1]);
     if(uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port
        && obs->token_len == token_len
@@ -146,9 +241,15 @@ coap_remove_observer_by_uri(uip_ipaddr_t *addr, uint16_t port,
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+  if(addr == NULL) {
+    obs = (coap_observer_t *)list_head(observers_list);
+  } else {
+    obs = first_of_client(addr, port);
+  }
+  for(; obs; obs = next) {
+    next = addr == NULL ? obs->next : next_of_client(obs);
     PRINTF("Remove check URL %p\n", uri);
     if((addr == NULL
         || (uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port))
@@ -165,9 +266,10 @@ coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+  for(obs = first_of_client(addr, port); obs; obs = next) {
+    next = next_of_client(obs);
     PRINTF("Remove check MID %u\n", mid);
     if(uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port
        && obs->last_mid == mid) {
@@ -180,6 +282,160 @@ coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
 /*---------------------------------------------------------------------------*/
 /*- Notification ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
+/* Prepare a notification and the "fake" GET request for the URI */
+static void
+init_notification(coap_packet_t *request, coap_packet_t *notification,
+                  const char *url)
+{
+  coap_init_message(notification, COAP_TYPE_NON, CONTENT_2_05, 0);
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+  coap_set_header_uri_path(request, url);
+}
+/*---------------------------------------------------------------------------*/
+#if COAP_OBSERVE_BATCH
+static int
+build_template(resource_t *resource, coap_packet_t *request,
+               coap_packet_t *notification)
+{
+  /* run the handler once, the result is shared by all observers */
+  resource->get_handler(request, notification,
+                        template + COAP_MAX_HEADER_SIZE,
+                        REST_MAX_CHUNK_SIZE, NULL);
+  template_len = coap_serialize_message(notification, template);
+  return template_len != 0;
+}
+#endif /* COAP_OBSERVE_BATCH */
+/*---------------------------------------------------------------------------*/
+/*
+ * Build the notification for one observer in a new transaction and send
+ * it. Returns 0 if no transaction slot was free.
+ */
+static int
+notify_observer(resource_t *resource, coap_observer_t *obs,
+                coap_packet_t *request, coap_packet_t *notification)
+{
+  coap_transaction_t *transaction;
+
+  /*TODO implement special transaction for CON, sharing the same buffer to allow for more observers */
+
+  transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port);
+  if(transaction == NULL) {
+    return 0;
+  }
+
+  if(obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0) {
+    PRINTF("           Force Confirmable for\n");
+    notification->type = COAP_TYPE_CON;
+  }
+
+  PRINTF("           Observer ");
+  PRINT6ADDR(&obs->addr);
+  PRINTF(":%u\n", obs->port);
+
+  /* update last MID for RST matching */
+  obs->last_mid = transaction->mid;
+
+#if COAP_OBSERVE_BATCH
+  /* patch the header, Token and Observe option of the template */
+  transaction->packet_len =
+    coap_serialize_notification(transaction->packet, template, template_len,
+                                notification->type, transaction->mid,
+                                obs->token, obs->token_len,
+                                notification->code < BAD_REQUEST_4_00
+                                ? (obs->obs_counter)++ : -1);
+  if(transaction->packet_len == 0) {
+    coap_clear_transaction(transaction);
+    return 1;
+  }
+#else /* COAP_OBSERVE_BATCH */
+  /* prepare response */
+  notification->mid = transaction->mid;
+
+  resource->get_handler(request, notification,
+                        transaction->packet + COAP_MAX_HEADER_SIZE,
+                        REST_MAX_CHUNK_SIZE, NULL);
+
+  if(notification->code < BAD_REQUEST_4_00) {
+    coap_set_header_observe(notification, (obs->obs_counter)++);
+  }
+  coap_set_token(notification, obs->token, obs->token_len);
+
+  transaction->packet_len =
+    coap_serialize_message(notification, transaction->packet);
+#endif /* COAP_OBSERVE_BATCH */
+
+  coap_send_transaction(transaction);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+#if COAP_OBSERVE_PACING_INTERVAL
+/*
+ * Paced notifications are only marked as pending on their observers. The
+ * pacing timer sends one at a time, and only then takes a transaction
+ * slot, so that waiting notifications do not hold the slots.
+ */
+static struct ctimer pacing_timer;
+/* Time at which the last paced notification was sent */
+static clock_time_t last_notification;
+
+static void
+send_pending(void *ptr)
+{
+  coap_packet_t notification[1];
+  coap_packet_t request[1];
+  coap_observer_t *obs;
+
+  for(obs = (coap_observer_t *)list_head(observers_list); obs;
+      obs = obs->next) {
+    if(obs->pending != NULL) {
+      break;
+    }
+  }
+  if(obs == NULL) {
+    return;
+  }
+
+  init_notification(request, notification, obs->url);
+#if COAP_OBSERVE_BATCH
+  if(!build_template(obs->pending, request, notification)) {
+    /* drop the notification that could not be serialized */
+    obs->pending = NULL;
+  }
+#endif /* COAP_OBSERVE_BATCH */
+  if(obs->pending != NULL
+     && notify_observer(obs->pending, obs, request, notification)) {
+    obs->pending = NULL;
+  }
+  last_notification = clock_time();
+
+  /* the next one, or this one again if no transaction slot was free */
+  for(obs = (coap_observer_t *)list_head(observers_list); obs;
+      obs = obs->next) {
+    if(obs->pending != NULL) {
+      ctimer_set(&pacing_timer, COAP_OBSERVE_PACING_INTERVAL,
+                 send_pending, NULL);
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+schedule_pending(void)
+{
+  clock_time_t elapsed;
+
+  if(!ctimer_expired(&pacing_timer)) {
+    /* already waiting to send the next one */
+    return;
+  }
+  elapsed = clock_time() - last_notification;
+  ctimer_set(&pacing_timer,
+             elapsed < COAP_OBSERVE_PACING_INTERVAL
+             ? COAP_OBSERVE_PACING_INTERVAL - elapsed : 0,
+             send_pending, NULL);
+}
+#endif /* COAP_OBSERVE_PACING_INTERVAL */
+/*---------------------------------------------------------------------------*/
 void
 coap_notify_observers(resource_t *resource)
 {
@@ -205,10 +461,10 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
   /* url now contains the notify URL that needs to match the observer */
   PRINTF("Observe: Notification from %s\n", url);
 
-  coap_init_message(notification, COAP_TYPE_NON, CONTENT_2_05, 0);
-  /* create a "fake" request for the URI */
-  coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
-  coap_set_header_uri_path(request, url);
+  init_notification(request, notification, url);
+#if COAP_OBSERVE_BATCH
+  template_len = 0;
+#endif /* COAP_OBSERVE_BATCH */
 
   /* iterate over observers */
   url_len = strlen(url);
@@ -223,42 +479,22 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
             && (resource->flags & HAS_SUB_RESOURCES)
             && obs->url[url_len] == '/'))
        && strncmp(url, obs->url, url_len) == 0) {
-      coap_transaction_t *transaction = NULL;
-
-      /*TODO implement special transaction for CON, sharing the same buffer to allow for more observers */
-
-      if((transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port))) {
-        if(obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0) {
-          PRINTF("           Force Confirmable for\n");
-          notification->type = COAP_TYPE_CON;
-        }
-
-        PRINTF("           Observer ");
-        PRINT6ADDR(&obs->addr);
-        PRINTF(":%u\n", obs->port);
-
-        /* update last MID for RST matching */
-        obs->last_mid = transaction->mid;
-
-        /* prepare response */
-        notification->mid = transaction->mid;
-
-        resource->get_handler(request, notification,
-                              transaction->packet + COAP_MAX_HEADER_SIZE,
-                              REST_MAX_CHUNK_SIZE, NULL);
-
-        if(notification->code < BAD_REQUEST_4_00) {
-          coap_set_header_observe(notification, (obs->obs_counter)++);
-        }
-        coap_set_token(notification, obs->token, obs->token_len);
-
-        transaction->packet_len =
-          coap_serialize_message(notification, transaction->packet);
-
-        coap_send_transaction(transaction);
+#if COAP_OBSERVE_PACING_INTERVAL
+      obs->pending = resource;
+#else /* COAP_OBSERVE_PACING_INTERVAL */
+#if COAP_OBSERVE_BATCH
+      if(template_len == 0
+         && !build_template(resource, request, notification)) {
+        return;
       }
+#endif /* COAP_OBSERVE_BATCH */
+      notify_observer(resource, obs, request, notification);
+#endif /* COAP_OBSERVE_PACING_INTERVAL */
     }
   }
+#if COAP_OBSERVE_PACING_INTERVAL
+  schedule_pending();
+#endif /* COAP_OBSERVE_PACING_INTERVAL */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -267,13 +503,16 @@ coap_observe_handler(resource_t *resource, void *request, void *response)
   coap_packet_t *const coap_req = (coap_packet_t *)request;
   coap_packet_t *const coap_res = (coap_packet_t *)response;
   coap_observer_t * obs;
+  const char *uri_path = NULL;
+  int uri_path_len;
 
   if(coap_req->code == COAP_GET && coap_res->code < 128) { /* GET request and response without error code */
     if(IS_OPTION(coap_req, COAP_OPTION_OBSERVE)) {
       if(coap_req->observe == 0) {
+        uri_path_len = coap_get_header_uri_path(coap_req, &uri_path);
         obs = add_observer(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport,
                            coap_req->token, coap_req->token_len,
-                           coap_req->uri_path, coap_req->uri_path_len);
+                           uri_path, uri_path_len);
        if(obs) {
           coap_set_header_observe(coap_res, (obs->obs_counter)++);
           /*
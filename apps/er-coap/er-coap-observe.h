@@ -55,6 +55,9 @@ typedef struct coap_observable {
 
 typedef struct coap_observer {
   struct coap_observer *next;   /* for LIST */
+#if COAP_TABLE_INDEX
+  struct coap_observer *client_next; /* next in the same client bucket */
+#endif /* COAP_TABLE_INDEX */
 
   char url[COAP_OBSERVER_URL_LEN];
   uip_ipaddr_t addr;
@@ -67,6 +70,9 @@ typedef struct coap_observer {
 
   struct etimer retrans_timer;
   uint8_t retrans_counter;
+#if COAP_OBSERVE_PACING_INTERVAL
+  resource_t *pending;          /* resource of a notification not sent yet */
+#endif /* COAP_OBSERVE_PACING_INTERVAL */
 } coap_observer_t;
 
 list_t coap_get_observers(void);
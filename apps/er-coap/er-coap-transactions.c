@@ -59,6 +59,88 @@ LIST(transactions_list);
 
 static struct process *transaction_handler_process = NULL;
 
+#if COAP_TABLE_INDEX
+static coap_transaction_t *transactions_by_mid[COAP_TRANSACTION_BUCKETS];
+static coap_transaction_t *transactions_by_client[COAP_TRANSACTION_BUCKETS];
+#endif /* COAP_TABLE_INDEX */
+
+/*---------------------------------------------------------------------------*/
+/*- Index -------------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+#if COAP_TABLE_INDEX
+uint16_t
+coap_client_hash(const uip_ipaddr_t *addr, uint16_t port)
+{
+  uint16_t hash = port;
+  int i;
+
+  /* The lower half of the address (the interface identifier for IPv6)
+     varies most between clients */
+  for(i = sizeof(*addr) / 4; i < sizeof(*addr) / 2; i++) {
+    hash = (hash << 5) + hash + addr->u16[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(coap_transaction_t *t)
+{
+  coap_transaction_t **bucket;
+
+  bucket = &transactions_by_mid[t->mid % COAP_TRANSACTION_BUCKETS];
+  t->mid_next = *bucket;
+  *bucket = t;
+
+  bucket = &transactions_by_client[coap_client_hash(&t->addr, t->port)
+                                   % COAP_TRANSACTION_BUCKETS];
+  t->client_next = *bucket;
+  *bucket = t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(coap_transaction_t *t)
+{
+  coap_transaction_t **p;
+
+  for(p = &transactions_by_mid[t->mid % COAP_TRANSACTION_BUCKETS];
+      *p != NULL; p = &(*p)->mid_next) {
+    if(*p == t) {
+      *p = t->mid_next;
+      break;
+    }
+  }
+  for(p = &transactions_by_client[coap_client_hash(&t->addr, t->port)
+                                  % COAP_TRANSACTION_BUCKETS];
+      *p != NULL; p = &(*p)->client_next) {
+    if(*p == t) {
+      *p = t->client_next;
+      break;
+    }
+  }
+}
+#endif /* COAP_TABLE_INDEX */
+/*---------------------------------------------------------------------------*/
+#if COAP_MAX_TRANSACTIONS_PER_CLIENT
+static int
+client_transactions(uip_ipaddr_t *addr, uint16_t port)
+{
+  coap_transaction_t *t;
+  int count = 0;
+
+#if COAP_TABLE_INDEX
+  for(t = transactions_by_client[coap_client_hash(addr, port)
+                                 % COAP_TRANSACTION_BUCKETS];
+      t; t = t->client_next) {
+#else /* COAP_TABLE_INDEX */
+  for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
+#endif /* COAP_TABLE_INDEX */
+    if(uip_ipaddr_cmp(&t->addr, addr) && t->port == port) {
+      count++;
+    }
+  }
+  return count;
+}
+#endif /* COAP_MAX_TRANSACTIONS_PER_CLIENT */
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -70,8 +152,17 @@ coap_register_as_transaction_handler()
 coap_transaction_t *
 coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
 {
-  coap_transaction_t *t = memb_alloc(&transactions_memb);
+  coap_transaction_t *t;
 
+#if COAP_MAX_TRANSACTIONS_PER_CLIENT
+  if(client_transactions(addr, port) >= COAP_MAX_TRANSACTIONS_PER_CLIENT) {
+    PRINTF("Transaction limit reached for client\n");
+    COAP_STAT(coap_stats.transactions_client_cap++);
+    return NULL;
+  }
+#endif /* COAP_MAX_TRANSACTIONS_PER_CLIENT */
+
+  t = memb_alloc(&transactions_memb);
   if(t) {
     t->mid = mid;
     t->retrans_counter = 0;
@@ -81,6 +172,11 @@ coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
     t->port = port;
 
     list_add(transactions_list, t); /* list itself makes sure same element is not added twice */
+#if COAP_TABLE_INDEX
+    index_add(t);
+#endif /* COAP_TABLE_INDEX */
+  } else {
+    COAP_STAT(coap_stats.transactions_full++);
   }
 
   return t;
@@ -146,6 +242,9 @@ coap_clear_transaction(coap_transaction_t *t)
 
     etimer_stop(&t->retrans_timer);
     list_remove(transactions_list, t);
+#if COAP_TABLE_INDEX
+    index_remove(t);
+#endif /* COAP_TABLE_INDEX */
     memb_free(&transactions_memb, t);
   }
 }
@@ -154,7 +253,12 @@ coap_get_transaction_by_mid(uint16_t mid)
 {
   coap_transaction_t *t = NULL;
 
+#if COAP_TABLE_INDEX
+  for(t = transactions_by_mid[mid % COAP_TRANSACTION_BUCKETS]; t;
+      t = t->mid_next) {
+#else /* COAP_TABLE_INDEX */
   for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
+#endif /* COAP_TABLE_INDEX */
     if(t->mid == mid) {
       PRINTF("Found transaction for MID %u: %p\n", t->mid, t);
       return t;
@@ -51,6 +51,10 @@
 /* container for transactions with message buffer and retransmission info */
 typedef struct coap_transaction {
   struct coap_transaction *next;        /* for LIST */
+#if COAP_TABLE_INDEX
+  struct coap_transaction *mid_next;    /* next in the same MID bucket */
+  struct coap_transaction *client_next; /* next in the same client bucket */
+#endif /* COAP_TABLE_INDEX */
 
   uint16_t mid;
   struct etimer retrans_timer;
@@ -75,6 +79,10 @@ void coap_send_transaction(coap_transaction_t *t);
 void coap_clear_transaction(coap_transaction_t *t);
 coap_transaction_t *coap_get_transaction_by_mid(uint16_t mid);
 
+#if COAP_TABLE_INDEX
+uint16_t coap_client_hash(const uip_ipaddr_t *addr, uint16_t port);
+#endif /* COAP_TABLE_INDEX */
+
 void coap_check_transactions(void);
 
 #endif /* COAP_TRANSACTIONS_H_ */
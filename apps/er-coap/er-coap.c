@@ -65,6 +65,10 @@ static uint16_t current_mid = 0;
 
 coap_status_t erbium_status_code = NO_ERROR;
 char *coap_error_message = "";
+
+#if COAP_STATS
+struct coap_stats coap_stats;
+#endif /* COAP_STATS */
 /*---------------------------------------------------------------------------*/
 /*- Local helper functions --------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -238,6 +242,96 @@ coap_merge_multi_option(char **dst, size_t *dst_len, uint8_t *option,
   }
 }
 /*---------------------------------------------------------------------------*/
+static const uint8_t *
+coap_parse_option_header(const uint8_t *option, unsigned int *delta,
+                         size_t *length)
+{
+  *delta = option[0] >> 4;
+  *length = option[0] & 0x0F;
+  ++option;
+
+  if(*delta == 13) {
+    *delta += option[0];
+    ++option;
+  } else if(*delta == 14) {
+    *delta += 255 + (option[0] << 8) + option[1];
+    option += 2;
+  }
+
+  if(*length == 13) {
+    *length += option[0];
+    ++option;
+  } else if(*length == 14) {
+    *length += 255 + (option[0] << 8) + option[1];
+    option += 2;
+  }
+  return option;
+}
+/*---------------------------------------------------------------------------*/
+#if COAP_LAZY_OPTIONS
+/* Decode an option recorded by coap_parse_message(), merging repeated ones */
+static void
+coap_decode_lazy_option(coap_packet_t *coap_pkt, int kind)
+{
+  uint8_t *option;
+  uint8_t *end;
+  unsigned int delta;
+  size_t length;
+  int first;
+
+  coap_pkt->lazy &= ~(1 << kind);
+
+  option = coap_pkt->buffer + coap_pkt->lazy_offset[kind];
+  end = coap_pkt->buffer + coap_pkt->lazy_end;
+  for(first = 1; option < end; first = 0) {
+    option = (uint8_t *)coap_parse_option_header(option, &delta, &length);
+    if(!first && delta != 0) {
+      /* next option number */
+      break;
+    }
+
+    /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
+    switch(kind) {
+    case COAP_LAZY_LOCATION_PATH:
+      coap_merge_multi_option((char **)&(coap_pkt->location_path),
+                              &(coap_pkt->location_path_len), option,
+                              length, '/');
+      break;
+    case COAP_LAZY_URI_PATH:
+      coap_merge_multi_option((char **)&(coap_pkt->uri_path),
+                              &(coap_pkt->uri_path_len), option, length,
+                              '/');
+      break;
+    case COAP_LAZY_URI_QUERY:
+      coap_merge_multi_option((char **)&(coap_pkt->uri_query),
+                              &(coap_pkt->uri_query_len), option, length,
+                              '&');
+      break;
+    case COAP_LAZY_LOCATION_QUERY:
+      coap_merge_multi_option((char **)&(coap_pkt->location_query),
+                              &(coap_pkt->location_query_len), option,
+                              length, '&');
+      break;
+    }
+    option += length;
+  }
+}
+/* Only the first of repeated options is recorded, decoding merges the rest */
+#define LAZY_RECORD(pkt, kind, offset) \
+  if(!((pkt)->lazy & (1 << (kind)))) { \
+    (pkt)->lazy |= 1 << (kind); \
+    (pkt)->lazy_offset[kind] = (offset); \
+  }
+#define LAZY_DECODE(pkt, kind) \
+  if((pkt)->lazy & (1 << (kind))) { \
+    coap_decode_lazy_option(pkt, kind); \
+  }
+#define LAZY_CLEAR(pkt, kind) ((pkt)->lazy &= ~(1 << (kind)))
+#else /* COAP_LAZY_OPTIONS */
+#define LAZY_DECODE(pkt, kind)
+#define LAZY_CLEAR(pkt, kind)
+#endif /* COAP_LAZY_OPTIONS */
+/*---------------------------------------------------------------------------*/
 static int
 coap_get_variable(const char *buffer, size_t length, const char *name,
                   const char **output)
@@ -307,12 +401,103 @@ coap_init_message(void *packet, coap_message_type_t type, uint8_t code,
   coap_pkt->mid = mid;
 }
 /*---------------------------------------------------------------------------*/
+#if COAP_SERIALIZE_FAST_PATH
+/* Only ETag, Observe, Content-Format, Max-Age, Block2 and Size2 are set */
+#define IS_COMMON_RESPONSE(packet) \
+  (((packet)->options[0] & ~0x50) == 0 && ((packet)->options[1] & ~0x50) == 0 \
+   && ((packet)->options[2] & ~0x80) == 0 && ((packet)->options[3] & ~0x10) == 0 \
+   && (packet)->options[4] == 0 && (packet)->options[5] == 0 \
+   && (packet)->options[6] == 0 && (packet)->options[7] == 0)
+/*---------------------------------------------------------------------------*/
+/* Write a uint option whose delta fits the one-byte extended form */
+static uint8_t *
+coap_serialize_short_int_option(unsigned int delta, uint8_t *option,
+                                uint32_t value)
+{
+  uint8_t *header = option++;
+  size_t length;
+
+  if(delta > 12) {
+    *option++ = delta - 13;
+    delta = 13;
+  }
+  length = value > 0xFFFFFF ? 4 : value > 0xFFFF ? 3 : value > 0xFF ? 2 :
+    value > 0 ? 1 : 0;
+  *header = delta << 4 | length;
+  switch(length) {
+  case 4:
+    *option++ = (uint8_t)(value >> 24);
+  /* fall through */
+  case 3:
+    *option++ = (uint8_t)(value >> 16);
+  /* fall through */
+  case 2:
+    *option++ = (uint8_t)(value >> 8);
+  /* fall through */
+  case 1:
+    *option++ = (uint8_t)value;
+  }
+  return option;
+}
+/*---------------------------------------------------------------------------*/
+/* Serialize the options of a response with IS_COMMON_RESPONSE() set */
+static uint8_t *
+coap_serialize_response_options(coap_packet_t *coap_pkt, uint8_t *option)
+{
+  unsigned int current_number = 0;
+
+  COAP_SERIALIZE_BYTE_OPTION(COAP_OPTION_ETAG, etag, "ETag");
+  if(IS_OPTION(coap_pkt, COAP_OPTION_OBSERVE)) {
+    option = coap_serialize_short_int_option(COAP_OPTION_OBSERVE
+                                             - current_number, option,
+                                             coap_pkt->observe);
+    current_number = COAP_OPTION_OBSERVE;
+  }
+  if(IS_OPTION(coap_pkt, COAP_OPTION_CONTENT_FORMAT)) {
+    option = coap_serialize_short_int_option(COAP_OPTION_CONTENT_FORMAT
+                                             - current_number, option,
+                                             coap_pkt->content_format);
+    current_number = COAP_OPTION_CONTENT_FORMAT;
+  }
+  if(IS_OPTION(coap_pkt, COAP_OPTION_MAX_AGE)) {
+    option = coap_serialize_short_int_option(COAP_OPTION_MAX_AGE
+                                             - current_number, option,
+                                             coap_pkt->max_age);
+    current_number = COAP_OPTION_MAX_AGE;
+  }
+  if(IS_OPTION(coap_pkt, COAP_OPTION_BLOCK2)) {
+    option = coap_serialize_short_int_option(COAP_OPTION_BLOCK2
+                                             - current_number, option,
+                                             coap_pkt->block2_num << 4
+                                             | (coap_pkt->block2_more ? 0x8 : 0)
+                                             | (0xF & coap_log_2(coap_pkt->block2_size / 16)));
+    current_number = COAP_OPTION_BLOCK2;
+  }
+  if(IS_OPTION(coap_pkt, COAP_OPTION_SIZE2)) {
+    option = coap_serialize_short_int_option(COAP_OPTION_SIZE2
+                                             - current_number, option,
+                                             coap_pkt->size2);
+  }
+  return option;
+}
+#endif /* COAP_SERIALIZE_FAST_PATH */
+/*---------------------------------------------------------------------------*/
 size_t
 coap_serialize_message(void *packet, uint8_t *buffer)
 {
   coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
   uint8_t *option;
   unsigned int current_number = 0;
+#if COAP_LAZY_OPTIONS
+  int kind;
+
+  /* options still pointing into a parsed buffer must be decoded first */
+  if(coap_pkt->lazy) {
+    for(kind = 0; kind < COAP_LAZY_OPTION_KINDS; ++kind) {
+      LAZY_DECODE(coap_pkt, kind);
+    }
+  }
+#endif /* COAP_LAZY_OPTIONS */
 
   /* Initialize */
   coap_pkt->buffer = buffer;
@@ -354,6 +539,13 @@ coap_serialize_message(void *packet, uint8_t *buffer)
 
   PRINTF("-Serializing options at %p-\n", option);
 
+#if COAP_SERIALIZE_FAST_PATH
+  if(IS_COMMON_RESPONSE(coap_pkt)) {
+    option = coap_serialize_response_options(coap_pkt, option);
+    goto options_done;
+  }
+#endif /* COAP_SERIALIZE_FAST_PATH */
+
   /* The options must be serialized in the order of their number */
   COAP_SERIALIZE_BYTE_OPTION(COAP_OPTION_IF_MATCH, if_match, "If-Match");
   COAP_SERIALIZE_STRING_OPTION(COAP_OPTION_URI_HOST, uri_host, '\0',
@@ -388,6 +580,9 @@ coap_serialize_message(void *packet, uint8_t *buffer)
                                "Proxy-Scheme");
   COAP_SERIALIZE_INT_OPTION(COAP_OPTION_SIZE1, size1, "Size1");
 
+#if COAP_SERIALIZE_FAST_PATH
+options_done:
+#endif /* COAP_SERIALIZE_FAST_PATH */
   PRINTF("-Done serializing at %p----\n", option);
 
   /* Pack payload */
@@ -422,6 +617,79 @@ coap_serialize_message(void *packet, uint8_t *buffer)
   return (option - buffer) + coap_pkt->payload_len; /* packet length */
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Serialize a message from a template that was serialized without Token
+ * and Observe option, so that a notification can be built for many
+ * observers without serializing all options and the payload each time.
+ * A negative observe value leaves out the Observe option.
+ */
+size_t
+coap_serialize_notification(uint8_t *buffer, const uint8_t *template,
+                            size_t template_len, coap_message_type_t type,
+                            uint16_t mid, const uint8_t *token,
+                            size_t token_len, int32_t observe)
+{
+  const uint8_t *option;
+  const uint8_t *value;
+  const uint8_t *end;
+  unsigned int number;
+  unsigned int delta;
+  size_t length;
+  uint8_t *out;
+
+  /* header with the type, Token length and MID of this message */
+  buffer[0] = (template[0] & COAP_HEADER_VERSION_MASK)
+    | (COAP_HEADER_TYPE_MASK & type << COAP_HEADER_TYPE_POSITION)
+    | (COAP_HEADER_TOKEN_LEN_MASK & token_len << COAP_HEADER_TOKEN_LEN_POSITION);
+  buffer[1] = template[1];
+  buffer[2] = (uint8_t)(mid >> 8);
+  buffer[3] = (uint8_t)mid;
+  memcpy(buffer + COAP_HEADER_LEN, token, token_len);
+  out = buffer + COAP_HEADER_LEN + token_len;
+
+  option = template + COAP_HEADER_LEN;
+  end = template + template_len;
+  if(observe >= 0) {
+    /* find the first option that goes after Observe */
+    number = 0;
+    value = NULL;
+    while(option < end && (option[0] & 0xF0) != 0xF0) {
+      value = coap_parse_option_header(option, &delta, &length);
+      if(number + delta > COAP_OPTION_OBSERVE) {
+        break;
+      }
+      number += delta;
+      option = value + length;
+      value = NULL;
+    }
+
+    /* options before Observe, Observe (at most 4 B), and the rewritten
+       header of the next option, which can only get shorter */
+    if(out - buffer + (option - template - COAP_HEADER_LEN) + 4
+       + (end - option) > COAP_MAX_PACKET_SIZE) {
+      coap_error_message = "Serialized header exceeds COAP_MAX_HEADER_SIZE";
+      return 0;
+    }
+    memcpy(out, template + COAP_HEADER_LEN,
+           option - template - COAP_HEADER_LEN);
+    out += option - template - COAP_HEADER_LEN;
+    out += coap_serialize_int_option(COAP_OPTION_OBSERVE, number, out,
+                                     observe);
+    if(value != NULL) {
+      /* the delta of the next option is now relative to Observe */
+      out += coap_set_option_header(number + delta - COAP_OPTION_OBSERVE,
+                                    length, out);
+      option = value;
+    }
+  } else if(out - buffer + (end - option) > COAP_MAX_PACKET_SIZE) {
+    coap_error_message = "Serialized header exceeds COAP_MAX_HEADER_SIZE";
+    return 0;
+  }
+  memcpy(out, option, end - option);
+
+  return out - buffer + (end - option);
+}
+/*---------------------------------------------------------------------------*/
 void
 coap_send_message(uip_ipaddr_t *addr, uint16_t port, uint8_t *data,
                   uint16_t length)
@@ -486,10 +754,18 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
   unsigned int option_number = 0;
   unsigned int option_delta = 0;
   size_t option_length = 0;
+#if COAP_LAZY_OPTIONS
+  uint8_t *option_start;
+
+  coap_pkt->lazy_end = data_len;
+#endif /* COAP_LAZY_OPTIONS */
 
   while(current_option < data + data_len) {
     /* payload marker 0xFF, currently only checking for 0xF* because rest is reserved */
     if((current_option[0] & 0xF0) == 0xF0) {
+#if COAP_LAZY_OPTIONS
+      coap_pkt->lazy_end = current_option - data;
+#endif /* COAP_LAZY_OPTIONS */
       coap_pkt->payload = ++current_option;
       coap_pkt->payload_len = data_len - (coap_pkt->payload - data);
 
@@ -503,6 +779,9 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
       break;
     }
 
+#if COAP_LAZY_OPTIONS
+    option_start = current_option;
+#endif /* COAP_LAZY_OPTIONS */
     option_delta = current_option[0] >> 4;
     option_length = current_option[0] & 0x0F;
     ++current_option;
@@ -610,36 +889,52 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
       PRINTF("Uri-Port [%u]\n", coap_pkt->uri_port);
       break;
     case COAP_OPTION_URI_PATH:
+#if COAP_LAZY_OPTIONS
+      LAZY_RECORD(coap_pkt, COAP_LAZY_URI_PATH, option_start - data);
+#else /* COAP_LAZY_OPTIONS */
       /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
       coap_merge_multi_option((char **)&(coap_pkt->uri_path),
                               &(coap_pkt->uri_path_len), current_option,
                               option_length, '/');
       PRINTF("Uri-Path [%.*s]\n", (int)coap_pkt->uri_path_len, coap_pkt->uri_path);
+#endif /* COAP_LAZY_OPTIONS */
       break;
     case COAP_OPTION_URI_QUERY:
+#if COAP_LAZY_OPTIONS
+      LAZY_RECORD(coap_pkt, COAP_LAZY_URI_QUERY, option_start - data);
+#else /* COAP_LAZY_OPTIONS */
       /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
       coap_merge_multi_option((char **)&(coap_pkt->uri_query),
                               &(coap_pkt->uri_query_len), current_option,
                               option_length, '&');
       PRINTF("Uri-Query [%.*s]\n", (int)coap_pkt->uri_query_len,
              coap_pkt->uri_query);
+#endif /* COAP_LAZY_OPTIONS */
       break;
 
     case COAP_OPTION_LOCATION_PATH:
+#if COAP_LAZY_OPTIONS
+      LAZY_RECORD(coap_pkt, COAP_LAZY_LOCATION_PATH, option_start - data);
+#else /* COAP_LAZY_OPTIONS */
       /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
       coap_merge_multi_option((char **)&(coap_pkt->location_path),
                               &(coap_pkt->location_path_len), current_option,
                               option_length, '/');
       PRINTF("Location-Path [%.*s]\n", (int)coap_pkt->location_path_len,
              coap_pkt->location_path);
+#endif /* COAP_LAZY_OPTIONS */
       break;
     case COAP_OPTION_LOCATION_QUERY:
+#if COAP_LAZY_OPTIONS
+      LAZY_RECORD(coap_pkt, COAP_LAZY_LOCATION_QUERY, option_start - data);
+#else /* COAP_LAZY_OPTIONS */
       /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
       coap_merge_multi_option((char **)&(coap_pkt->location_query),
                               &(coap_pkt->location_query_len), current_option,
                               option_length, '&');
       PRINTF("Location-Query [%.*s]\n", (int)coap_pkt->location_query_len,
              coap_pkt->location_query);
+#endif /* COAP_LAZY_OPTIONS */
       break;
 
     case COAP_OPTION_OBSERVE:
@@ -703,6 +998,7 @@ coap_get_query_variable(void *packet, const char *name, const char **output)
   coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
 
   if(IS_OPTION(coap_pkt, COAP_OPTION_URI_QUERY)) {
+    LAZY_DECODE(coap_pkt, COAP_LAZY_URI_QUERY);
     return coap_get_variable(coap_pkt->uri_query, coap_pkt->uri_query_len,
                              name, output);
   }
@@ -923,6 +1219,7 @@ coap_get_header_uri_path(void *packet, const char **path)
   if(!IS_OPTION(coap_pkt, COAP_OPTION_URI_PATH)) {
     return 0;
   }
+  LAZY_DECODE(coap_pkt, COAP_LAZY_URI_PATH);
   *path = coap_pkt->uri_path;
   return coap_pkt->uri_path_len;
 }
@@ -936,6 +1233,7 @@ coap_set_header_uri_path(void *packet, const char *path)
 
   coap_pkt->uri_path = path;
   coap_pkt->uri_path_len = strlen(path);
+  LAZY_CLEAR(coap_pkt, COAP_LAZY_URI_PATH);
 
   SET_OPTION(coap_pkt, COAP_OPTION_URI_PATH);
   return coap_pkt->uri_path_len;
@@ -949,6 +1247,7 @@ coap_get_header_uri_query(void *packet, const char **query)
   if(!IS_OPTION(coap_pkt, COAP_OPTION_URI_QUERY)) {
     return 0;
   }
+  LAZY_DECODE(coap_pkt, COAP_LAZY_URI_QUERY);
   *query = coap_pkt->uri_query;
   return coap_pkt->uri_query_len;
 }
@@ -962,6 +1261,7 @@ coap_set_header_uri_query(void *packet, const char *query)
 
   coap_pkt->uri_query = query;
   coap_pkt->uri_query_len = strlen(query);
+  LAZY_CLEAR(coap_pkt, COAP_LAZY_URI_QUERY);
 
   SET_OPTION(coap_pkt, COAP_OPTION_URI_QUERY);
   return coap_pkt->uri_query_len;
@@ -975,6 +1275,7 @@ coap_get_header_location_path(void *packet, const char **path)
   if(!IS_OPTION(coap_pkt, COAP_OPTION_LOCATION_PATH)) {
     return 0;
   }
+  LAZY_DECODE(coap_pkt, COAP_LAZY_LOCATION_PATH);
   *path = coap_pkt->location_path;
   return coap_pkt->location_path_len;
 }
@@ -994,6 +1295,7 @@ coap_set_header_location_path(void *packet, const char *path)
   } else {
     coap_pkt->location_path_len = strlen(path);
   } coap_pkt->location_path = path;
+  LAZY_CLEAR(coap_pkt, COAP_LAZY_LOCATION_PATH);
 
   if(coap_pkt->location_path_len > 0) {
     SET_OPTION(coap_pkt, COAP_OPTION_LOCATION_PATH);
@@ -1009,6 +1311,7 @@ coap_get_header_location_query(void *packet, const char **query)
   if(!IS_OPTION(coap_pkt, COAP_OPTION_LOCATION_QUERY)) {
     return 0;
   }
+  LAZY_DECODE(coap_pkt, COAP_LAZY_LOCATION_QUERY);
   *query = coap_pkt->location_query;
   return coap_pkt->location_query_len;
 }
@@ -1022,6 +1325,7 @@ coap_set_header_location_query(void *packet, const char *query)
 
   coap_pkt->location_query = query;
   coap_pkt->location_query_len = strlen(query);
+  LAZY_CLEAR(coap_pkt, COAP_LAZY_LOCATION_QUERY);
 
   SET_OPTION(coap_pkt, COAP_OPTION_LOCATION_QUERY);
   return coap_pkt->location_query_len;
@@ -73,12 +73,37 @@
 #define UIP_UDP_BUF  ((struct uip_udp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
 #endif
 
+#if COAP_STATS
+/* Overflow counters of the transaction and observer tables */
+struct coap_stats {
+  uint16_t transactions_full;         /* no free transaction slot */
+  uint16_t transactions_client_cap;   /* COAP_MAX_TRANSACTIONS_PER_CLIENT reached */
+  uint16_t observers_full;            /* no free observer slot */
+  uint16_t observers_client_cap;      /* COAP_MAX_OBSERVERS_PER_CLIENT reached */
+};
+extern struct coap_stats coap_stats;
+#define COAP_STAT(code) (code)
+#else /* COAP_STATS */
+#define COAP_STAT(code)
+#endif /* COAP_STATS */
+
 /* bitmap for set options */
 enum { OPTION_MAP_SIZE = sizeof(uint8_t) * 8 };
 
 #define SET_OPTION(packet, opt) ((packet)->options[opt / OPTION_MAP_SIZE] |= 1 << (opt % OPTION_MAP_SIZE))
 #define IS_OPTION(packet, opt) ((packet)->options[opt / OPTION_MAP_SIZE] & (1 << (opt % OPTION_MAP_SIZE)))
 
+#if COAP_LAZY_OPTIONS
+/* options that coap_parse_message() records instead of decoding */
+enum {
+  COAP_LAZY_LOCATION_PATH,
+  COAP_LAZY_URI_PATH,
+  COAP_LAZY_URI_QUERY,
+  COAP_LAZY_LOCATION_QUERY,
+  COAP_LAZY_OPTION_KINDS
+};
+#endif /* COAP_LAZY_OPTIONS */
+
 /* parsed message struct */
 typedef struct {
   uint8_t *buffer; /* pointer to CoAP header / incoming packet buffer / memory to serialize packet */
@@ -130,6 +155,12 @@ typedef struct {
 
   uint16_t payload_len;
   uint8_t *payload;
+
+#if COAP_LAZY_OPTIONS
+  uint8_t lazy;                                 /* bitmap of options not decoded yet */
+  uint16_t lazy_end;                            /* offset of the end of the options */
+  uint16_t lazy_offset[COAP_LAZY_OPTION_KINDS]; /* offset of the first option of each kind */
+#endif /* COAP_LAZY_OPTIONS */
 } coap_packet_t;
 
 /* option format serialization */
@@ -182,6 +213,11 @@ uint16_t coap_get_mid(void);
 void coap_init_message(void *packet, coap_message_type_t type, uint8_t code,
                        uint16_t mid);
 size_t coap_serialize_message(void *packet, uint8_t *buffer);
+size_t coap_serialize_notification(uint8_t *buffer, const uint8_t *template,
+                                   size_t template_len,
+                                   coap_message_type_t type, uint16_t mid,
+                                   const uint8_t *token, size_t token_len,
+                                   int32_t observe);
 void coap_send_message(uip_ipaddr_t *addr, uint16_t port, uint8_t *data,
                        uint16_t length);
 coap_status_t coap_parse_message(void *request, uint8_t *data,
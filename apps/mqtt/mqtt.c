@@ -58,6 +58,9 @@
 #include "lib/assert.h"
 #include "lib/list.h"
 #include "sys/cc.h"
+#if MQTT_QUEUE
+#include "cfs/cfs.h"
+#endif /* MQTT_QUEUE */
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -122,6 +125,12 @@ typedef enum {
 #define MQTT_STRING_LEN_SIZE 2
 #define MQTT_MID_SIZE 2
 #define MQTT_QOS_SIZE 1
+
+#define MQTT_QUEUE_HEAD_FILE MQTT_QUEUE_FILE ".h"
+/* Topic length, payload length, QoS and retain flag */
+#define MQTT_QUEUE_RECORD_HEADER_SIZE 6
+/* A zero topic length after the last record */
+#define MQTT_QUEUE_END_MARKER_SIZE 2
 /*---------------------------------------------------------------------------*/
 #define RESPONSE_WAIT_TIMEOUT (CLOCK_SECOND * 10)
 /*---------------------------------------------------------------------------*/
@@ -165,6 +174,9 @@ static process_event_t mqtt_do_subscribe_event;
 static process_event_t mqtt_do_unsubscribe_event;
 static process_event_t mqtt_do_publish_event;
 static process_event_t mqtt_do_pingreq_event;
+#if MQTT_INFLIGHT_WINDOW
+static process_event_t mqtt_do_inflight_event;
+#endif /* MQTT_INFLIGHT_WINDOW */
 static process_event_t mqtt_continue_send_event;
 static process_event_t mqtt_abort_now_event;
 process_event_t mqtt_update_event;
@@ -186,6 +198,14 @@ static void tcp_event(struct tcp_socket *s, void *ptr,
                       tcp_socket_event_t event);
 
 static void reset_packet(struct mqtt_in_packet *packet);
+
+static uint16_t next_mid(struct mqtt_connection *conn);
+#if MQTT_INFLIGHT_WINDOW
+static void inflight_reconnect(struct mqtt_connection *conn);
+#endif /* MQTT_INFLIGHT_WINDOW */
+#if MQTT_QUEUE
+static void queue_save_head(struct mqtt_connection *conn);
+#endif /* MQTT_QUEUE */
 /*---------------------------------------------------------------------------*/
 LIST(mqtt_conn_list);
 /*---------------------------------------------------------------------------*/
@@ -203,7 +223,14 @@ call_event(struct mqtt_connection *conn,
 static void
 reset_defaults(struct mqtt_connection *conn)
 {
+#if MQTT_INFLIGHT_WINDOW
+  /* Messages in the window keep their IDs across reconnects */
+  if(conn->mid_counter == 0) {
+    conn->mid_counter = 1;
+  }
+#else /* MQTT_INFLIGHT_WINDOW */
   conn->mid_counter = 1;
+#endif /* MQTT_INFLIGHT_WINDOW */
   PT_INIT(&conn->out_proto_thread);
   conn->waiting_for_pingresp = 0;
 
@@ -220,6 +247,13 @@ abort_connection(struct mqtt_connection *conn)
   /* Reset outgoing packet */
   memset(&conn->out_packet, 0, sizeof(conn->out_packet));
 
+#if MQTT_INFLIGHT_WINDOW
+  inflight_reconnect(conn);
+#endif /* MQTT_INFLIGHT_WINDOW */
+#if MQTT_QUEUE
+  queue_save_head(conn);
+#endif /* MQTT_QUEUE */
+
   tcp_socket_close(&conn->socket);
   tcp_socket_unregister(&conn->socket);
 
@@ -375,6 +409,490 @@ reset_packet(struct mqtt_in_packet *packet)
   packet->remaining_multiplier = 1;
 }
 /*---------------------------------------------------------------------------*/
+#if MQTT_QUEUE
+/* Bytes from one ring offset up to another */
+#define QUEUE_DISTANCE(from, to) \
+  (((to) + MQTT_QUEUE_SIZE - (from)) % MQTT_QUEUE_SIZE)
+/*---------------------------------------------------------------------------*/
+/* Read or write at a ring offset, wrapping around at the end of the file */
+static int
+queue_access(int fd, uint32_t offset, uint8_t *buf, uint16_t len,
+             uint8_t writing)
+{
+  uint16_t chunk;
+
+  while(len > 0) {
+    chunk = MIN(len, MQTT_QUEUE_SIZE - offset);
+    if(cfs_seek(fd, offset, CFS_SEEK_SET) != offset ||
+       (writing ? cfs_write(fd, buf, chunk) : cfs_read(fd, buf, chunk)) !=
+       chunk) {
+      return 0;
+    }
+    buf += chunk;
+    len -= chunk;
+    offset = (offset + chunk) % MQTT_QUEUE_SIZE;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_save_head(struct mqtt_connection *conn)
+{
+  int fd;
+
+  if(conn->queue_saved == conn->queue_head) {
+    return;
+  }
+  fd = cfs_open(MQTT_QUEUE_HEAD_FILE, CFS_WRITE);
+  if(fd >= 0) {
+    if(cfs_write(fd, &conn->queue_head, sizeof(conn->queue_head)) ==
+       sizeof(conn->queue_head)) {
+      conn->queue_saved = conn->queue_head;
+    }
+    cfs_close(fd);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_clear(struct mqtt_connection *conn)
+{
+  cfs_remove(MQTT_QUEUE_FILE);
+  cfs_remove(MQTT_QUEUE_HEAD_FILE);
+  conn->queue_head = 0;
+  conn->queue_replay = 0;
+  conn->queue_tail = 0;
+  conn->queue_saved = 0;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Pick up the messages left in the queue by a previous run. The records
+ * from the saved head on are followed by an end marker, a zero topic length.
+ * Messages acknowledged since the head was last saved are sent again.
+ */
+static void
+queue_init(struct mqtt_connection *conn)
+{
+  uint8_t header[MQTT_QUEUE_RECORD_HEADER_SIZE];
+  uint16_t topic_length;
+  uint16_t payload_size;
+  uint32_t used;
+  int fd;
+
+  conn->queue_head = 0;
+  fd = cfs_open(MQTT_QUEUE_HEAD_FILE, CFS_READ);
+  if(fd >= 0) {
+    if(cfs_read(fd, &conn->queue_head, sizeof(conn->queue_head)) !=
+       sizeof(conn->queue_head) || conn->queue_head >= MQTT_QUEUE_SIZE) {
+      conn->queue_head = 0;
+    }
+    cfs_close(fd);
+  }
+  conn->queue_replay = conn->queue_head;
+  conn->queue_tail = conn->queue_head;
+  conn->queue_saved = conn->queue_head;
+
+  fd = cfs_open(MQTT_QUEUE_FILE, CFS_READ);
+  if(fd < 0) {
+    return;
+  }
+  used = 0;
+  while(queue_access(fd, conn->queue_tail, header, sizeof(header), 0)) {
+    topic_length = (header[0] << 8) | header[1];
+    payload_size = (header[2] << 8) | header[3];
+    if(topic_length == 0) {
+      break;
+    }
+    used += sizeof(header) + topic_length + payload_size;
+    if(topic_length > MQTT_MAX_TOPIC_LENGTH ||
+       payload_size > MQTT_QUEUE_PAYLOAD_SIZE ||
+       used + MQTT_QUEUE_END_MARKER_SIZE > MQTT_QUEUE_SIZE) {
+      cfs_close(fd);
+      queue_clear(conn);
+      return;
+    }
+    conn->queue_tail = (conn->queue_head + used) % MQTT_QUEUE_SIZE;
+  }
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+static mqtt_status_t
+queue_append(struct mqtt_connection *conn, char *topic, uint8_t *payload,
+             uint32_t payload_size, mqtt_qos_level_t qos_level,
+             mqtt_retain_t retain)
+{
+  uint8_t header[MQTT_QUEUE_RECORD_HEADER_SIZE];
+  uint8_t end[MQTT_QUEUE_END_MARKER_SIZE];
+  uint16_t topic_length;
+  uint32_t length;
+  uint32_t offset;
+  int fd;
+
+  topic_length = strlen(topic);
+  if(topic_length == 0 || topic_length > MQTT_MAX_TOPIC_LENGTH ||
+     payload_size > MQTT_QUEUE_PAYLOAD_SIZE) {
+    return MQTT_STATUS_INVALID_ARGS_ERROR;
+  }
+
+  /*
+   * A restart replays from the saved head, so the records after it must
+   * not be overwritten. Save the head only when the ring needs the space.
+   */
+  length = sizeof(header) + topic_length + payload_size;
+  if(QUEUE_DISTANCE(conn->queue_saved, conn->queue_tail) + length +
+     sizeof(end) > MQTT_QUEUE_SIZE) {
+    if(QUEUE_DISTANCE(conn->queue_head, conn->queue_tail) + length +
+       sizeof(end) > MQTT_QUEUE_SIZE) {
+      DBG("MQTT - Outbound queue full\n");
+      conn->stats.dropped++;
+      return MQTT_STATUS_OUT_QUEUE_FULL;
+    }
+    queue_save_head(conn);
+    if(conn->queue_saved != conn->queue_head) {
+      conn->stats.dropped++;
+      return MQTT_STATUS_ERROR;
+    }
+  }
+
+  header[0] = topic_length >> 8;
+  header[1] = topic_length & 0x00FF;
+  header[2] = payload_size >> 8;
+  header[3] = payload_size & 0x00FF;
+  header[4] = qos_level;
+  header[5] = retain;
+  memset(end, 0, sizeof(end));
+
+  fd = cfs_open(MQTT_QUEUE_FILE, CFS_READ | CFS_WRITE);
+  if(fd < 0) {
+    conn->stats.dropped++;
+    return MQTT_STATUS_ERROR;
+  }
+  /* The header replaces the old end marker last, which commits the record */
+  offset = conn->queue_tail + sizeof(header);
+  if(!queue_access(fd, (offset + topic_length + payload_size) %
+                   MQTT_QUEUE_SIZE, end, sizeof(end), 1) ||
+     !queue_access(fd, offset % MQTT_QUEUE_SIZE, (uint8_t *)topic,
+                   topic_length, 1) ||
+     !queue_access(fd, (offset + topic_length) % MQTT_QUEUE_SIZE, payload,
+                   payload_size, 1) ||
+     !queue_access(fd, conn->queue_tail, header, sizeof(header), 1)) {
+    /* The queue cannot be trusted beyond this point */
+    cfs_close(fd);
+    conn->stats.dropped++;
+    queue_clear(conn);
+    return MQTT_STATUS_ERROR;
+  }
+  cfs_close(fd);
+
+  conn->queue_tail = (conn->queue_tail + length) % MQTT_QUEUE_SIZE;
+  conn->stats.queued++;
+
+  DBG("MQTT - Queued %lu bytes, queue %lu-%lu\n", (unsigned long)length,
+      (unsigned long)conn->queue_head, (unsigned long)conn->queue_tail);
+
+  return MQTT_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+/* Read the next message to replay into the replay buffers of its entry */
+static int
+queue_load(struct mqtt_connection *conn, struct mqtt_inflight *inflight)
+{
+  uint8_t header[MQTT_QUEUE_RECORD_HEADER_SIZE];
+  uint16_t payload_size;
+  uint32_t offset;
+  int index;
+  int fd;
+
+  index = inflight - conn->inflight;
+  fd = cfs_open(MQTT_QUEUE_FILE, CFS_READ);
+  if(fd < 0) {
+    queue_clear(conn);
+    return 0;
+  }
+  offset = conn->queue_replay;
+  if(!queue_access(fd, offset, header, sizeof(header), 0)) {
+    cfs_close(fd);
+    queue_clear(conn);
+    return 0;
+  }
+
+  inflight->topic_length = (header[0] << 8) | header[1];
+  payload_size = (header[2] << 8) | header[3];
+  offset += sizeof(header);
+  if(inflight->topic_length == 0 ||
+     inflight->topic_length > MQTT_MAX_TOPIC_LENGTH ||
+     payload_size > MQTT_QUEUE_PAYLOAD_SIZE ||
+     !queue_access(fd, offset % MQTT_QUEUE_SIZE,
+                   (uint8_t *)conn->queue_topic[index],
+                   inflight->topic_length, 0) ||
+     !queue_access(fd, (offset + inflight->topic_length) % MQTT_QUEUE_SIZE,
+                   conn->queue_payload[index], payload_size, 0)) {
+    cfs_close(fd);
+    queue_clear(conn);
+    return 0;
+  }
+  cfs_close(fd);
+
+  conn->queue_topic[index][inflight->topic_length] = '\0';
+  inflight->topic = conn->queue_topic[index];
+  inflight->payload = conn->queue_payload[index];
+  inflight->payload_size = payload_size;
+  inflight->qos = header[4];
+  inflight->retain = header[5];
+  inflight->from_queue = 1;
+  inflight->queue_offset = conn->queue_replay;
+  conn->queue_replay = (offset + inflight->topic_length + payload_size) %
+    MQTT_QUEUE_SIZE;
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Move the head up to the oldest replayed message that is still in the
+ * window. Acknowledgements may arrive out of order.
+ */
+static void
+queue_advance(struct mqtt_connection *conn)
+{
+  uint32_t oldest;
+  uint32_t distance;
+  int i;
+
+  oldest = QUEUE_DISTANCE(conn->queue_head, conn->queue_replay);
+  for(i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    if(conn->inflight[i].state != MQTT_INFLIGHT_FREE &&
+       conn->inflight[i].from_queue) {
+      distance = QUEUE_DISTANCE(conn->queue_head,
+                                conn->inflight[i].queue_offset);
+      if(distance < oldest) {
+        oldest = distance;
+      }
+    }
+  }
+  conn->queue_head = (conn->queue_head + oldest) % MQTT_QUEUE_SIZE;
+
+  if(conn->queue_head == conn->queue_tail) {
+    queue_save_head(conn);
+  }
+}
+#endif /* MQTT_QUEUE */
+/*---------------------------------------------------------------------------*/
+#if MQTT_INFLIGHT_WINDOW
+static struct mqtt_inflight *
+inflight_find(struct mqtt_connection *conn, uint16_t mid,
+              mqtt_inflight_state_t state)
+{
+  int i;
+
+  for(i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    if(conn->inflight[i].state == state && conn->inflight[i].mid == mid) {
+      return &conn->inflight[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+inflight_in_use(struct mqtt_connection *conn, uint16_t mid)
+{
+  int i;
+
+  for(i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    if(conn->inflight[i].state != MQTT_INFLIGHT_FREE &&
+       conn->inflight[i].mid == mid) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Take a free window entry and give it a message ID nobody else uses */
+static struct mqtt_inflight *
+inflight_alloc(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight *inflight;
+  int i;
+
+  inflight = NULL;
+  for(i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    if(conn->inflight[i].state == MQTT_INFLIGHT_FREE) {
+      inflight = &conn->inflight[i];
+      break;
+    }
+  }
+  if(inflight == NULL) {
+    return NULL;
+  }
+
+  memset(inflight, 0, sizeof(*inflight));
+  inflight->mid = next_mid(conn);
+  inflight->state = MQTT_INFLIGHT_SEND;
+  return inflight;
+}
+/*---------------------------------------------------------------------------*/
+/* The next entry that has something to send, PUBRELs first */
+static struct mqtt_inflight *
+inflight_next(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight *next;
+  int i;
+
+  next = NULL;
+  for(i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    if(conn->inflight[i].state == MQTT_INFLIGHT_SEND_PUBREL) {
+      return &conn->inflight[i];
+    }
+    if(conn->inflight[i].state == MQTT_INFLIGHT_SEND && next == NULL) {
+      next = &conn->inflight[i];
+    }
+  }
+
+#if MQTT_QUEUE
+  /* Replay the queue in order, as many messages as the window has room for */
+  if(next == NULL && conn->queue_replay != conn->queue_tail) {
+    next = inflight_alloc(conn);
+    if(next != NULL && !queue_load(conn, next)) {
+      next->state = MQTT_INFLIGHT_FREE;
+      next = NULL;
+    }
+  }
+#endif /* MQTT_QUEUE */
+
+  return next;
+}
+/*---------------------------------------------------------------------------*/
+static int
+inflight_pending(struct mqtt_connection *conn)
+{
+  int i;
+#if MQTT_QUEUE
+  int room;
+
+  room = 0;
+#endif /* MQTT_QUEUE */
+  for(i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    if(conn->inflight[i].state == MQTT_INFLIGHT_SEND ||
+       conn->inflight[i].state == MQTT_INFLIGHT_SEND_PUBREL) {
+      return 1;
+    }
+#if MQTT_QUEUE
+    if(conn->inflight[i].state == MQTT_INFLIGHT_FREE) {
+      room = 1;
+    }
+#endif /* MQTT_QUEUE */
+  }
+#if MQTT_QUEUE
+  if(room && conn->queue_replay != conn->queue_tail) {
+    return 1;
+  }
+#endif /* MQTT_QUEUE */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Have mqtt_process send the next window entry if it can do so now */
+static void
+inflight_kick(struct mqtt_connection *conn)
+{
+  if(!conn->inflight_kicked && conn->out_buffer_sent && !conn->out_queue_full &&
+     conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER &&
+     inflight_pending(conn)) {
+    if(process_post(&mqtt_process, mqtt_do_inflight_event, conn) ==
+       PROCESS_ERR_OK) {
+      conn->inflight_kicked = 1;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+inflight_sent(struct mqtt_connection *conn, struct mqtt_inflight *inflight)
+{
+  if(inflight->dup) {
+    conn->stats.retransmitted++;
+  } else {
+    conn->stats.published++;
+  }
+  inflight->sent = clock_time();
+  if(inflight->qos == MQTT_QOS_LEVEL_1) {
+    inflight->state = MQTT_INFLIGHT_WAIT_PUBACK;
+  } else {
+    inflight->state = MQTT_INFLIGHT_WAIT_PUBREC;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+inflight_complete(struct mqtt_connection *conn, struct mqtt_inflight *inflight)
+{
+  clock_time_t latency;
+
+  latency = clock_time() - inflight->sent;
+  conn->stats.completed++;
+  conn->stats.completed_bytes += inflight->payload_size;
+  conn->stats.latency_total += latency;
+  if(latency > conn->stats.latency_max) {
+    conn->stats.latency_max = latency;
+  }
+
+  inflight->state = MQTT_INFLIGHT_FREE;
+#if MQTT_QUEUE
+  if(inflight->from_queue) {
+    queue_advance(conn);
+  }
+#endif /* MQTT_QUEUE */
+  inflight_kick(conn);
+}
+/*---------------------------------------------------------------------------*/
+/* Everything that was not acknowledged is sent again on the next connection */
+static void
+inflight_reconnect(struct mqtt_connection *conn)
+{
+  int i;
+
+  conn->inflight_kicked = 0;
+  for(i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    switch(conn->inflight[i].state) {
+    case MQTT_INFLIGHT_WAIT_PUBACK:
+    case MQTT_INFLIGHT_WAIT_PUBREC:
+      conn->inflight[i].state = MQTT_INFLIGHT_SEND;
+      conn->inflight[i].dup = 1;
+      break;
+    case MQTT_INFLIGHT_WAIT_PUBCOMP:
+      conn->inflight[i].state = MQTT_INFLIGHT_SEND_PUBREL;
+      break;
+    default:
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+inflight_load_packet(struct mqtt_connection *conn,
+                     struct mqtt_inflight *inflight)
+{
+  conn->out_queue_full = 1;
+  conn->out_packet.mid = inflight->mid;
+  conn->out_packet.retain = inflight->retain;
+  conn->out_packet.topic = inflight->topic;
+  conn->out_packet.topic_length = inflight->topic_length;
+  conn->out_packet.payload = inflight->payload;
+  conn->out_packet.payload_size = inflight->payload_size;
+  conn->out_packet.qos = inflight->qos;
+  conn->out_packet.qos_state = MQTT_QOS_STATE_NO_ACK;
+  conn->out_packet.inflight = inflight;
+}
+#endif /* MQTT_INFLIGHT_WINDOW */
+/*---------------------------------------------------------------------------*/
+/* A message ID that no PUBLISH in the window is waiting with */
+static uint16_t
+next_mid(struct mqtt_connection *conn)
+{
+  INCREMENT_MID(conn);
+#if MQTT_INFLIGHT_WINDOW
+  while(inflight_in_use(conn, conn->mid_counter)) {
+    INCREMENT_MID(conn);
+  }
+#endif /* MQTT_INFLIGHT_WINDOW */
+  return conn->mid_counter;
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(connect_pt(struct pt *pt, struct mqtt_connection *conn))
 {
@@ -530,7 +1048,7 @@ PT_THREAD(subscribe_pt(struct pt *pt, struct mqtt_connection *conn))
                       conn->out_packet.remaining_length_enc,
                       conn->out_packet.remaining_length_enc_bytes);
   /* Write Variable Header */
-  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid << 8));
+  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid >> 8));
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
   /* Write Payload */
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length >> 8));
@@ -592,7 +1110,7 @@ PT_THREAD(unsubscribe_pt(struct pt *pt, struct mqtt_connection *conn))
   PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.remaining_length_enc,
                       conn->out_packet.remaining_length_enc_bytes);
   /* Write Variable Header */
-  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid << 8));
+  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid >> 8));
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
   /* Write Payload */
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length >> 8));
@@ -640,6 +1158,11 @@ PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
   if(conn->out_packet.retain == MQTT_RETAIN_ON) {
     conn->out_packet.fhdr |= MQTT_FHDR_RETAIN_FLAG;
   }
+#if MQTT_INFLIGHT_WINDOW
+  if(conn->out_packet.inflight != NULL && conn->out_packet.inflight->dup) {
+    conn->out_packet.fhdr |= MQTT_FHDR_DUP_FLAG;
+  }
+#endif /* MQTT_INFLIGHT_WINDOW */
   conn->out_packet.remaining_length = MQTT_STRING_LEN_SIZE +
     conn->out_packet.topic_length +
     conn->out_packet.payload_size;
@@ -662,10 +1185,36 @@ PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
   /* Write Variable Header */
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length >> 8));
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length & 0x00FF));
+#if MQTT_SCATTER_GATHER
+  /* The rest is gathered by TCP from the topic and payload buffers */
+  conn->out_mid[0] = conn->out_packet.mid >> 8;
+  conn->out_mid[1] = conn->out_packet.mid & 0x00FF;
+  conn->out_segments[0].data = (uint8_t *)conn->out_packet.topic;
+  conn->out_segments[0].len = conn->out_packet.topic_length;
+  conn->out_segments[1].data = conn->out_mid;
+  conn->out_segments[1].len =
+    conn->out_packet.qos > MQTT_QOS_LEVEL_0 ? MQTT_MID_SIZE : 0;
+  conn->out_segments[2].data = conn->out_packet.payload;
+  conn->out_segments[2].len = conn->out_packet.payload_size;
+
+  send_out_buffer(conn);
+  tcp_socket_send_segments(&conn->socket, conn->out_segments, 3);
+  conn->out_buffer_sent = 0;
+#if MQTT_INFLIGHT_WINDOW
+  /* A PUBACK or PUBREC may arrive along with the last TCP ACK, before this
+     thread runs again */
+  if(conn->out_packet.qos > MQTT_QOS_LEVEL_0) {
+    inflight_sent(conn, conn->out_packet.inflight);
+  }
+#endif /* MQTT_INFLIGHT_WINDOW */
+
+  /* The buffers are read until the whole message has been acknowledged */
+  PT_WAIT_UNTIL(pt, conn->out_buffer_sent);
+#else /* MQTT_SCATTER_GATHER */
   PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.topic,
                       conn->out_packet.topic_length);
   if(conn->out_packet.qos > MQTT_QOS_LEVEL_0) {
-    PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid << 8));
+    PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid >> 8));
     PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
   }
   /* Write Payload */
@@ -674,6 +1223,7 @@ PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
                       conn->out_packet.payload_size);
 
   send_out_buffer(conn);
+#endif /* MQTT_SCATTER_GATHER */
   timer_set(&conn->t, RESPONSE_WAIT_TIMEOUT);
 
   /*
@@ -684,6 +1234,12 @@ PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
    */
   if(conn->out_packet.qos == 0) {
     process_post(conn->app_process, mqtt_update_event, NULL);
+#if MQTT_INFLIGHT_WINDOW
+  } else if(!MQTT_SCATTER_GATHER) {
+    /* The acknowledgements are matched against the window as they arrive */
+    inflight_sent(conn, conn->out_packet.inflight);
+  }
+#else /* MQTT_INFLIGHT_WINDOW */
   } else if(conn->out_packet.qos == 1) {
     /* Wait for PUBACK */
     reset_packet(&conn->in_packet);
@@ -702,15 +1258,44 @@ PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
   }
 
   reset_packet(&conn->in_packet);
+#endif /* MQTT_INFLIGHT_WINDOW */
 
   /* This is clear after the entire transaction is complete */
   conn->out_queue_full = 0;
+#if MQTT_INFLIGHT_WINDOW
+  conn->out_packet.inflight = NULL;
+#endif /* MQTT_INFLIGHT_WINDOW */
 
   DBG("MQTT - Publish Enqueued\n");
 
   PT_END(pt);
 }
 /*---------------------------------------------------------------------------*/
+#if MQTT_INFLIGHT_WINDOW
+static
+PT_THREAD(pubrel_pt(struct pt *pt, struct mqtt_connection *conn))
+{
+  PT_BEGIN(pt);
+
+  DBG("MQTT - Sending PUBREL for %u\n", conn->out_packet.mid);
+
+  /* Write Fixed Header */
+  PT_MQTT_WRITE_BYTE(conn, MQTT_FHDR_MSG_TYPE_PUBREL | MQTT_FHDR_QOS_LEVEL_1);
+  PT_MQTT_WRITE_BYTE(conn, MQTT_MID_SIZE);
+  /* Write Variable Header */
+  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid >> 8));
+  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
+
+  send_out_buffer(conn);
+
+  conn->out_packet.inflight->state = MQTT_INFLIGHT_WAIT_PUBCOMP;
+  conn->out_packet.inflight = NULL;
+  conn->out_queue_full = 0;
+
+  PT_END(pt);
+}
+#endif /* MQTT_INFLIGHT_WINDOW */
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(pingreq_pt(struct pt *pt, struct mqtt_connection *conn))
 {
@@ -761,6 +1346,11 @@ handle_connack(struct mqtt_connection *conn)
   /* Always reset packet before callback since it might be used directly */
   conn->state = MQTT_CONN_STATE_CONNECTED_TO_BROKER;
   call_event(conn, MQTT_EVENT_CONNECTED, NULL);
+
+#if MQTT_INFLIGHT_WINDOW
+  /* Resend what was not acknowledged and replay the queue */
+  inflight_kick(conn);
+#endif /* MQTT_INFLIGHT_WINDOW */
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -818,15 +1408,73 @@ handle_unsuback(struct mqtt_connection *conn)
 static void
 handle_puback(struct mqtt_connection *conn)
 {
+#if MQTT_INFLIGHT_WINDOW
+  struct mqtt_inflight *inflight;
+#endif /* MQTT_INFLIGHT_WINDOW */
+
   DBG("MQTT - Got PUBACK\n");
 
-  conn->out_packet.qos_state = MQTT_QOS_STATE_GOT_ACK;
   conn->in_packet.mid = (conn->in_packet.payload[0] << 8) |
     (conn->in_packet.payload[1]);
 
+#if MQTT_INFLIGHT_WINDOW
+  inflight = inflight_find(conn, conn->in_packet.mid,
+                           MQTT_INFLIGHT_WAIT_PUBACK);
+  if(inflight == NULL) {
+    DBG("MQTT - Got PUBACK for unknown MID %u\n", conn->in_packet.mid);
+    return;
+  }
+  inflight_complete(conn, inflight);
+#else /* MQTT_INFLIGHT_WINDOW */
+  conn->out_packet.qos_state = MQTT_QOS_STATE_GOT_ACK;
+#endif /* MQTT_INFLIGHT_WINDOW */
+
   call_event(conn, MQTT_EVENT_PUBACK, &conn->in_packet.mid);
 }
 /*---------------------------------------------------------------------------*/
+#if MQTT_INFLIGHT_WINDOW
+static void
+handle_pubrec(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight *inflight;
+
+  DBG("MQTT - Got PUBREC\n");
+
+  conn->in_packet.mid = (conn->in_packet.payload[0] << 8) |
+    (conn->in_packet.payload[1]);
+
+  inflight = inflight_find(conn, conn->in_packet.mid,
+                           MQTT_INFLIGHT_WAIT_PUBREC);
+  if(inflight == NULL) {
+    DBG("MQTT - Got PUBREC for unknown MID %u\n", conn->in_packet.mid);
+    return;
+  }
+  inflight->state = MQTT_INFLIGHT_SEND_PUBREL;
+  inflight_kick(conn);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_pubcomp(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight *inflight;
+
+  DBG("MQTT - Got PUBCOMP\n");
+
+  conn->in_packet.mid = (conn->in_packet.payload[0] << 8) |
+    (conn->in_packet.payload[1]);
+
+  inflight = inflight_find(conn, conn->in_packet.mid,
+                           MQTT_INFLIGHT_WAIT_PUBCOMP);
+  if(inflight == NULL) {
+    DBG("MQTT - Got PUBCOMP for unknown MID %u\n", conn->in_packet.mid);
+    return;
+  }
+  inflight_complete(conn, inflight);
+
+  call_event(conn, MQTT_EVENT_PUBCOMP, &conn->in_packet.mid);
+}
+#endif /* MQTT_INFLIGHT_WINDOW */
+/*---------------------------------------------------------------------------*/
 static void
 handle_publish(struct mqtt_connection *conn)
 {
@@ -907,21 +1555,20 @@ parse_publish_vhdr(struct mqtt_connection *conn,
   }
 }
 /*---------------------------------------------------------------------------*/
-static int
-tcp_input(struct tcp_socket *s,
-          void *ptr,
-          const uint8_t *input_data_ptr,
-          int input_data_len)
+/*
+ * Reads input until the end of the current packet and handles it. Returns the
+ * number of bytes used, the rest belongs to the next packet.
+ */
+static uint32_t
+input_packet(struct mqtt_connection *conn,
+             const uint8_t *input_data_ptr,
+             int input_data_len)
 {
-  struct mqtt_connection *conn = ptr;
   uint32_t pos = 0;
   uint32_t copy_bytes = 0;
+  uint32_t packet_end;
   uint8_t byte;
 
-  if(input_data_len == 0) {
-    return 0;
-  }
-
   if(conn->in_packet.packet_received) {
     reset_packet(&conn->in_packet);
   }
@@ -936,7 +1583,7 @@ tcp_input(struct tcp_socket *s,
     DBG("MQTT - Read VHDR '%02X'\n", conn->in_packet.fhdr);
 
     if(pos >= input_data_len) {
-      return 0;
+      return pos;
     }
   }
 
@@ -944,7 +1591,7 @@ tcp_input(struct tcp_socket *s,
   if(!conn->in_packet.has_remaining_length) {
     do {
       if(pos >= input_data_len) {
-        return 0;
+        return pos;
       }
 
       byte = input_data_ptr[pos++];
@@ -955,7 +1602,7 @@ tcp_input(struct tcp_socket *s,
       if(conn->in_packet.byte_counter > 5) {
         call_event(conn, MQTT_EVENT_ERROR, NULL);
         DBG("Received more then 4 byte 'remaining lenght'.");
-        return 0;
+        return input_data_len;
       }
 
       conn->in_packet.remaining_length +=
@@ -967,6 +1614,12 @@ tcp_input(struct tcp_socket *s,
     conn->in_packet.has_remaining_length = 1;
   }
 
+  packet_end = MQTT_FHDR_SIZE + conn->in_packet.remaining_length_bytes +
+    conn->in_packet.remaining_length;
+  if(pos >= input_data_len && conn->in_packet.byte_counter < packet_end) {
+    return pos;
+  }
+
   /*
    * Check for unsupported payload length. Will read all incoming data from the
    * server in any case and then reset the packet.
@@ -978,12 +1631,13 @@ tcp_input(struct tcp_socket *s,
 
     PRINTF("MQTT - Error, unsupported payload size for non-PUBLISH message\n");
 
-    conn->in_packet.byte_counter += input_data_len;
-    if(conn->in_packet.byte_counter >=
-       (MQTT_FHDR_SIZE + conn->in_packet.remaining_length)) {
+    copy_bytes = MIN(input_data_len - pos,
+                     packet_end - conn->in_packet.byte_counter);
+    conn->in_packet.byte_counter += copy_bytes;
+    if(conn->in_packet.byte_counter >= packet_end) {
       conn->in_packet.packet_received = 1;
     }
-    return 0;
+    return pos + copy_bytes;
   }
 
   /*
@@ -992,8 +1646,7 @@ tcp_input(struct tcp_socket *s,
    * Note: There will always be at least one byte left to read when we enter
    *       this loop.
    */
-  while(conn->in_packet.byte_counter <
-        (MQTT_FHDR_SIZE + conn->in_packet.remaining_length)) {
+  while(conn->in_packet.byte_counter < packet_end) {
 
     if((conn->in_packet.fhdr & 0xF0) == MQTT_FHDR_MSG_TYPE_PUBLISH &&
        conn->in_packet.topic_received == 0) {
@@ -1003,6 +1656,7 @@ tcp_input(struct tcp_socket *s,
     /* Read in as much as we can into the packet payload */
     copy_bytes = MIN(input_data_len - pos,
                      MQTT_INPUT_BUFF_SIZE - conn->in_packet.payload_pos);
+    copy_bytes = MIN(copy_bytes, packet_end - conn->in_packet.byte_counter);
     DBG("- Copied %lu payload bytes\n", copy_bytes);
     memcpy(&conn->in_packet.payload[conn->in_packet.payload_pos],
            &input_data_ptr[pos],
@@ -1030,9 +1684,8 @@ tcp_input(struct tcp_socket *s,
       conn->in_packet.payload_pos = 0;
     }
 
-    if(pos >= input_data_len &&
-       (conn->in_packet.byte_counter < (MQTT_FHDR_SIZE + conn->in_packet.remaining_length))) {
-      return 0;
+    if(pos >= input_data_len && conn->in_packet.byte_counter < packet_end) {
+      return pos;
     }
   }
 
@@ -1041,8 +1694,8 @@ tcp_input(struct tcp_socket *s,
   /* Take care of input */
   DBG("MQTT - Finished reading packet!\n");
   /* What to return? */
-  DBG("MQTT - total data was %i bytes of data. \n",
-      (MQTT_FHDR_SIZE + conn->in_packet.remaining_length));
+  DBG("MQTT - total data was %lu bytes of data. \n",
+      (unsigned long)packet_end);
 
   /* Handle packet here. */
   switch(conn->in_packet.fhdr & 0xF0) {
@@ -1068,11 +1721,21 @@ tcp_input(struct tcp_socket *s,
   case MQTT_FHDR_MSG_TYPE_PINGRESP:
     handle_pingresp(conn);
     break;
+#if MQTT_INFLIGHT_WINDOW
+  case MQTT_FHDR_MSG_TYPE_PUBREC:
+    handle_pubrec(conn);
+    break;
+  case MQTT_FHDR_MSG_TYPE_PUBCOMP:
+    handle_pubcomp(conn);
+    break;
+#endif /* MQTT_INFLIGHT_WINDOW */
 
   /* QoS 2 not implemented yet */
+#if !MQTT_INFLIGHT_WINDOW
   case MQTT_FHDR_MSG_TYPE_PUBREC:
-  case MQTT_FHDR_MSG_TYPE_PUBREL:
   case MQTT_FHDR_MSG_TYPE_PUBCOMP:
+#endif /* !MQTT_INFLIGHT_WINDOW */
+  case MQTT_FHDR_MSG_TYPE_PUBREL:
     call_event(conn, MQTT_EVENT_NOT_IMPLEMENTED_ERROR, NULL);
     PRINTF("MQTT - Got unhandled MQTT Message Type '%i'",
            (conn->in_packet.fhdr & 0xF0));
@@ -1086,6 +1749,23 @@ tcp_input(struct tcp_socket *s,
 
   conn->in_packet.packet_received = 1;
 
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static int
+tcp_input(struct tcp_socket *s,
+          void *ptr,
+          const uint8_t *input_data_ptr,
+          int input_data_len)
+{
+  struct mqtt_connection *conn = ptr;
+  uint32_t pos = 0;
+
+  /* A segment can hold several packets, e.g. PUBACKs for a whole window */
+  while(pos < input_data_len) {
+    pos += input_packet(conn, &input_data_ptr[pos], input_data_len - pos);
+  }
+
   return 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -1128,9 +1808,16 @@ tcp_event(struct tcp_socket *s, void *ptr, tcp_socket_event_t event)
   case TCP_SOCKET_DATA_SENT: {
     DBG("MQTT - Got TCP_DATA_SENT\n");
 
-    if(conn->socket.output_data_len == 0) {
+    if(conn->socket.output_data_len == 0
+#if MQTT_SCATTER_GATHER
+       && !tcp_socket_segments_pending(&conn->socket)
+#endif /* MQTT_SCATTER_GATHER */
+       ) {
       conn->out_buffer_sent = 1;
       conn->out_buffer_ptr = conn->out_buffer;
+#if MQTT_INFLIGHT_WINDOW
+      inflight_kick(conn);
+#endif /* MQTT_INFLIGHT_WINDOW */
     }
 
     ctimer_restart(&conn->keep_alive_timer);
@@ -1147,6 +1834,9 @@ tcp_event(struct tcp_socket *s, void *ptr, tcp_socket_event_t event)
 PROCESS_THREAD(mqtt_process, ev, data)
 {
   static struct mqtt_connection *conn;
+#if MQTT_INFLIGHT_WINDOW
+  static struct mqtt_inflight *inflight;
+#endif /* MQTT_INFLIGHT_WINDOW */
 
   PROCESS_BEGIN();
 
@@ -1249,6 +1939,36 @@ PROCESS_THREAD(mqtt_process, ev, data)
         }
       }
     }
+#if MQTT_INFLIGHT_WINDOW
+    if(ev == mqtt_do_inflight_event) {
+      conn = data;
+      conn->inflight_kicked = 0;
+      DBG("MQTT - Got mqtt_do_inflight_event!\n");
+
+      if(conn->out_buffer_sent == 1 && !conn->out_queue_full &&
+         conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER &&
+         (inflight = inflight_next(conn)) != NULL) {
+        inflight_load_packet(conn, inflight);
+        PT_INIT(&conn->out_proto_thread);
+        if(inflight->state == MQTT_INFLIGHT_SEND_PUBREL) {
+          while(pubrel_pt(&conn->out_proto_thread, conn) < PT_EXITED &&
+                conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+            PT_MQTT_WAIT_SEND();
+          }
+        } else {
+          while(publish_pt(&conn->out_proto_thread, conn) < PT_EXITED &&
+                conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+            PT_MQTT_WAIT_SEND();
+          }
+        }
+      }
+    }
+
+    /* Continue with the window once whatever was being sent is done */
+    if(conn != NULL && ev != mqtt_continue_send_event) {
+      inflight_kick(conn);
+    }
+#endif /* MQTT_INFLIGHT_WINDOW */
   }
   PROCESS_END();
 }
@@ -1267,6 +1987,9 @@ mqtt_init(void)
     mqtt_do_unsubscribe_event = process_alloc_event();
     mqtt_do_publish_event = process_alloc_event();
     mqtt_do_pingreq_event = process_alloc_event();
+#if MQTT_INFLIGHT_WINDOW
+    mqtt_do_inflight_event = process_alloc_event();
+#endif /* MQTT_INFLIGHT_WINDOW */
     mqtt_update_event = process_alloc_event();
     mqtt_abort_now_event = process_alloc_event();
     mqtt_event_max = mqtt_abort_now_event;
@@ -1296,6 +2019,9 @@ mqtt_register(struct mqtt_connection *conn, struct process *app_process,
   conn->auto_reconnect = 1;
   conn->max_segment_size = max_segment_size;
   reset_defaults(conn);
+#if MQTT_QUEUE
+  queue_init(conn);
+#endif /* MQTT_QUEUE */
 
   mqtt_init();
   list_add(mqtt_conn_list, conn);
@@ -1375,7 +2101,7 @@ mqtt_subscribe(struct mqtt_connection *conn, uint16_t *mid, char *topic,
   conn->out_queue_full = 1;
   DBG("MQTT - Accepted!\n");
 
-  conn->out_packet.mid = INCREMENT_MID(conn);
+  conn->out_packet.mid = next_mid(conn);
   conn->out_packet.topic = topic;
   conn->out_packet.topic_length = strlen(topic);
   conn->out_packet.qos = qos_level;
@@ -1401,7 +2127,7 @@ mqtt_unsubscribe(struct mqtt_connection *conn, uint16_t *mid, char *topic)
   conn->out_queue_full = 1;
   DBG("MQTT - Accepted!\n");
 
-  conn->out_packet.mid = INCREMENT_MID(conn);
+  conn->out_packet.mid = next_mid(conn);
   conn->out_packet.topic = topic;
   conn->out_packet.topic_length = strlen(topic);
   conn->out_packet.qos_state = MQTT_QOS_STATE_NO_ACK;
@@ -1415,12 +2141,61 @@ mqtt_publish(struct mqtt_connection *conn, uint16_t *mid, char *topic,
              uint8_t *payload, uint32_t payload_size,
              mqtt_qos_level_t qos_level, mqtt_retain_t retain)
 {
+#if MQTT_INFLIGHT_WINDOW
+  struct mqtt_inflight *inflight;
+#endif /* MQTT_INFLIGHT_WINDOW */
+
+#if MQTT_QUEUE
+  /* Queue behind older messages, or until the broker is reachable again */
+  if(qos_level > MQTT_QOS_LEVEL_0 &&
+     (conn->state != MQTT_CONN_STATE_CONNECTED_TO_BROKER ||
+      conn->queue_head != conn->queue_tail)) {
+    if(mid != NULL) {
+      *mid = 0;
+    }
+    return queue_append(conn, topic, payload, payload_size, qos_level, retain);
+  }
+#endif /* MQTT_QUEUE */
+
   if(conn->state != MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
     return MQTT_STATUS_NOT_CONNECTED_ERROR;
   }
 
   DBG("MQTT - Call to mqtt_publish...\n");
 
+#if MQTT_INFLIGHT_WINDOW
+  if(qos_level > MQTT_QOS_LEVEL_0) {
+    inflight = inflight_alloc(conn);
+    if(inflight == NULL) {
+#if MQTT_QUEUE
+      if(mid != NULL) {
+        *mid = 0;
+      }
+      return queue_append(conn, topic, payload, payload_size, qos_level,
+                          retain);
+#else /* MQTT_QUEUE */
+      DBG("MQTT - Not accepted, window full!\n");
+      return MQTT_STATUS_OUT_QUEUE_FULL;
+#endif /* MQTT_QUEUE */
+    }
+    DBG("MQTT - Accepted as MID %u!\n", inflight->mid);
+
+    inflight->retain = retain;
+    inflight->topic = topic;
+    inflight->topic_length = strlen(topic);
+    inflight->payload = payload;
+    inflight->payload_size = payload_size;
+    inflight->qos = qos_level;
+    if(mid != NULL) {
+      *mid = inflight->mid;
+    }
+
+    /* mqtt_process sends the window in order, see inflight_next() */
+    inflight_kick(conn);
+    return MQTT_STATUS_OK;
+  }
+#endif /* MQTT_INFLIGHT_WINDOW */
+
   /* Currently don't have a queue, so only one item at a time */
   if(conn->out_queue_full) {
     DBG("MQTT - Not accepted!\n");
@@ -1429,7 +2204,7 @@ mqtt_publish(struct mqtt_connection *conn, uint16_t *mid, char *topic,
   conn->out_queue_full = 1;
   DBG("MQTT - Accepted!\n");
 
-  conn->out_packet.mid = INCREMENT_MID(conn);
+  conn->out_packet.mid = next_mid(conn);
   conn->out_packet.retain = retain;
   conn->out_packet.topic = topic;
   conn->out_packet.topic_length = strlen(topic);
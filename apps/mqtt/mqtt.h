@@ -61,7 +61,7 @@
  *  -- "Exactly once" (2), where message are assured to arrive exactly once.
  *  This level could be used, for example, with billing systems where duplicate
  *  or lost messages could lead to incorrect charges being applied. This QoS
- *  level is currently not supported in this implementation.
+ *  level requires MQTT_CONF_INFLIGHT_WINDOW in this implementation.
  *
  * - A small transport overhead and protocol exchanges minimized to reduce
  *   network traffic.
@@ -117,6 +117,68 @@
 #define MQTT_PROTOCOL_VERSION 3
 #define MQTT_PROTOCOL_NAME "MQIsdp"
 #define MQTT_TOPIC_MAX_LENGTH 128
+
+/*
+ * Number of QoS 1 and 2 PUBLISH messages that may await their PUBACK or
+ * PUBCOMP at the same time. With 0, each publish blocks the connection until
+ * it has been acknowledged, and QoS 2 is not supported.
+ */
+#ifdef MQTT_CONF_INFLIGHT_WINDOW
+#define MQTT_INFLIGHT_WINDOW MQTT_CONF_INFLIGHT_WINDOW
+#else
+#define MQTT_INFLIGHT_WINDOW 0
+#endif
+
+/*
+ * Keep QoS 1 and 2 messages that are published while the window is full or
+ * the broker is unreachable in a CFS file, and replay them once connected.
+ * The file is used as a ring buffer and must allow writes in place, as
+ * Coffee does. Only one connection can use the queue.
+ */
+#ifdef MQTT_CONF_QUEUE
+#define MQTT_QUEUE MQTT_CONF_QUEUE
+#else
+#define MQTT_QUEUE 0
+#endif
+
+#if MQTT_QUEUE && !MQTT_INFLIGHT_WINDOW
+#error "MQTT_CONF_QUEUE requires MQTT_CONF_INFLIGHT_WINDOW"
+#endif
+
+#ifdef MQTT_CONF_QUEUE_FILE
+#define MQTT_QUEUE_FILE MQTT_CONF_QUEUE_FILE
+#else
+#define MQTT_QUEUE_FILE "mqtt-q"
+#endif
+
+/* Size of the queue file in bytes, the ring wraps around at this offset */
+#ifdef MQTT_CONF_QUEUE_SIZE
+#define MQTT_QUEUE_SIZE MQTT_CONF_QUEUE_SIZE
+#else
+#define MQTT_QUEUE_SIZE 2048
+#endif
+
+/* Largest payload that can be queued */
+#ifdef MQTT_CONF_QUEUE_PAYLOAD_SIZE
+#define MQTT_QUEUE_PAYLOAD_SIZE MQTT_CONF_QUEUE_PAYLOAD_SIZE
+#else
+#define MQTT_QUEUE_PAYLOAD_SIZE 128
+#endif
+
+/*
+ * Hand the topic and payload of a PUBLISH to TCP as a segment list instead of
+ * copying them into the output buffer, which also lifts the output buffer
+ * size limit on payloads.
+ */
+#ifdef MQTT_CONF_SCATTER_GATHER
+#define MQTT_SCATTER_GATHER MQTT_CONF_SCATTER_GATHER
+#else
+#define MQTT_SCATTER_GATHER 0
+#endif
+
+#if MQTT_SCATTER_GATHER && !TCP_SOCKET_SEGMENTS
+#error "MQTT_CONF_SCATTER_GATHER requires TCP_SOCKET_CONF_SEGMENTS"
+#endif
 /*---------------------------------------------------------------------------*/
 /*
  * Debug configuration, this is similar but not exactly like the Debugging
@@ -151,6 +213,7 @@ typedef enum {
   MQTT_EVENT_UNSUBACK,
   MQTT_EVENT_PUBLISH,
   MQTT_EVENT_PUBACK,
+  MQTT_EVENT_PUBCOMP,
 
   /* Errors */
   MQTT_EVENT_ERROR = 0x80,
@@ -185,6 +248,18 @@ typedef enum {
 
   /* Expand for QoS 2 */
 } mqtt_qos_state_t;
+
+#if MQTT_INFLIGHT_WINDOW
+/* State of a QoS 1 or 2 PUBLISH in the in-flight window */
+typedef enum {
+  MQTT_INFLIGHT_FREE,
+  MQTT_INFLIGHT_SEND,
+  MQTT_INFLIGHT_WAIT_PUBACK,
+  MQTT_INFLIGHT_WAIT_PUBREC,
+  MQTT_INFLIGHT_SEND_PUBREL,
+  MQTT_INFLIGHT_WAIT_PUBCOMP,
+} mqtt_inflight_state_t;
+#endif /* MQTT_INFLIGHT_WINDOW */
 /*---------------------------------------------------------------------------*/
 /*
  * This is the state of the connection itself.
@@ -283,7 +358,47 @@ struct mqtt_out_packet {
   mqtt_qos_level_t qos;
   mqtt_qos_state_t qos_state;
   mqtt_retain_t retain;
+#if MQTT_INFLIGHT_WINDOW
+  /* Window entry of a QoS 1 or 2 PUBLISH */
+  struct mqtt_inflight *inflight;
+#endif /* MQTT_INFLIGHT_WINDOW */
+};
+
+#if MQTT_INFLIGHT_WINDOW
+/*
+ * A QoS 1 or 2 PUBLISH that has not been acknowledged yet. Its topic and
+ * payload must stay valid until the PUBACK or PUBCOMP event.
+ */
+struct mqtt_inflight {
+  uint16_t mid;
+  uint8_t state;
+  uint8_t dup;
+  uint8_t from_queue;
+  mqtt_qos_level_t qos;
+  mqtt_retain_t retain;
+  char *topic;
+  uint16_t topic_length;
+  uint8_t *payload;
+  uint32_t payload_size;
+  clock_time_t sent;
+#if MQTT_QUEUE
+  /* Ring offset of the queue record this message was replayed from */
+  uint32_t queue_offset;
+#endif /* MQTT_QUEUE */
 };
+
+/* Counters kept for the QoS 1 and 2 PUBLISH messages of a connection */
+struct mqtt_stats {
+  uint32_t published;         /* sent for the first time */
+  uint32_t retransmitted;     /* sent again after a reconnect */
+  uint32_t completed;         /* acknowledged by PUBACK or PUBCOMP */
+  uint32_t completed_bytes;   /* payload bytes of the completed messages */
+  uint32_t queued;            /* stored in the outbound queue */
+  uint32_t dropped;           /* refused because the queue was full */
+  clock_time_t latency_total; /* last send to acknowledgement, summed */
+  clock_time_t latency_max;
+};
+#endif /* MQTT_INFLIGHT_WINDOW */
 /*---------------------------------------------------------------------------*/
 /**
  * \brief           MQTT event callback function
@@ -348,6 +463,11 @@ struct mqtt_connection {
   struct pt out_proto_thread;
   uint32_t out_write_pos;
   uint16_t max_segment_size;
+#if MQTT_SCATTER_GATHER
+  /* Topic, message ID and payload of the PUBLISH being sent */
+  struct tcp_socket_segment out_segments[3];
+  uint8_t out_mid[2];
+#endif /* MQTT_SCATTER_GATHER */
 
   /* Incoming data related */
   uint8_t in_buffer[MQTT_TCP_INPUT_BUFF_SIZE];
@@ -359,6 +479,28 @@ struct mqtt_connection {
   uip_ipaddr_t server_ip;
   uint16_t server_port;
   struct tcp_socket socket;
+
+#if MQTT_INFLIGHT_WINDOW
+  struct mqtt_inflight inflight[MQTT_INFLIGHT_WINDOW];
+  uint8_t inflight_kicked;
+  struct mqtt_stats stats;
+#endif /* MQTT_INFLIGHT_WINDOW */
+
+#if MQTT_QUEUE
+  /*
+   * Ring offsets of the oldest unacknowledged queued message, of the next
+   * one to replay and of the end of the queue. The head is only written to
+   * the CFS when the ring needs the space, when the queue runs empty and on
+   * disconnects, queue_saved is the head the file holds.
+   */
+  uint32_t queue_head;
+  uint32_t queue_replay;
+  uint32_t queue_tail;
+  uint32_t queue_saved;
+  /* Replay buffers, one per window entry */
+  char queue_topic[MQTT_INFLIGHT_WINDOW][MQTT_MAX_TOPIC_LENGTH + 1];
+  uint8_t queue_payload[MQTT_INFLIGHT_WINDOW][MQTT_QUEUE_PAYLOAD_SIZE];
+#endif /* MQTT_QUEUE */
 };
 /* This is the API exposed to the user. */
 /*---------------------------------------------------------------------------*/
@@ -443,7 +585,8 @@ mqtt_status_t mqtt_unsubscribe(struct mqtt_connection *conn,
  * \param topic A pointer to the topic to subscribe to.
  * \param payload A pointer to the topic payload.
  * \param payload_size Payload size.
- * \param qos_level Quality Of Service level to use. Currently supports 0, 1.
+ * \param qos_level Quality Of Service level to use. Currently supports 0, 1,
+ *        and 2 when MQTT_CONF_INFLIGHT_WINDOW is set.
  * \param retain If the RETAIN flag is set to 1, in a PUBLISH Packet sent by a
  *        Client to a Server, the Server MUST store the Application Message
  *        and its QoS, so that it can be delivered to future subscribers whose
@@ -451,6 +594,17 @@ mqtt_status_t mqtt_unsubscribe(struct mqtt_connection *conn,
  * \return MQTT_STATUS_OK or some error status
  *
  * This function publishes to a topic on a MQTT broker.
+ *
+ * With MQTT_CONF_INFLIGHT_WINDOW, QoS 1 and 2 messages are acknowledged
+ * asynchronously. *mid is set to the message ID reported with the
+ * MQTT_EVENT_PUBACK or MQTT_EVENT_PUBCOMP event, and topic and payload must
+ * remain valid until that event. With MQTT_CONF_QUEUE, messages that cannot
+ * be sent right away are copied to the outbound queue instead of failing,
+ * and *mid is set to 0.
+ *
+ * With MQTT_CONF_SCATTER_GATHER, topic and payload are read directly by TCP
+ * and must not change until mqtt_ready() is true again, and the payload is not
+ * limited by the size of the output buffer.
  */
 mqtt_status_t mqtt_publish(struct mqtt_connection *conn,
                            uint16_t *mid,
@@ -500,6 +654,10 @@ void mqtt_set_last_will(struct mqtt_connection *conn,
 
 #define mqtt_ready(conn) \
   (!(conn)->out_queue_full && mqtt_connected((conn)))
+
+#if MQTT_INFLIGHT_WINDOW
+#define mqtt_stats(conn) ((const struct mqtt_stats *)&(conn)->stats)
+#endif /* MQTT_INFLIGHT_WINDOW */
 /*---------------------------------------------------------------------------*/
 #endif /* MQTT_H_ */
 /*---------------------------------------------------------------------------*/
@@ -59,6 +59,92 @@ PROCESS(rest_engine_process, "REST Engine");
 LIST(restful_services);
 LIST(restful_periodic_services);
 /*---------------------------------------------------------------------------*/
+#if REST_ROUTING_INDEX
+/* Resources chained by the hash of their URL, in the order of the list */
+static resource_t *routes[REST_ROUTING_BUCKETS];
+static uint16_t route_order;
+/*---------------------------------------------------------------------------*/
+static uint16_t
+route_hash_update(uint16_t hash, char c)
+{
+  return (hash << 5) + hash + (uint8_t)c;
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_remove(resource_t *resource)
+{
+  resource_t **r;
+
+  for(r = &routes[resource->route_hash % REST_ROUTING_BUCKETS];
+      *r != NULL; r = &(*r)->route_next) {
+    if(*r == resource) {
+      *r = resource->route_next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_add(resource_t *resource)
+{
+  resource_t **r;
+  const char *c;
+
+  /* The resource may have been activated before */
+  route_remove(resource);
+
+  resource->url_len = strlen(resource->url);
+  resource->route_hash = 5381;
+  for(c = resource->url; *c != '\0'; c++) {
+    resource->route_hash = route_hash_update(resource->route_hash, *c);
+  }
+  /* list_add() moves the resource to the end of the list */
+  resource->route_order = route_order++;
+  resource->route_next = NULL;
+
+  for(r = &routes[resource->route_hash % REST_ROUTING_BUCKETS];
+      *r != NULL; r = &(*r)->route_next);
+  *r = resource;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Find the resource that the linear walk over the resource list would
+ * find: the first one with the URL of the request, or with a prefix of
+ * it up to a '/' if the resource has sub-resources.
+ */
+static resource_t *
+route_lookup(const char *url, int url_len)
+{
+  resource_t *best;
+  resource_t *r;
+  uint16_t hash;
+  int i;
+
+  best = NULL;
+  hash = 5381;
+  for(i = 0; i <= url_len; i++) {
+    if(i == url_len || url[i] == '/') {
+      for(r = routes[hash % REST_ROUTING_BUCKETS]; r != NULL;
+          r = r->route_next) {
+        if(best != NULL && r->route_order > best->route_order) {
+          break;
+        }
+        if(r->route_hash == hash && r->url_len == i
+           && (i == url_len || (r->flags & HAS_SUB_RESOURCES))
+           && strncmp(r->url, url, i) == 0) {
+          best = r;
+          break;
+        }
+      }
+    }
+    if(i < url_len) {
+      hash = route_hash_update(hash, url[i]);
+    }
+  }
+  return best;
+}
+#endif /* REST_ROUTING_INDEX */
+/*---------------------------------------------------------------------------*/
 /*- REST Engine API ---------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
 /**
@@ -104,6 +190,9 @@ rest_activate_resource(resource_t *resource, char *path)
 {
   resource->url = path;
   list_add(restful_services, resource);
+#if REST_ROUTING_INDEX
+  route_add(resource);
+#endif /* REST_ROUTING_INDEX */
 
   PRINTF("Activating: %s\n", resource->url);
 
@@ -132,18 +221,15 @@ rest_get_resources(void)
   return restful_services;
 }
 /*---------------------------------------------------------------------------*/
-int
-rest_invoke_restful_service(void *request, void *response, uint8_t *buffer,
-                            uint16_t buffer_size, int32_t *offset)
+static resource_t *
+find_resource(const char *url, int url_len)
 {
-  uint8_t found = 0;
-  uint8_t allowed = 1;
-
-  resource_t *resource = NULL;
-  const char *url = NULL;
-  int url_len, res_url_len;
+#if REST_ROUTING_INDEX
+  return route_lookup(url, url_len);
+#else /* REST_ROUTING_INDEX */
+  resource_t *resource;
+  int res_url_len;
 
-  url_len = REST.get_url(request, &url);
   for(resource = (resource_t *)list_head(restful_services);
       resource; resource = resource->next) {
 
@@ -154,31 +240,50 @@ rest_invoke_restful_service(void *request, void *response, uint8_t *buffer,
             && (resource->flags & HAS_SUB_RESOURCES)
             && url[res_url_len] == '/'))
        && strncmp(resource->url, url, res_url_len) == 0) {
-      found = 1;
-      rest_resource_flags_t method = REST.get_method_type(request);
-
-      PRINTF("/%s, method %u, resource->flags %u\n", resource->url,
-             (uint16_t)method, resource->flags);
-
-      if((method & METHOD_GET) && resource->get_handler != NULL) {
-        /* call handler function */
-        resource->get_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_POST) && resource->post_handler != NULL) {
-        /* call handler function */
-        resource->post_handler(request, response, buffer, buffer_size,
+      return resource;
+    }
+  }
+  return NULL;
+#endif /* REST_ROUTING_INDEX */
+}
+/*---------------------------------------------------------------------------*/
+int
+rest_invoke_restful_service(void *request, void *response, uint8_t *buffer,
+                            uint16_t buffer_size, int32_t *offset)
+{
+  uint8_t found = 0;
+  uint8_t allowed = 1;
+
+  resource_t *resource = NULL;
+  const char *url = NULL;
+  int url_len;
+
+  url_len = REST.get_url(request, &url);
+  resource = find_resource(url, url_len);
+  if(resource != NULL) {
+    found = 1;
+    rest_resource_flags_t method = REST.get_method_type(request);
+
+    PRINTF("/%s, method %u, resource->flags %u\n", resource->url,
+           (uint16_t)method, resource->flags);
+
+    if((method & METHOD_GET) && resource->get_handler != NULL) {
+      /* call handler function */
+      resource->get_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_POST) && resource->post_handler != NULL) {
+      /* call handler function */
+      resource->post_handler(request, response, buffer, buffer_size,
+                             offset);
+    } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
+      /* call handler function */
+      resource->put_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
+      /* call handler function */
+      resource->delete_handler(request, response, buffer, buffer_size,
                                offset);
-      } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
-        /* call handler function */
-        resource->put_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
-        /* call handler function */
-        resource->delete_handler(request, response, buffer, buffer_size,
-                                 offset);
-      } else {
-        allowed = 0;
-        REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
-      }
-      break;
+    } else {
+      allowed = 0;
+      REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
     }
   }
   if(!found) {
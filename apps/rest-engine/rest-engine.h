@@ -62,6 +62,23 @@
 #define REST_MAX_CHUNK_SIZE     64
 #endif
 
+/*
+ * Keep a hash index over the URLs of the activated resources, so that a
+ * request is dispatched without comparing its URL to every resource.
+ */
+#ifdef REST_CONF_ROUTING_INDEX
+#define REST_ROUTING_INDEX REST_CONF_ROUTING_INDEX
+#else /* REST_CONF_ROUTING_INDEX */
+#define REST_ROUTING_INDEX 0
+#endif /* REST_CONF_ROUTING_INDEX */
+
+/* Number of hash buckets in the routing index */
+#ifdef REST_CONF_ROUTING_BUCKETS
+#define REST_ROUTING_BUCKETS REST_CONF_ROUTING_BUCKETS
+#else /* REST_CONF_ROUTING_BUCKETS */
+#define REST_ROUTING_BUCKETS 16
+#endif /* REST_CONF_ROUTING_BUCKETS */
+
 struct resource_s;
 struct periodic_resource_s;
 
@@ -95,6 +112,12 @@ struct resource_s {
     restful_trigger_handler trigger;
     restful_trigger_handler resume;
   };
+#if REST_ROUTING_INDEX
+  struct resource_s *route_next;  /* next resource in the same routing bucket */
+  uint16_t route_hash;            /* hash of the URL */
+  uint16_t route_order;           /* position in the resource list */
+  uint16_t url_len;               /* length of the URL */
+#endif /* REST_ROUTING_INDEX */
 };
 typedef struct resource_s resource_t;
 
@@ -84,6 +84,53 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING  1
 #endif
 
+/*
+ * Keep a directory cache in RAM that maps hashes of file names to the
+ * pages of the file headers, together with the file lengths. Opening
+ * a file then requires no sequential scan of the storage, and no
+ * backward search for the file end when it has been computed before.
+ */
+#ifndef COFFEE_DIR_CACHE
+#ifdef COFFEE_CONF_DIR_CACHE
+#define COFFEE_DIR_CACHE COFFEE_CONF_DIR_CACHE
+#else
+#define COFFEE_DIR_CACHE 0
+#endif
+#endif
+
+/* The number of files that fit in the directory cache. If there are
+   more files, lookups of uncached names fall back to a storage scan. */
+#ifndef COFFEE_DIR_CACHE_SIZE
+#ifdef COFFEE_CONF_DIR_CACHE_SIZE
+#define COFFEE_DIR_CACHE_SIZE COFFEE_CONF_DIR_CACHE_SIZE
+#else
+#define COFFEE_DIR_CACHE_SIZE 32
+#endif
+#endif
+
+/*
+ * Keep an index in RAM that maps each region of a modified file to
+ * its latest micro log record, so that reads and writes do not have
+ * to search the log index table in the storage.
+ */
+#ifndef COFFEE_LOG_INDEX
+#ifdef COFFEE_CONF_LOG_INDEX
+#define COFFEE_LOG_INDEX COFFEE_CONF_LOG_INDEX
+#else
+#define COFFEE_LOG_INDEX 0
+#endif
+#endif
+
+/* The number of regions that can be indexed for each file. Files
+   whose logs cover more regions are searched in the storage. */
+#ifndef COFFEE_LOG_INDEX_SIZE
+#ifdef COFFEE_CONF_LOG_INDEX_SIZE
+#define COFFEE_LOG_INDEX_SIZE COFFEE_CONF_LOG_INDEX_SIZE
+#else
+#define COFFEE_LOG_INDEX_SIZE (2 * COFFEE_LOG_SIZE / COFFEE_PAGE_SIZE)
+#endif
+#endif
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -96,6 +143,9 @@
 
 /* File object flags. */
 #define COFFEE_FILE_MODIFIED  0x1
+#define COFFEE_FILE_END_CACHED 0x2 /* The directory cache holds the end. */
+#define COFFEE_FILE_LOG_INDEXED 0x4 /* The log index is valid. */
+#define COFFEE_FILE_LOG_UNINDEXED 0x8 /* The log did not fit in the index. */
 
 /* Internal Coffee markers. */
 #define INVALID_PAGE      ((coffee_page_t)-1)
@@ -197,6 +247,30 @@ struct log_param {
   uint16_t size;
 };
 
+#if COFFEE_DIR_CACHE
+/* Directory cache states. */
+#define DIR_CACHE_INVALID  0
+#define DIR_CACHE_COMPLETE 1 /* All files are in the cache. */
+#define DIR_CACHE_PARTIAL  2 /* Some files did not fit in the cache. */
+
+/* An entry in the directory cache. Free entries have the page
+   value INVALID_PAGE. */
+struct dir_cache_entry {
+  cfs_offset_t end;
+  coffee_page_t page;
+  uint16_t hash;
+};
+#endif /* COFFEE_DIR_CACHE */
+
+#if COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX
+/* An entry in a log index. The region number is incremented, as in
+   the log index table, so that free entries have the value zero. */
+struct log_index_entry {
+  uint16_t region;
+  int16_t record;
+};
+#endif /* COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX */
+
 /*
  * Variables that keep track of opened files and internal
  * optimization information for Coffee.
@@ -206,6 +280,19 @@ static struct file_desc coffee_fd_set[COFFEE_FD_SET_SIZE];
 static coffee_page_t next_free;
 static char gc_wait;
 
+#if COFFEE_DIR_CACHE
+/* Open addressing hash table of the files, with linear probing. */
+static struct dir_cache_entry dir_cache[COFFEE_DIR_CACHE_SIZE];
+static uint8_t dir_cache_state;
+static unsigned long dir_cache_hits;
+static unsigned long dir_cache_misses;
+#endif /* COFFEE_DIR_CACHE */
+
+#if COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX
+/* One log index for each entry in coffee_files. */
+static struct log_index_entry log_index[COFFEE_MAX_OPEN_FILES][COFFEE_LOG_INDEX_SIZE];
+#endif /* COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX */
+
 /*---------------------------------------------------------------------------*/
 static void
 write_header(struct file_header *hdr, coffee_page_t page)
@@ -384,6 +471,9 @@ collect_garbage(int mode)
 
       COFFEE_ERASE(sector);
       PRINTF("Coffee: Erased sector %d!\n", sector);
+#if COFFEE_DIR_CACHE
+      dir_cache_state = DIR_CACHE_INVALID;
+#endif /* COFFEE_DIR_CACHE */
 
       if(mode == GC_RELUCTANT && isolation_count > 0) {
         break;
@@ -452,12 +542,203 @@ load_file(coffee_page_t start, struct file_header *hdr)
   return file;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_DIR_CACHE
+static uint16_t
+dir_cache_hash(const char *name)
+{
+  uint16_t hash;
+  int i;
+
+  hash = 5381;
+  for(i = 0; i < COFFEE_NAME_LENGTH && name[i] != '\0'; i++) {
+    hash = hash * 33 + (unsigned char)name[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+dir_cache_add(const char *name, coffee_page_t page, cfs_offset_t end)
+{
+  uint16_t hash;
+  int i, n;
+
+  if(dir_cache_state == DIR_CACHE_INVALID) {
+    return;
+  }
+
+  hash = dir_cache_hash(name);
+  i = hash % COFFEE_DIR_CACHE_SIZE;
+  for(n = 0; n < COFFEE_DIR_CACHE_SIZE; n++) {
+    if(dir_cache[i].page == INVALID_PAGE) {
+      dir_cache[i].hash = hash;
+      dir_cache[i].page = page;
+      dir_cache[i].end = end;
+      return;
+    }
+    i = (i + 1) % COFFEE_DIR_CACHE_SIZE;
+  }
+
+  /* The cache is full, so it cannot tell that a file does not exist. */
+  dir_cache_state = DIR_CACHE_PARTIAL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+dir_cache_remove(const char *name, coffee_page_t page)
+{
+  int i, j, home, n;
+
+  if(dir_cache_state == DIR_CACHE_INVALID) {
+    return;
+  }
+
+  i = dir_cache_hash(name) % COFFEE_DIR_CACHE_SIZE;
+  for(n = 0; dir_cache[i].page != page; n++) {
+    if(dir_cache[i].page == INVALID_PAGE || n == COFFEE_DIR_CACHE_SIZE) {
+      return;
+    }
+    i = (i + 1) % COFFEE_DIR_CACHE_SIZE;
+  }
+
+  /* Shift back the following entries of the probe sequence that
+     would no longer be reachable. */
+  for(j = (i + 1) % COFFEE_DIR_CACHE_SIZE;
+      dir_cache[j].page != INVALID_PAGE && j != i;
+      j = (j + 1) % COFFEE_DIR_CACHE_SIZE) {
+    home = dir_cache[j].hash % COFFEE_DIR_CACHE_SIZE;
+    if((i < j && (home <= i || home > j)) ||
+       (i > j && home <= i && home > j)) {
+      dir_cache[i] = dir_cache[j];
+      i = j;
+    }
+  }
+  dir_cache[i].page = INVALID_PAGE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+dir_cache_build(void)
+{
+  struct file_header hdr;
+  coffee_page_t page;
+  int i;
+
+  for(i = 0; i < COFFEE_DIR_CACHE_SIZE; i++) {
+    dir_cache[i].page = INVALID_PAGE;
+  }
+  dir_cache_state = DIR_CACHE_COMPLETE;
+
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
+      dir_cache_add(hdr.name, page, UNKNOWN_OFFSET);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct dir_cache_entry *
+dir_cache_find_page(coffee_page_t page)
+{
+  int i;
+
+  if(dir_cache_state != DIR_CACHE_INVALID) {
+    for(i = 0; i < COFFEE_DIR_CACHE_SIZE; i++) {
+      if(dir_cache[i].page == page) {
+        return &dir_cache[i];
+      }
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Store the end of a file that was just computed from the storage. */
+static void
+dir_cache_set_end(struct file *file)
+{
+  struct dir_cache_entry *entry;
+
+  entry = dir_cache_find_page(file->page);
+  if(entry != NULL) {
+    entry->end = file->end;
+    file->flags |= COFFEE_FILE_END_CACHED;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Forget the cached end of a file that is about to be written to. */
+static void
+dir_cache_end_changed(struct file *file)
+{
+  struct dir_cache_entry *entry;
+
+  if(file->flags & COFFEE_FILE_END_CACHED) {
+    file->flags &= ~COFFEE_FILE_END_CACHED;
+    entry = dir_cache_find_page(file->page);
+    if(entry != NULL) {
+      entry->end = UNKNOWN_OFFSET;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Look up a file in the directory cache. Returns 1 if the cache has
+   the answer, which is stored in *file, and 0 if the storage must be
+   scanned. */
+static int
+dir_cache_find(const char *name, struct file **file)
+{
+  struct file_header hdr;
+  uint16_t hash;
+  int i, n;
+  int built;
+
+  built = 0;
+  if(dir_cache_state == DIR_CACHE_INVALID) {
+    dir_cache_build();
+    built = 1;
+  }
+
+  hash = dir_cache_hash(name);
+  i = hash % COFFEE_DIR_CACHE_SIZE;
+  for(n = 0; n < COFFEE_DIR_CACHE_SIZE && dir_cache[i].page != INVALID_PAGE; n++) {
+    if(dir_cache[i].hash == hash) {
+      read_header(&hdr, dir_cache[i].page);
+      if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr) && strcmp(name, hdr.name) == 0) {
+        *file = load_file(dir_cache[i].page, &hdr);
+        if(*file != NULL && dir_cache[i].end != UNKNOWN_OFFSET) {
+          (*file)->end = dir_cache[i].end;
+          (*file)->flags |= COFFEE_FILE_END_CACHED;
+        }
+        if(built) {
+          dir_cache_misses++;
+        } else {
+          dir_cache_hits++;
+        }
+        return 1;
+      }
+    }
+    i = (i + 1) % COFFEE_DIR_CACHE_SIZE;
+  }
+
+  *file = NULL;
+  if(built) {
+    dir_cache_misses++;
+    return dir_cache_state == DIR_CACHE_COMPLETE;
+  }
+  if(dir_cache_state == DIR_CACHE_COMPLETE) {
+    dir_cache_hits++;
+    return 1;
+  }
+  dir_cache_misses++;
+  return 0;
+}
+#endif /* COFFEE_DIR_CACHE */
+/*---------------------------------------------------------------------------*/
 static struct file *
 find_file(const char *name)
 {
   int i;
   struct file_header hdr;
   coffee_page_t page;
+#if COFFEE_DIR_CACHE
+  struct file *file;
+#endif
 
   /* First check if the file metadata is cached. */
   for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
@@ -471,6 +752,12 @@ find_file(const char *name)
     }
   }
 
+#if COFFEE_DIR_CACHE
+  if(dir_cache_find(name, &file)) {
+    return file;
+  }
+#endif /* COFFEE_DIR_CACHE */
+
   /* Scan the flash memory sequentially otherwise. */
   for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
     read_header(&hdr, page);
@@ -573,6 +860,10 @@ remove_by_page(coffee_page_t page, int remove_log,
   hdr.flags |= HDR_FLAG_OBSOLETE;
   write_header(&hdr, page);
 
+#if COFFEE_DIR_CACHE
+  dir_cache_remove(hdr.name, page);
+#endif /* COFFEE_DIR_CACHE */
+
   gc_wait = 0;
 
   /* Close all file descriptors that reference the removed file. */
@@ -645,6 +936,15 @@ reserve(const char *name, coffee_page_t pages,
     file->end = 0;
   }
 
+#if COFFEE_DIR_CACHE
+  if(!(flags & HDR_FLAG_LOG)) {
+    dir_cache_add(hdr.name, page, 0);
+    if(file != NULL) {
+      file->flags |= COFFEE_FILE_END_CACHED;
+    }
+  }
+#endif /* COFFEE_DIR_CACHE */
+
   return file;
 }
 /*---------------------------------------------------------------------------*/
@@ -720,10 +1020,102 @@ get_record_index(coffee_page_t log_page, uint16_t search_records,
 }
 #endif /* COFFEE_MICRO_LOGS */
 /*---------------------------------------------------------------------------*/
+#if COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX
+static void
+log_index_add(struct file *file, uint16_t region, int16_t record)
+{
+  struct log_index_entry *index;
+  int i, n;
+
+  index = log_index[file - coffee_files];
+  i = region % COFFEE_LOG_INDEX_SIZE;
+  for(n = 0; n < COFFEE_LOG_INDEX_SIZE; n++) {
+    if(index[i].region == 0 || index[i].region == region) {
+      index[i].region = region;
+      index[i].record = record;
+      return;
+    }
+    i = (i + 1) % COFFEE_LOG_INDEX_SIZE;
+  }
+
+  /* The index is full, so the log must be searched in the storage. */
+  file->flags &= ~COFFEE_FILE_LOG_INDEXED;
+  file->flags |= COFFEE_FILE_LOG_UNINDEXED;
+}
+/*---------------------------------------------------------------------------*/
+static int
+log_index_find(struct file *file, uint16_t region)
+{
+  struct log_index_entry *index;
+  int i, n;
+
+  index = log_index[file - coffee_files];
+  i = region % COFFEE_LOG_INDEX_SIZE;
+  for(n = 0; n < COFFEE_LOG_INDEX_SIZE && index[i].region != 0; n++) {
+    if(index[i].region == region) {
+      return index[i].record;
+    }
+    i = (i + 1) % COFFEE_LOG_INDEX_SIZE;
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+log_index_reset(struct file *file)
+{
+  memset(log_index[file - coffee_files], 0, sizeof(log_index[0]));
+  file->flags &= ~COFFEE_FILE_LOG_UNINDEXED;
+  file->flags |= COFFEE_FILE_LOG_INDEXED;
+}
+/*---------------------------------------------------------------------------*/
+/* Build the log index from the log index table of a modified file. */
+static void
+log_index_load(struct file *file)
+{
+  struct file_header hdr;
+  uint16_t log_record_size;
+  uint16_t log_records;
+  uint16_t processed;
+  uint16_t batch_size;
+  int i;
+
+  read_header(&hdr, file->page);
+  adjust_log_config(&hdr, &log_record_size, &log_records);
+  log_index_reset(file);
+
+  batch_size = log_records > COFFEE_LOG_TABLE_LIMIT ?
+    COFFEE_LOG_TABLE_LIMIT : log_records;
+  {
+    uint16_t indices[batch_size];
+
+    for(processed = 0; processed < log_records; processed += batch_size) {
+      if(batch_size + processed > log_records) {
+        batch_size = log_records - processed;
+      }
+
+      COFFEE_READ(&indices, batch_size * sizeof(indices[0]),
+                  absolute_offset(hdr.log_page, processed * sizeof(indices[0])));
+      for(i = 0; i < batch_size; i++) {
+        if(indices[i] == 0) {
+          file->record_count = processed + i;
+          return;
+        }
+        log_index_add(file, indices[i], processed + i);
+        if(!(file->flags & COFFEE_FILE_LOG_INDEXED)) {
+          return;
+        }
+      }
+    }
+  }
+
+  file->record_count = log_records;
+}
+#endif /* COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX */
+/*---------------------------------------------------------------------------*/
 #if COFFEE_MICRO_LOGS
 static int
-read_log_page(struct file_header *hdr, int16_t record_count,
-              struct log_param *lp)
+read_log_page(struct file *file, struct file_header *hdr,
+              int16_t record_count, struct log_param *lp)
 {
   uint16_t region;
   int16_t match_index;
@@ -736,6 +1128,12 @@ read_log_page(struct file_header *hdr, int16_t record_count,
   region = modify_log_buffer(log_record_size, &lp->offset, &lp->size);
 
   search_records = record_count < 0 ? log_records : record_count;
+#if COFFEE_LOG_INDEX
+  if(file->flags & COFFEE_FILE_LOG_INDEXED) {
+    /* The index only holds records that precede record_count. */
+    match_index = log_index_find(file, region + 1);
+  } else
+#endif /* COFFEE_LOG_INDEX */
   match_index = get_record_index(hdr->log_page, search_records, region);
   if(match_index < 0) {
     return -1;
@@ -773,6 +1171,9 @@ create_log(struct file *file, struct file_header *hdr)
   write_header(hdr, file->page);
 
   file->flags |= COFFEE_FILE_MODIFIED;
+#if COFFEE_LOG_INDEX
+  log_index_reset(file);
+#endif /* COFFEE_LOG_INDEX */
   return log_file->page;
 }
 #endif /* COFFEE_MICRO_LOGS */
@@ -805,6 +1206,10 @@ merge_log(coffee_page_t file_page, int extend)
     return -1;
   }
 
+#if COFFEE_DIR_CACHE
+  dir_cache_end_changed(new_file);
+#endif /* COFFEE_DIR_CACHE */
+
   offset = 0;
   do {
     char buf[hdr.log_record_size == 0 ? COFFEE_PAGE_SIZE : hdr.log_record_size];
@@ -934,7 +1339,7 @@ write_log_page(struct file *file, struct log_param *lp)
     lp_out.size = log_record_size;
 
     if((lp->offset > 0 || lp->size != log_record_size) &&
-       read_log_page(&hdr, log_record, &lp_out) < 0) {
+       read_log_page(file, &hdr, log_record, &lp_out) < 0) {
       COFFEE_READ(copy_buf, sizeof(copy_buf),
                   absolute_offset(file->page, offset));
     }
@@ -954,6 +1359,11 @@ write_log_page(struct file *file, struct log_param *lp)
     COFFEE_WRITE(copy_buf, sizeof(copy_buf),
                  offset + log_record * log_record_size);
     file->record_count = log_record + 1;
+#if COFFEE_LOG_INDEX
+    if(file->flags & COFFEE_FILE_LOG_INDEXED) {
+      log_index_add(file, region, log_record);
+    }
+#endif /* COFFEE_LOG_INDEX */
   }
 
   return lp->size;
@@ -1001,7 +1411,18 @@ cfs_open(const char *name, int flags)
     fdp->file->end = 0;
   } else if(fdp->file->end == UNKNOWN_OFFSET) {
     fdp->file->end = file_end(fdp->file->page);
+#if COFFEE_DIR_CACHE
+    dir_cache_set_end(fdp->file);
+#endif /* COFFEE_DIR_CACHE */
+  }
+
+#if COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX
+  if(FILE_MODIFIED(fdp->file) &&
+     !(fdp->file->flags &
+       (COFFEE_FILE_LOG_INDEXED | COFFEE_FILE_LOG_UNINDEXED))) {
+    log_index_load(fdp->file);
   }
+#endif /* COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX */
 
   fdp->flags |= flags;
   fdp->offset = flags & CFS_APPEND ? fdp->file->end : 0;
@@ -1122,7 +1543,7 @@ cfs_read(int fd, void *buf, unsigned size)
     lp.offset = fdp->offset;
     lp.buf = buf;
     lp.size = bytes_left;
-    r = read_log_page(&hdr, file->record_count, &lp);
+    r = read_log_page(file, &hdr, file->record_count, &lp);
 
     /* Read from the original file if we cannot find the data in the log. */
     if(r < 0) {
@@ -1157,6 +1578,10 @@ cfs_write(int fd, const void *buf, unsigned size)
   fdp = &coffee_fd_set[fd];
   file = fdp->file;
 
+#if COFFEE_DIR_CACHE
+  dir_cache_end_changed(file);
+#endif /* COFFEE_DIR_CACHE */
+
   /* Attempt to extend the file if we try to write past the end. */
   if(!(fdp->io_flags & CFS_COFFEE_IO_FIRM_SIZE)) {
     while(size + fdp->offset + sizeof(struct file_header) >
@@ -1323,6 +1748,15 @@ cfs_coffee_set_io_semantics(int fd, unsigned flags)
 }
 #endif
 /*---------------------------------------------------------------------------*/
+#if COFFEE_DIR_CACHE
+void
+cfs_coffee_dir_cache_stats(unsigned long *hits, unsigned long *misses)
+{
+  *hits = dir_cache_hits;
+  *misses = dir_cache_misses;
+}
+#endif /* COFFEE_DIR_CACHE */
+/*---------------------------------------------------------------------------*/
 int
 cfs_coffee_format(void)
 {
@@ -1340,6 +1774,9 @@ cfs_coffee_format(void)
   memset(&coffee_fd_set, 0, sizeof(coffee_fd_set));
   next_free = 0;
   gc_wait = 1;
+#if COFFEE_DIR_CACHE
+  dir_cache_state = DIR_CACHE_INVALID;
+#endif /* COFFEE_DIR_CACHE */
 
   PRINTF(" done!\n");
 
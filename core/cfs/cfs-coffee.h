@@ -125,6 +125,18 @@ int cfs_coffee_configure_log(const char *file, unsigned log_size,
  */
 int cfs_coffee_set_io_semantics(int fd, unsigned flags);
 
+/**
+ * \brief Get the statistics of the directory cache.
+ * \param hits Set to the number of file lookups answered by the cache.
+ * \param misses Set to the number of file lookups that required
+ *        a scan of the storage.
+ *
+ * The directory cache is enabled by setting COFFEE_CONF_DIR_CACHE.
+ * It maps file names to file locations and lengths, and is rebuilt
+ * with a single scan of the storage after garbage collection.
+ */
+void cfs_coffee_dir_cache_stats(unsigned long *hits, unsigned long *misses);
+
 /**
  * \brief Format the storage area assigned to Coffee.
  * \return 0 on success, -1 on failure.
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Table-driven AES-128 encryption for 32-bit CPUs.
+ *
+ *         Each round combines SubBytes, ShiftRows and MixColumns into
+ *         four lookups per column in one 1 kB table, whose rotations
+ *         stand in for the three other tables of the usual four-table
+ *         layout. Select it with
+ *         #define AES_128_CONF aes_128_ttable_driver
+ */
+
+#include "lib/aes-128.h"
+
+/*
+ * Number of expanded keys to keep. Switching back to a key that is still
+ * kept, like the per-index keys of TSCH, skips the key expansion.
+ */
+#ifdef AES_128_TTABLE_CONF_KEYS
+#define AES_128_TTABLE_KEYS AES_128_TTABLE_CONF_KEYS
+#else /* AES_128_TTABLE_CONF_KEYS */
+#define AES_128_TTABLE_KEYS 1
+#endif /* AES_128_TTABLE_CONF_KEYS */
+
+/* Te0[x] = (2 S[x], S[x], S[x], 3 S[x]), most significant byte first */
+static const uint32_t te0[256] = {
+  0xc66363a5UL, 0xf87c7c84UL, 0xee777799UL, 0xf67b7b8dUL,
+  0xfff2f20dUL, 0xd66b6bbdUL, 0xde6f6fb1UL, 0x91c5c554UL,
+  0x60303050UL, 0x02010103UL, 0xce6767a9UL, 0x562b2b7dUL,
+  0xe7fefe19UL, 0xb5d7d762UL, 0x4dababe6UL, 0xec76769aUL,
+  0x8fcaca45UL, 0x1f82829dUL, 0x89c9c940UL, 0xfa7d7d87UL,
+  0xeffafa15UL, 0xb25959ebUL, 0x8e4747c9UL, 0xfbf0f00bUL,
+  0x41adadecUL, 0xb3d4d467UL, 0x5fa2a2fdUL, 0x45afafeaUL,
+  0x239c9cbfUL, 0x53a4a4f7UL, 0xe4727296UL, 0x9bc0c05bUL,
+  0x75b7b7c2UL, 0xe1fdfd1cUL, 0x3d9393aeUL, 0x4c26266aUL,
+  0x6c36365aUL, 0x7e3f3f41UL, 0xf5f7f702UL, 0x83cccc4fUL,
+  0x6834345cUL, 0x51a5a5f4UL, 0xd1e5e534UL, 0xf9f1f108UL,
+  0xe2717193UL, 0xabd8d873UL, 0x62313153UL, 0x2a15153fUL,
+  0x0804040cUL, 0x95c7c752UL, 0x46232365UL, 0x9dc3c35eUL,
+  0x30181828UL, 0x379696a1UL, 0x0a05050fUL, 0x2f9a9ab5UL,
+  0x0e070709UL, 0x24121236UL, 0x1b80809bUL, 0xdfe2e23dUL,
+  0xcdebeb26UL, 0x4e272769UL, 0x7fb2b2cdUL, 0xea75759fUL,
+  0x1209091bUL, 0x1d83839eUL, 0x582c2c74UL, 0x341a1a2eUL,
+  0x361b1b2dUL, 0xdc6e6eb2UL, 0xb45a5aeeUL, 0x5ba0a0fbUL,
+  0xa45252f6UL, 0x763b3b4dUL, 0xb7d6d661UL, 0x7db3b3ceUL,
+  0x5229297bUL, 0xdde3e33eUL, 0x5e2f2f71UL, 0x13848497UL,
+  0xa65353f5UL, 0xb9d1d168UL, 0x00000000UL, 0xc1eded2cUL,
+  0x40202060UL, 0xe3fcfc1fUL, 0x79b1b1c8UL, 0xb65b5bedUL,
+  0xd46a6abeUL, 0x8dcbcb46UL, 0x67bebed9UL, 0x7239394bUL,
+  0x944a4adeUL, 0x984c4cd4UL, 0xb05858e8UL, 0x85cfcf4aUL,
+  0xbbd0d06bUL, 0xc5efef2aUL, 0x4faaaae5UL, 0xedfbfb16UL,
+  0x864343c5UL, 0x9a4d4dd7UL, 0x66333355UL, 0x11858594UL,
+  0x8a4545cfUL, 0xe9f9f910UL, 0x04020206UL, 0xfe7f7f81UL,
+  0xa05050f0UL, 0x783c3c44UL, 0x259f9fbaUL, 0x4ba8a8e3UL,
+  0xa25151f3UL, 0x5da3a3feUL, 0x804040c0UL, 0x058f8f8aUL,
+  0x3f9292adUL, 0x219d9dbcUL, 0x70383848UL, 0xf1f5f504UL,
+  0x63bcbcdfUL, 0x77b6b6c1UL, 0xafdada75UL, 0x42212163UL,
+  0x20101030UL, 0xe5ffff1aUL, 0xfdf3f30eUL, 0xbfd2d26dUL,
+  0x81cdcd4cUL, 0x180c0c14UL, 0x26131335UL, 0xc3ecec2fUL,
+  0xbe5f5fe1UL, 0x359797a2UL, 0x884444ccUL, 0x2e171739UL,
+  0x93c4c457UL, 0x55a7a7f2UL, 0xfc7e7e82UL, 0x7a3d3d47UL,
+  0xc86464acUL, 0xba5d5de7UL, 0x3219192bUL, 0xe6737395UL,
+  0xc06060a0UL, 0x19818198UL, 0x9e4f4fd1UL, 0xa3dcdc7fUL,
+  0x44222266UL, 0x542a2a7eUL, 0x3b9090abUL, 0x0b888883UL,
+  0x8c4646caUL, 0xc7eeee29UL, 0x6bb8b8d3UL, 0x2814143cUL,
+  0xa7dede79UL, 0xbc5e5ee2UL, 0x160b0b1dUL, 0xaddbdb76UL,
+  0xdbe0e03bUL, 0x64323256UL, 0x743a3a4eUL, 0x140a0a1eUL,
+  0x924949dbUL, 0x0c06060aUL, 0x4824246cUL, 0xb85c5ce4UL,
+  0x9fc2c25dUL, 0xbdd3d36eUL, 0x43acacefUL, 0xc46262a6UL,
+  0x399191a8UL, 0x319595a4UL, 0xd3e4e437UL, 0xf279798bUL,
+  0xd5e7e732UL, 0x8bc8c843UL, 0x6e373759UL, 0xda6d6db7UL,
+  0x018d8d8cUL, 0xb1d5d564UL, 0x9c4e4ed2UL, 0x49a9a9e0UL,
+  0xd86c6cb4UL, 0xac5656faUL, 0xf3f4f407UL, 0xcfeaea25UL,
+  0xca6565afUL, 0xf47a7a8eUL, 0x47aeaee9UL, 0x10080818UL,
+  0x6fbabad5UL, 0xf0787888UL, 0x4a25256fUL, 0x5c2e2e72UL,
+  0x381c1c24UL, 0x57a6a6f1UL, 0x73b4b4c7UL, 0x97c6c651UL,
+  0xcbe8e823UL, 0xa1dddd7cUL, 0xe874749cUL, 0x3e1f1f21UL,
+  0x964b4bddUL, 0x61bdbddcUL, 0x0d8b8b86UL, 0x0f8a8a85UL,
+  0xe0707090UL, 0x7c3e3e42UL, 0x71b5b5c4UL, 0xcc6666aaUL,
+  0x904848d8UL, 0x06030305UL, 0xf7f6f601UL, 0x1c0e0e12UL,
+  0xc26161a3UL, 0x6a35355fUL, 0xae5757f9UL, 0x69b9b9d0UL,
+  0x17868691UL, 0x99c1c158UL, 0x3a1d1d27UL, 0x279e9eb9UL,
+  0xd9e1e138UL, 0xebf8f813UL, 0x2b9898b3UL, 0x22111133UL,
+  0xd26969bbUL, 0xa9d9d970UL, 0x078e8e89UL, 0x339494a7UL,
+  0x2d9b9bb6UL, 0x3c1e1e22UL, 0x15878792UL, 0xc9e9e920UL,
+  0x87cece49UL, 0xaa5555ffUL, 0x50282878UL, 0xa5dfdf7aUL,
+  0x038c8c8fUL, 0x59a1a1f8UL, 0x09898980UL, 0x1a0d0d17UL,
+  0x65bfbfdaUL, 0xd7e6e631UL, 0x844242c6UL, 0xd06868b8UL,
+  0x824141c3UL, 0x299999b0UL, 0x5a2d2d77UL, 0x1e0f0f11UL,
+  0x7bb0b0cbUL, 0xa85454fcUL, 0x6dbbbbd6UL, 0x2c16163aUL
+};
+
+#define ROTR8(x) (((x) >> 8) | ((x) << 24))
+#define ROTR16(x) (((x) >> 16) | ((x) << 16))
+#define ROTR24(x) (((x) >> 24) | ((x) << 8))
+
+/* The S-box is the second byte of the table entries */
+#define SBOX(x) ((te0[(x)] >> 16) & 0xff)
+
+#define GET32(p) (((uint32_t)(p)[0] << 24) | ((uint32_t)(p)[1] << 16) | \
+                  ((uint32_t)(p)[2] << 8) | (uint32_t)(p)[3])
+#define PUT32(p, v) do { \
+    (p)[0] = (v) >> 24; \
+    (p)[1] = (v) >> 16; \
+    (p)[2] = (v) >> 8; \
+    (p)[3] = (v); \
+  } while(0)
+
+/* One column of a full round */
+#define ROUND_COLUMN(a, b, c, d, k) \
+  (te0[(a) >> 24] ^ ROTR8(te0[((b) >> 16) & 0xff]) ^ \
+   ROTR16(te0[((c) >> 8) & 0xff]) ^ ROTR24(te0[(d) & 0xff]) ^ (k))
+
+/* One column of the last round, which skips MixColumns */
+#define FINAL_COLUMN(a, b, c, d, k) \
+  (((SBOX((a) >> 24) << 24) | (SBOX(((b) >> 16) & 0xff) << 16) | \
+    (SBOX(((c) >> 8) & 0xff) << 8) | SBOX((d) & 0xff)) ^ (k))
+
+/* The first four words of an expanded key are the key itself */
+static uint32_t schedules[AES_128_TTABLE_KEYS][44];
+static uint32_t *round_keys = schedules[0];
+#if AES_128_TTABLE_KEYS > 1
+static uint8_t schedules_used;
+static uint8_t next_schedule;
+#endif /* AES_128_TTABLE_KEYS > 1 */
+/*---------------------------------------------------------------------------*/
+static void
+set_key(const uint8_t *key)
+{
+  uint32_t k[4];
+  uint32_t rcon;
+  uint32_t t;
+  uint8_t i;
+
+  for(i = 0; i < 4; i++) {
+    k[i] = GET32(key + 4 * i);
+  }
+
+#if AES_128_TTABLE_KEYS > 1
+  for(i = 0; i < schedules_used; i++) {
+    if(schedules[i][0] == k[0] && schedules[i][1] == k[1] &&
+       schedules[i][2] == k[2] && schedules[i][3] == k[3]) {
+      round_keys = schedules[i];
+      return;
+    }
+  }
+
+  round_keys = schedules[next_schedule];
+  next_schedule = (next_schedule + 1) % AES_128_TTABLE_KEYS;
+  if(schedules_used < AES_128_TTABLE_KEYS) {
+    schedules_used++;
+  }
+#endif /* AES_128_TTABLE_KEYS > 1 */
+
+  for(i = 0; i < 4; i++) {
+    round_keys[i] = k[i];
+  }
+
+  rcon = 0x01000000UL;
+  for(i = 4; i < 44; i++) {
+    t = round_keys[i - 1];
+    if((i & 3) == 0) {
+      /* RotWord, SubWord and Rcon */
+      t = ((SBOX((t >> 16) & 0xff) << 24) | (SBOX((t >> 8) & 0xff) << 16) |
+           (SBOX(t & 0xff) << 8) | SBOX(t >> 24)) ^ rcon;
+      rcon = (rcon & 0x80000000UL) ? 0x1b000000UL : rcon << 1;
+    }
+    round_keys[i] = round_keys[i - 4] ^ t;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+encrypt_blocks(uint8_t *blocks, uint8_t count)
+{
+  const uint32_t *rk;
+  uint32_t s0, s1, s2, s3;
+  uint32_t t0, t1, t2, t3;
+  uint8_t round;
+
+  for(; count > 0; count--, blocks += AES_128_BLOCK_SIZE) {
+    rk = round_keys;
+    s0 = GET32(blocks) ^ rk[0];
+    s1 = GET32(blocks + 4) ^ rk[1];
+    s2 = GET32(blocks + 8) ^ rk[2];
+    s3 = GET32(blocks + 12) ^ rk[3];
+
+    for(round = 1; round < 10; round++) {
+      rk += 4;
+      t0 = ROUND_COLUMN(s0, s1, s2, s3, rk[0]);
+      t1 = ROUND_COLUMN(s1, s2, s3, s0, rk[1]);
+      t2 = ROUND_COLUMN(s2, s3, s0, s1, rk[2]);
+      t3 = ROUND_COLUMN(s3, s0, s1, s2, rk[3]);
+      s0 = t0;
+      s1 = t1;
+      s2 = t2;
+      s3 = t3;
+    }
+
+    rk += 4;
+    t0 = FINAL_COLUMN(s0, s1, s2, s3, rk[0]);
+    t1 = FINAL_COLUMN(s1, s2, s3, s0, rk[1]);
+    t2 = FINAL_COLUMN(s2, s3, s0, s1, rk[2]);
+    t3 = FINAL_COLUMN(s3, s0, s1, s2, rk[3]);
+    PUT32(blocks, t0);
+    PUT32(blocks + 4, t1);
+    PUT32(blocks + 8, t2);
+    PUT32(blocks + 12, t3);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+encrypt(uint8_t *plaintext_and_result)
+{
+  encrypt_blocks(plaintext_and_result, 1);
+}
+/*---------------------------------------------------------------------------*/
+const struct aes_128_driver aes_128_ttable_driver = {
+  set_key,
+  encrypt,
+  encrypt_blocks
+};
+/*---------------------------------------------------------------------------*/
@@ -176,8 +176,22 @@ aes_128_set_padded_key(uint8_t *key, uint8_t key_len)
   AES_128.set_key(block);
 }
 /*---------------------------------------------------------------------------*/
+void
+aes_128_encrypt_blocks(uint8_t *blocks, uint8_t count)
+{
+  if(AES_128.encrypt_blocks != NULL) {
+    AES_128.encrypt_blocks(blocks, count);
+    return;
+  }
+
+  for(; count > 0; count--, blocks += AES_128_BLOCK_SIZE) {
+    AES_128.encrypt(blocks);
+  }
+}
+/*---------------------------------------------------------------------------*/
 const struct aes_128_driver aes_128_driver = {
   set_key,
-  encrypt
+  encrypt,
+  NULL
 };
 /*---------------------------------------------------------------------------*/
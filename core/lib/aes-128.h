@@ -65,6 +65,11 @@ struct aes_128_driver {
    * \brief Encrypts.
    */
   void (* encrypt)(uint8_t *plaintext_and_result);
+
+  /**
+   * \brief Encrypts count consecutive blocks in place. May be NULL.
+   */
+  void (* encrypt_blocks)(uint8_t *blocks, uint8_t count);
 };
 
 /**
@@ -72,6 +77,13 @@ struct aes_128_driver {
  */
 void aes_128_set_padded_key(uint8_t *key, uint8_t key_len);
 
+/**
+ * \brief Encrypts count consecutive blocks in place with AES_128, in one
+ *        call if the driver has encrypt_blocks
+ */
+void aes_128_encrypt_blocks(uint8_t *blocks, uint8_t count);
+
 extern const struct aes_128_driver AES_128;
+extern const struct aes_128_driver aes_128_ttable_driver;
 
 #endif /* AES_128_H_ */
@@ -46,6 +46,23 @@
 #define CCM_STAR_AUTH_FLAGS(Adata, M) ((Adata ? (1u << 6) : 0) | (((M - 2u) >> 1) << 3) | 1u)
 #define CCM_STAR_ENCRYPTION_FLAGS     1
 
+/* Number of CTR keystream blocks that are encrypted in one go */
+#ifdef CCM_STAR_CONF_CTR_BLOCKS
+#define CCM_STAR_CTR_BLOCKS CCM_STAR_CONF_CTR_BLOCKS
+#else /* CCM_STAR_CONF_CTR_BLOCKS */
+#define CCM_STAR_CTR_BLOCKS 4
+#endif /* CCM_STAR_CONF_CTR_BLOCKS */
+
+/*
+ * Compute the CBC-MAC and the CTR keystream in one pass over the message,
+ * encrypting each MAC block together with the next keystream block
+ */
+#ifdef CCM_STAR_CONF_SINGLE_PASS
+#define CCM_STAR_SINGLE_PASS CCM_STAR_CONF_SINGLE_PASS
+#else /* CCM_STAR_CONF_SINGLE_PASS */
+#define CCM_STAR_SINGLE_PASS 0
+#endif /* CCM_STAR_CONF_SINGLE_PASS */
+
 /*---------------------------------------------------------------------------*/
 static void
 set_iv(uint8_t *iv,
@@ -59,6 +76,40 @@ set_iv(uint8_t *iv,
   iv[15] = counter;
 }
 /*---------------------------------------------------------------------------*/
+/* Starts the CBC-MAC in x with B_0 and the additional authenticated data */
+static void
+mic_start(uint8_t *x,
+    const uint8_t *nonce,
+    uint8_t m_len,
+    const uint8_t *a, uint8_t a_len,
+    uint8_t mic_len)
+{
+  uint8_t pos;
+  uint8_t i;
+  
+  set_iv(x, CCM_STAR_AUTH_FLAGS(a_len, mic_len), nonce, m_len);
+  AES_128.encrypt(x);
+  
+  if(a_len) {
+    x[1] = x[1] ^ a_len;
+    for(i = 2; (i - 2 < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
+      x[i] ^= a[i - 2];
+    }
+    
+    AES_128.encrypt(x);
+    
+    pos = 14;
+    while(pos < a_len) {
+      for(i = 0; (pos + i < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
+        x[i] ^= a[pos + i];
+      }
+      pos += AES_128_BLOCK_SIZE;
+      AES_128.encrypt(x);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if !CCM_STAR_SINGLE_PASS
 /* XORs the block m[pos] ... m[pos + 15] with K_{counter} */
 static void
 ctr_step(const uint8_t *nonce,
@@ -89,26 +140,7 @@ mic(const uint8_t *nonce,
   uint8_t pos;
   uint8_t i;
   
-  set_iv(x, CCM_STAR_AUTH_FLAGS(a_len, mic_len), nonce, m_len);
-  AES_128.encrypt(x);
-  
-  if(a_len) {
-    x[1] = x[1] ^ a_len;
-    for(i = 2; (i - 2 < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
-      x[i] ^= a[i - 2];
-    }
-    
-    AES_128.encrypt(x);
-    
-    pos = 14;
-    while(pos < a_len) {
-      for(i = 0; (pos + i < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
-        x[i] ^= a[pos + i];
-      }
-      pos += AES_128_BLOCK_SIZE;
-      AES_128.encrypt(x);
-    }
-  }
+  mic_start(x, nonce, m_len, a, a_len, mic_len);
   
   if(m_len) {
     pos = 0;
@@ -129,16 +161,31 @@ mic(const uint8_t *nonce,
 static void
 ctr(const uint8_t *nonce, uint8_t *m, uint8_t m_len)
 {
-  uint8_t pos;
+  uint8_t keystream[CCM_STAR_CTR_BLOCKS * AES_128_BLOCK_SIZE];
+  uint16_t pos;
+  uint16_t len;
+  uint16_t i;
+  uint8_t blocks;
   uint8_t counter;
   
   pos = 0;
   counter = 1;
   while(pos < m_len) {
-    ctr_step(nonce, pos, m, m_len, counter++);
-    pos += AES_128_BLOCK_SIZE;
+    len = MIN(m_len - pos, sizeof(keystream));
+    blocks = (len + AES_128_BLOCK_SIZE - 1) / AES_128_BLOCK_SIZE;
+    for(i = 0; i < blocks; i++) {
+      set_iv(keystream + i * AES_128_BLOCK_SIZE,
+          CCM_STAR_ENCRYPTION_FLAGS, nonce, counter++);
+    }
+    aes_128_encrypt_blocks(keystream, blocks);
+    
+    for(i = 0; i < len; i++) {
+      m[pos + i] ^= keystream[i];
+    }
+    pos += len;
   }
 }
+#endif /* !CCM_STAR_SINGLE_PASS */
 /*---------------------------------------------------------------------------*/
 static void
 set_key(const uint8_t *key)
@@ -146,6 +193,66 @@ set_key(const uint8_t *key)
   AES_128.set_key(key);
 }
 /*---------------------------------------------------------------------------*/
+#if CCM_STAR_SINGLE_PASS
+static void
+aead(const uint8_t* nonce,
+    uint8_t* m, uint8_t m_len,
+    const uint8_t* a, uint8_t a_len,
+    uint8_t *result, uint8_t mic_len,
+    int forward)
+{
+  /* The CBC-MAC state, directly followed by a CTR block */
+  uint8_t blocks[2 * AES_128_BLOCK_SIZE];
+  uint8_t *x = blocks;
+  uint8_t *s = blocks + AES_128_BLOCK_SIZE;
+  uint16_t pos;
+  uint8_t len;
+  uint8_t i;
+  uint8_t counter;
+  uint8_t pending;
+  
+  mic_start(x, nonce, m_len, a, a_len, mic_len);
+  
+  /* Block i is XORed into x right after K_i is known, which is when both
+     its plaintext and its ciphertext are available. x is then encrypted
+     together with K_{i+1}, or with K_0 for the MIC after the last block. */
+  pending = 0;
+  counter = 1;
+  for(pos = 0; pos < m_len; pos += len) {
+    set_iv(s, CCM_STAR_ENCRYPTION_FLAGS, nonce, counter++);
+    if(pending) {
+      aes_128_encrypt_blocks(x, 2);
+    } else {
+      AES_128.encrypt(s);
+    }
+    
+    len = MIN(m_len - pos, AES_128_BLOCK_SIZE);
+    if(forward) {
+      for(i = 0; i < len; i++) {
+        x[i] ^= m[pos + i];
+        m[pos + i] ^= s[i];
+      }
+    } else {
+      for(i = 0; i < len; i++) {
+        m[pos + i] ^= s[i];
+        x[i] ^= m[pos + i];
+      }
+    }
+    pending = 1;
+  }
+  
+  set_iv(s, CCM_STAR_ENCRYPTION_FLAGS, nonce, 0);
+  if(pending) {
+    aes_128_encrypt_blocks(x, 2);
+  } else {
+    AES_128.encrypt(s);
+  }
+  
+  for(i = 0; i < mic_len; i++) {
+    result[i] = x[i] ^ s[i];
+  }
+}
+#else /* CCM_STAR_SINGLE_PASS */
 static void
 aead(const uint8_t* nonce,
     uint8_t* m, uint8_t m_len,
@@ -169,6 +276,7 @@ aead(const uint8_t* nonce,
     ctr(nonce, m, m_len);
   }
 }
+#endif /* CCM_STAR_SINGLE_PASS */
 /*---------------------------------------------------------------------------*/
 const struct ccm_star_driver ccm_star_driver = {
   set_key,
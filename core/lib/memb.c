@@ -47,6 +47,136 @@
 #include "contiki.h"
 #include "lib/memb.h"
 
+#if MEMB_FREE_BITMAP
+/*---------------------------------------------------------------------------*/
+/* Index of the lowest set bit in a non-zero word. */
+static int
+lowest_bit(uint32_t x)
+{
+#ifdef __GNUC__
+  return __builtin_ctzl(x);
+#else /* __GNUC__ */
+  int i;
+
+  i = 0;
+  if((x & 0xffff) == 0) {
+    x >>= 16;
+    i += 16;
+  }
+  if((x & 0xff) == 0) {
+    x >>= 8;
+    i += 8;
+  }
+  if((x & 0xf) == 0) {
+    x >>= 4;
+    i += 4;
+  }
+  if((x & 0x3) == 0) {
+    x >>= 2;
+    i += 2;
+  }
+  if((x & 0x1) == 0) {
+    i += 1;
+  }
+  return i;
+#endif /* __GNUC__ */
+}
+/*---------------------------------------------------------------------------*/
+static void
+mark_free(struct memb *m, int i)
+{
+  uint32_t *bitmap = m->freemap + MEMB_SUMMARY_WORDS(m->num);
+  int word = i / 32;
+
+  bitmap[word] |= (uint32_t)1 << (i % 32);
+  m->freemap[word / 32] |= (uint32_t)1 << (word % 32);
+}
+/*---------------------------------------------------------------------------*/
+void
+memb_init(struct memb *m)
+{
+  int i;
+
+  memset(m->count, 0, m->num);
+  memset(m->mem, 0, m->size * m->num);
+  memset(m->freemap, 0, sizeof(uint32_t) *
+         (MEMB_SUMMARY_WORDS(m->num) + MEMB_BITMAP_WORDS(m->num)));
+  for(i = 0; i < m->num; ++i) {
+    mark_free(m, i);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void *
+memb_alloc(struct memb *m)
+{
+  uint32_t *bitmap = m->freemap + MEMB_SUMMARY_WORDS(m->num);
+  int s, word, i;
+
+  for(s = 0; s < MEMB_SUMMARY_WORDS(m->num); ++s) {
+    if(m->freemap[s] != 0) {
+      word = s * 32 + lowest_bit(m->freemap[s]);
+      i = word * 32 + lowest_bit(bitmap[word]);
+
+      bitmap[word] &= ~((uint32_t)1 << (i % 32));
+      if(bitmap[word] == 0) {
+        m->freemap[s] &= ~((uint32_t)1 << (word % 32));
+      }
+      ++(m->count[i]);
+      return (void *)((char *)m->mem + (i * m->size));
+    }
+  }
+
+  /* No free block was found, so we return NULL to indicate failure to
+     allocate block. */
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+char
+memb_free(struct memb *m, void *ptr)
+{
+  int i;
+  unsigned offset;
+
+  if(!memb_inmemb(m, ptr)) {
+    return -1;
+  }
+
+  /* The block index follows directly from the pointer, as long as it
+     points to the start of a block. */
+  offset = (unsigned)((char *)ptr - (char *)m->mem);
+  if(offset % m->size != 0) {
+    return -1;
+  }
+  i = offset / m->size;
+
+  if(m->count[i] > 0) {
+    /* Make sure that we don't deallocate free memory. */
+    --(m->count[i]);
+    if(m->count[i] == 0) {
+      mark_free(m, i);
+    }
+  }
+  return m->count[i];
+}
+/*---------------------------------------------------------------------------*/
+int
+memb_numfree(struct memb *m)
+{
+  uint32_t *bitmap = m->freemap + MEMB_SUMMARY_WORDS(m->num);
+  uint32_t bits;
+  int word;
+  int num_free = 0;
+
+  for(word = 0; word < MEMB_BITMAP_WORDS(m->num); ++word) {
+    for(bits = bitmap[word]; bits != 0; bits &= bits - 1) {
+      ++num_free;
+    }
+  }
+
+  return num_free;
+}
+/*---------------------------------------------------------------------------*/
+#else /* MEMB_FREE_BITMAP */
 /*---------------------------------------------------------------------------*/
 void
 memb_init(struct memb *m)
@@ -101,13 +231,6 @@ memb_free(struct memb *m, void *ptr)
 }
 /*---------------------------------------------------------------------------*/
 int
-memb_inmemb(struct memb *m, void *ptr)
-{
-  return (char *)ptr >= (char *)m->mem &&
-    (char *)ptr < (char *)m->mem + (m->num * m->size);
-}
-/*---------------------------------------------------------------------------*/
-int
 memb_numfree(struct memb *m)
 {
   int i;
@@ -121,4 +244,13 @@ memb_numfree(struct memb *m)
 
   return num_free;
 }
+/*---------------------------------------------------------------------------*/
+#endif /* MEMB_FREE_BITMAP */
+/*---------------------------------------------------------------------------*/
+int
+memb_inmemb(struct memb *m, void *ptr)
+{
+  return (char *)ptr >= (char *)m->mem &&
+    (char *)ptr < (char *)m->mem + (m->num * m->size);
+}
 /** @} */
@@ -63,8 +63,37 @@
 #ifndef MEMB_H_
 #define MEMB_H_
 
+#include "contiki-conf.h"
 #include "sys/cc.h"
 
+#include <stdint.h>
+
+#ifdef MEMB_CONF_FREE_BITMAP
+#define MEMB_FREE_BITMAP MEMB_CONF_FREE_BITMAP
+#else /* MEMB_CONF_FREE_BITMAP */
+#define MEMB_FREE_BITMAP 0
+#endif /* MEMB_CONF_FREE_BITMAP */
+
+#if MEMB_FREE_BITMAP
+/*
+ * With MEMB_FREE_BITMAP, every pool carries a packed bitmap with one
+ * bit per block (set when the block is free), preceded by a summary
+ * bitmap with one bit per non-empty bitmap word. memb_alloc() finds a
+ * free block with two find-first-set operations for pools of up to
+ * 1024 blocks, instead of scanning the reference counts.
+ */
+#define MEMB_BITMAP_WORDS(num) (((num) + 31) / 32)
+#define MEMB_SUMMARY_WORDS(num) ((MEMB_BITMAP_WORDS(num) + 31) / 32)
+
+#define MEMB_FREEMAP(name, num) \
+        static uint32_t CC_CONCAT(name,_memb_freemap)[MEMB_SUMMARY_WORDS(num) + \
+                                                      MEMB_BITMAP_WORDS(num)];
+#define MEMB_FREEMAP_REF(name) , CC_CONCAT(name,_memb_freemap)
+#else /* MEMB_FREE_BITMAP */
+#define MEMB_FREEMAP(name, num)
+#define MEMB_FREEMAP_REF(name)
+#endif /* MEMB_FREE_BITMAP */
+
 /**
  * Declare a memory block.
  *
@@ -89,15 +118,20 @@ MEMB(connections, struct connection, 16);
 #define MEMB(name, structure, num) \
         static char CC_CONCAT(name,_memb_count)[num]; \
         static structure CC_CONCAT(name,_memb_mem)[num]; \
+        MEMB_FREEMAP(name, num) \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_count), \
-                                          (void *)CC_CONCAT(name,_memb_mem)}
+                                          (void *)CC_CONCAT(name,_memb_mem) \
+                                          MEMB_FREEMAP_REF(name)}
 
 struct memb {
   unsigned short size;
   unsigned short num;
   char *count;
   void *mem;
+#if MEMB_FREE_BITMAP
+  uint32_t *freemap;
+#endif /* MEMB_FREE_BITMAP */
 };
 
 /**
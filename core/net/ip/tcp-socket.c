@@ -40,6 +40,10 @@
 #include <stdio.h>
 #include <string.h>
 
+#if TCP_SOCKET_SEGMENTS
+/* Where uIP expects the data that uip_send() would copy */
+extern void *uip_sappdata;
+#endif /* TCP_SOCKET_SEGMENTS */
 
 static void relisten(struct tcp_socket *s);
 
@@ -55,11 +59,100 @@ call_event(struct tcp_socket *s, tcp_socket_event_t event)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if TCP_SOCKET_SEGMENTS
+static void
+skip_empty_segments(struct tcp_socket *s)
+{
+  while(s->output_segments_count > 0 &&
+        s->output_segment_offset == s->output_segments->len) {
+    s->output_segments++;
+    s->output_segments_count--;
+    s->output_segment_offset = 0;
+  }
+  if(s->output_segments_count == 0) {
+    s->output_segments = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+senddata_segments(struct tcp_socket *s, int len)
+{
+  const struct tcp_socket_segment *seg;
+  uint8_t *dataptr = uip_sappdata;
+  uint32_t offset, copylen;
+  uint8_t count;
+  int sent;
+
+  /* Gather the unacknowledged data directly into the packet buffer,
+     starting with what was queued in the output buffer before the
+     segment list. A retransmission gathers the same bytes again. */
+  sent = MIN(s->output_data_len, len);
+  memcpy(dataptr, s->output_data_ptr, sent);
+
+  seg = s->output_segments;
+  count = s->output_segments_count;
+  offset = s->output_segment_offset;
+  while(sent < len && count > 0) {
+    copylen = MIN(seg->len - offset, (uint32_t)(len - sent));
+    memcpy(&dataptr[sent], &seg->data[offset], copylen);
+    sent += copylen;
+    seg++;
+    count--;
+    offset = 0;
+  }
+
+  if(sent > 0) {
+    s->output_data_send_nxt = sent;
+    uip_send(dataptr, sent);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+acked_segments(struct tcp_socket *s)
+{
+  uint16_t acked = s->output_data_send_nxt;
+  uint16_t buffered;
+  uint32_t len;
+
+  if(acked == 0) {
+    return;
+  }
+
+  buffered = MIN(acked, s->output_data_len);
+  if(buffered > 0) {
+    memmove(&s->output_data_ptr[0], &s->output_data_ptr[buffered],
+            s->output_data_len - buffered);
+    s->output_data_len -= buffered;
+    acked -= buffered;
+  }
+
+  while(acked > 0 && s->output_segments != NULL) {
+    len = MIN(s->output_segments->len - s->output_segment_offset,
+              (uint32_t)acked);
+    s->output_segment_offset += len;
+    acked -= len;
+    skip_empty_segments(s);
+  }
+
+  s->output_senddata_len = s->output_data_len;
+  s->output_data_send_nxt = 0;
+
+  call_event(s, TCP_SOCKET_DATA_SENT);
+}
+#endif /* TCP_SOCKET_SEGMENTS */
+/*---------------------------------------------------------------------------*/
 static void
 senddata(struct tcp_socket *s)
 {
   int len = MIN(s->output_data_max_seg, uip_mss());
 
+#if TCP_SOCKET_SEGMENTS
+  if(s->output_segments != NULL) {
+    senddata_segments(s, len);
+    return;
+  }
+#endif /* TCP_SOCKET_SEGMENTS */
+
   if(s->output_senddata_len > 0) {
     len = MIN(s->output_senddata_len, len);
     s->output_data_send_nxt = len;
@@ -70,6 +163,13 @@ senddata(struct tcp_socket *s)
 static void
 acked(struct tcp_socket *s)
 {
+#if TCP_SOCKET_SEGMENTS
+  if(s->output_segments != NULL) {
+    acked_segments(s);
+    return;
+  }
+#endif /* TCP_SOCKET_SEGMENTS */
+
   if(s->output_senddata_len > 0) {
     /* Copy the data in the outputbuf down and update outputbufptr and
        outputbuf_lastsent */
@@ -215,7 +315,11 @@ appcall(void *state)
     senddata(s);
   }
 
-  if(s->output_data_len == 0 && s->flags & TCP_SOCKET_FLAGS_CLOSING) {
+  if(s->output_data_len == 0 &&
+#if TCP_SOCKET_SEGMENTS
+     s->output_segments == NULL &&
+#endif /* TCP_SOCKET_SEGMENTS */
+     s->flags & TCP_SOCKET_FLAGS_CLOSING) {
     s->flags &= ~TCP_SOCKET_FLAGS_CLOSING;
     uip_close();
     s->c = NULL;
@@ -276,6 +380,9 @@ tcp_socket_register(struct tcp_socket *s, void *ptr,
   s->output_data_len = 0;
   s->output_data_ptr = output_databuf;
   s->output_data_maxlen = output_databuf_len;
+#if TCP_SOCKET_SEGMENTS
+  s->output_segments = NULL;
+#endif /* TCP_SOCKET_SEGMENTS */
   s->input_callback = input_callback;
   s->event_callback = event_callback;
   list_add(socketlist, s);
@@ -347,6 +454,13 @@ tcp_socket_send(struct tcp_socket *s,
     return -1;
   }
 
+#if TCP_SOCKET_SEGMENTS
+  /* Data must not overtake a pending segment list */
+  if(s->output_segments != NULL) {
+    return 0;
+  }
+#endif /* TCP_SOCKET_SEGMENTS */
+
   len = MIN(datalen, s->output_data_maxlen - s->output_data_len);
 
   memcpy(&s->output_data_ptr[s->output_data_len], data, len);
@@ -366,6 +480,25 @@ tcp_socket_send_str(struct tcp_socket *s,
   return tcp_socket_send(s, (const uint8_t *)str, strlen(str));
 }
 /*---------------------------------------------------------------------------*/
+#if TCP_SOCKET_SEGMENTS
+int
+tcp_socket_send_segments(struct tcp_socket *s,
+                         const struct tcp_socket_segment *segments,
+                         int count)
+{
+  if(s == NULL || s->output_segments != NULL) {
+    return -1;
+  }
+
+  s->output_segments = segments;
+  s->output_segments_count = count;
+  s->output_segment_offset = 0;
+  skip_empty_segments(s);
+
+  return 1;
+}
+#endif /* TCP_SOCKET_SEGMENTS */
+/*---------------------------------------------------------------------------*/
 int
 tcp_socket_close(struct tcp_socket *s)
 {
@@ -395,6 +528,11 @@ tcp_socket_unregister(struct tcp_socket *s)
 int
 tcp_socket_max_sendlen(struct tcp_socket *s)
 {
+#if TCP_SOCKET_SEGMENTS
+  if(s->output_segments != NULL) {
+    return 0;
+  }
+#endif /* TCP_SOCKET_SEGMENTS */
   return s->output_data_maxlen - s->output_data_len;
 }
 /*---------------------------------------------------------------------------*/
@@ -34,6 +34,17 @@
 
 #include "uip.h"
 
+/*
+ * Let tcp_socket_send_segments() queue caller-owned buffers that are
+ * gathered straight into the uIP packet buffer, instead of being copied
+ * into the socket's output buffer first.
+ */
+#ifdef TCP_SOCKET_CONF_SEGMENTS
+#define TCP_SOCKET_SEGMENTS TCP_SOCKET_CONF_SEGMENTS
+#else
+#define TCP_SOCKET_SEGMENTS 0
+#endif
+
 struct tcp_socket;
 
 typedef enum {
@@ -80,6 +91,16 @@ typedef void (* tcp_socket_event_callback_t)(struct tcp_socket *s,
                                              void *ptr,
                                              tcp_socket_event_t event);
 
+#if TCP_SOCKET_SEGMENTS
+/**
+ * \brief One buffer of a segment list passed to tcp_socket_send_segments()
+ */
+struct tcp_socket_segment {
+  const uint8_t *data;
+  uint32_t len;
+};
+#endif /* TCP_SOCKET_SEGMENTS */
+
 struct tcp_socket {
   struct tcp_socket *next;
 
@@ -100,6 +121,13 @@ struct tcp_socket {
   uint16_t output_senddata_len;
   uint16_t output_data_max_seg;
 
+#if TCP_SOCKET_SEGMENTS
+  /* Unacknowledged part of the segment list, sent after the output buffer */
+  const struct tcp_socket_segment *output_segments;
+  uint8_t output_segments_count;
+  uint32_t output_segment_offset;
+#endif /* TCP_SOCKET_SEGMENTS */
+
   uint8_t flags;
   uint16_t listen_port;
   struct uip_conn *c;
@@ -243,6 +271,38 @@ int tcp_socket_send(struct tcp_socket *s,
 int tcp_socket_send_str(struct tcp_socket *s,
                         const char *strptr);
 
+#if TCP_SOCKET_SEGMENTS
+/**
+ * \brief      Send a list of buffers on a connected TCP socket without copying them
+ * \param s    A pointer to a TCP socket that must have been previously registered with tcp_socket_register()
+ * \param segments A pointer to an array of segments
+ * \param count The number of segments in the array
+ * \retval -1  If an error occurs
+ * \retval 1   If the operation succeeds.
+ *
+ *             This function queues the segments to be sent after
+ *             the data that is already in the output buffer. The
+ *             segments are copied directly into outgoing TCP
+ *             segments, so they may be larger than the output
+ *             buffer. The array and the buffers it points to are
+ *             owned by the caller and must not be changed until
+ *             tcp_socket_segments_pending() returns 0. Until then,
+ *             tcp_socket_send() does not accept any data. The
+ *             function fails if a segment list is already pending.
+ *
+ */
+int tcp_socket_send_segments(struct tcp_socket *s,
+                             const struct tcp_socket_segment *segments,
+                             int count);
+
+/**
+ * \brief      Check whether a segment list is waiting to be acknowledged
+ * \param s    A pointer to a TCP socket
+ * \return     Non-zero if tcp_socket_send_segments() data is still in use
+ */
+#define tcp_socket_segments_pending(s) ((s)->output_segments != NULL)
+#endif /* TCP_SOCKET_SEGMENTS */
+
 /**
  * \brief      Close a connected TCP socket
  * \param s    A pointer to a TCP socket that must have been previously registered with tcp_socket_register()
@@ -38,6 +38,10 @@
 
 #include "lib/random.h"
 
+#if IP64_ADDRMAP_HASH
+#include "sys/ctimer.h"
+#endif /* IP64_ADDRMAP_HASH */
+
 #include <string.h>
 
 #ifdef IP64_ADDRMAP_CONF_ENTRIES
@@ -46,9 +50,33 @@
 #define NUM_ENTRIES 32
 #endif /* IP64_ADDRMAP_CONF_ENTRIES */
 
+/* Number of buckets in each hash index, defaults to one per entry */
+#ifdef IP64_ADDRMAP_CONF_HASH_SIZE
+#define HASH_SIZE IP64_ADDRMAP_CONF_HASH_SIZE
+#else /* IP64_ADDRMAP_CONF_HASH_SIZE */
+#define HASH_SIZE NUM_ENTRIES
+#endif /* IP64_ADDRMAP_CONF_HASH_SIZE */
+
+/* How often old mappings are thrown away when using the hash indexes */
+#ifdef IP64_ADDRMAP_CONF_AGE_INTERVAL
+#define AGE_INTERVAL IP64_ADDRMAP_CONF_AGE_INTERVAL
+#else /* IP64_ADDRMAP_CONF_AGE_INTERVAL */
+#define AGE_INTERVAL (10 * CLOCK_SECOND)
+#endif /* IP64_ADDRMAP_CONF_AGE_INTERVAL */
+
 MEMB(entrymemb, struct ip64_addrmap_entry, NUM_ENTRIES);
 LIST(entrylist);
 
+#if IP64_ADDRMAP_HASH
+static struct ip64_addrmap_entry *tuple_hash[HASH_SIZE];
+static struct ip64_addrmap_entry *port_hash[HASH_SIZE];
+static struct ctimer age_timer;
+#endif /* IP64_ADDRMAP_HASH */
+
+#if IP64_ADDRMAP_STATS
+struct ip64_addrmap_stats ip64_addrmap_stats;
+#endif /* IP64_ADDRMAP_STATS */
+
 #define FIRST_MAPPED_PORT 10000
 #define LAST_MAPPED_PORT  20000
 static uint16_t mapped_port = FIRST_MAPPED_PORT;
@@ -67,9 +95,86 @@ ip64_addrmap_init(void)
 {
   memb_init(&entrymemb);
   list_init(entrylist);
+#if IP64_ADDRMAP_HASH
+  memset(tuple_hash, 0, sizeof(tuple_hash));
+  memset(port_hash, 0, sizeof(port_hash));
+  ctimer_stop(&age_timer);
+#endif /* IP64_ADDRMAP_HASH */
   mapped_port = FIRST_MAPPED_PORT;
 }
 /*---------------------------------------------------------------------------*/
+#if IP64_ADDRMAP_HASH
+static uint16_t
+tuple_bucket(const uip_ip6addr_t *ip6addr, uint16_t ip6port,
+             const uip_ip4addr_t *ip4addr, uint16_t ip4port,
+             uint8_t protocol)
+{
+  uint16_t h;
+  int i;
+
+  h = protocol ^ ip6port ^ (ip4port << 1);
+  for(i = 0; i < sizeof(uip_ip6addr_t); i++) {
+    h = (h << 5) + h + ip6addr->u8[i];
+  }
+  for(i = 0; i < sizeof(uip_ip4addr_t); i++) {
+    h = (h << 5) + h + ip4addr->u8[i];
+  }
+  return h % HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+#define port_bucket(port) ((port) % HASH_SIZE)
+/*---------------------------------------------------------------------------*/
+static void
+hash_add(struct ip64_addrmap_entry *m)
+{
+  uint16_t bucket;
+
+  bucket = tuple_bucket(&m->ip6addr, m->ip6port,
+                        &m->ip4addr, m->ip4port, m->protocol);
+  m->tuple_next = tuple_hash[bucket];
+  tuple_hash[bucket] = m;
+
+  bucket = port_bucket(m->mapped_port);
+  m->port_next = port_hash[bucket];
+  port_hash[bucket] = m;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_rm(struct ip64_addrmap_entry *m)
+{
+  struct ip64_addrmap_entry **p;
+
+  for(p = &tuple_hash[tuple_bucket(&m->ip6addr, m->ip6port,
+                                   &m->ip4addr, m->ip4port, m->protocol)];
+      *p != NULL;
+      p = &(*p)->tuple_next) {
+    if(*p == m) {
+      *p = m->tuple_next;
+      break;
+    }
+  }
+
+  for(p = &port_hash[port_bucket(m->mapped_port)];
+      *p != NULL;
+      p = &(*p)->port_next) {
+    if(*p == m) {
+      *p = m->port_next;
+      break;
+    }
+  }
+}
+#endif /* IP64_ADDRMAP_HASH */
+/*---------------------------------------------------------------------------*/
+static void
+remove_entry(struct ip64_addrmap_entry *m)
+{
+#if IP64_ADDRMAP_HASH
+  hash_rm(m);
+#endif /* IP64_ADDRMAP_HASH */
+  list_remove(entrylist, m);
+  memb_free(&entrymemb, m);
+}
+/*---------------------------------------------------------------------------*/
 static void
 check_age(void)
 {
@@ -80,8 +185,7 @@ check_age(void)
   m = list_head(entrylist);
   while(m != NULL) {
     if(timer_expired(&m->timer)) {
-      list_remove(entrylist, m);
-      memb_free(&entrymemb, m);
+      remove_entry(m);
       m = list_head(entrylist);
     } else {
       m = list_item_next(m);
@@ -89,6 +193,17 @@ check_age(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if IP64_ADDRMAP_HASH
+static void
+periodic_check_age(void *ptr)
+{
+  check_age();
+  if(list_head(entrylist) != NULL) {
+    ctimer_reset(&age_timer);
+  }
+}
+#endif /* IP64_ADDRMAP_HASH */
+/*---------------------------------------------------------------------------*/
 static int
 recycle(void)
 {
@@ -117,8 +232,8 @@ recycle(void)
   /* If we found an oldest recyclable entry, remove it and return
      non-zero. */
   if(oldest != NULL) {
-    list_remove(entrylist, oldest);
-    memb_free(&entrymemb, oldest);
+    remove_entry(oldest);
+    IP64_ADDRMAP_STAT(ip64_addrmap_stats.recycled++);
     return 1;
   }
 
@@ -134,6 +249,28 @@ ip64_addrmap_lookup(const uip_ip6addr_t *ip6addr,
 {
   struct ip64_addrmap_entry *m;
 
+#if IP64_ADDRMAP_HASH
+  for(m = tuple_hash[tuple_bucket(ip6addr, ip6port, ip4addr, ip4port,
+                                  protocol)];
+      m != NULL;
+      m = m->tuple_next) {
+    if(m->protocol == protocol &&
+       m->ip4port == ip4port &&
+       m->ip6port == ip6port &&
+       uip_ip4addr_cmp(&m->ip4addr, ip4addr) &&
+       uip_ip6addr_cmp(&m->ip6addr, ip6addr)) {
+      /* Mappings that are too old but not yet thrown away by the
+         periodic check are not used anymore. */
+      if(timer_expired(&m->timer)) {
+        remove_entry(m);
+        break;
+      }
+      m->ip6to4++;
+      IP64_ADDRMAP_STAT(ip64_addrmap_stats.hits++);
+      return m;
+    }
+  }
+#else /* IP64_ADDRMAP_HASH */
   printf("lookup ip4port %d ip6port %d\n", uip_htons(ip4port),
 	 uip_htons(ip6port));
   check_age();
@@ -150,9 +287,12 @@ ip64_addrmap_lookup(const uip_ip6addr_t *ip6addr,
        uip_ip4addr_cmp(&m->ip4addr, ip4addr) &&
        uip_ip6addr_cmp(&m->ip6addr, ip6addr)) {
       m->ip6to4++;
+      IP64_ADDRMAP_STAT(ip64_addrmap_stats.hits++);
       return m;
     }
   }
+#endif /* IP64_ADDRMAP_HASH */
+  IP64_ADDRMAP_STAT(ip64_addrmap_stats.misses++);
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -161,6 +301,22 @@ ip64_addrmap_lookup_port(uint16_t mapped_port, uint8_t protocol)
 {
   struct ip64_addrmap_entry *m;
 
+#if IP64_ADDRMAP_HASH
+  for(m = port_hash[port_bucket(mapped_port)];
+      m != NULL;
+      m = m->port_next) {
+    if(m->mapped_port == mapped_port &&
+       m->protocol == protocol) {
+      if(timer_expired(&m->timer)) {
+        remove_entry(m);
+        break;
+      }
+      m->ip4to6++;
+      IP64_ADDRMAP_STAT(ip64_addrmap_stats.hits++);
+      return m;
+    }
+  }
+#else /* IP64_ADDRMAP_HASH */
   check_age();
   for(m = list_head(entrylist); m != NULL; m = list_item_next(m)) {
     printf("mapped port %d %d, protocol %d %d\n",
@@ -169,9 +325,12 @@ ip64_addrmap_lookup_port(uint16_t mapped_port, uint8_t protocol)
     if(m->mapped_port == mapped_port &&
        m->protocol == protocol) {
       m->ip4to6++;
+      IP64_ADDRMAP_STAT(ip64_addrmap_stats.hits++);
       return m;
     }
   }
+#endif /* IP64_ADDRMAP_HASH */
+  IP64_ADDRMAP_STAT(ip64_addrmap_stats.misses++);
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -182,6 +341,27 @@ increase_mapped_port(void)
     FIRST_MAPPED_PORT;
 }
 /*---------------------------------------------------------------------------*/
+static int
+mapped_port_used(void)
+{
+  struct ip64_addrmap_entry *n;
+
+#if IP64_ADDRMAP_HASH
+  for(n = port_hash[port_bucket(mapped_port)]; n != NULL; n = n->port_next) {
+    if(n->mapped_port == mapped_port) {
+      return 1;
+    }
+  }
+#else /* IP64_ADDRMAP_HASH */
+  for(n = list_head(entrylist); n != NULL; n = list_item_next(n)) {
+    if(n->mapped_port == mapped_port) {
+      return 1;
+    }
+  }
+#endif /* IP64_ADDRMAP_HASH */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 struct ip64_addrmap_entry *
 ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
 		    uint16_t ip6port,
@@ -191,8 +371,18 @@ ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
 {
   struct ip64_addrmap_entry *m;
 
+#if IP64_ADDRMAP_HASH
+  m = memb_alloc(&entrymemb);
+  if(m == NULL) {
+    /* Throw away old mappings that the periodic check has not got to
+       yet before recycling one that is still in use. */
+    check_age();
+    m = memb_alloc(&entrymemb);
+  }
+#else /* IP64_ADDRMAP_HASH */
   check_age();
   m = memb_alloc(&entrymemb);
+#endif /* IP64_ADDRMAP_HASH */
   if(m == NULL) {
     /* We could not allocate an entry, try to recycle one and try to
        allocate again. */
@@ -214,22 +404,19 @@ ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
     /* Pick a new, unused local port. First make sure that the
        mapped_port number does not belong to any active connection. If
        so, we keep increasing the mapped_port until we're free. */
-    {
-      struct ip64_addrmap_entry *n;
-      n = list_head(entrylist);
-      while(n != NULL) {
-	if(n->mapped_port == mapped_port) {
-	  increase_mapped_port();
-	  n = list_head(entrylist);
-	} else {
-	  n = list_item_next(m);
-	}
-      }
+    while(mapped_port_used()) {
+      increase_mapped_port();
     }
     m->mapped_port = mapped_port;
     increase_mapped_port();
 
     list_add(entrylist, m);
+#if IP64_ADDRMAP_HASH
+    hash_add(m);
+    if(ctimer_expired(&age_timer)) {
+      ctimer_set(&age_timer, AGE_INTERVAL, periodic_check_age, NULL);
+    }
+#endif /* IP64_ADDRMAP_HASH */
     return m;
   }
   return NULL;
@@ -36,8 +36,28 @@
 #include "sys/timer.h"
 #include "net/ip/uip.h"
 
+/* Index the address mappings by their address/port tuple and by their
+   mapped port, and throw away old mappings from a periodic timer
+   instead of on every lookup. */
+#ifdef IP64_ADDRMAP_CONF_HASH
+#define IP64_ADDRMAP_HASH IP64_ADDRMAP_CONF_HASH
+#else /* IP64_ADDRMAP_CONF_HASH */
+#define IP64_ADDRMAP_HASH 0
+#endif /* IP64_ADDRMAP_CONF_HASH */
+
+/* Count lookups and recycled mappings in ip64_addrmap_stats */
+#ifdef IP64_ADDRMAP_CONF_STATS
+#define IP64_ADDRMAP_STATS IP64_ADDRMAP_CONF_STATS
+#else /* IP64_ADDRMAP_CONF_STATS */
+#define IP64_ADDRMAP_STATS 0
+#endif /* IP64_ADDRMAP_CONF_STATS */
+
 struct ip64_addrmap_entry {
   struct ip64_addrmap_entry *next;
+#if IP64_ADDRMAP_HASH
+  struct ip64_addrmap_entry *tuple_next;
+  struct ip64_addrmap_entry *port_next;
+#endif /* IP64_ADDRMAP_HASH */
   struct timer timer;
   uip_ip6addr_t ip6addr;
   uip_ip4addr_t ip4addr;
@@ -52,6 +72,23 @@ struct ip64_addrmap_entry {
 #define FLAGS_NONE       0
 #define FLAGS_RECYCLABLE 1
 
+#if IP64_ADDRMAP_STATS
+struct ip64_addrmap_stats {
+  /** Lookups that found a mapping */
+  uint32_t hits;
+  /** Lookups that did not find a mapping */
+  uint32_t misses;
+  /** Mappings thrown away to make room for a new one */
+  uint32_t recycled;
+};
+
+extern struct ip64_addrmap_stats ip64_addrmap_stats;
+
+#define IP64_ADDRMAP_STAT(code) (code)
+#else /* IP64_ADDRMAP_STATS */
+#define IP64_ADDRMAP_STAT(code)
+#endif /* IP64_ADDRMAP_STATS */
+
 /**
  * Initialize the ip64_addrmap module.
  */
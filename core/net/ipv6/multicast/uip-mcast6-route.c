@@ -56,15 +56,92 @@
 #else
 #define UIP_MCAST6_ROUTE_ROUTES 1
 #endif /* UIP_CONF_DS6_MCAST_ROUTES */
+
+/* Number of hash buckets, defaults to two per route */
+#ifdef UIP_MCAST6_ROUTE_CONF_HASH_SIZE
+#define UIP_MCAST6_ROUTE_HASH_SIZE UIP_MCAST6_ROUTE_CONF_HASH_SIZE
+#else
+#define UIP_MCAST6_ROUTE_HASH_SIZE (2 * UIP_MCAST6_ROUTE_ROUTES)
+#endif /* UIP_MCAST6_ROUTE_CONF_HASH_SIZE */
 /*---------------------------------------------------------------------------*/
 LIST(mcast_route_list);
 MEMB(mcast_route_memb, uip_mcast6_route_t, UIP_MCAST6_ROUTE_ROUTES);
 
 static uip_mcast6_route_t *locmcastrt;
+
+#if UIP_MCAST6_ROUTE_HASH
+/*
+ * Routes are chained into hash buckets by their group. One bit per bucket
+ * tells whether the bucket holds any route, so that a datagram for a group
+ * we have no route for is usually rejected without touching a route.
+ */
+static uip_mcast6_route_t *mcast_route_hash[UIP_MCAST6_ROUTE_HASH_SIZE];
+static uint8_t mcast_route_members[(UIP_MCAST6_ROUTE_HASH_SIZE + 7) / 8];
+#endif /* UIP_MCAST6_ROUTE_HASH */
+/*---------------------------------------------------------------------------*/
+#if UIP_MCAST6_ROUTE_HASH
+static uint16_t
+hash_bucket(const uip_ipaddr_t *group)
+{
+  uint16_t h;
+  int i;
+
+  /* The scope and flags in the first two bytes rarely tell groups apart */
+  h = 0;
+  for(i = 2; i < 16; i++) {
+    h = (h << 5) + h + group->u8[i];
+  }
+  return h % UIP_MCAST6_ROUTE_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_add(uip_mcast6_route_t *route)
+{
+  uint16_t bucket = hash_bucket(&route->group);
+
+  route->hash_next = mcast_route_hash[bucket];
+  mcast_route_hash[bucket] = route;
+  mcast_route_members[bucket >> 3] |= 1 << (bucket & 7);
+}
+/*---------------------------------------------------------------------------*/
+static int
+hash_rm(uip_mcast6_route_t *route)
+{
+  uint16_t bucket = hash_bucket(&route->group);
+  uip_mcast6_route_t **p;
+
+  for(p = &mcast_route_hash[bucket]; *p != NULL; p = &(*p)->hash_next) {
+    if(*p == route) {
+      *p = route->hash_next;
+      if(mcast_route_hash[bucket] == NULL) {
+        mcast_route_members[bucket >> 3] &= ~(1 << (bucket & 7));
+      }
+      return 1;
+    }
+  }
+  return 0;
+}
+#endif /* UIP_MCAST6_ROUTE_HASH */
 /*---------------------------------------------------------------------------*/
 uip_mcast6_route_t *
 uip_mcast6_route_lookup(uip_ipaddr_t *group)
 {
+#if UIP_MCAST6_ROUTE_HASH
+  uint16_t bucket = hash_bucket(group);
+
+  if(!(mcast_route_members[bucket >> 3] & (1 << (bucket & 7)))) {
+    return NULL;
+  }
+  for(locmcastrt = mcast_route_hash[bucket];
+      locmcastrt != NULL;
+      locmcastrt = locmcastrt->hash_next) {
+    if(uip_ipaddr_cmp(&locmcastrt->group, group)) {
+      return locmcastrt;
+    }
+  }
+
+  return NULL;
+#else
   locmcastrt = NULL;
   for(locmcastrt = list_head(mcast_route_list);
       locmcastrt != NULL;
@@ -75,6 +152,7 @@ uip_mcast6_route_lookup(uip_ipaddr_t *group)
   }
 
   return NULL;
+#endif /* UIP_MCAST6_ROUTE_HASH */
 }
 /*---------------------------------------------------------------------------*/
 uip_mcast6_route_t *
@@ -89,6 +167,10 @@ uip_mcast6_route_add(uip_ipaddr_t *group)
       return NULL;
     }
     list_add(mcast_route_list, locmcastrt);
+#if UIP_MCAST6_ROUTE_HASH
+    uip_ipaddr_copy(&(locmcastrt->group), group);
+    hash_add(locmcastrt);
+#endif /* UIP_MCAST6_ROUTE_HASH */
   }
 
   /* Reaching here means we either found the prefix or allocated a new one */
@@ -101,6 +183,13 @@ uip_mcast6_route_add(uip_ipaddr_t *group)
 void
 uip_mcast6_route_rm(uip_mcast6_route_t *route)
 {
+#if UIP_MCAST6_ROUTE_HASH
+  /* Make sure it's actually in the table */
+  if(hash_rm(route)) {
+    list_remove(mcast_route_list, route);
+    memb_free(&mcast_route_memb, route);
+  }
+#else
   /* Make sure it's actually in the list */
   for(locmcastrt = list_head(mcast_route_list);
       locmcastrt != NULL;
@@ -111,6 +200,7 @@ uip_mcast6_route_rm(uip_mcast6_route_t *route)
       return;
     }
   }
+#endif /* UIP_MCAST6_ROUTE_HASH */
 }
 /*---------------------------------------------------------------------------*/
 uip_mcast6_route_t *
@@ -130,6 +220,10 @@ uip_mcast6_route_init()
 {
   memb_init(&mcast_route_memb);
   list_init(mcast_route_list);
+#if UIP_MCAST6_ROUTE_HASH
+  memset(mcast_route_hash, 0, sizeof(mcast_route_hash));
+  memset(mcast_route_members, 0, sizeof(mcast_route_members));
+#endif /* UIP_MCAST6_ROUTE_HASH */
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
@@ -47,9 +47,23 @@
 
 #include <stdint.h>
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief Keep a hash index over the multicast routing table, so that
+ *        uip_mcast6_route_lookup() does not have to compare the group of
+ *        every route for each received multicast datagram
+ */
+#ifdef UIP_MCAST6_ROUTE_CONF_HASH
+#define UIP_MCAST6_ROUTE_HASH UIP_MCAST6_ROUTE_CONF_HASH
+#else
+#define UIP_MCAST6_ROUTE_HASH 0
+#endif
+/*---------------------------------------------------------------------------*/
 /** \brief An entry in the multicast routing table */
 typedef struct uip_mcast6_route {
   struct uip_mcast6_route *next; /**< Routes are arranged in a linked list */
+#if UIP_MCAST6_ROUTE_HASH
+  struct uip_mcast6_route *hash_next; /**< Next route in the hash bucket */
+#endif
   uip_ipaddr_t group; /**< The multicast group */
   uint32_t lifetime; /**< Entry lifetime seconds */
   void *dag; /**< Pointer to an rpl_dag_t struct */
@@ -251,6 +251,23 @@ static uint16_t my_tag;
 /* Assuming that the worst growth for uncompression is 38 bytes */
 #define SICSLOWPAN_FIRST_FRAGMENT_SIZE (SICSLOWPAN_FRAGMENT_SIZE + 38)
 
+#if SICSLOWPAN_REASS_HASH
+/* Number of hash buckets for the reassembly contexts */
+#ifdef SICSLOWPAN_CONF_REASS_HASH_SIZE
+#define SICSLOWPAN_REASS_HASH_SIZE SICSLOWPAN_CONF_REASS_HASH_SIZE
+#else
+#define SICSLOWPAN_REASS_HASH_SIZE SICSLOWPAN_REASS_CONTEXTS
+#endif
+
+/* Index of a reassembly context or fragment buffer */
+#if SICSLOWPAN_REASS_CONTEXTS >= 0xff || SICSLOWPAN_FRAGMENT_BUFFERS >= 0xff
+typedef uint16_t reass_index_t;
+#else
+typedef uint8_t reass_index_t;
+#endif
+#define REASS_NONE ((reass_index_t)~0)
+#endif /* SICSLOWPAN_REASS_HASH */
+
 /* all information needed for reassembly */
 struct sicslowpan_frag_info {
   /** When reassembling, the source address of the fragments being merged */
@@ -265,6 +282,15 @@ struct sicslowpan_frag_info {
   uint16_t reassembled_len;
   /** Reassembly %process %timer. */
   struct timer reass_timer;
+#if SICSLOWPAN_REASS_HASH
+  /** Next context in the same hash bucket, or in the free list */
+  reass_index_t hash_next;
+  /** Previous and next context in the LRU list */
+  reass_index_t lru_prev;
+  reass_index_t lru_next;
+  /** Chain of the fragment buffers of this context */
+  reass_index_t frags;
+#endif /* SICSLOWPAN_REASS_HASH */
 
   /** Fragment size of first fragment */
   uint16_t first_frag_len;
@@ -276,8 +302,13 @@ struct sicslowpan_frag_info {
 static struct sicslowpan_frag_info frag_info[SICSLOWPAN_REASS_CONTEXTS];
 
 struct sicslowpan_frag_buf {
+#if SICSLOWPAN_REASS_HASH
+  /* Next fragment of the same context, or next free buffer */
+  reass_index_t next;
+#else /* SICSLOWPAN_REASS_HASH */
   /* the index of the frag_info */
   uint8_t index;
+#endif /* SICSLOWPAN_REASS_HASH */
   /* Fragment offset */
   uint8_t offset;
   /* Length of this fragment (if zero this buffer is not allocated) */
@@ -287,6 +318,265 @@ struct sicslowpan_frag_buf {
 
 static struct sicslowpan_frag_buf frag_buf[SICSLOWPAN_FRAGMENT_BUFFERS];
 
+#if SICSLOWPAN_REASS_HASH
+/* Contexts in use, hashed on sender and tag */
+static reass_index_t reass_hash[SICSLOWPAN_REASS_HASH_SIZE];
+/* Contexts in use, from the most to the least recently used */
+static reass_index_t reass_lru_head;
+static reass_index_t reass_lru_tail;
+/* Unused contexts and fragment buffers */
+static reass_index_t reass_free_contexts;
+static reass_index_t reass_free_bufs;
+/* Statistics */
+static uint32_t reass_evicted;
+static uint32_t reass_timedout;
+
+/*---------------------------------------------------------------------------*/
+static void
+reass_init(void)
+{
+  int i;
+  for(i = 0; i < SICSLOWPAN_REASS_HASH_SIZE; i++) {
+    reass_hash[i] = REASS_NONE;
+  }
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    frag_info[i].len = 0;
+    frag_info[i].hash_next = i + 1 < SICSLOWPAN_REASS_CONTEXTS ? i + 1 : REASS_NONE;
+  }
+  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
+    frag_buf[i].len = 0;
+    frag_buf[i].next = i + 1 < SICSLOWPAN_FRAGMENT_BUFFERS ? i + 1 : REASS_NONE;
+  }
+  reass_free_contexts = SICSLOWPAN_REASS_CONTEXTS > 0 ? 0 : REASS_NONE;
+  reass_free_bufs = SICSLOWPAN_FRAGMENT_BUFFERS > 0 ? 0 : REASS_NONE;
+  reass_lru_head = reass_lru_tail = REASS_NONE;
+  reass_evicted = reass_timedout = 0;
+}
+/*---------------------------------------------------------------------------*/
+static reass_index_t *
+reass_bucket(const linkaddr_t *sender, uint16_t tag)
+{
+  uint16_t h = tag;
+  int i;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = h * 33 + sender->u8[i];
+  }
+  return &reass_hash[h % SICSLOWPAN_REASS_HASH_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+static reass_index_t
+reass_lookup(const linkaddr_t *sender, uint16_t tag)
+{
+  reass_index_t i = *reass_bucket(sender, tag);
+  while(i != REASS_NONE) {
+    if(frag_info[i].tag == tag && linkaddr_cmp(&frag_info[i].sender, sender)) {
+      break;
+    }
+    i = frag_info[i].hash_next;
+  }
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+static void
+lru_unlink(reass_index_t i)
+{
+  if(frag_info[i].lru_prev != REASS_NONE) {
+    frag_info[frag_info[i].lru_prev].lru_next = frag_info[i].lru_next;
+  } else {
+    reass_lru_head = frag_info[i].lru_next;
+  }
+  if(frag_info[i].lru_next != REASS_NONE) {
+    frag_info[frag_info[i].lru_next].lru_prev = frag_info[i].lru_prev;
+  } else {
+    reass_lru_tail = frag_info[i].lru_prev;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+lru_push(reass_index_t i)
+{
+  frag_info[i].lru_prev = REASS_NONE;
+  frag_info[i].lru_next = reass_lru_head;
+  if(reass_lru_head != REASS_NONE) {
+    frag_info[reass_lru_head].lru_prev = i;
+  } else {
+    reass_lru_tail = i;
+  }
+  reass_lru_head = i;
+}
+/*---------------------------------------------------------------------------*/
+/* Release a context and all its fragment buffers */
+static void
+reass_free(reass_index_t i)
+{
+  reass_index_t *p;
+  reass_index_t b = frag_info[i].frags;
+
+  while(b != REASS_NONE) {
+    reass_index_t next = frag_buf[b].next;
+    frag_buf[b].len = 0;
+    frag_buf[b].next = reass_free_bufs;
+    reass_free_bufs = b;
+    b = next;
+  }
+
+  p = reass_bucket(&frag_info[i].sender, frag_info[i].tag);
+  while(*p != i) {
+    p = &frag_info[*p].hash_next;
+  }
+  *p = frag_info[i].hash_next;
+  lru_unlink(i);
+
+  frag_info[i].len = 0;
+  frag_info[i].hash_next = reass_free_contexts;
+  reass_free_contexts = i;
+}
+/*---------------------------------------------------------------------------*/
+/* Drop the least recently used reassembly other than keep.
+   Returns 0 if there is none. */
+static int
+reass_evict(reass_index_t keep)
+{
+  reass_index_t i = reass_lru_tail;
+  if(i != REASS_NONE && i == keep) {
+    i = frag_info[i].lru_prev;
+  }
+  if(i == REASS_NONE) {
+    return 0;
+  }
+  if(timer_expired(&frag_info[i].reass_timer)) {
+    reass_timedout++;
+  } else {
+    reass_evicted++;
+    PRINTF("*** Evicting fragment session - tag: %d\n", frag_info[i].tag);
+  }
+  reass_free(i);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* add a new fragment to the buffer */
+static int16_t
+add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
+{
+  const linkaddr_t *sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  reass_index_t i;
+  reass_index_t b;
+  int len;
+
+  /* Drop the timed out reassemblies that have not been used since */
+  while(reass_lru_tail != REASS_NONE &&
+        timer_expired(&frag_info[reass_lru_tail].reass_timer)) {
+    reass_evict(REASS_NONE);
+  }
+
+  i = reass_lookup(sender, tag);
+
+  if(offset == 0) {
+    if(i != REASS_NONE) {
+      PRINTF("*** Duplicate first fragment - tag: %d\n", tag);
+      return -1;
+    }
+    if(reass_free_contexts == REASS_NONE) {
+      reass_evict(REASS_NONE);
+    }
+    if(reass_free_contexts == REASS_NONE) {
+      PRINTF("*** Failed to store new fragment session - tag: %d\n", tag);
+      return -1;
+    }
+
+    i = reass_free_contexts;
+    reass_free_contexts = frag_info[i].hash_next;
+
+    frag_info[i].len = frag_size;
+    frag_info[i].tag = tag;
+    linkaddr_copy(&frag_info[i].sender, sender);
+    timer_set(&frag_info[i].reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+    frag_info[i].frags = REASS_NONE;
+    frag_info[i].hash_next = *reass_bucket(sender, tag);
+    *reass_bucket(sender, tag) = i;
+    lru_push(i);
+    /* first fragment can not be stored immediately but is moved into
+       the buffer while uncompressing */
+    return i;
+  }
+
+  if(i == REASS_NONE) {
+    /* no entry found for storing the new fragment */
+    PRINTF("*** Failed to store N-fragment - could not find session - tag: %d offset: %d\n", tag, offset);
+    return -1;
+  }
+  if(timer_expired(&frag_info[i].reass_timer)) {
+    reass_timedout++;
+    reass_free(i);
+    return -1;
+  }
+
+  len = packetbuf_datalen() - packetbuf_hdr_len;
+  if(len <= 0 || len > SICSLOWPAN_FRAGMENT_SIZE) {
+    PRINTF("*** Failed to store fragment - bad length %d tag: %d\n", len, tag);
+    return -1;
+  }
+  /* Ignore duplicates, they would be counted twice in reassembled_len */
+  for(b = frag_info[i].frags; b != REASS_NONE; b = frag_buf[b].next) {
+    if(frag_buf[b].offset == offset) {
+      PRINTF("*** Duplicate fragment - tag: %d offset: %d\n", tag, offset);
+      return -1;
+    }
+  }
+
+  /* Make this the most recently used reassembly, and evict others if
+     we are out of fragment buffers */
+  lru_unlink(i);
+  lru_push(i);
+  while(reass_free_bufs == REASS_NONE && reass_evict(i));
+  if(reass_free_bufs == REASS_NONE) {
+    PRINTF("*** Failed to store fragment - packet reassembly will fail tag:%d l\n", tag);
+    return -1;
+  }
+
+  b = reass_free_bufs;
+  reass_free_bufs = frag_buf[b].next;
+  frag_buf[b].offset = offset;
+  frag_buf[b].len = len;
+  memcpy(frag_buf[b].data, packetbuf_ptr + packetbuf_hdr_len, len);
+  frag_buf[b].next = frag_info[i].frags;
+  frag_info[i].frags = b;
+  PRINTF("Fragsize: %d\n", len);
+
+  frag_info[i].reassembled_len += len;
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+/* Copy all the fragments that are associated with a specific context
+   into uip */
+static void
+copy_frags2uip(int context)
+{
+  reass_index_t b;
+
+  /* Copy from the fragment context info buffer first */
+  memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)frag_info[context].first_frag,
+	 frag_info[context].first_frag_len);
+  for(b = frag_info[context].frags; b != REASS_NONE; b = frag_buf[b].next) {
+    memcpy((uint8_t *)UIP_IP_BUF + (uint16_t)(frag_buf[b].offset << 3),
+	   (uint8_t *)frag_buf[b].data, frag_buf[b].len);
+  }
+  /* deallocate all the fragments for this context */
+  reass_free(context);
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+sicslowpan_reass_evicted(void)
+{
+  return reass_evicted;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+sicslowpan_reass_timedout(void)
+{
+  return reass_timedout;
+}
+#else /* SICSLOWPAN_REASS_HASH */
 /*---------------------------------------------------------------------------*/
 static int
 clear_fragments(uint8_t frag_info_index)
@@ -342,12 +632,12 @@ store_fragment(uint8_t index, uint8_t offset)
 }
 /*---------------------------------------------------------------------------*/
 /* add a new fragment to the buffer */
-static int8_t
+static int16_t
 add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
 {
   int i;
   int len;
-  int8_t found = -1;
+  int16_t found = -1;
 
   if(offset == 0) {
     /* This is a first fragment - check if we can add this */
@@ -433,6 +723,7 @@ copy_frags2uip(int context)
   /* deallocate all the fragments for this context */
   clear_fragments(context);
 }
+#endif /* SICSLOWPAN_REASS_HASH */
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 /* -------------------------------------------------------------------------- */
@@ -1510,7 +1801,7 @@ input(void)
 
 #if SICSLOWPAN_CONF_FRAG
   uint8_t is_fragment = 0;
-  int8_t frag_context = 0;
+  int16_t frag_context = 0;
 
   /* tag of the fragment */
   uint16_t frag_tag = 0;
@@ -1788,6 +2079,10 @@ sicslowpan_init(void)
 #endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 1 */
 
 #endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
+
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_HASH
+  reass_init();
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_HASH */
 }
 /*--------------------------------------------------------------------*/
 int
@@ -64,6 +64,15 @@
 
 /** @} */
 
+/* Index the reassembly contexts with a hash on (sender, tag), chain the
+ * fragments of each context and evict the least recently used
+ * reassembly when running out of contexts or fragment buffers */
+#ifdef SICSLOWPAN_CONF_REASS_HASH
+#define SICSLOWPAN_REASS_HASH SICSLOWPAN_CONF_REASS_HASH
+#else
+#define SICSLOWPAN_REASS_HASH 0
+#endif
+
 /**
  * \name 6lowpan compressions
  * @{
@@ -321,6 +330,13 @@ struct sicslowpan_nh_compressor {
 
 int sicslowpan_get_last_rssi(void);
 
+#if SICSLOWPAN_REASS_HASH
+/** Number of reassemblies evicted to make room for other ones */
+uint32_t sicslowpan_reass_evicted(void);
+/** Number of reassemblies dropped because they timed out */
+uint32_t sicslowpan_reass_timedout(void);
+#endif /* SICSLOWPAN_REASS_HASH */
+
 extern const struct network_driver sicslowpan_driver;
 
 #endif /* SICSLOWPAN_H_ */
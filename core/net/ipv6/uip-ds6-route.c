@@ -75,6 +75,20 @@ MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 static int num_routes = 0;
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 
+#if UIP_DS6_ROUTE_HASH
+/* Routes are chained into hash buckets by their prefix and prefix
+   length. For every prefix length, route_hash_count holds the number of
+   routes of that length, so that a lookup only probes the lengths that
+   are in use, longest first. */
+#if UIP_DS6_ROUTE_NB < 256
+typedef uint8_t route_hash_count_t;
+#else
+typedef uint16_t route_hash_count_t;
+#endif
+static uip_ds6_route_t *route_hash[UIP_DS6_ROUTE_HASH_SIZE];
+static route_hash_count_t route_hash_count[129];
+#endif /* UIP_DS6_ROUTE_HASH */
+
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
 
 /* Default routes are held on the defaultrouterlist and their
@@ -155,6 +169,71 @@ uip_ds6_notification_rm(struct uip_ds6_notification *n)
   list_remove(notificationlist, n);
 }
 #endif
+#if (UIP_CONF_MAX_ROUTES != 0) && UIP_DS6_ROUTE_HASH
+/*---------------------------------------------------------------------------*/
+/* Hash the part of an address that uip_ipaddr_prefixcmp() compares for
+   a prefix of the given length. */
+static uint16_t
+route_hash_bucket(const uip_ipaddr_t *addr, uint8_t length)
+{
+  uint16_t h;
+  int i;
+
+  h = length;
+  for(i = 0; i < (length >> 3); i++) {
+    h = (h << 5) + h + addr->u8[i];
+  }
+  return h % UIP_DS6_ROUTE_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_hash_add(uip_ds6_route_t *r)
+{
+  uint16_t bucket = route_hash_bucket(&r->ipaddr, r->length);
+
+  r->hash_next = route_hash[bucket];
+  route_hash[bucket] = r;
+  route_hash_count[r->length]++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_hash_rm(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **p;
+
+  for(p = &route_hash[route_hash_bucket(&r->ipaddr, r->length)];
+      *p != NULL;
+      p = &(*p)->hash_next) {
+    if(*p == r) {
+      *p = r->hash_next;
+      route_hash_count[r->length]--;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+route_hash_lookup(const uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r;
+  int length;
+
+  for(length = 128; length >= 0; length--) {
+    if(route_hash_count[length] == 0) {
+      continue;
+    }
+    for(r = route_hash[route_hash_bucket(addr, length)];
+        r != NULL;
+        r = r->hash_next) {
+      if(r->length == length &&
+         uip_ipaddr_prefixcmp(addr, &r->ipaddr, length)) {
+        return r;
+      }
+    }
+  }
+  return NULL;
+}
+#endif /* (UIP_CONF_MAX_ROUTES != 0) && UIP_DS6_ROUTE_HASH */
 /*---------------------------------------------------------------------------*/
 void
 uip_ds6_route_init(void)
@@ -162,6 +241,10 @@ uip_ds6_route_init(void)
 #if (UIP_CONF_MAX_ROUTES != 0)
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_HASH
+  memset(route_hash, 0, sizeof(route_hash));
+  memset(route_hash_count, 0, sizeof(route_hash_count));
+#endif /* UIP_DS6_ROUTE_HASH */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
@@ -254,15 +337,20 @@ uip_ds6_route_t *
 uip_ds6_route_lookup(uip_ipaddr_t *addr)
 {
 #if (UIP_CONF_MAX_ROUTES != 0)
-  uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_HASH
+  uip_ds6_route_t *r;
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_HASH */
 
   PRINTF("uip-ds6-route: Looking up route for ");
   PRINT6ADDR(addr);
   PRINTF("\n");
 
 
+#if UIP_DS6_ROUTE_HASH
+  found_route = route_hash_lookup(addr);
+#else /* UIP_DS6_ROUTE_HASH */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
@@ -278,6 +366,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
       }
     }
   }
+#endif /* UIP_DS6_ROUTE_HASH */
 
   if(found_route != NULL) {
     PRINTF("uip-ds6-route: Found route: ");
@@ -289,6 +378,10 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     PRINTF("uip-ds6-route: No route found\n");
   }
 
+#if !UIP_DS6_ROUTE_HASH || UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+  /* With the hash index, the list order only matters for evicting the
+     least recently used route, and list_remove() would make every
+     lookup linear again. */
   if(found_route != NULL && found_route != list_head(routelist)) {
     /* If we found a route, we put it at the start of the routeslist
        list. The list is ordered by how recently we looked them up:
@@ -298,6 +391,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     list_remove(routelist, found_route);
     list_push(routelist, found_route);
   }
+#endif /* !UIP_DS6_ROUTE_HASH || UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
 
   return found_route;
 #else /* (UIP_CONF_MAX_ROUTES != 0) */
@@ -436,6 +530,9 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_HASH
+  route_hash_add(r);
+#endif /* UIP_DS6_ROUTE_HASH */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -479,6 +576,9 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
 
     /* Remove the route from the route list */
     list_remove(routelist, route);
+#if UIP_DS6_ROUTE_HASH
+    route_hash_rm(route);
+#endif /* UIP_DS6_ROUTE_HASH */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
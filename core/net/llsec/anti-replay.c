@@ -33,7 +33,8 @@
 /**
  * \file
  *         Protects against replay attacks by comparing with the last
- *         unicast or broadcast frame counter of the sender.
+ *         unicast or broadcast frame counter of the sender, or with a
+ *         sliding window of its recent frame counters.
  * \author
  *         Konrad Krentz <konrad.krentz@gmail.com>
  */
@@ -52,6 +53,10 @@
 /* This node's current frame counter value */
 static uint32_t counter;
 
+#if ANTI_REPLAY_STATS
+struct anti_replay_stats anti_replay_stats;
+#endif /* ANTI_REPLAY_STATS */
+
 /*---------------------------------------------------------------------------*/
 void
 anti_replay_set_counter(void)
@@ -82,8 +87,61 @@ anti_replay_init_info(struct anti_replay_info *info)
   info->last_broadcast_counter
       = info->last_unicast_counter
       = anti_replay_get_counter();
+#if ANTI_REPLAY_WINDOW
+  info->broadcast_window = info->unicast_window = 1;
+#endif /* ANTI_REPLAY_WINDOW */
 }
 /*---------------------------------------------------------------------------*/
+#if ANTI_REPLAY_WINDOW
+static int
+was_replayed(uint32_t *last_counter, anti_replay_window_t *window,
+    uint32_t received_counter)
+{
+  uint32_t age;
+  anti_replay_window_t bit;
+  
+  if(received_counter > *last_counter) {
+    age = received_counter - *last_counter;
+    if(age >= ANTI_REPLAY_WINDOW) {
+      *window = 1;
+    } else {
+      *window = (*window << age) | 1;
+    }
+    *last_counter = received_counter;
+    ANTI_REPLAY_STAT(anti_replay_stats.accepted++);
+    return 0;
+  }
+  
+  age = *last_counter - received_counter;
+  if(age >= ANTI_REPLAY_WINDOW) {
+    ANTI_REPLAY_STAT(anti_replay_stats.rejected_too_old++);
+    return 1;
+  }
+  bit = (anti_replay_window_t)1 << age;
+  if(*window & bit) {
+    ANTI_REPLAY_STAT(anti_replay_stats.rejected_replayed++);
+    return 1;
+  }
+  *window |= bit;
+  ANTI_REPLAY_STAT(anti_replay_stats.accepted_out_of_order++);
+  return 0;
+}
+#else /* ANTI_REPLAY_WINDOW */
+static int
+was_replayed(uint32_t *last_counter, uint32_t received_counter)
+{
+  if(received_counter <= *last_counter) {
+    ANTI_REPLAY_STAT(received_counter == *last_counter
+        ? anti_replay_stats.rejected_replayed++
+        : anti_replay_stats.rejected_too_old++);
+    return 1;
+  }
+  *last_counter = received_counter;
+  ANTI_REPLAY_STAT(anti_replay_stats.accepted++);
+  return 0;
+}
+#endif /* ANTI_REPLAY_WINDOW */
+/*---------------------------------------------------------------------------*/
 int
 anti_replay_was_replayed(struct anti_replay_info *info)
 {
@@ -91,23 +149,21 @@ anti_replay_was_replayed(struct anti_replay_info *info)
   
   received_counter = anti_replay_get_counter();
   
+#if ANTI_REPLAY_WINDOW
   if(packetbuf_holds_broadcast()) {
-    /* broadcast */
-    if(received_counter <= info->last_broadcast_counter) {
-      return 1;
-    } else {
-      info->last_broadcast_counter = received_counter;
-      return 0;
-    }
+    return was_replayed(&info->last_broadcast_counter,
+        &info->broadcast_window, received_counter);
   } else {
-    /* unicast */
-    if(received_counter <= info->last_unicast_counter) {
-      return 1;
-    } else {
-      info->last_unicast_counter = received_counter;
-      return 0;
-    }
+    return was_replayed(&info->last_unicast_counter,
+        &info->unicast_window, received_counter);
+  }
+#else /* ANTI_REPLAY_WINDOW */
+  if(packetbuf_holds_broadcast()) {
+    return was_replayed(&info->last_broadcast_counter, received_counter);
+  } else {
+    return was_replayed(&info->last_unicast_counter, received_counter);
   }
+#endif /* ANTI_REPLAY_WINDOW */
 }
 /*---------------------------------------------------------------------------*/
 #endif /* LLSEC802154_USES_FRAME_COUNTER */
@@ -47,11 +47,63 @@
 
 #include "contiki.h"
 
+/*
+ * Size in bits (0, 32 or 64) of a sliding window of recently received
+ * frame counters. With a window, a frame that arrives after a frame with
+ * a higher counter is still accepted, as long as it is within the window
+ * and was not received before. This is the case for frames reordered by
+ * retransmissions or channel hopping. 0 only accepts increasing counters.
+ */
+#ifdef ANTI_REPLAY_CONF_WINDOW
+#define ANTI_REPLAY_WINDOW ANTI_REPLAY_CONF_WINDOW
+#else /* ANTI_REPLAY_CONF_WINDOW */
+#define ANTI_REPLAY_WINDOW 0
+#endif /* ANTI_REPLAY_CONF_WINDOW */
+
+/* Count accepted and rejected frames in anti_replay_stats */
+#ifdef ANTI_REPLAY_CONF_STATS
+#define ANTI_REPLAY_STATS ANTI_REPLAY_CONF_STATS
+#else /* ANTI_REPLAY_CONF_STATS */
+#define ANTI_REPLAY_STATS 0
+#endif /* ANTI_REPLAY_CONF_STATS */
+
+#if ANTI_REPLAY_WINDOW == 32
+typedef uint32_t anti_replay_window_t;
+#elif ANTI_REPLAY_WINDOW == 64
+typedef uint64_t anti_replay_window_t;
+#elif ANTI_REPLAY_WINDOW
+#error "ANTI_REPLAY_CONF_WINDOW must be 0, 32 or 64"
+#endif /* ANTI_REPLAY_WINDOW */
+
 struct anti_replay_info {
   uint32_t last_broadcast_counter;
   uint32_t last_unicast_counter;
+#if ANTI_REPLAY_WINDOW
+  /* Bit i is set if last_..._counter - i was received */
+  anti_replay_window_t broadcast_window;
+  anti_replay_window_t unicast_window;
+#endif /* ANTI_REPLAY_WINDOW */
 };
 
+#if ANTI_REPLAY_STATS
+struct anti_replay_stats {
+  /** Frames with a counter higher than any before */
+  uint32_t accepted;
+  /** Frames within the window that arrived after a higher counter */
+  uint32_t accepted_out_of_order;
+  /** Frames with a counter that was received before */
+  uint32_t rejected_replayed;
+  /** Frames with a counter older than the window */
+  uint32_t rejected_too_old;
+};
+
+extern struct anti_replay_stats anti_replay_stats;
+
+#define ANTI_REPLAY_STAT(code) (code)
+#else /* ANTI_REPLAY_STATS */
+#define ANTI_REPLAY_STAT(code)
+#endif /* ANTI_REPLAY_STATS */
+
 /**
  * \brief Sets the frame counter packetbuf attributes.
  */
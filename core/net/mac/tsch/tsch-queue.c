@@ -77,6 +77,94 @@ LIST(neighbor_list);
 struct tsch_neighbor *n_broadcast;
 struct tsch_neighbor *n_eb;
 
+#if TSCH_QUEUE_WITH_READY_LIST
+/* Unicast neighbors without tx link that may have packets, in the order
+ * they became ready. The list is owned by the slot operation, or by
+ * whoever holds the TSCH lock. Process context notifies the slot
+ * operation of new ready neighbors through ready_ringbuf, with the same
+ * lockfree scheme as the packet queues. If the ringbuf is full,
+ * ready_rebuild requests a rebuild of the list from all neighbors. */
+static struct tsch_neighbor *ready_head;
+static struct tsch_neighbor *ready_tail;
+static struct tsch_neighbor *ready_array[TSCH_QUEUE_NUM_PER_NEIGHBOR];
+static struct ringbufindex ready_ringbuf;
+static volatile uint8_t ready_rebuild;
+#endif /* TSCH_QUEUE_WITH_READY_LIST */
+
+#if TSCH_QUEUE_WITH_READY_LIST
+/*---------------------------------------------------------------------------*/
+/* Append a neighbor to the ready list, unless it is already in it */
+static void
+ready_list_add(struct tsch_neighbor *n)
+{
+  if(!n->in_ready_list) {
+    n->in_ready_list = 1;
+    n->ready_next = NULL;
+    if(ready_tail != NULL) {
+      ready_tail->ready_next = n;
+    } else {
+      ready_head = n;
+    }
+    ready_tail = n;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a neighbor from the ready list, given its predecessor */
+static void
+ready_list_unlink(struct tsch_neighbor *prev, struct tsch_neighbor *n)
+{
+  if(prev != NULL) {
+    prev->ready_next = n->ready_next;
+  } else {
+    ready_head = n->ready_next;
+  }
+  if(ready_tail == n) {
+    ready_tail = prev;
+  }
+  n->ready_next = NULL;
+  n->in_ready_list = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Apply the notifications from process context to the ready list.
+ * Called from the slot operation or with the TSCH lock held. */
+static void
+ready_list_update(void)
+{
+  int16_t get_index;
+  if(ready_rebuild) {
+    struct tsch_neighbor *n;
+    ready_rebuild = 0;
+    /* Notifications are superseded by the rebuild */
+    while(ringbufindex_get(&ready_ringbuf) != -1);
+    for(n = list_head(neighbor_list); n != NULL; n = list_item_next(n)) {
+      if(!n->is_broadcast && n->tx_links_count == 0
+         && !ringbufindex_empty(&n->tx_ringbuf)) {
+        ready_list_add(n);
+      }
+    }
+  }
+  while((get_index = ringbufindex_peek_get(&ready_ringbuf)) != -1) {
+    ready_list_add(ready_array[get_index]);
+    ringbufindex_get(&ready_ringbuf);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Notify the slot operation that a neighbor may have packets for shared
+ * links. Called from process context, after the packet was added. */
+void
+tsch_queue_nbr_ready(struct tsch_neighbor *n)
+{
+  if(n != NULL && !n->is_broadcast && n->tx_links_count == 0) {
+    int16_t put_index = ringbufindex_peek_put(&ready_ringbuf);
+    if(put_index != -1) {
+      ready_array[put_index] = n;
+      ringbufindex_put(&ready_ringbuf);
+    } else {
+      ready_rebuild = 1;
+    }
+  }
+}
+#endif /* TSCH_QUEUE_WITH_READY_LIST */
 /*---------------------------------------------------------------------------*/
 /* Add a TSCH neighbor */
 struct tsch_neighbor *
@@ -208,6 +296,21 @@ tsch_queue_remove_nbr(struct tsch_neighbor *n)
       /* Remove neighbor from list */
       list_remove(neighbor_list, n);
 
+#if TSCH_QUEUE_WITH_READY_LIST
+      /* Remove neighbor from the ready list, after flushing pending
+       * notifications that may point to it */
+      ready_list_update();
+      if(n->in_ready_list) {
+        struct tsch_neighbor *prev = NULL;
+        struct tsch_neighbor *curr_nbr = ready_head;
+        while(curr_nbr != n) {
+          prev = curr_nbr;
+          curr_nbr = curr_nbr->ready_next;
+        }
+        ready_list_unlink(prev, n);
+      }
+#endif /* TSCH_QUEUE_WITH_READY_LIST */
+
       tsch_release_lock();
 
       /* Flush queue */
@@ -246,6 +349,9 @@ tsch_queue_add_packet(const linkaddr_t *addr, mac_callback_t sent, void *ptr)
             /* Add to ringbuf (actual add committed through atomic operation) */
             n->tx_array[put_index] = p;
             ringbufindex_put(&n->tx_ringbuf);
+#if TSCH_QUEUE_WITH_READY_LIST
+            tsch_queue_nbr_ready(n);
+#endif /* TSCH_QUEUE_WITH_READY_LIST */
             return p;
           } else {
             memb_free(&packet_memb, p);
@@ -388,6 +494,33 @@ tsch_queue_get_packet_for_dest_addr(const linkaddr_t *addr, struct tsch_link *li
 struct tsch_packet *
 tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link *link)
 {
+#if TSCH_QUEUE_WITH_READY_LIST
+  if(!tsch_is_locked()) {
+    struct tsch_neighbor *prev = NULL;
+    struct tsch_neighbor *curr_nbr;
+    struct tsch_packet *p = NULL;
+    ready_list_update();
+    curr_nbr = ready_head;
+    while(curr_nbr != NULL) {
+      struct tsch_neighbor *next_nbr = curr_nbr->ready_next;
+      if(curr_nbr->tx_links_count != 0 || ringbufindex_empty(&curr_nbr->tx_ringbuf)) {
+        /* Not ready anymore. Adding a packet or removing the last tx link
+         * will notify us again. */
+        ready_list_unlink(prev, curr_nbr);
+      } else {
+        p = tsch_queue_get_packet_for_nbr(curr_nbr, link);
+        if(p != NULL) {
+          if(n != NULL) {
+            *n = curr_nbr;
+          }
+          return p;
+        }
+        prev = curr_nbr;
+      }
+      curr_nbr = next_nbr;
+    }
+  }
+#else /* TSCH_QUEUE_WITH_READY_LIST */
   if(!tsch_is_locked()) {
     struct tsch_neighbor *curr_nbr = list_head(neighbor_list);
     struct tsch_packet *p = NULL;
@@ -405,6 +538,7 @@ tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link
       curr_nbr = list_item_next(curr_nbr);
     }
   }
+#endif /* TSCH_QUEUE_WITH_READY_LIST */
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -463,6 +597,11 @@ tsch_queue_init(void)
   list_init(neighbor_list);
   memb_init(&neighbor_memb);
   memb_init(&packet_memb);
+#if TSCH_QUEUE_WITH_READY_LIST
+  ready_head = ready_tail = NULL;
+  ringbufindex_init(&ready_ringbuf, TSCH_QUEUE_NUM_PER_NEIGHBOR);
+  ready_rebuild = 0;
+#endif /* TSCH_QUEUE_WITH_READY_LIST */
   /* Add virtual EB and the broadcast neighbors */
   n_eb = tsch_queue_add_nbr(&tsch_eb_address);
   n_broadcast = tsch_queue_add_nbr(&tsch_broadcast_address);
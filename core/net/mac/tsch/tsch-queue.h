@@ -77,6 +77,15 @@
 #define TSCH_QUEUE_MAX_NEIGHBOR_QUEUES ((NBR_TABLE_CONF_MAX_NEIGHBORS) + 2)
 #endif
 
+/* Keep a list of the neighbors that have packets for shared links, so
+ * that tsch_queue_get_unicast_packet_for_any() does not have to walk all
+ * neighbors in the slot operation */
+#ifdef TSCH_QUEUE_CONF_WITH_READY_LIST
+#define TSCH_QUEUE_WITH_READY_LIST TSCH_QUEUE_CONF_WITH_READY_LIST
+#else
+#define TSCH_QUEUE_WITH_READY_LIST 0
+#endif
+
 /* TSCH CSMA-CA parameters, see IEEE 802.15.4e-2012 */
 /* Min backoff exponent */
 #ifdef TSCH_CONF_MAC_MIN_BE
@@ -140,6 +149,12 @@ struct tsch_neighbor {
   struct tsch_packet *tx_array[TSCH_QUEUE_NUM_PER_NEIGHBOR];
   /* Circular buffer of pointers to packet. */
   struct ringbufindex tx_ringbuf;
+#if TSCH_QUEUE_WITH_READY_LIST
+  /* Next neighbor in the ready list, only accessed from the slot operation
+   * or with the TSCH lock held */
+  struct tsch_neighbor *ready_next;
+  uint8_t in_ready_list; /* is the neighbor in the ready list? */
+#endif /* TSCH_QUEUE_WITH_READY_LIST */
 };
 
 /***** External Variables *****/
@@ -180,6 +195,10 @@ struct tsch_packet *tsch_queue_get_packet_for_dest_addr(const linkaddr_t *addr,
 /* Returns the head packet of any neighbor queue with zero backoff counter.
  * Writes pointer to the neighbor in *n */
 struct tsch_packet *tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link *link);
+#if TSCH_QUEUE_WITH_READY_LIST
+/* Notify the slot operation that a neighbor may have packets for shared links */
+void tsch_queue_nbr_ready(struct tsch_neighbor *n);
+#endif /* TSCH_QUEUE_WITH_READY_LIST */
 /* May the neighbor transmit over a share link? */
 int tsch_queue_backoff_expired(const struct tsch_neighbor *n);
 /* Reset neighbor backoff */
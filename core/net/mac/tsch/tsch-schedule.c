@@ -89,6 +89,9 @@ tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
       sf->handle = handle;
       ASN_DIVISOR_INIT(sf->size, size);
       LIST_STRUCT_INIT(sf, links_list);
+#if TSCH_SCHEDULE_SORTED_LINKS
+      sf->lookup_cursor = NULL;
+#endif /* TSCH_SCHEDULE_SORTED_LINKS */
       /* Add the slotframe to the global list */
       list_add(slotframe_list, sf);
     }
@@ -195,8 +198,20 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
       } else {
         static int current_link_handle = 0;
         struct tsch_neighbor *n;
+#if TSCH_SCHEDULE_SORTED_LINKS
+        /* Add the link to the slotframe, after all links with a lower
+         * or equal timeslot */
+        struct tsch_link *prev = NULL;
+        struct tsch_link *next = list_head(slotframe->links_list);
+        while(next != NULL && next->timeslot <= timeslot) {
+          prev = next;
+          next = list_item_next(next);
+        }
+        list_insert(slotframe->links_list, prev, l);
+#else /* TSCH_SCHEDULE_SORTED_LINKS */
         /* Add the link to the slotframe */
         list_add(slotframe->links_list, l);
+#endif /* TSCH_SCHEDULE_SORTED_LINKS */
         /* Initialize link */
         l->handle = current_link_handle++;
         l->link_options = link_options;
@@ -255,6 +270,19 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
              slotframe->handle, l->link_options, l->timeslot, l->channel_offset,
              TSCH_LOG_ID_FROM_LINKADDR(&l->addr));
 
+#if TSCH_SCHEDULE_SORTED_LINKS
+      if(l == slotframe->lookup_cursor) {
+        /* Step the cursor back to the previous link, so that the next
+         * lookup continues from there instead of from the list head */
+        struct tsch_link *prev = NULL;
+        struct tsch_link *p = list_head(slotframe->links_list);
+        while(p != l) {
+          prev = p;
+          p = list_item_next(p);
+        }
+        slotframe->lookup_cursor = prev;
+      }
+#endif /* TSCH_SCHEDULE_SORTED_LINKS */
       list_remove(slotframe->links_list, l);
       memb_free(&link_memb, l);
 
@@ -269,6 +297,12 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
           if(!(link_options & LINK_OPTION_SHARED)) {
             n->dedicated_tx_links_count--;
           }
+#if TSCH_QUEUE_WITH_READY_LIST
+          /* Queued packets may now go over shared links */
+          if(!tsch_queue_is_empty(n)) {
+            tsch_queue_nbr_ready(n);
+          }
+#endif /* TSCH_QUEUE_WITH_READY_LIST */
         }
       }
 
@@ -308,6 +342,52 @@ tsch_schedule_get_link_by_timeslot(struct tsch_slotframe *slotframe, uint16_t ti
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+/* Considers link l, occurring in time_to_timeslot slots, for the next
+ * active link. Updates the current best and backup links. */
+static void
+select_link(struct tsch_link *l, uint16_t time_to_timeslot,
+            struct tsch_link **curr_best, uint16_t *time_to_curr_best,
+            struct tsch_link **curr_backup)
+{
+  if(*curr_best == NULL || time_to_timeslot < *time_to_curr_best) {
+    *time_to_curr_best = time_to_timeslot;
+    *curr_best = l;
+    *curr_backup = NULL;
+  } else if(time_to_timeslot == *time_to_curr_best) {
+    struct tsch_link *new_best = NULL;
+    /* Two links are overlapping, we need to select one of them.
+     * By standard: prioritize Tx links first, second by lowest handle */
+    if(((*curr_best)->link_options & LINK_OPTION_TX) == (l->link_options & LINK_OPTION_TX)) {
+      /* Both or neither links have Tx, select the one with lowest handle */
+      if(l->slotframe_handle < (*curr_best)->slotframe_handle) {
+        new_best = l;
+      }
+    } else {
+      /* Select the link that has the Tx option */
+      if(l->link_options & LINK_OPTION_TX) {
+        new_best = l;
+      }
+    }
+
+    /* Maintain backup_link */
+    if(*curr_backup == NULL) {
+      /* Check if 'l' best can be used as backup */
+      if(new_best != l && (l->link_options & LINK_OPTION_RX)) { /* Does 'l' have Rx flag? */
+        *curr_backup = l;
+      }
+      /* Check if curr_best can be used as backup */
+      if(new_best != *curr_best && ((*curr_best)->link_options & LINK_OPTION_RX)) { /* Does curr_best have Rx flag? */
+        *curr_backup = *curr_best;
+      }
+    }
+
+    /* Maintain curr_best */
+    if(new_best != NULL) {
+      *curr_best = new_best;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 /* Returns the next active link after a given ASN, and a backup link (for the same ASN, with Rx flag) */
 struct tsch_link *
 tsch_schedule_get_next_active_link(struct asn_t *asn, uint16_t *time_offset,
@@ -325,52 +405,50 @@ tsch_schedule_get_next_active_link(struct asn_t *asn, uint16_t *time_offset,
     while(sf != NULL) {
       /* Get timeslot from ASN, given the slotframe length */
       uint16_t timeslot = ASN_MOD(*asn, sf->size);
+#if TSCH_SCHEDULE_SORTED_LINKS
+      /* Links are sorted by timeslot: the earliest occurring links are the
+       * first ones after the current timeslot, or the first ones of the
+       * slotframe if there are none. Start from the cursor left by the
+       * previous lookup, unless the ASN went backwards or wrapped. */
+      struct tsch_link *prev = sf->lookup_cursor;
+      struct tsch_link *l;
+      if(prev != NULL && prev->timeslot > timeslot) {
+        prev = NULL;
+      }
+      l = prev != NULL ? list_item_next(prev) : list_head(sf->links_list);
+      while(l != NULL && l->timeslot <= timeslot) {
+        prev = l;
+        l = list_item_next(l);
+      }
+      sf->lookup_cursor = prev;
+      if(l == NULL) {
+        l = list_head(sf->links_list);
+      }
+      if(l != NULL) {
+        uint16_t first_timeslot = l->timeslot;
+        uint16_t time_to_timeslot =
+          first_timeslot > timeslot ?
+          first_timeslot - timeslot :
+          sf->size.val + first_timeslot - timeslot;
+        /* Normally a single link, unless several share the timeslot */
+        while(l != NULL && l->timeslot == first_timeslot) {
+          select_link(l, time_to_timeslot,
+                      &curr_best, &time_to_curr_best, &curr_backup);
+          l = list_item_next(l);
+        }
+      }
+#else /* TSCH_SCHEDULE_SORTED_LINKS */
       struct tsch_link *l = list_head(sf->links_list);
       while(l != NULL) {
         uint16_t time_to_timeslot =
           l->timeslot > timeslot ?
           l->timeslot - timeslot :
           sf->size.val + l->timeslot - timeslot;
-        if(curr_best == NULL || time_to_timeslot < time_to_curr_best) {
-          time_to_curr_best = time_to_timeslot;
-          curr_best = l;
-          curr_backup = NULL;
-        } else if(time_to_timeslot == time_to_curr_best) {
-          struct tsch_link *new_best = NULL;
-          /* Two links are overlapping, we need to select one of them.
-           * By standard: prioritize Tx links first, second by lowest handle */
-          if((curr_best->link_options & LINK_OPTION_TX) == (l->link_options & LINK_OPTION_TX)) {
-            /* Both or neither links have Tx, select the one with lowest handle */
-            if(l->slotframe_handle < curr_best->slotframe_handle) {
-              new_best = l;
-            }
-          } else {
-            /* Select the link that has the Tx option */
-            if(l->link_options & LINK_OPTION_TX) {
-              new_best = l;
-            }
-          }
-
-          /* Maintain backup_link */
-          if(curr_backup == NULL) {
-            /* Check if 'l' best can be used as backup */
-            if(new_best != l && (l->link_options & LINK_OPTION_RX)) { /* Does 'l' have Rx flag? */
-              curr_backup = l;
-            }
-            /* Check if curr_best can be used as backup */
-            if(new_best != curr_best && (curr_best->link_options & LINK_OPTION_RX)) { /* Does curr_best have Rx flag? */
-              curr_backup = curr_best;
-            }
-          }
-
-          /* Maintain curr_best */
-          if(new_best != NULL) {
-            curr_best = new_best;
-          }
-        }
-
+        select_link(l, time_to_timeslot,
+                    &curr_best, &time_to_curr_best, &curr_backup);
         l = list_item_next(l);
       }
+#endif /* TSCH_SCHEDULE_SORTED_LINKS */
       sf = list_item_next(sf);
     }
     if(time_offset != NULL) {
@@ -72,6 +72,15 @@
 #define TSCH_SCHEDULE_MAX_LINKS 32
 #endif
 
+/* Keep the links of every slotframe sorted by timeslot, together with a
+ * per-slotframe cursor, so that tsch_schedule_get_next_active_link()
+ * steps from the previous position instead of checking every link */
+#ifdef TSCH_SCHEDULE_CONF_SORTED_LINKS
+#define TSCH_SCHEDULE_SORTED_LINKS TSCH_SCHEDULE_CONF_SORTED_LINKS
+#else
+#define TSCH_SCHEDULE_SORTED_LINKS 0
+#endif
+
 /********** Constants *********/
 
 /* Link options */
@@ -122,6 +131,11 @@ struct tsch_slotframe {
   struct asn_divisor_t size;
   /* List of links belonging to this slotframe */
   LIST_STRUCT(links_list);
+#if TSCH_SCHEDULE_SORTED_LINKS
+  /* Last link at or before the timeslot of the previous lookup,
+   * NULL to start from the head of links_list */
+  struct tsch_link *lookup_cursor;
+#endif /* TSCH_SCHEDULE_SORTED_LINKS */
 };
 
 /********** Functions *********/
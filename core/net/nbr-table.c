@@ -83,6 +83,22 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_WITH_HASH_INDEX
+/* Open-addressing hash index over the link-layer addresses of all keys,
+ * kept beside the key list. Each slot holds a neighbor index + 1, or 0
+ * when the slot is empty. The key list still defines the LRU order. */
+#if NBR_TABLE_MAX_NEIGHBORS < 255
+typedef uint8_t nbr_table_slot_t;
+#else
+typedef uint16_t nbr_table_slot_t;
+#endif
+/* Probes stop at an empty slot, so a full table must leave many of them */
+#if NBR_TABLE_HASH_SIZE < 2 * NBR_TABLE_MAX_NEIGHBORS
+#error "NBR_TABLE_CONF_HASH_SIZE must be at least twice NBR_TABLE_CONF_MAX_NEIGHBORS"
+#endif
+static nbr_table_slot_t hash_index[NBR_TABLE_HASH_SIZE];
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -125,6 +141,91 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
 {
   return key_from_index(index_from_item(table, item));
 }
+#if NBR_TABLE_WITH_HASH_INDEX
+/*---------------------------------------------------------------------------*/
+/* Get the home slot of a link-layer address in the hash index */
+static int
+hash_slot(const linkaddr_t *lladdr)
+{
+  int i;
+  uint16_t h = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = (h << 5) + h + lladdr->u8[i];
+  }
+  return h % NBR_TABLE_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+/* Add the key of a neighbor to the hash index */
+static void
+hash_insert(nbr_table_key_t *key)
+{
+  int slot = hash_slot(&key->lladdr);
+  while(hash_index[slot] != 0) {
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+  hash_index[slot] = index_from_key(key) + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove the key of a neighbor from the hash index. Following entries
+ * of the probe sequence are shifted back so that no tombstones are
+ * needed. */
+static void
+hash_remove(nbr_table_key_t *key)
+{
+  int slot;
+  int next;
+  int home;
+  nbr_table_slot_t entry = index_from_key(key) + 1;
+
+  slot = hash_slot(&key->lladdr);
+  while(hash_index[slot] != entry) {
+    if(hash_index[slot] == 0) {
+      /* Not in the index */
+      return;
+    }
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+
+  next = slot;
+  while(1) {
+    hash_index[slot] = 0;
+    do {
+      next = (next + 1) % NBR_TABLE_HASH_SIZE;
+      if(hash_index[next] == 0) {
+        return;
+      }
+      home = hash_slot(&key_from_index(hash_index[next] - 1)->lladdr);
+      /* Keep the entry where it is if its home slot lies cyclically
+       * in (slot, next] */
+    } while(slot <= next ? (slot < home && home <= next)
+                         : (slot < home || home <= next));
+    hash_index[slot] = hash_index[next];
+    slot = next;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Get the index of a neighbor from its link-layer address */
+static int
+index_from_lladdr(const linkaddr_t *lladdr)
+{
+  int slot;
+  nbr_table_key_t *key;
+  /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
+   * Only one such entry is possible at a time, indexed by linkaddr_null. */
+  if(lladdr == NULL) {
+    lladdr = &linkaddr_null;
+  }
+  slot = hash_slot(lladdr);
+  while(hash_index[slot] != 0) {
+    key = key_from_index(hash_index[slot] - 1);
+    if(linkaddr_cmp(lladdr, &key->lladdr)) {
+      return hash_index[slot] - 1;
+    }
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+  return -1;
+}
+#else /* NBR_TABLE_WITH_HASH_INDEX */
 /*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
@@ -145,6 +246,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
   }
   return -1;
 }
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
 /*---------------------------------------------------------------------------*/
 /* Get bit from "used" or "locked" bitmap */
 static int
@@ -195,6 +297,9 @@ remove_key(nbr_table_key_t *least_used_key)
   used_map[index_from_key(least_used_key)] = 0;
   /* Remove neighbor from list */
   list_remove(nbr_table_keys, least_used_key);
+#if NBR_TABLE_WITH_HASH_INDEX
+  hash_remove(least_used_key);
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
 }
 /*---------------------------------------------------------------------------*/
 static nbr_table_key_t *
@@ -359,6 +464,9 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr, nbr_table_rea
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_WITH_HASH_INDEX
+    hash_insert(key);
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
   }
 
   /* Get item in the current table */
@@ -446,11 +554,17 @@ nbr_table_update_lladdr(const linkaddr_t *old_addr, const linkaddr_t *new_addr,
     return 0;
   }
   key = key_from_index(index);
+#if NBR_TABLE_WITH_HASH_INDEX
+  hash_remove(key);
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
   /**
    * Copy the new lladdr into the key - since we know that there is no
    * conflicting entry.
    */
   memcpy(&key->lladdr, new_addr, sizeof(linkaddr_t));
+#if NBR_TABLE_WITH_HASH_INDEX
+  hash_insert(key);
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
   return 1;
 }
 /*---------------------------------------------------------------------------*/
@@ -52,7 +52,114 @@
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
+#if ETIMER_HEAP
+static struct etimer *heap[ETIMER_HEAP_SIZE];
+static etimer_heap_index_t heap_size;
+#endif /* ETIMER_HEAP */
+
 PROCESS(etimer_process, "Event timer");
+#if ETIMER_HEAP
+/*---------------------------------------------------------------------------*/
+/* Time until a timer expires, 0 if it already has. Ordering timers by
+   this value is stable as time goes by, also across clock wraps. */
+static clock_time_t
+time_left(struct etimer *t, clock_time_t now)
+{
+  if((clock_time_t)(now - t->timer.start) >= t->timer.interval) {
+    return 0;
+  }
+  return t->timer.start + t->timer.interval - now;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_set(int i, struct etimer *t)
+{
+  heap[i] = t;
+  t->heap_index = i;
+}
+/*---------------------------------------------------------------------------*/
+static int
+in_heap(struct etimer *t)
+{
+  return t->heap_index < heap_size && heap[t->heap_index] == t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+sift_up(int i, clock_time_t now)
+{
+  struct etimer *t = heap[i];
+  clock_time_t left = time_left(t, now);
+  int parent;
+
+  while(i > 0) {
+    parent = (i - 1) / 2;
+    if(time_left(heap[parent], now) <= left) {
+      break;
+    }
+    heap_set(i, heap[parent]);
+    i = parent;
+  }
+  heap_set(i, t);
+}
+/*---------------------------------------------------------------------------*/
+static void
+sift_down(int i, clock_time_t now)
+{
+  struct etimer *t = heap[i];
+  clock_time_t left = time_left(t, now);
+  int child;
+
+  while((child = 2 * i + 1) < heap_size) {
+    if(child + 1 < heap_size &&
+       time_left(heap[child + 1], now) < time_left(heap[child], now)) {
+      child++;
+    }
+    if(left <= time_left(heap[child], now)) {
+      break;
+    }
+    heap_set(i, heap[child]);
+    i = child;
+  }
+  heap_set(i, t);
+}
+/*---------------------------------------------------------------------------*/
+static int
+heap_insert(struct etimer *t)
+{
+  if(heap_size == ETIMER_HEAP_SIZE) {
+    return 0;
+  }
+  heap_set(heap_size++, t);
+  sift_up(t->heap_index, clock_time());
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_remove(struct etimer *t)
+{
+  clock_time_t now;
+  int i = t->heap_index;
+
+  heap_size--;
+  if(i != heap_size) {
+    now = clock_time();
+    heap_set(i, heap[heap_size]);
+    sift_down(i, now);
+    sift_up(i, now);
+  }
+  t->heap_index = ETIMER_HEAP_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+/* Restore the heap order after the expiration time of a timer changed */
+static void
+heap_update(struct etimer *t)
+{
+  clock_time_t now = clock_time();
+
+  sift_up(t->heap_index, now);
+  sift_down(t->heap_index, now);
+}
+#endif /* ETIMER_HEAP */
 /*---------------------------------------------------------------------------*/
 static void
 update_time(void)
@@ -61,6 +168,20 @@ update_time(void)
   clock_time_t now;
   struct etimer *t;
 
+#if ETIMER_HEAP
+  if(heap_size > 0) {
+    now = clock_time();
+    tdist = time_left(heap[0], now);
+    for(t = timerlist; t != NULL; t = t->next) {
+      if(time_left(t, now) < tdist) {
+        tdist = time_left(t, now);
+      }
+    }
+    next_expiration = now + tdist;
+    return;
+  }
+#endif /* ETIMER_HEAP */
+
   if (timerlist == NULL) {
     next_expiration = 0;
   } else {
@@ -104,11 +225,46 @@ PROCESS_THREAD(etimer_process, ev, data)
 	    t = t->next;
 	}
       }
+#if ETIMER_HEAP
+      {
+        int i, j;
+
+        /* Drop the timers of the exited process and rebuild the heap */
+        for(i = j = 0; i < heap_size; i++) {
+          if(heap[i]->p != p) {
+            heap_set(j++, heap[i]);
+          }
+        }
+        if(j != heap_size) {
+          heap_size = j;
+          for(i = heap_size / 2 - 1; i >= 0; i--) {
+            sift_down(i, clock_time());
+          }
+          update_time();
+        }
+      }
+#endif /* ETIMER_HEAP */
       continue;
     } else if(ev != PROCESS_EVENT_POLL) {
       continue;
     }
 
+#if ETIMER_HEAP
+    /* The heap is ordered by expiration, so only its root needs to be
+       checked. */
+    while(heap_size > 0 && timer_expired(&heap[0]->timer)) {
+      t = heap[0];
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+        t->p = PROCESS_NONE;
+        heap_remove(t);
+      } else {
+        etimer_request_poll();
+        break;
+      }
+    }
+    update_time();
+#endif /* ETIMER_HEAP */
+
   again:
     
     u = NULL;
@@ -155,6 +311,15 @@ add_timer(struct etimer *timer)
   etimer_request_poll();
 
   if(timer->p != PROCESS_NONE) {
+#if ETIMER_HEAP
+    if(in_heap(timer)) {
+      /* Timer already in the heap, move it to its new position. */
+      timer->p = PROCESS_CURRENT();
+      heap_update(timer);
+      update_time();
+      return;
+    }
+#endif /* ETIMER_HEAP */
     for(t = timerlist; t != NULL; t = t->next) {
       if(t == timer) {
 	/* Timer already on list, bail out. */
@@ -167,6 +332,12 @@ add_timer(struct etimer *timer)
 
   /* Timer not on list. */
   timer->p = PROCESS_CURRENT();
+#if ETIMER_HEAP
+  if(heap_insert(timer)) {
+    update_time();
+    return;
+  }
+#endif /* ETIMER_HEAP */
   timer->next = timerlist;
   timerlist = timer;
 
@@ -206,6 +377,11 @@ void
 etimer_adjust(struct etimer *et, int timediff)
 {
   et->timer.start += timediff;
+#if ETIMER_HEAP
+  if(in_heap(et)) {
+    heap_update(et);
+  }
+#endif /* ETIMER_HEAP */
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -230,6 +406,11 @@ etimer_start_time(struct etimer *et)
 int
 etimer_pending(void)
 {
+#if ETIMER_HEAP
+  if(heap_size > 0) {
+    return 1;
+  }
+#endif /* ETIMER_HEAP */
   return timerlist != NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -244,6 +425,16 @@ etimer_stop(struct etimer *et)
 {
   struct etimer *t;
 
+#if ETIMER_HEAP
+  if(in_heap(et)) {
+    heap_remove(et);
+    update_time();
+    et->next = NULL;
+    et->p = PROCESS_NONE;
+    return;
+  }
+#endif /* ETIMER_HEAP */
+
   /* First check if et is the first event timer on the list. */
   if(et == timerlist) {
     timerlist = timerlist->next;
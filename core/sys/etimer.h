@@ -73,10 +73,39 @@
  *
  * \hideinitializer
  */
+/*
+ * With ETIMER_HEAP, pending event timers are kept in a binary heap
+ * ordered by expiration time, so that setting, stopping and finding
+ * the next expiration are O(log n) instead of walking every timer.
+ * Timers that do not fit in the heap fall back to the unsorted list.
+ */
+#ifdef ETIMER_CONF_HEAP
+#define ETIMER_HEAP ETIMER_CONF_HEAP
+#else /* ETIMER_CONF_HEAP */
+#define ETIMER_HEAP 0
+#endif /* ETIMER_CONF_HEAP */
+
+#ifdef ETIMER_CONF_HEAP_SIZE
+#define ETIMER_HEAP_SIZE ETIMER_CONF_HEAP_SIZE
+#else /* ETIMER_CONF_HEAP_SIZE */
+#define ETIMER_HEAP_SIZE 32
+#endif /* ETIMER_CONF_HEAP_SIZE */
+
+#if ETIMER_HEAP
+#if ETIMER_HEAP_SIZE < 255
+typedef uint8_t etimer_heap_index_t;
+#else
+typedef uint16_t etimer_heap_index_t;
+#endif
+#endif /* ETIMER_HEAP */
+
 struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_HEAP
+  etimer_heap_index_t heap_index;
+#endif /* ETIMER_HEAP */
 };
 
 /**
@@ -47,6 +47,9 @@
 
 #include "sys/process.h"
 #include "sys/arg.h"
+#if PROCESS_READY_QUEUE
+#include "sys/isr-control.h"
+#endif /* PROCESS_READY_QUEUE */
 
 /*
  * Pointer to the currently running process structure.
@@ -63,13 +66,36 @@ struct event_data {
   process_event_t ev;
   process_data_t data;
   struct process *p;
+#if PROCESS_READY_QUEUE
+  process_num_events_t next;
+#endif /* PROCESS_READY_QUEUE */
 };
 
 static process_num_events_t nevents, fevent;
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
 
+#if PROCESS_READY_QUEUE
+/*
+ * The event slots are linked into one FIFO per priority level, and the
+ * unused slots into a free list. EVENT_NONE terminates these lists.
+ */
+#define EVENT_NONE PROCESS_CONF_NUMEVENTS
+static process_num_events_t event_free;
+static process_num_events_t event_head[PROCESS_PRIORITY_LEVELS];
+static process_num_events_t event_tail[PROCESS_PRIORITY_LEVELS];
+
+/*
+ * Polled processes are linked into one FIFO per priority level. These
+ * are also modified by process_poll() from interrupt context.
+ */
+static struct process *poll_head[PROCESS_PRIORITY_LEVELS];
+static struct process *poll_tail[PROCESS_PRIORITY_LEVELS];
+static unsigned int poll_count[PROCESS_PRIORITY_LEVELS];
+#endif /* PROCESS_READY_QUEUE */
+
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
+static unsigned long process_droppedevents;
 #endif
 
 static volatile unsigned char poll_requested;
@@ -157,6 +183,36 @@ exit_process(struct process *p, struct process *fromprocess)
     }
   }
 
+#if PROCESS_READY_QUEUE
+  if(p->needspoll) {
+    struct process *prev;
+    isr_state_t isr_state = atomic_section_enter();
+    int level;
+
+    /* Take the process off the poll queue it is waiting on */
+    for(level = 0; level < PROCESS_PRIORITY_LEVELS; level++) {
+      prev = NULL;
+      for(q = poll_head[level]; q != NULL && q != p; q = q->poll_next) {
+        prev = q;
+      }
+      if(q == p) {
+        if(prev == NULL) {
+          poll_head[level] = p->poll_next;
+        } else {
+          prev->poll_next = p->poll_next;
+        }
+        if(poll_tail[level] == p) {
+          poll_tail[level] = prev;
+        }
+        poll_count[level]--;
+        break;
+      }
+    }
+    p->needspoll = 0;
+    atomic_section_exit(isr_state);
+  }
+#endif /* PROCESS_READY_QUEUE */
+
   if(p == process_list) {
     process_list = process_list->next;
   } else {
@@ -212,8 +268,25 @@ process_init(void)
   nevents = fevent = 0;
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
+  process_droppedevents = 0;
 #endif /* PROCESS_CONF_STATS */
 
+#if PROCESS_READY_QUEUE
+  {
+    int i;
+
+    for(i = 0; i < PROCESS_CONF_NUMEVENTS; i++) {
+      events[i].next = i + 1;
+    }
+    event_free = 0;
+    for(i = 0; i < PROCESS_PRIORITY_LEVELS; i++) {
+      event_head[i] = event_tail[i] = EVENT_NONE;
+      poll_head[i] = poll_tail[i] = NULL;
+      poll_count[i] = 0;
+    }
+  }
+#endif /* PROCESS_READY_QUEUE */
+
   process_current = process_list = NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -225,6 +298,39 @@ static void
 do_poll(void)
 {
   struct process *p;
+#if PROCESS_READY_QUEUE
+  isr_state_t isr_state;
+  unsigned int n;
+  int level;
+
+  poll_requested = 0;
+  /* Call the processes on the poll queues, highest priority first.
+     Processes that are polled again while we do this are served in the
+     next round. */
+  for(level = PROCESS_PRIORITY_LEVELS - 1; level >= 0; level--) {
+    isr_state = atomic_section_enter();
+    n = poll_count[level];
+    atomic_section_exit(isr_state);
+    for(; n > 0; n--) {
+      isr_state = atomic_section_enter();
+      p = poll_head[level];
+      if(p != NULL) {
+        poll_head[level] = p->poll_next;
+        if(poll_head[level] == NULL) {
+          poll_tail[level] = NULL;
+        }
+        poll_count[level]--;
+        p->needspoll = 0;
+      }
+      atomic_section_exit(isr_state);
+      if(p == NULL) {
+        break;
+      }
+      p->state = PROCESS_STATE_RUNNING;
+      call_process(p, PROCESS_EVENT_POLL, NULL);
+    }
+  }
+#else /* PROCESS_READY_QUEUE */
 
   poll_requested = 0;
   /* Call the processes that needs to be polled. */
@@ -235,6 +341,7 @@ do_poll(void)
       call_process(p, PROCESS_EVENT_POLL, NULL);
     }
   }
+#endif /* PROCESS_READY_QUEUE */
 }
 /*---------------------------------------------------------------------------*/
 /*
@@ -259,6 +366,28 @@ do_event(void)
    */
 
   if(nevents > 0) {
+#if PROCESS_READY_QUEUE
+    int level;
+
+    /* Take the first event of the highest priority queue that has
+       one, and put its slot back on the free list. */
+    for(level = PROCESS_PRIORITY_LEVELS - 1;
+        event_head[level] == EVENT_NONE;
+        level--);
+    fevent = event_head[level];
+    event_head[level] = events[fevent].next;
+    if(event_head[level] == EVENT_NONE) {
+      event_tail[level] = EVENT_NONE;
+    }
+
+    ev = events[fevent].ev;
+    data = events[fevent].data;
+    receiver = events[fevent].p;
+
+    events[fevent].next = event_free;
+    event_free = fevent;
+    --nevents;
+#else /* PROCESS_READY_QUEUE */
     
     /* There are events that we should deliver. */
     ev = events[fevent].ev;
@@ -270,6 +399,7 @@ do_event(void)
        and decrease the number of events. */
     fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
     --nevents;
+#endif /* PROCESS_READY_QUEUE */
 
     /* If this is a broadcast event, we deliver it to all events, in
        order of their priority. */
@@ -340,10 +470,29 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
       printf("soft panic: event queue is full when event %d was posted to %s from %s\n", ev, PROCESS_NAME_STRING(p), PROCESS_NAME_STRING(process_current));
     }
 #endif /* DEBUG */
+#if PROCESS_CONF_STATS
+    process_droppedevents++;
+#endif /* PROCESS_CONF_STATS */
     return PROCESS_ERR_FULL;
   }
   
+#if PROCESS_READY_QUEUE
+  {
+    int level = p == PROCESS_BROADCAST ? PROCESS_PRIORITY_DEFAULT : p->priority;
+
+    snum = event_free;
+    event_free = events[snum].next;
+    events[snum].next = EVENT_NONE;
+    if(event_tail[level] == EVENT_NONE) {
+      event_head[level] = snum;
+    } else {
+      events[event_tail[level]].next = snum;
+    }
+    event_tail[level] = snum;
+  }
+#else /* PROCESS_READY_QUEUE */
   snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
+#endif /* PROCESS_READY_QUEUE */
   events[snum].ev = ev;
   events[snum].data = data;
   events[snum].p = p;
@@ -373,8 +522,26 @@ process_poll(struct process *p)
   if(p != NULL) {
     if(p->state == PROCESS_STATE_RUNNING ||
        p->state == PROCESS_STATE_CALLED) {
+#if PROCESS_READY_QUEUE
+      isr_state_t isr_state = atomic_section_enter();
+
+      if(!p->needspoll) {
+        p->needspoll = 1;
+        p->poll_next = NULL;
+        if(poll_tail[p->priority] == NULL) {
+          poll_head[p->priority] = p;
+        } else {
+          poll_tail[p->priority]->poll_next = p;
+        }
+        poll_tail[p->priority] = p;
+        poll_count[p->priority]++;
+      }
+      poll_requested = 1;
+      atomic_section_exit(isr_state);
+#else /* PROCESS_READY_QUEUE */
       p->needspoll = 1;
       poll_requested = 1;
+#endif /* PROCESS_READY_QUEUE */
     }
   }
 }
@@ -384,5 +551,37 @@ process_is_running(struct process *p)
 {
   return p->state != PROCESS_STATE_NONE;
 }
+#if PROCESS_READY_QUEUE
+/*---------------------------------------------------------------------------*/
+void
+process_set_priority(struct process *p, unsigned char priority)
+{
+  if(priority > PROCESS_PRIORITY_HIGHEST) {
+    priority = PROCESS_PRIORITY_HIGHEST;
+  }
+  p->priority = priority;
+}
+#endif /* PROCESS_READY_QUEUE */
+#if PROCESS_CONF_STATS
+/*---------------------------------------------------------------------------*/
+process_num_events_t
+process_stats_max_events(void)
+{
+  return process_maxevents;
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+process_stats_dropped_events(void)
+{
+  return process_droppedevents;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_stats_reset(void)
+{
+  process_maxevents = nevents;
+  process_droppedevents = 0;
+}
+#endif /* PROCESS_CONF_STATS */
 /*---------------------------------------------------------------------------*/
 /** @} */
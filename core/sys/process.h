@@ -88,6 +88,31 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/*
+ * With PROCESS_CONF_READY_QUEUE, polled processes are put on a ready
+ * queue instead of being found by walking the process list, and both
+ * polls and queued events are dispatched in order of the priority of
+ * the receiving process (see process_set_priority()). process_poll()
+ * then needs the platform's sys/isr-control.h atomic sections.
+ */
+#ifdef PROCESS_CONF_READY_QUEUE
+#define PROCESS_READY_QUEUE PROCESS_CONF_READY_QUEUE
+#else /* PROCESS_CONF_READY_QUEUE */
+#define PROCESS_READY_QUEUE 0
+#endif /* PROCESS_CONF_READY_QUEUE */
+
+/* Number of process priority levels used by the ready queue */
+#ifdef PROCESS_CONF_PRIORITY_LEVELS
+#define PROCESS_PRIORITY_LEVELS PROCESS_CONF_PRIORITY_LEVELS
+#else /* PROCESS_CONF_PRIORITY_LEVELS */
+#define PROCESS_PRIORITY_LEVELS 3
+#endif /* PROCESS_CONF_PRIORITY_LEVELS */
+
+/** The priority all processes start with, also used for broadcasts */
+#define PROCESS_PRIORITY_DEFAULT 0
+/** The highest priority a process can have */
+#define PROCESS_PRIORITY_HIGHEST (PROCESS_PRIORITY_LEVELS - 1)
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -323,6 +348,10 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_READY_QUEUE
+  unsigned char priority;
+  struct process *poll_next;
+#endif /* PROCESS_READY_QUEUE */
 };
 
 /**
@@ -519,6 +548,42 @@ CCIF int process_is_running(struct process *p);
  */
 int process_nevents(void);
 
+#if PROCESS_READY_QUEUE
+/**
+ * \brief      Set the scheduling priority of a process
+ * \param p    The process
+ * \param priority The priority, from PROCESS_PRIORITY_DEFAULT up to
+ *             PROCESS_PRIORITY_HIGHEST
+ *
+ *             Polls and events for processes with a higher priority
+ *             are dispatched before those for processes with a lower
+ *             priority. Events to processes of the same priority, and
+ *             broadcast events, keep their FIFO order. The priority
+ *             should be set before the process receives any events.
+ */
+void process_set_priority(struct process *p, unsigned char priority);
+#endif /* PROCESS_READY_QUEUE */
+
+#if PROCESS_CONF_STATS
+/**
+ * \brief      Get the highest number of events that have been queued
+ *             at the same time since the last process_stats_reset()
+ */
+process_num_events_t process_stats_max_events(void);
+
+/**
+ * \brief      Get the number of events that process_post() had to drop
+ *             because the event queue was full since the last
+ *             process_stats_reset()
+ */
+unsigned long process_stats_dropped_events(void);
+
+/**
+ * \brief      Reset the event queue statistics
+ */
+void process_stats_reset(void);
+#endif /* PROCESS_CONF_STATS */
+
 /** @} */
 
 CCIF extern struct process *process_list;
@@ -115,7 +115,8 @@ encrypt(uint8_t *plaintext_and_result)
 /*---------------------------------------------------------------------------*/
 const struct aes_128_driver cc2538_aes_128_driver = {
   set_key,
-  encrypt
+  encrypt,
+  NULL
 };
 
 /** @} */
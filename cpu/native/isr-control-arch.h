@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *         Atomic sections for the native platform. The native rtimer
+ *         runs its callbacks from a signal handler, so an atomic
+ *         section blocks all signals.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef ISR_CONTROL_ARCH_H_
+#define ISR_CONTROL_ARCH_H_
+/*---------------------------------------------------------------------------*/
+/* Includes */
+#include <signal.h>
+/*---------------------------------------------------------------------------*/
+typedef sigset_t isr_state_t;
+/*---------------------------------------------------------------------------*/
+/* Inline Functions */
+static inline isr_state_t
+atomic_section_enter(void)
+{
+  sigset_t all;
+  sigset_t state;
+
+  sigfillset(&all);
+  sigprocmask(SIG_BLOCK, &all, &state);
+  return state;
+}
+/*---------------------------------------------------------------------------*/
+static inline void
+atomic_section_exit(isr_state_t state)
+{
+  sigprocmask(SIG_SETMASK, &state, NULL);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* ISR_CONTROL_ARCH_H_ */
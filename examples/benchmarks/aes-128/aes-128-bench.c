@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Known-answer tests and throughput of the byte-oriented and the
+ *         T-table AES-128 drivers, and of CCM* on a 127 byte frame. Build
+ *         with MAKE_WITH_TTABLE=1 to run CCM* on the T-table driver.
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+#include "lib/ccm-star.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define ROUNDS 100000
+#define FRAME_ROUNDS 10000
+
+/* Also declared by aes-128.h unless AES_128_CONF selects another driver */
+extern const struct aes_128_driver aes_128_driver;
+
+static const struct {
+  const char *name;
+  const struct aes_128_driver *driver;
+} drivers[] = {
+  { "bytewise", &aes_128_driver },
+  { "ttable", &aes_128_ttable_driver },
+};
+#define DRIVERS (sizeof(drivers) / sizeof(drivers[0]))
+
+/* FIPS-197, appendix C.1 */
+static const uint8_t fips_key[16] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t fips_plaintext[16] = {
+  0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+  0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const uint8_t fips_ciphertext[16] = {
+  0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+  0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+/* NIST SP 800-38A, F.1.1 ECB-AES128.Encrypt */
+static const uint8_t ecb_key[16] = {
+  0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+  0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static const uint8_t ecb_plaintext[64] = {
+  0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+  0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+  0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+  0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+  0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+  0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+  0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+  0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+static const uint8_t ecb_ciphertext[64] = {
+  0x3a, 0xd7, 0x7b, 0xb4, 0x0d, 0x7a, 0x36, 0x60,
+  0xa8, 0x9e, 0xca, 0xf3, 0x24, 0x66, 0xef, 0x97,
+  0xf5, 0xd3, 0xd5, 0x85, 0x03, 0xb9, 0x69, 0x9d,
+  0xe7, 0x85, 0x89, 0x5a, 0x96, 0xfd, 0xba, 0xaf,
+  0x43, 0xb1, 0xcd, 0x7f, 0x59, 0x8e, 0xce, 0x23,
+  0x88, 0x1b, 0x00, 0xe3, 0xed, 0x03, 0x06, 0x88,
+  0x7b, 0x0c, 0x78, 0x5e, 0x27, 0xe8, 0xad, 0x3f,
+  0x82, 0x23, 0x20, 0x71, 0x04, 0x72, 0x5d, 0xd4
+};
+
+/* RFC 3610, packet vector #1 */
+static const uint8_t ccm_key[16] = {
+  0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+  0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf
+};
+static const uint8_t ccm_nonce[CCM_STAR_NONCE_LENGTH] = {
+  0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00,
+  0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5
+};
+static const uint8_t ccm_header[8] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07
+};
+static const uint8_t ccm_plaintext[23] = {
+  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+  0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+  0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e
+};
+static const uint8_t ccm_ciphertext[23] = {
+  0x58, 0x8c, 0x97, 0x9a, 0x61, 0xc6, 0x63, 0xd2,
+  0xf0, 0x66, 0xd0, 0xc2, 0xc0, 0xf9, 0x89, 0x80,
+  0x6d, 0x5f, 0x6b, 0x61, 0xda, 0xc3, 0x84
+};
+static const uint8_t ccm_mic[8] = {
+  0x17, 0xe8, 0xd1, 0x2c, 0xfd, 0xf9, 0x26, 0xe0
+};
+
+static int failures;
+/*---------------------------------------------------------------------------*/
+static void
+check(const char *name, const uint8_t *result, const uint8_t *expected,
+      int len)
+{
+  if(memcmp(result, expected, len) != 0) {
+    printf("aes-128-bench: %s failed\n", name);
+    failures++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+known_answer_tests(void)
+{
+  uint8_t buf[64];
+  uint8_t mic[8];
+  unsigned d;
+  int i;
+
+  for(d = 0; d < DRIVERS; d++) {
+    drivers[d].driver->set_key(fips_key);
+    memcpy(buf, fips_plaintext, 16);
+    drivers[d].driver->encrypt(buf);
+    check(drivers[d].name, buf, fips_ciphertext, 16);
+
+    drivers[d].driver->set_key(ecb_key);
+    memcpy(buf, ecb_plaintext, 64);
+    for(i = 0; i < 64; i += AES_128_BLOCK_SIZE) {
+      drivers[d].driver->encrypt(buf + i);
+    }
+    check(drivers[d].name, buf, ecb_ciphertext, 64);
+
+    if(drivers[d].driver->encrypt_blocks != NULL) {
+      memcpy(buf, ecb_plaintext, 64);
+      drivers[d].driver->encrypt_blocks(buf, 4);
+      check(drivers[d].name, buf, ecb_ciphertext, 64);
+    }
+  }
+
+  memcpy(buf, ecb_plaintext, 64);
+  AES_128.set_key(ecb_key);
+  aes_128_encrypt_blocks(buf, 4);
+  check("aes_128_encrypt_blocks", buf, ecb_ciphertext, 64);
+
+  CCM_STAR.set_key(ccm_key);
+  memcpy(buf, ccm_plaintext, sizeof(ccm_plaintext));
+  CCM_STAR.aead(ccm_nonce, buf, sizeof(ccm_plaintext),
+                ccm_header, sizeof(ccm_header), mic, sizeof(mic), 1);
+  check("ccm-star encryption", buf, ccm_ciphertext, sizeof(ccm_ciphertext));
+  check("ccm-star mic", mic, ccm_mic, sizeof(ccm_mic));
+  CCM_STAR.aead(ccm_nonce, buf, sizeof(ccm_plaintext),
+                ccm_header, sizeof(ccm_header), mic, sizeof(mic), 0);
+  check("ccm-star decryption", buf, ccm_plaintext, sizeof(ccm_plaintext));
+  check("ccm-star mic", mic, ccm_mic, sizeof(ccm_mic));
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *name, unsigned long bytes, uint64_t total_ns,
+       unsigned long ops)
+{
+  bench_report(name, bytes, total_ns, ops);
+  printf("aes-128-bench: %s %.0f bytes/s\n",
+         name, (double)bytes * ops * 1e9 / total_ns);
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_drivers(void)
+{
+  static uint8_t buf[4 * AES_128_BLOCK_SIZE];
+  char name[32];
+  uint64_t start;
+  unsigned d;
+  long i;
+
+  for(d = 0; d < DRIVERS; d++) {
+    drivers[d].driver->set_key(ecb_key);
+
+    start = bench_now_ns();
+    for(i = 0; i < ROUNDS; i++) {
+      drivers[d].driver->encrypt(buf);
+    }
+    snprintf(name, sizeof(name), "encrypt/%s", drivers[d].name);
+    report(name, AES_128_BLOCK_SIZE, bench_now_ns() - start, ROUNDS);
+
+    if(drivers[d].driver->encrypt_blocks != NULL) {
+      start = bench_now_ns();
+      for(i = 0; i < ROUNDS / 4; i++) {
+        drivers[d].driver->encrypt_blocks(buf, 4);
+      }
+      snprintf(name, sizeof(name), "encrypt_blocks/%s", drivers[d].name);
+      report(name, sizeof(buf), bench_now_ns() - start, ROUNDS / 4);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_ccm_star(void)
+{
+  /* A full 802.15.4 frame: 23 bytes of header, 100 of payload, 4 of MIC */
+  static uint8_t header[23];
+  static uint8_t payload[100];
+  uint8_t mic[4];
+  uint64_t start;
+  long i;
+
+  CCM_STAR.set_key(ccm_key);
+  start = bench_now_ns();
+  for(i = 0; i < FRAME_ROUNDS; i++) {
+    CCM_STAR.aead(ccm_nonce, payload, sizeof(payload),
+                  header, sizeof(header), mic, sizeof(mic), 1);
+  }
+  report("ccm-star", sizeof(header) + sizeof(payload) + sizeof(mic),
+         bench_now_ns() - start, FRAME_ROUNDS);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(aes_128_bench_process, "AES-128 benchmark");
+AUTOSTART_PROCESSES(&aes_128_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(aes_128_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+#ifdef AES_128_CONF
+  printf("aes-128-bench: CCM* on ttable\n");
+#else /* AES_128_CONF */
+  printf("aes-128-bench: CCM* on bytewise\n");
+#endif /* AES_128_CONF */
+
+  known_answer_tests();
+  if(failures) {
+    exit(1);
+  }
+  bench_drivers();
+  bench_ccm_star();
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Checks and timing of Antelope GROUP BY with more groups than
+ *         fit in memory (DB_GROUP_LIMIT), so that partial aggregates are
+ *         spilled to Coffee and merged in later passes. The minimum,
+ *         maximum, mean and count of every group are compared with
+ *         values computed here from the same tuples.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "antelope.h"
+#include "bench.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define GROUPS  (3 * DB_GROUP_LIMIT + 5)
+#define TUPLES  2000
+#define QUERIES 5
+/* Only the tuples with a later time than this are aggregated */
+#define TIME_MIN 100
+
+struct expected {
+  long min;
+  long max;
+  long sum;
+  long count;
+  uint8_t seen;
+};
+
+static struct expected expected[GROUPS];
+/*---------------------------------------------------------------------------*/
+static void
+fail(const char *msg, long value)
+{
+  printf("antelope-group-bench: %s (%ld)\n", msg, value);
+  exit(1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+check(db_result_t result, const char *what)
+{
+  if(DB_ERROR(result)) {
+    printf("antelope-group-bench: %s failed: %s\n",
+           what, db_get_result_message(result));
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The number of spill files that can be found at the moment */
+static int
+spill_files(void)
+{
+  struct cfs_dir dir;
+  struct cfs_dirent dirent;
+  int files;
+
+  files = 0;
+  if(cfs_opendir(&dir, "/") == 0) {
+    while(cfs_readdir(&dir, &dirent) == 0) {
+      if(strncmp(dirent.name, "group.", 6) == 0) {
+        files++;
+      }
+    }
+    cfs_closedir(&dir);
+  }
+  return files;
+}
+/*---------------------------------------------------------------------------*/
+static long
+column(db_handle_t *handle, unsigned col)
+{
+  attribute_value_t value;
+
+  check(db_get_value(&value, handle, col), "get value");
+  return db_value_to_long(&value);
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_row(db_handle_t *handle)
+{
+  struct expected *e;
+  long node;
+
+  node = column(handle, 0);
+  if(node < 0 || node >= GROUPS) {
+    fail("unknown group", node);
+  }
+  e = &expected[node];
+  if(e->count == 0 || e->seen) {
+    fail("group returned more than once or without tuples", node);
+  }
+  e->seen = 1;
+  /* MEAN is the sum divided by the count, as the C division rounds */
+  if(column(handle, 1) != e->min || column(handle, 2) != e->max ||
+     column(handle, 3) != e->sum / e->count ||
+     column(handle, 4) != e->count) {
+    printf("antelope-group-bench: group %ld: %ld %ld %ld %ld, expected %ld %ld %ld %ld\n",
+           node, column(handle, 1), column(handle, 2), column(handle, 3),
+           column(handle, 4), e->min, e->max, e->sum / e->count, e->count);
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+run_query(void)
+{
+  db_handle_t handle;
+  db_result_t result;
+  int spilled;
+  int i;
+
+  for(i = 0; i < GROUPS; i++) {
+    expected[i].seen = 0;
+  }
+
+  check(db_query(&handle, "SELECT node, MIN(temp), MAX(temp), MEAN(temp), COUNT(temp) FROM samples WHERE time > %u GROUP BY node;",
+                 TIME_MIN), "query");
+  spilled = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      check_row(&handle);
+      spilled |= spill_files() > 0;
+    } else if(result == DB_FINISHED) {
+      break;
+    } else {
+      check(result, "processing");
+    }
+  }
+  db_free(&handle);
+
+  for(i = 0; i < GROUPS; i++) {
+    if(expected[i].count > 0 && !expected[i].seen) {
+      fail("group missing", i);
+    }
+  }
+  if(spill_files() != 0) {
+    fail("spill files left behind", spill_files());
+  }
+  return spilled;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(antelope_group_bench_process, "Antelope GROUP BY benchmark");
+AUTOSTART_PROCESSES(&antelope_group_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(antelope_group_bench_process, ev, data)
+{
+  uint64_t start;
+  unsigned i;
+  int node, temp;
+  int spilled;
+
+  PROCESS_BEGIN();
+
+  cfs_coffee_format();
+  db_init();
+
+  check(db_query(NULL, "CREATE RELATION samples;"), "create relation");
+  check(db_query(NULL, "CREATE ATTRIBUTE node DOMAIN INT IN samples;"),
+        "create attribute");
+  check(db_query(NULL, "CREATE ATTRIBUTE temp DOMAIN INT IN samples;"),
+        "create attribute");
+  check(db_query(NULL, "CREATE ATTRIBUTE time DOMAIN INT IN samples;"),
+        "create attribute");
+
+  /* Groups of different sizes, interleaved so that every pass spills */
+  for(i = 0; i < GROUPS; i++) {
+    expected[i].min = LONG_MAX;
+    expected[i].max = LONG_MIN;
+  }
+  srandom(1);
+  for(i = 0; i < TUPLES; i++) {
+    node = random() % GROUPS;
+    if(node % 7 == 3) {
+      node = (node * node) % GROUPS;
+    }
+    temp = random() % 1001;
+    check(db_query(NULL, "INSERT (%d, %d, %u) INTO samples;",
+                   node, temp, i), "insert");
+    if(i > TIME_MIN) {
+      if(temp < expected[node].min) {
+        expected[node].min = temp;
+      }
+      if(temp > expected[node].max) {
+        expected[node].max = temp;
+      }
+      expected[node].sum += temp;
+      expected[node].count++;
+    }
+  }
+
+  /* Coffee does not list every file once its sectors are fragmented, so
+     the spill files are not always seen */
+  spilled = 0;
+  start = bench_now_ns();
+  for(i = 0; i < QUERIES; i++) {
+    spilled += run_query();
+  }
+  bench_report("group-by", GROUPS, bench_now_ns() - start, QUERIES);
+  if(spilled == 0) {
+    fail("no groups were spilled", GROUPS);
+  }
+
+  printf("antelope-group-bench: all checks passed\n");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Micro-benchmark for Antelope point and range queries on an
+ *         attribute indexed with MaxHeap and with the B+-tree index.
+ *         Both relations get the same tuples, inserted in random key
+ *         order, and are stored in Coffee on emulated flash.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs-coffee.h"
+#include "antelope.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+/*---------------------------------------------------------------------------*/
+#define TUPLES        2000
+#define POINT_QUERIES 200
+#define RANGE_QUERIES 50
+
+static const char *relations[] = { "heap", "tree" };
+static const char *index_types[] = { "MAXHEAP", "BPTREE" };
+static unsigned keys[TUPLES];
+/*---------------------------------------------------------------------------*/
+static void
+check(db_result_t result, const char *what)
+{
+  if(DB_ERROR(result)) {
+    printf("antelope-index-bench: %s failed: %s\n",
+           what, db_get_result_message(result));
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+run_query(const char *format, const char *relation,
+          unsigned min, unsigned max)
+{
+  db_handle_t handle;
+  db_result_t result;
+  unsigned long rows;
+
+  check(db_query(&handle, format, relation, min, max), "query");
+
+  rows = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      rows++;
+    } else if(result == DB_FINISHED) {
+      break;
+    } else {
+      check(result, "processing");
+    }
+  }
+  db_free(&handle);
+
+  return rows;
+}
+/*---------------------------------------------------------------------------*/
+static void
+create_relation(int r)
+{
+  check(db_query(NULL, "CREATE RELATION %s;", relations[r]),
+        "create relation");
+  check(db_query(NULL, "CREATE ATTRIBUTE time DOMAIN INT IN %s;",
+                 relations[r]), "create attribute");
+  check(db_query(NULL, "CREATE ATTRIBUTE value DOMAIN INT IN %s;",
+                 relations[r]), "create attribute");
+  check(db_query(NULL, "CREATE INDEX %s.time TYPE %s;",
+                 relations[r], index_types[r]), "create index");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(antelope_index_bench_process, "Antelope index benchmark");
+AUTOSTART_PROCESSES(&antelope_index_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(antelope_index_bench_process, ev, data)
+{
+  static const unsigned ranges[] = { 10, 100 };
+  char name[32];
+  uint64_t start;
+  unsigned long rows;
+  unsigned i, j, tmp, key;
+  int r, k;
+
+  PROCESS_BEGIN();
+
+  cfs_coffee_format();
+  db_init();
+
+  /* A random permutation of the keys, shared by both relations. */
+  srandom(1);
+  for(i = 0; i < TUPLES; i++) {
+    keys[i] = i;
+  }
+  for(i = TUPLES - 1; i > 0; i--) {
+    j = random() % (i + 1);
+    tmp = keys[i];
+    keys[i] = keys[j];
+    keys[j] = tmp;
+  }
+
+  for(r = 0; r < 2; r++) {
+    create_relation(r);
+
+    start = bench_now_ns();
+    for(i = 0; i < TUPLES; i++) {
+      check(db_query(NULL, "INSERT (%u, %u) INTO %s;",
+                     keys[i], i, relations[r]), "insert");
+    }
+    snprintf(name, sizeof(name), "%s-insert", relations[r]);
+    bench_report(name, TUPLES, bench_now_ns() - start, TUPLES);
+
+    rows = 0;
+    start = bench_now_ns();
+    for(i = 0; i < POINT_QUERIES; i++) {
+      key = keys[(i * 7919) % TUPLES];
+      rows += run_query("SELECT time, value FROM %s WHERE time = %u;",
+                        relations[r], key, key);
+    }
+    if(rows != POINT_QUERIES) {
+      printf("antelope-index-bench: %lu rows from %u point queries\n",
+             rows, POINT_QUERIES);
+      exit(1);
+    }
+    snprintf(name, sizeof(name), "%s-point", relations[r]);
+    bench_report(name, TUPLES, bench_now_ns() - start, POINT_QUERIES);
+
+    for(k = 0; k < sizeof(ranges) / sizeof(ranges[0]); k++) {
+      rows = 0;
+      start = bench_now_ns();
+      for(i = 0; i < RANGE_QUERIES; i++) {
+        key = (i * 7919) % (TUPLES - ranges[k]);
+        rows += run_query("SELECT time, value FROM %s WHERE time >= %u AND time < %u;",
+                          relations[r], key, key + ranges[k]);
+      }
+      if(rows != (unsigned long)RANGE_QUERIES * ranges[k]) {
+        printf("antelope-index-bench: %lu rows from %u range queries\n",
+               rows, RANGE_QUERIES);
+        exit(1);
+      }
+      snprintf(name, sizeof(name), "%s-range", relations[r]);
+      bench_report(name, ranges[k], bench_now_ns() - start, RANGE_QUERIES);
+    }
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
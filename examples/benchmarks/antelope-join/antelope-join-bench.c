@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Checks and timing of Antelope joins. Relations of 20, 600 and
+ *         3000 tuples are joined on indexed and on non-indexed
+ *         attributes. The benchmark checks the method the planner picks
+ *         for each pair of cardinalities and compares every result with
+ *         the join computed here from the same tuples, so the hash join
+ *         (MAKE_WITH_HASH_JOIN=1) and the index nested-loop join must
+ *         return the same rows.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs-coffee.h"
+#include "antelope.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define SENSORS  20
+#define READINGS 600
+#define HISTORY  3000
+#define QUERIES  3
+
+/* The tuples of the three relations */
+static unsigned sensor_id[SENSORS];
+static unsigned sensor_room[SENSORS];
+static unsigned reading_id[READINGS];
+static unsigned reading_room[READINGS];
+static unsigned history_id[HISTORY];
+
+/* Result rows found for each reading, and the number expected */
+static unsigned matches[READINGS];
+static unsigned expected[READINGS];
+
+enum join_on { ON_ID, ON_ROOM, ON_HISTORY };
+
+struct join {
+  const char *name;
+  const char *query;
+  enum join_on on;
+  /* The reading and its partner are in these result columns */
+  unsigned reading_col;
+  unsigned partner_col;
+  /* The method the planner must pick, or an error without a usable one */
+  uint8_t flags;
+  db_result_t error;
+};
+
+#if DB_FEATURE_HASH_JOIN
+#define HASH_OR(hash, index) (hash)
+#else
+#define HASH_OR(hash, index) (index)
+#endif
+
+static const struct join joins[] = {
+  /* A small inner relation is cheaper to hash than to look up */
+  { "small-right", "JOIN readings, sensors ON id PROJECT value, kind;",
+    ON_ID, 0, 1,
+    HASH_OR(DB_HANDLE_FLAG_HASH_JOIN, DB_HANDLE_FLAG_JOIN_SWAPPED), DB_OK },
+  { "small-left", "JOIN sensors, readings ON id PROJECT kind, value;",
+    ON_ID, 1, 0,
+    HASH_OR(DB_HANDLE_FLAG_HASH_JOIN | DB_HANDLE_FLAG_JOIN_SWAPPED, 0),
+    DB_OK },
+  /* Neither relation fits in memory in few enough chunks */
+  { "large", "JOIN readings, history ON id PROJECT value, hvalue;",
+    ON_HISTORY, 0, 1, 0, DB_OK },
+  /* Only a hash join can join on an attribute without an index */
+  { "no-index", "JOIN readings, sensors ON room PROJECT value, kind;",
+    ON_ROOM, 0, 1, DB_HANDLE_FLAG_HASH_JOIN,
+    HASH_OR(DB_OK, DB_INDEX_ERROR) },
+};
+#define JOINS (sizeof(joins) / sizeof(joins[0]))
+/*---------------------------------------------------------------------------*/
+static void
+check(db_result_t result, const char *what)
+{
+  if(DB_ERROR(result)) {
+    printf("antelope-join-bench: %s failed: %s\n",
+           what, db_get_result_message(result));
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+fail(const struct join *join, const char *msg, long value)
+{
+  printf("antelope-join-bench: %s: %s (%ld)\n", join->name, msg, value);
+  exit(1);
+}
+/*---------------------------------------------------------------------------*/
+static long
+column(db_handle_t *handle, unsigned col)
+{
+  attribute_value_t value;
+
+  check(db_get_value(&value, handle, col), "get value");
+  return db_value_to_long(&value);
+}
+/*---------------------------------------------------------------------------*/
+/* Whether a reading and a partner tuple satisfy the join condition */
+static int
+joined(const struct join *join, unsigned reading, unsigned partner)
+{
+  switch(join->on) {
+  case ON_ID:
+    return partner < SENSORS && reading_id[reading] == sensor_id[partner];
+  case ON_ROOM:
+    return partner < SENSORS && reading_room[reading] == sensor_room[partner];
+  default:
+    return partner < HISTORY && reading_id[reading] == history_id[partner];
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+expect(const struct join *join)
+{
+  unsigned i, j;
+  unsigned partners;
+
+  partners = join->on == ON_HISTORY ? HISTORY : SENSORS;
+  for(i = 0; i < READINGS; i++) {
+    matches[i] = 0;
+    expected[i] = 0;
+    for(j = 0; j < partners; j++) {
+      expected[i] += joined(join, i, j);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_join(const struct join *join)
+{
+  db_handle_t handle;
+  db_result_t result;
+  long reading;
+  long partner;
+  unsigned i;
+
+  result = db_query(&handle, join->query);
+  if(join->error != DB_OK) {
+    if(result != join->error) {
+      fail(join, "unexpected result", result);
+    }
+    db_free(&handle);
+    return;
+  }
+  check(result, join->name);
+  if((handle.flags & (DB_HANDLE_FLAG_HASH_JOIN | DB_HANDLE_FLAG_JOIN_SWAPPED)) !=
+     join->flags) {
+    fail(join, "planned with other flags", handle.flags);
+  }
+
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      reading = column(&handle, join->reading_col);
+      partner = column(&handle, join->partner_col);
+      if(reading < 0 || reading >= READINGS ||
+         !joined(join, reading, partner)) {
+        fail(join, "row does not satisfy the join", reading);
+      }
+      matches[reading]++;
+    } else if(result == DB_FINISHED) {
+      break;
+    } else {
+      check(result, "processing");
+    }
+  }
+  db_free(&handle);
+
+  for(i = 0; i < READINGS; i++) {
+    if(matches[i] != expected[i]) {
+      fail(join, "rows for a reading", (long)matches[i] - expected[i]);
+    }
+    matches[i] = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(antelope_join_bench_process, "Antelope join benchmark");
+AUTOSTART_PROCESSES(&antelope_join_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(antelope_join_bench_process, ev, data)
+{
+  uint64_t start;
+  unsigned i, j;
+
+  PROCESS_BEGIN();
+
+  cfs_coffee_format();
+  db_init();
+
+  check(db_query(NULL, "CREATE RELATION sensors;"), "create relation");
+  check(db_query(NULL, "CREATE ATTRIBUTE id DOMAIN INT IN sensors;"),
+        "create attribute");
+  check(db_query(NULL, "CREATE ATTRIBUTE room DOMAIN INT IN sensors;"),
+        "create attribute");
+  check(db_query(NULL, "CREATE ATTRIBUTE kind DOMAIN INT IN sensors;"),
+        "create attribute");
+  check(db_query(NULL, "CREATE INDEX sensors.id TYPE BPTREE;"),
+        "create index");
+
+  check(db_query(NULL, "CREATE RELATION readings;"), "create relation");
+  check(db_query(NULL, "CREATE ATTRIBUTE id DOMAIN INT IN readings;"),
+        "create attribute");
+  check(db_query(NULL, "CREATE ATTRIBUTE room DOMAIN INT IN readings;"),
+        "create attribute");
+  check(db_query(NULL, "CREATE ATTRIBUTE value DOMAIN INT IN readings;"),
+        "create attribute");
+  check(db_query(NULL, "CREATE INDEX readings.id TYPE BPTREE;"),
+        "create index");
+
+  check(db_query(NULL, "CREATE RELATION history;"), "create relation");
+  check(db_query(NULL, "CREATE ATTRIBUTE id DOMAIN INT IN history;"),
+        "create attribute");
+  check(db_query(NULL, "CREATE ATTRIBUTE hvalue DOMAIN INT IN history;"),
+        "create attribute");
+  check(db_query(NULL, "CREATE INDEX history.id TYPE BPTREE;"),
+        "create index");
+
+  /* kind, value and hvalue are the tuple numbers. Not every reading has
+     a sensor with its ID or room. */
+  srandom(1);
+  for(i = 0; i < SENSORS; i++) {
+    sensor_id[i] = i * 3;
+    sensor_room[i] = i % 5;
+    check(db_query(NULL, "INSERT (%u, %u, %u) INTO sensors;",
+                   sensor_id[i], sensor_room[i], i), "insert");
+  }
+  for(i = 0; i < READINGS; i++) {
+    reading_id[i] = random() % (3 * SENSORS);
+    reading_room[i] = i % 7;
+    check(db_query(NULL, "INSERT (%u, %u, %u) INTO readings;",
+                   reading_id[i], reading_room[i], i), "insert");
+  }
+  for(i = 0; i < HISTORY; i++) {
+    history_id[i] = random() % 200;
+    check(db_query(NULL, "INSERT (%u, %u) INTO history;",
+                   history_id[i], i), "insert");
+  }
+
+  for(i = 0; i < JOINS; i++) {
+    expect(&joins[i]);
+    start = bench_now_ns();
+    for(j = 0; j < QUERIES; j++) {
+      run_join(&joins[i]);
+    }
+    if(joins[i].error == DB_OK) {
+      bench_report(joins[i].name, READINGS, bench_now_ns() - start, QUERIES);
+    }
+  }
+
+  printf("antelope-join-bench: all checks passed\n");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Checks and timing of Antelope selections. The same predicates
+ *         are evaluated over 2000 tuples by the LVM interpreter and, with
+ *         MAKE_WITH_LVM_COMPILER=1, by the compiled filter. Every result
+ *         is compared with the predicate evaluated here, and the
+ *         predicates on the indexed attribute must be answered by a range
+ *         scan of the index in both builds.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs-coffee.h"
+#include "antelope.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define TUPLES  2000
+#define QUERIES 3
+
+/* The tuples of the relation; time is the tuple number */
+static unsigned temps[TUPLES];
+static unsigned nodes[TUPLES];
+static long bigs[TUPLES];
+static unsigned char removed[TUPLES];
+static unsigned char seen[TUPLES];
+static const char *pass = "";
+
+struct selection {
+  const char *name;
+  const char *where;
+  int (*match)(unsigned t);
+  /* Whether the index on time must be searched */
+  int index;
+};
+/*---------------------------------------------------------------------------*/
+static int
+folded(unsigned t)
+{
+  return t > 2 * 50;
+}
+static int
+conjunction(unsigned t)
+{
+  return t >= 500 && t < 700 && temps[t] > 300;
+}
+static int
+mirrored(unsigned t)
+{
+  return 500 < t && temps[t] <= 200;
+}
+static int
+disjunction(unsigned t)
+{
+  return (t < 100 || t > 1900) && nodes[t] == 3;
+}
+static int
+unindexed(unsigned t)
+{
+  return temps[t] > 400 && temps[t] < 450;
+}
+static int
+partial(unsigned t)
+{
+  return t > 1500 && (temps[t] < 100 || nodes[t] + 1 == 5);
+}
+static int
+arithmetic(unsigned t)
+{
+  return (long)t - 10 > 1000 && temps[t] * 2 < 500;
+}
+static int
+wide(unsigned t)
+{
+  return bigs[t] >= 100000000L && bigs[t] < 103000000L;
+}
+/*---------------------------------------------------------------------------*/
+static const struct selection selections[] = {
+  /* Only the compiler folds the constants, so that a range is derived */
+  { "folded", "time > 2 * 50", folded, DB_FEATURE_LVM_COMPILER },
+  { "conjunction", "time >= 500 AND time < 700 AND temp > 300",
+    conjunction, 1 },
+  { "mirrored", "500 < time AND temp <= 200", mirrored, 1 },
+  /* Connectives group to the right. The union of the two ranges of time
+     spans the whole index. */
+  { "disjunction", "node = 3 AND time < 100 OR time > 1900",
+    disjunction, 1 },
+  { "unindexed", "temp > 400 AND temp < 450", unindexed, 0 },
+  /* No range is derived from the right operand of AND, but the left
+     operand still selects the index */
+  { "partial", "time > 1500 AND temp < 100 OR node + 1 = 5", partial, 1 },
+  /* Arithmetic on variables is left to the interpreter */
+  { "arithmetic", "time - 10 > 1000 AND temp * 2 < 500", arithmetic, 0 },
+  { "wide", "big >= 100000000 AND big < 103000000", wide, 0 },
+};
+#define SELECTIONS (sizeof(selections) / sizeof(selections[0]))
+/*---------------------------------------------------------------------------*/
+static void
+check(db_result_t result, const char *what)
+{
+  if(DB_ERROR(result)) {
+    printf("antelope-select-bench: %s failed: %s\n",
+           what, db_get_result_message(result));
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+fail(const struct selection *selection, const char *msg, long value)
+{
+  printf("antelope-select-bench: %s%s: %s (%ld)\n",
+         selection->name, pass, msg, value);
+  exit(1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_selection(const struct selection *selection, int indexed)
+{
+  db_handle_t handle;
+  db_result_t result;
+  attribute_value_t value;
+  long t;
+  unsigned i;
+
+  check(db_query(&handle, "SELECT time FROM samples WHERE %s;",
+                 selection->where), selection->name);
+  if(!(handle.flags & DB_HANDLE_FLAG_SEARCH_INDEX) !=
+     !(indexed && selection->index)) {
+    fail(selection, "index search", handle.flags);
+  }
+
+  memset(seen, 0, sizeof(seen));
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      check(db_get_value(&value, &handle, 0), "get value");
+      t = db_value_to_long(&value);
+      if(t < 0 || t >= TUPLES || removed[t] || seen[t]) {
+        fail(selection, "unexpected row", t);
+      }
+      seen[t] = 1;
+    } else if(result == DB_FINISHED) {
+      break;
+    } else {
+      check(result, "processing");
+    }
+  }
+  db_free(&handle);
+
+  for(i = 0; i < TUPLES; i++) {
+    if(seen[i] != (!removed[i] && selection->match(i))) {
+      fail(selection, "row differs from the predicate", i);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_remove(const char *where)
+{
+  db_handle_t handle;
+  db_result_t result;
+
+  check(db_query(&handle, "REMOVE FROM samples WHERE %s;", where), "remove");
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_FINISHED) {
+      break;
+    }
+    check(result, "removing");
+  }
+  db_free(&handle);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_selections(const char *suffix, int indexed)
+{
+  char name[32];
+  uint64_t start;
+  unsigned i, j;
+
+  pass = suffix;
+  for(i = 0; i < SELECTIONS; i++) {
+    start = bench_now_ns();
+    for(j = 0; j < QUERIES; j++) {
+      run_selection(&selections[i], indexed);
+    }
+    snprintf(name, sizeof(name), "%s%s", selections[i].name, suffix);
+    bench_report(name, TUPLES, bench_now_ns() - start, QUERIES);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(antelope_select_bench_process, "Antelope selection benchmark");
+AUTOSTART_PROCESSES(&antelope_select_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(antelope_select_bench_process, ev, data)
+{
+  unsigned i;
+
+  PROCESS_BEGIN();
+
+  cfs_coffee_format();
+  db_init();
+
+  check(db_query(NULL, "CREATE RELATION samples;"), "create relation");
+  check(db_query(NULL, "CREATE ATTRIBUTE time DOMAIN INT IN samples;"),
+        "create attribute");
+  check(db_query(NULL, "CREATE ATTRIBUTE temp DOMAIN INT IN samples;"),
+        "create attribute");
+  check(db_query(NULL, "CREATE ATTRIBUTE node DOMAIN INT IN samples;"),
+        "create attribute");
+  check(db_query(NULL, "CREATE ATTRIBUTE big DOMAIN LONG IN samples;"),
+        "create attribute");
+  check(db_query(NULL, "CREATE INDEX samples.time TYPE BPTREE;"),
+        "create index");
+
+  srandom(1);
+  for(i = 0; i < TUPLES; i++) {
+    temps[i] = random() % 1000;
+    nodes[i] = random() % 30;
+    bigs[i] = 99000000L + i * 3000L;
+    check(db_query(NULL, "INSERT (%u, %u, %u, %ld) INTO samples;",
+                   i, temps[i], nodes[i], bigs[i]), "insert");
+  }
+
+  run_selections("", 1);
+
+  /* REMOVE inverts the predicate, so the rows outside its range are the
+     ones that must be kept. The relation replaced by the result has no
+     index. */
+  run_remove("temp > 900");
+  for(i = 0; i < TUPLES; i++) {
+    removed[i] = temps[i] > 900;
+  }
+  run_selections("-removed", 0);
+
+  printf("antelope-select-bench: all checks passed\n");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
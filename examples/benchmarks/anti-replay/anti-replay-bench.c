@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Checks and benchmark of the link-layer anti-replay check:
+ *         in-order and reordered counters, duplicates, counters older
+ *         than the window and jumps over the whole window, for unicast
+ *         and broadcast frames. Build with MAKE_WITH_WINDOW=32 or 64 to
+ *         check the sliding window of ANTI_REPLAY_CONF_WINDOW bits.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/llsec/anti-replay.h"
+#include "net/llsec/llsec802154.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+/*---------------------------------------------------------------------------*/
+#define FRAMES 100000
+#define W ANTI_REPLAY_WINDOW
+
+enum outcome {
+  ACCEPTED,
+  ACCEPTED_OUT_OF_ORDER,
+  REJECTED_REPLAYED,
+  REJECTED_TOO_OLD
+};
+
+static const char *outcome_names[] = {
+  "accepted", "accepted out of order", "rejected as replayed",
+  "rejected as too old"
+};
+
+static const linkaddr_t sender = { { 0x02, 0, 0, 0, 0, 0, 0, 0x01 } };
+/*---------------------------------------------------------------------------*/
+/* Put a received frame with the given counter into packetbuf */
+static void
+set_frame(uint32_t frame_counter, int broadcast)
+{
+  frame802154_frame_counter_t reordered_counter;
+
+  packetbuf_clear();
+  reordered_counter.u32 = LLSEC802154_HTONL(frame_counter);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_0_1,
+                     reordered_counter.u16[0]);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_2_3,
+                     reordered_counter.u16[1]);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &sender);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER,
+                     broadcast ? &linkaddr_null : &linkaddr_node_addr);
+}
+/*---------------------------------------------------------------------------*/
+/* Start over with a sender whose first frame had the given counter */
+static void
+init_info(struct anti_replay_info *info, uint32_t frame_counter)
+{
+  set_frame(frame_counter, 0);
+  anti_replay_init_info(info);
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+stat_of(enum outcome outcome)
+{
+  switch(outcome) {
+  case ACCEPTED:
+    return anti_replay_stats.accepted;
+  case ACCEPTED_OUT_OF_ORDER:
+    return anti_replay_stats.accepted_out_of_order;
+  case REJECTED_REPLAYED:
+    return anti_replay_stats.rejected_replayed;
+  default:
+    return anti_replay_stats.rejected_too_old;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Receive a frame and check both the verdict and the counter it updated */
+static void
+expect(struct anti_replay_info *info, uint32_t frame_counter, int broadcast,
+       enum outcome outcome)
+{
+  uint32_t before;
+  int replayed;
+
+  before = stat_of(outcome);
+  set_frame(frame_counter, broadcast);
+  replayed = anti_replay_was_replayed(info);
+  if(replayed != (outcome >= REJECTED_REPLAYED)
+     || stat_of(outcome) != before + 1) {
+    printf("anti-replay-bench: %s counter %lu not %s\n",
+           broadcast ? "broadcast" : "unicast", (unsigned long)frame_counter,
+           outcome_names[outcome]);
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_in_order(void)
+{
+  struct anti_replay_info info;
+
+  init_info(&info, 1000);
+  expect(&info, 1000, 0, REJECTED_REPLAYED);
+  expect(&info, 1001, 0, ACCEPTED);
+  expect(&info, 1001, 0, REJECTED_REPLAYED);
+  expect(&info, 1005, 0, ACCEPTED);
+  expect(&info, 1005, 0, REJECTED_REPLAYED);
+  expect(&info, 0xffffffff, 0, ACCEPTED);
+  expect(&info, 0xffffffff, 0, REJECTED_REPLAYED);
+
+  /* broadcast and unicast counters are independent */
+  init_info(&info, 1000);
+  expect(&info, 1010, 0, ACCEPTED);
+  expect(&info, 1005, 1, ACCEPTED);
+  expect(&info, 1005, 1, REJECTED_REPLAYED);
+  expect(&info, 1011, 0, ACCEPTED);
+  expect(&info, 1006, 1, ACCEPTED);
+}
+/*---------------------------------------------------------------------------*/
+#if W
+static void
+check_window(void)
+{
+  struct anti_replay_info info;
+  uint32_t c;
+
+  /* frames reordered within the window are accepted once */
+  init_info(&info, 1000);
+  expect(&info, 1005, 0, ACCEPTED);
+  expect(&info, 1003, 0, ACCEPTED_OUT_OF_ORDER);
+  expect(&info, 1004, 0, ACCEPTED_OUT_OF_ORDER);
+  expect(&info, 1001, 0, ACCEPTED_OUT_OF_ORDER);
+  expect(&info, 1003, 0, REJECTED_REPLAYED);
+  expect(&info, 1005, 0, REJECTED_REPLAYED);
+  expect(&info, 1000, 0, REJECTED_REPLAYED);
+  expect(&info, 1002, 0, ACCEPTED_OUT_OF_ORDER);
+  expect(&info, 1002, 0, REJECTED_REPLAYED);
+
+  /* the oldest counter in the window is still remembered */
+  init_info(&info, 1000);
+  expect(&info, 1000 + W - 1, 0, ACCEPTED);
+  expect(&info, 1000, 0, REJECTED_REPLAYED);
+  expect(&info, 1001, 0, ACCEPTED_OUT_OF_ORDER);
+  /* and drops out when the window moves on */
+  expect(&info, 1000 + W, 0, ACCEPTED);
+  expect(&info, 1000, 0, REJECTED_TOO_OLD);
+  expect(&info, 1001, 0, REJECTED_REPLAYED);
+  expect(&info, 1002, 0, ACCEPTED_OUT_OF_ORDER);
+  expect(&info, 999, 0, REJECTED_TOO_OLD);
+
+  /* a jump over the whole window forgets all counters before it */
+  init_info(&info, 1000);
+  for(c = 1001; c < 1000 + W; c++) {
+    expect(&info, c, 0, ACCEPTED);
+  }
+  expect(&info, 1000 + 3 * W, 0, ACCEPTED);
+  for(c = 1000 + 2 * W + 1; c < 1000 + 3 * W; c++) {
+    expect(&info, c, 0, ACCEPTED_OUT_OF_ORDER);
+    expect(&info, c, 0, REJECTED_REPLAYED);
+  }
+  expect(&info, 1000 + 2 * W, 0, REJECTED_TOO_OLD);
+  expect(&info, 1000 + W - 1, 0, REJECTED_TOO_OLD);
+
+  /* so does a jump by exactly the window size */
+  init_info(&info, 1000);
+  expect(&info, 1000 + W, 0, ACCEPTED);
+  expect(&info, 1001, 0, ACCEPTED_OUT_OF_ORDER);
+  expect(&info, 1000, 0, REJECTED_TOO_OLD);
+
+  /* the broadcast window is kept apart from the unicast window */
+  init_info(&info, 1000);
+  expect(&info, 1010, 0, ACCEPTED);
+  expect(&info, 1008, 1, ACCEPTED);
+  expect(&info, 1009, 0, ACCEPTED_OUT_OF_ORDER);
+  expect(&info, 1009, 1, ACCEPTED);
+  expect(&info, 1008, 0, ACCEPTED_OUT_OF_ORDER);
+  expect(&info, 1008, 1, REJECTED_REPLAYED);
+}
+#else /* W */
+static void
+check_window(void)
+{
+  struct anti_replay_info info;
+
+  /* without a window, any counter below the last one is too old */
+  init_info(&info, 1000);
+  expect(&info, 1005, 0, ACCEPTED);
+  expect(&info, 1003, 0, REJECTED_TOO_OLD);
+  expect(&info, 1004, 0, REJECTED_TOO_OLD);
+  expect(&info, 1006, 0, ACCEPTED);
+  expect(&info, 999, 0, REJECTED_TOO_OLD);
+}
+#endif /* W */
+/*---------------------------------------------------------------------------*/
+/* A stream in which every other pair of frames is swapped */
+static void
+bench_stream(void)
+{
+  struct anti_replay_info info;
+  uint64_t total;
+  uint64_t start;
+  unsigned long accepted;
+  uint32_t c;
+
+  init_info(&info, 0);
+  accepted = 0;
+  total = 0;
+  for(c = 1; c <= FRAMES; c++) {
+    set_frame(c % 4 == 1 ? c + 1 : c % 4 == 2 ? c - 1 : c, 0);
+    start = bench_now_ns();
+    accepted += !anti_replay_was_replayed(&info);
+    total += bench_now_ns() - start;
+  }
+  bench_report("reordered stream", W, total, FRAMES);
+  if(accepted != (W ? FRAMES : FRAMES - FRAMES / 4)) {
+    printf("anti-replay-bench: %lu frames accepted\n", accepted);
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(anti_replay_bench_process, "Anti-replay benchmark");
+AUTOSTART_PROCESSES(&anti_replay_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(anti_replay_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("anti-replay-bench: %u bit window\n", W);
+
+  check_in_order();
+  check_window();
+  bench_stream();
+
+  printf("anti-replay-bench: all checks passed\n");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
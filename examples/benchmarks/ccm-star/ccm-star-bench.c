@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Secures and unsecures 127 byte IEEE 802.15.4 frames with CCM*,
+ *         alternating between two keys like TSCH does for EBs and data
+ *         frames. Build with MAKE_WITH_SINGLE_PASS=1 for the single-pass
+ *         CCM* and cached key schedules.
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+#include "lib/ccm-star.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define FRAME_ROUNDS 20000
+#define FRAME_LEN 127
+
+/* RFC 3610, packet vector #1 */
+static const uint8_t ccm_key[16] = {
+  0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+  0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf
+};
+static const uint8_t ccm_nonce[CCM_STAR_NONCE_LENGTH] = {
+  0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00,
+  0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5
+};
+static const uint8_t ccm_header[8] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07
+};
+static const uint8_t ccm_plaintext[23] = {
+  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+  0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+  0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e
+};
+static const uint8_t ccm_ciphertext[23] = {
+  0x58, 0x8c, 0x97, 0x9a, 0x61, 0xc6, 0x63, 0xd2,
+  0xf0, 0x66, 0xd0, 0xc2, 0xc0, 0xf9, 0x89, 0x80,
+  0x6d, 0x5f, 0x6b, 0x61, 0xda, 0xc3, 0x84
+};
+static const uint8_t ccm_mic[8] = {
+  0x17, 0xe8, 0xd1, 0x2c, 0xfd, 0xf9, 0x26, 0xe0
+};
+
+/* The TSCH default keys for EBs (key index 1) and other frames (index 2) */
+static const uint8_t eb_key[16] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t data_key[16] = {
+  0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+  0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f
+};
+
+/*
+ * A frame: the first hdr_len bytes are authenticated only, the rest up
+ * to the MIC are encrypted as well
+ */
+struct frame {
+  const char *name;
+  const uint8_t *key;
+  uint8_t hdr_len;
+  uint8_t mic_len;
+  uint8_t buf[FRAME_LEN];
+};
+
+static struct frame frames[] = {
+  /* Security level 1 (MIC-32) */
+  { "eb", eb_key, FRAME_LEN - 4, 4 },
+  /* Security level 5 (ENC-MIC-32) after a 23 byte header */
+  { "data", data_key, 23, 4 },
+  /* Security level 7 (ENC-MIC-128) */
+  { "data-mic128", data_key, 23, 16 },
+};
+#define FRAMES (sizeof(frames) / sizeof(frames[0]))
+
+static int failures;
+/*---------------------------------------------------------------------------*/
+static void
+check(const char *name, const uint8_t *result, const uint8_t *expected,
+      int len)
+{
+  if(memcmp(result, expected, len) != 0) {
+    printf("ccm-star-bench: %s failed\n", name);
+    failures++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+known_answer_tests(void)
+{
+  uint8_t buf[sizeof(ccm_plaintext)];
+  uint8_t mic[sizeof(ccm_mic)];
+
+  CCM_STAR.set_key(ccm_key);
+  memcpy(buf, ccm_plaintext, sizeof(buf));
+  CCM_STAR.aead(ccm_nonce, buf, sizeof(buf),
+                ccm_header, sizeof(ccm_header), mic, sizeof(mic), 1);
+  check("encryption", buf, ccm_ciphertext, sizeof(buf));
+  check("encryption mic", mic, ccm_mic, sizeof(mic));
+  CCM_STAR.aead(ccm_nonce, buf, sizeof(buf),
+                ccm_header, sizeof(ccm_header), mic, sizeof(mic), 0);
+  check("decryption", buf, ccm_plaintext, sizeof(buf));
+  check("decryption mic", mic, ccm_mic, sizeof(mic));
+}
+/*---------------------------------------------------------------------------*/
+static void
+secure(struct frame *f, const uint8_t *nonce)
+{
+  uint8_t data_len = FRAME_LEN - f->hdr_len - f->mic_len;
+
+  CCM_STAR.set_key(f->key);
+  CCM_STAR.aead(nonce, f->buf + f->hdr_len, data_len,
+                f->buf, f->hdr_len, f->buf + FRAME_LEN - f->mic_len,
+                f->mic_len, 1);
+}
+/*---------------------------------------------------------------------------*/
+static int
+unsecure(struct frame *f, const uint8_t *nonce)
+{
+  uint8_t data_len = FRAME_LEN - f->hdr_len - f->mic_len;
+  uint8_t mic[16];
+
+  CCM_STAR.set_key(f->key);
+  CCM_STAR.aead(nonce, f->buf + f->hdr_len, data_len,
+                f->buf, f->hdr_len, mic, f->mic_len, 0);
+  return memcmp(mic, f->buf + FRAME_LEN - f->mic_len, f->mic_len) == 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+round_trip_tests(void)
+{
+  uint8_t plaintext[FRAME_LEN];
+  unsigned f;
+  int i;
+
+  for(f = 0; f < FRAMES; f++) {
+    for(i = 0; i < FRAME_LEN; i++) {
+      frames[f].buf[i] = plaintext[i] = i * 7 + f;
+    }
+    secure(&frames[f], ccm_nonce);
+    if(!unsecure(&frames[f], ccm_nonce)) {
+      printf("ccm-star-bench: %s mic mismatch\n", frames[f].name);
+      failures++;
+    }
+    check(frames[f].name, frames[f].buf, plaintext,
+          FRAME_LEN - frames[f].mic_len);
+
+    /* A flipped bit must fail the check */
+    secure(&frames[f], ccm_nonce);
+    frames[f].buf[FRAME_LEN / 2] ^= 1;
+    if(unsecure(&frames[f], ccm_nonce)) {
+      printf("ccm-star-bench: %s tampering not detected\n", frames[f].name);
+      failures++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_frames(void)
+{
+  uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+  char name[32];
+  uint64_t start;
+  unsigned f;
+  long i;
+
+  memcpy(nonce, ccm_nonce, sizeof(nonce));
+
+  for(f = 0; f < FRAMES; f++) {
+    start = bench_now_ns();
+    for(i = 0; i < FRAME_ROUNDS; i++) {
+      nonce[12] = i;
+      secure(&frames[f], nonce);
+    }
+    snprintf(name, sizeof(name), "secure/%s", frames[f].name);
+    bench_report(name, FRAME_LEN, bench_now_ns() - start, FRAME_ROUNDS);
+
+    start = bench_now_ns();
+    for(i = 0; i < FRAME_ROUNDS; i++) {
+      nonce[12] = i;
+      unsecure(&frames[f], nonce);
+    }
+    snprintf(name, sizeof(name), "unsecure/%s", frames[f].name);
+    bench_report(name, FRAME_LEN, bench_now_ns() - start, FRAME_ROUNDS);
+  }
+
+  /* EBs and data frames interleaved, each switching the key */
+  start = bench_now_ns();
+  for(i = 0; i < FRAME_ROUNDS; i++) {
+    nonce[12] = i;
+    secure(&frames[i & 1], nonce);
+  }
+  bench_report("secure/interleaved", FRAME_LEN, bench_now_ns() - start,
+               FRAME_ROUNDS);
+
+  start = bench_now_ns();
+  for(i = 0; i < FRAME_ROUNDS; i++) {
+    nonce[12] = i;
+    unsecure(&frames[i & 1], nonce);
+  }
+  bench_report("unsecure/interleaved", FRAME_LEN, bench_now_ns() - start,
+               FRAME_ROUNDS);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(ccm_star_bench_process, "CCM* benchmark");
+AUTOSTART_PROCESSES(&ccm_star_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ccm_star_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  known_answer_tests();
+  round_trip_tests();
+  if(failures) {
+    exit(1);
+  }
+  bench_frames();
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
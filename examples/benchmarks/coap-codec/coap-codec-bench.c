@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for coap_parse_message() and coap_serialize_message()
+ *         over a corpus of typical CoAP requests and responses. Build
+ *         with MAKE_WITH_LAZY_OPTIONS=1 to measure lazy option decoding
+ *         and the serialization fast path. Also checks that
+ *         coap_serialize_notification() produces the same bytes as
+ *         coap_serialize_message().
+ */
+
+#include "contiki.h"
+#include "er-coap.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define ROUNDS 100000
+
+struct frame {
+  const char *name;
+  uint16_t len;
+  uint8_t data[96];
+};
+
+/* Requests and responses as seen on the wire, with their Tokens */
+static const struct frame corpus[] = {
+  { "GET /sensors/temp", 21,
+    { 0x44, 0x01, 0x1a, 0x2b, 0x11, 0x22, 0x33, 0x44, 0xb7, 0x73, 0x65,
+      0x6e, 0x73, 0x6f, 0x72, 0x73, 0x04, 0x74, 0x65, 0x6d, 0x70 }
+  },
+  { "GET observe /test/push", 18,
+    { 0x42, 0x01, 0x1a, 0x2c, 0x5a, 0x5b, 0x60, 0x54, 0x74, 0x65, 0x73,
+      0x74, 0x04, 0x70, 0x75, 0x73, 0x68, 0x60 }
+  },
+  { "GET /.well-known/core?rt", 39,
+    { 0x42, 0x01, 0x1a, 0x2d, 0x01, 0x02, 0xbb, 0x2e, 0x77, 0x65, 0x6c,
+      0x6c, 0x2d, 0x6b, 0x6e, 0x6f, 0x77, 0x6e, 0x04, 0x63, 0x6f, 0x72,
+      0x65, 0x4d, 0x01, 0x72, 0x74, 0x3d, 0x74, 0x65, 0x6d, 0x70, 0x65,
+      0x72, 0x61, 0x74, 0x75, 0x72, 0x65 }
+  },
+  { "POST /actuators/leds?color", 44,
+    { 0x48, 0x02, 0x1a, 0x2e, 0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70,
+      0x80, 0xb9, 0x61, 0x63, 0x74, 0x75, 0x61, 0x74, 0x6f, 0x72, 0x73,
+      0x04, 0x6c, 0x65, 0x64, 0x73, 0x10, 0x37, 0x63, 0x6f, 0x6c, 0x6f,
+      0x72, 0x3d, 0x72, 0xff, 0x6d, 0x6f, 0x64, 0x65, 0x3d, 0x6f, 0x6e }
+  },
+  { "PUT block1", 96,
+    { 0x44, 0x03, 0x1a, 0x2f, 0xaa, 0xbb, 0xcc, 0xdd, 0xb4, 0x74, 0x65,
+      0x73, 0x74, 0x0c, 0x6c, 0x61, 0x72, 0x67, 0x65, 0x2d, 0x75, 0x70,
+      0x64, 0x61, 0x74, 0x65, 0x11, 0x2a, 0xd1, 0x02, 0x3a, 0xff, 0x00,
+      0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b,
+      0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+      0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21,
+      0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c,
+      0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+      0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f }
+  },
+  { "ACK 2.05 text", 18,
+    { 0x64, 0x45, 0x1a, 0x2b, 0x11, 0x22, 0x33, 0x44, 0xc0, 0x21, 0x3c,
+      0xff, 0x32, 0x32, 0x2e, 0x35, 0x20, 0x43 }
+  },
+  { "NON 2.05 notification", 22,
+    { 0x52, 0x45, 0x70, 0x01, 0x5a, 0x5b, 0x62, 0x04, 0xd2, 0x61, 0x32,
+      0xff, 0x7b, 0x22, 0x74, 0x22, 0x3a, 0x32, 0x32, 0x2e, 0x35, 0x7d }
+  },
+  { "ACK 2.05 block2", 80,
+    { 0x64, 0x45, 0x1a, 0x30, 0x01, 0x02, 0x03, 0x04, 0xc1, 0x28, 0xb1,
+      0x2a, 0x52, 0x04, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00 }
+  },
+  { "empty ACK", 4,
+    { 0x60, 0x00, 0x70, 0x01 }
+  },
+  { "GET host etag /a/b/c", 28,
+    { 0x41, 0x01, 0x1a, 0x31, 0x99, 0x3b, 0x65, 0x78, 0x61, 0x6d, 0x70,
+      0x6c, 0x65, 0x2e, 0x63, 0x6f, 0x6d, 0x14, 0xde, 0xad, 0xbe, 0xef,
+      0x71, 0x61, 0x01, 0x62, 0x01, 0x63 }
+  },
+};
+#define CORPUS_SIZE (sizeof(corpus) / sizeof(corpus[0]))
+
+static uint8_t buffer[COAP_MAX_PACKET_SIZE + 1];
+/*---------------------------------------------------------------------------*/
+/* Read the options that the engine and a typical resource handler read */
+static unsigned long
+access_options(coap_packet_t *pkt)
+{
+  const char *str;
+  const uint8_t *bytes;
+  unsigned int format;
+  uint32_t observe;
+  uint32_t num;
+  unsigned long sum;
+
+  sum = coap_get_header_uri_path(pkt, &str);
+  sum += coap_get_header_uri_query(pkt, &str);
+  sum += coap_get_header_etag(pkt, &bytes);
+  if(coap_get_header_content_format(pkt, &format)) {
+    sum += format;
+  }
+  if(coap_get_header_observe(pkt, &observe)) {
+    sum += observe;
+  }
+  if(coap_get_header_block2(pkt, &num, NULL, NULL, NULL)) {
+    sum += num;
+  }
+  return sum + coap_get_payload(pkt, &bytes);
+}
+/*---------------------------------------------------------------------------*/
+/* Print what was decoded, so that the backends can be compared */
+static void
+print_frame(int i)
+{
+  coap_packet_t pkt[1];
+  const char *str;
+  const uint8_t *bytes;
+  unsigned int format = 0;
+  uint32_t observe = 0;
+  uint32_t num = 0;
+  int len;
+
+  memcpy(buffer, corpus[i].data, corpus[i].len);
+  if(coap_parse_message(pkt, buffer, corpus[i].len) != NO_ERROR) {
+    printf("coap-codec-bench: could not parse %s\n", corpus[i].name);
+    exit(1);
+  }
+  printf("frame %d: %u.%02u", i, pkt->code >> 5, pkt->code & 0x1F);
+  if((len = coap_get_header_uri_host(pkt, &str)) > 0) {
+    printf(" host %.*s", len, str);
+  }
+  if((len = coap_get_header_uri_path(pkt, &str)) > 0) {
+    printf(" path %.*s", len, str);
+  }
+  if((len = coap_get_header_uri_query(pkt, &str)) > 0) {
+    printf(" query %.*s", len, str);
+  }
+  if((len = coap_get_header_etag(pkt, &bytes)) > 0) {
+    printf(" etag %d", len);
+  }
+  coap_get_header_content_format(pkt, &format);
+  coap_get_header_observe(pkt, &observe);
+  coap_get_header_block2(pkt, &num, NULL, NULL, NULL);
+  printf(" format %u observe %lu block2 %lu payload %d\n", format,
+         (unsigned long)observe, (unsigned long)num,
+         coap_get_payload(pkt, &bytes));
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_parse(void)
+{
+  coap_packet_t pkt[1];
+  uint64_t start;
+  uint64_t total_parse;
+  uint64_t total_access;
+  unsigned long sum;
+  unsigned long r;
+  int i;
+
+  sum = 0;
+  total_parse = 0;
+  total_access = 0;
+  for(r = 0; r < ROUNDS; r++) {
+    for(i = 0; i < CORPUS_SIZE; i++) {
+      /* parsing may rewrite the buffer, so start from a fresh copy */
+      memcpy(buffer, corpus[i].data, corpus[i].len);
+      start = bench_now_ns();
+      coap_parse_message(pkt, buffer, corpus[i].len);
+      total_parse += bench_now_ns() - start;
+      start = bench_now_ns();
+      sum += access_options(pkt);
+      total_access += bench_now_ns() - start;
+    }
+  }
+  bench_report("parse", CORPUS_SIZE, total_parse, ROUNDS * CORPUS_SIZE);
+  bench_report("parse+access", CORPUS_SIZE, total_parse + total_access,
+               ROUNDS * CORPUS_SIZE);
+  if(sum == 0) {
+    printf("coap-codec-bench: no options read\n");
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static size_t
+serialize_response(int shape, uint16_t mid)
+{
+  static const uint8_t token[] = { 0x5a, 0x5b, 0x5c, 0x5d };
+  static const char payload[] = "{\"e\":[{\"n\":\"temp\",\"v\":22.5}]}";
+  coap_packet_t pkt[1];
+
+  coap_init_message(pkt, COAP_TYPE_ACK, CONTENT_2_05, mid);
+  coap_set_token(pkt, token, sizeof(token));
+  coap_set_header_content_format(pkt, APPLICATION_JSON);
+  if(shape == 1) {
+    coap_set_header_observe(pkt, 1000 + mid);
+  } else if(shape == 2) {
+    coap_set_header_block2(pkt, 2, 1, 32);
+  } else if(shape == 3) {
+    coap_set_header_max_age(pkt, 60);
+    coap_set_header_location_path(pkt, "data/1");
+  }
+  coap_set_payload(pkt, payload, sizeof(payload) - 1);
+  return coap_serialize_message(pkt, buffer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_serialize(void)
+{
+  static const char *names[] = {
+    "serialize content", "serialize observe", "serialize block2",
+    "serialize other"
+  };
+  uint64_t start;
+  unsigned long r;
+  size_t len;
+  int shape;
+
+  for(shape = 0; shape < 4; shape++) {
+    len = 0;
+    start = bench_now_ns();
+    for(r = 0; r < ROUNDS; r++) {
+      len += serialize_response(shape, r);
+    }
+    bench_report(names[shape], shape, bench_now_ns() - start, ROUNDS);
+    if(len == 0) {
+      printf("coap-codec-bench: could not serialize\n");
+      exit(1);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Print the serialized shapes, so that the backends can be compared */
+static void
+print_shapes(void)
+{
+  size_t len;
+  int shape;
+  int i;
+
+  for(shape = 0; shape < 4; shape++) {
+    len = serialize_response(shape, 0x1234);
+    printf("shape %d:", shape);
+    for(i = 0; i < len; i++) {
+      printf(" %02x", buffer[i]);
+    }
+    printf("\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Serialize a notification of the given shape either in one go, or as a
+ * template without Token and Observe option that is completed by
+ * coap_serialize_notification(). A negative observe leaves the option out.
+ */
+static size_t
+serialize_notification(int shape, coap_message_type_t type, int32_t observe,
+                       int from_template, uint8_t *out)
+{
+  static const uint8_t token[] = { 0x5a, 0x5b, 0x5c, 0x5d };
+  static const uint8_t etag[] = { 0xde, 0xad, 0xbe, 0xef };
+  static const char payload[] = "{\"e\":[{\"n\":\"temp\",\"v\":22.5}]}";
+  static uint8_t template[COAP_MAX_PACKET_SIZE + 1];
+  coap_packet_t pkt[1];
+  size_t len;
+
+  coap_init_message(pkt, type, observe < 0 ? NOT_FOUND_4_04 : CONTENT_2_05,
+                    0x1234);
+  coap_set_header_content_format(pkt, APPLICATION_JSON);
+  if(shape == 1) {
+    coap_set_header_max_age(pkt, 60);
+  } else if(shape == 2) {
+    coap_set_header_block2(pkt, 2, 1, 32);
+  } else if(shape == 3) {
+    coap_set_header_etag(pkt, etag, sizeof(etag));
+    coap_set_header_location_path(pkt, "data/1");
+  }
+  coap_set_payload(pkt, payload, sizeof(payload) - 1);
+
+  if(!from_template) {
+    coap_set_token(pkt, token, sizeof(token));
+    if(observe >= 0) {
+      coap_set_header_observe(pkt, observe);
+    }
+    return coap_serialize_message(pkt, out);
+  }
+  len = coap_serialize_message(pkt, template);
+  return coap_serialize_notification(out, template, len, type, 0x1234,
+                                     token, sizeof(token), observe);
+}
+/*---------------------------------------------------------------------------*/
+/* Notifications completed from a template must equal the ones serialized
+   in one go, with Observe values of every option length */
+static void
+check_notifications(void)
+{
+  static const int32_t observes[] = { -1, 0, 5, 300, 70000 };
+  static uint8_t direct[COAP_MAX_PACKET_SIZE + 1];
+  static uint8_t patched[COAP_MAX_PACKET_SIZE + 1];
+  size_t direct_len;
+  size_t patched_len;
+  int shape;
+  int type;
+  int i;
+
+  for(shape = 0; shape < 4; shape++) {
+    for(type = COAP_TYPE_CON; type <= COAP_TYPE_NON; type++) {
+      for(i = 0; i < sizeof(observes) / sizeof(observes[0]); i++) {
+        direct_len = serialize_notification(shape, type, observes[i], 0,
+                                            direct);
+        patched_len = serialize_notification(shape, type, observes[i], 1,
+                                             patched);
+        if(direct_len == 0 || direct_len != patched_len
+           || memcmp(direct, patched, direct_len) != 0) {
+          printf("coap-codec-bench: notification shape %d type %d observe %ld"
+                 " differs from template\n", shape, type, (long)observes[i]);
+          exit(1);
+        }
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(coap_codec_bench_process, "CoAP codec benchmark");
+AUTOSTART_PROCESSES(&coap_codec_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coap_codec_bench_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("coap-codec-bench: %s\n",
+         COAP_LAZY_OPTIONS ? "lazy options" : "eager options");
+
+  for(i = 0; i < CORPUS_SIZE; i++) {
+    print_frame(i);
+  }
+  print_shapes();
+  check_notifications();
+
+  bench_parse();
+  bench_serialize();
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Checks and benchmark of the CoAP transaction and observer
+ *         tables: lookups by MID and by client, overflow counters and
+ *         batched notifications. Build with MAKE_WITH_TABLE_INDEX=1 to
+ *         use the hashed indices, and with MAKE_WITH_PACING=1 to check
+ *         that paced notifications share a single transaction slot.
+ */
+
+#include "contiki.h"
+#include "rest-engine.h"
+#include "er-coap.h"
+#include "er-coap-transactions.h"
+#include "er-coap-observe.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define ROUNDS 100000
+#define CLIENTS 3
+
+/* MIDs that all fall into the same bucket of the transaction index */
+#define TEST_MID(i) (0x100 + (i) * COAP_TRANSACTION_BUCKETS)
+
+static void res_get_handler(void *request, void *response, uint8_t *buffer,
+                            uint16_t preferred_size, int32_t *offset);
+
+static uint16_t mids[COAP_MAX_OBSERVERS];
+
+EVENT_RESOURCE(res_push, "obs", res_get_handler, NULL, NULL, NULL, NULL);
+/*---------------------------------------------------------------------------*/
+static void
+res_get_handler(void *request, void *response, uint8_t *buffer,
+                uint16_t preferred_size, int32_t *offset)
+{
+  REST.set_header_content_type(response, REST.type.TEXT_PLAIN);
+  REST.set_response_payload(response, "22.5 C", 6);
+}
+/*---------------------------------------------------------------------------*/
+static void
+fail(const char *msg, unsigned long value)
+{
+  printf("coap-tables-bench: %s (%lu)\n", msg, value);
+  exit(1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+client_addr(uip_ipaddr_t *addr, int i)
+{
+  uip_ip6addr(addr, 0xfd00, 0, 0, 0, 0, 0, 0, i % CLIENTS + 1);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+client_port(int i)
+{
+  return UIP_HTONS(COAP_DEFAULT_PORT + i / CLIENTS);
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_transactions(void)
+{
+  coap_transaction_t *t;
+  uip_ipaddr_t addr;
+  uint64_t start;
+  unsigned long r;
+  int found;
+  int i;
+
+  for(i = 0; i < COAP_MAX_OPEN_TRANSACTIONS; i++) {
+    client_addr(&addr, i);
+    if(coap_new_transaction(TEST_MID(i), &addr, client_port(i)) == NULL) {
+      fail("could not allocate transaction", i);
+    }
+  }
+  client_addr(&addr, 0);
+  if(coap_new_transaction(TEST_MID(i), &addr, client_port(0)) != NULL) {
+    fail("allocated more transactions than slots", i);
+  }
+  if(coap_stats.transactions_full != 1) {
+    fail("transactions_full not counted", coap_stats.transactions_full);
+  }
+
+  for(i = 0; i < COAP_MAX_OPEN_TRANSACTIONS; i++) {
+    t = coap_get_transaction_by_mid(TEST_MID(i));
+    client_addr(&addr, i);
+    if(t == NULL || t->mid != TEST_MID(i)
+       || !uip_ipaddr_cmp(&t->addr, &addr) || t->port != client_port(i)) {
+      fail("wrong transaction for MID", TEST_MID(i));
+    }
+    if(coap_get_transaction_by_mid(TEST_MID(i) + 1) != NULL) {
+      fail("found transaction for unused MID", TEST_MID(i) + 1);
+    }
+  }
+
+  found = 0;
+  start = bench_now_ns();
+  for(r = 0; r < ROUNDS; r++) {
+    found += coap_get_transaction_by_mid(TEST_MID(r % (i + 1))) != NULL;
+  }
+  bench_report("transaction lookup", COAP_MAX_OPEN_TRANSACTIONS,
+               bench_now_ns() - start, ROUNDS);
+  if(found != ROUNDS - ROUNDS / (i + 1)) {
+    fail("wrong number of transactions found", found);
+  }
+
+  /* clear every other one, the rest must still be found */
+  for(i = 0; i < COAP_MAX_OPEN_TRANSACTIONS; i += 2) {
+    coap_clear_transaction(coap_get_transaction_by_mid(TEST_MID(i)));
+  }
+  for(i = 0; i < COAP_MAX_OPEN_TRANSACTIONS; i++) {
+    t = coap_get_transaction_by_mid(TEST_MID(i));
+    if((t == NULL) != (i % 2 == 0)) {
+      fail("wrong transaction after clearing", TEST_MID(i));
+    }
+    coap_clear_transaction(t);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Register an observer the way a GET with Observe 0 from client i does */
+static int
+observe(int i)
+{
+  coap_packet_t request[1];
+  coap_packet_t response[1];
+  uint8_t token[2];
+
+  token[0] = 0xa0;
+  token[1] = i;
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, i);
+  coap_set_header_uri_path(request, res_push.url);
+  coap_set_header_observe(request, 0);
+  coap_set_token(request, token, sizeof(token));
+  coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, i);
+
+  uip_ext_len = 0;
+  client_addr(&UIP_IP_BUF->srcipaddr, i);
+  UIP_UDP_BUF->srcport = client_port(i);
+  coap_observe_handler(&res_push, request, response);
+  return response->code == CONTENT_2_05;
+}
+/*---------------------------------------------------------------------------*/
+static coap_observer_t *
+find_observer(int i)
+{
+  coap_observer_t *obs;
+  uip_ipaddr_t addr;
+
+  client_addr(&addr, i);
+  for(obs = list_head(coap_get_observers()); obs; obs = obs->next) {
+    if(uip_ipaddr_cmp(&obs->addr, &addr) && obs->port == client_port(i)) {
+      return obs;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_observers(void)
+{
+  int i;
+
+  for(i = 0; i < COAP_MAX_OBSERVERS; i++) {
+    if(!observe(i)) {
+      fail("could not add observer", i);
+    }
+  }
+  if(observe(i)) {
+    fail("added more observers than slots", i);
+  }
+  if(coap_stats.observers_full != 1) {
+    fail("observers_full not counted", coap_stats.observers_full);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if COAP_OBSERVE_PACING_INTERVAL
+/* Take all but one transaction slot, or give them back */
+static void
+hold_transactions(int hold)
+{
+  uip_ipaddr_t addr;
+  int i;
+
+  client_addr(&addr, 0);
+  for(i = 0; i < COAP_MAX_OPEN_TRANSACTIONS - 1; i++) {
+    if(hold) {
+      coap_new_transaction(0x8000 + i, &addr, 0);
+    } else {
+      coap_clear_transaction(coap_get_transaction_by_mid(0x8000 + i));
+    }
+  }
+}
+#endif /* COAP_OBSERVE_PACING_INTERVAL */
+/*---------------------------------------------------------------------------*/
+/* Every observer must have been sent one notification, all built from
+   one template */
+static void
+check_notified(void)
+{
+  coap_observer_t *obs;
+  int i;
+  int j;
+
+  for(i = 0; i < COAP_MAX_OBSERVERS; i++) {
+    obs = find_observer(i);
+    if(obs == NULL || obs->obs_counter != 2 || obs->last_mid == 0) {
+      fail("observer not notified", i);
+    }
+    mids[i] = obs->last_mid;
+    for(j = 0; j < i; j++) {
+      if(mids[j] == mids[i]) {
+        fail("notifications share a MID", mids[i]);
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_observers(void)
+{
+  uip_ipaddr_t addr;
+  uint8_t token[2];
+  uint64_t start;
+  unsigned long r;
+  int removed;
+  int i;
+
+  /* a MID that no observer has walks all observers of the client */
+  client_addr(&addr, 0);
+  start = bench_now_ns();
+  for(r = 0; r < ROUNDS; r++) {
+    removed = coap_remove_observer_by_mid(&addr, client_port(0), mids[0] + 1);
+    if(removed) {
+      fail("removed observer by unused MID", mids[0] + 1);
+    }
+  }
+  bench_report("observer lookup", COAP_MAX_OBSERVERS,
+               bench_now_ns() - start, ROUNDS);
+
+  token[0] = 0xa0;
+  token[1] = 1;
+  client_addr(&addr, 0);
+  if(coap_remove_observer_by_token(&addr, client_port(0), token,
+                                   sizeof(token)) != 0) {
+    fail("removed observer by the token of another client", 1);
+  }
+  client_addr(&addr, 1);
+  if(coap_remove_observer_by_token(&addr, client_port(1), token,
+                                   sizeof(token)) != 1
+     || find_observer(1) != NULL) {
+    fail("could not remove observer by token", 1);
+  }
+  client_addr(&addr, 2);
+  if(coap_remove_observer_by_mid(&addr, client_port(2), mids[2]) != 1
+     || find_observer(2) != NULL) {
+    fail("could not remove observer by MID", mids[2]);
+  }
+
+  /* client 0 also observes from another port, which must stay */
+  client_addr(&addr, 0);
+  if(coap_remove_observer_by_client(&addr, client_port(0)) != 1
+     || find_observer(0) != NULL || find_observer(CLIENTS) == NULL) {
+    fail("could not remove observers by client", 0);
+  }
+  if(list_length(coap_get_observers()) != COAP_MAX_OBSERVERS - 3) {
+    fail("wrong number of observers left",
+         list_length(coap_get_observers()));
+  }
+  for(i = CLIENTS; i < COAP_MAX_OBSERVERS; i++) {
+    client_addr(&addr, i);
+    if(coap_remove_observer_by_client(&addr, client_port(i)) != 1) {
+      fail("could not remove observer", i);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(coap_tables_bench_process, "CoAP tables benchmark");
+AUTOSTART_PROCESSES(&coap_tables_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coap_tables_bench_process, ev, data)
+{
+#if COAP_OBSERVE_PACING_INTERVAL
+  static struct etimer et;
+#endif /* COAP_OBSERVE_PACING_INTERVAL */
+
+  PROCESS_BEGIN();
+
+  printf("coap-tables-bench: %s, %s notifications\n",
+         COAP_TABLE_INDEX ? "hash index" : "lists",
+         COAP_OBSERVE_PACING_INTERVAL ? "paced" : "immediate");
+
+  rest_init_engine();
+  rest_activate_resource(&res_push, "test/push");
+  /* let the CoAP engine open its socket */
+  PROCESS_PAUSE();
+
+  check_transactions();
+  add_observers();
+
+#if COAP_OBSERVE_PACING_INTERVAL
+  /* paced notifications take a transaction slot only when they are sent,
+     so that a single free slot is enough for all of them */
+  hold_transactions(1);
+  coap_notify_observers(&res_push);
+  etimer_set(&et, (COAP_MAX_OBSERVERS + 1) * COAP_OBSERVE_PACING_INTERVAL);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  hold_transactions(0);
+  if(coap_stats.transactions_full != 1) {
+    fail("paced notification found no transaction slot",
+         coap_stats.transactions_full - 1);
+  }
+#else /* COAP_OBSERVE_PACING_INTERVAL */
+  coap_notify_observers(&res_push);
+#endif /* COAP_OBSERVE_PACING_INTERVAL */
+  check_notified();
+  remove_observers();
+
+  printf("coap-tables-bench: all checks passed\n");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Micro-benchmark for random reads and writes of a Coffee file
+ *         whose micro log fills from 0 to 100%. The storage is emulated
+ *         with a POSIX file. Build with MAKE_WITH_LOG_INDEX=1 to measure
+ *         the in-RAM log index instead of searching the log in storage.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "dev/xmem.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+/*---------------------------------------------------------------------------*/
+#define FILE_NAME    "relation"
+#define FILE_SIZE    8192
+#define RECORD_SIZE  32
+#define LOG_RECORDS  256
+#define IO_SIZE      8
+#define READS        2000
+#define WRITES       16
+
+/* The size of the storage in the native Coffee configuration */
+#define XMEM_SIZE    (1024UL * 1024UL)
+
+static int storage = -1;
+static unsigned char shadow[FILE_SIZE];
+static int fd;
+static int records;
+/*---------------------------------------------------------------------------*/
+void
+xmem_init(void)
+{
+  FILE *f;
+
+  f = tmpfile();
+  if(f == NULL) {
+    perror("coffee-log-bench: tmpfile");
+    exit(1);
+  }
+  storage = fileno(f);
+}
+/*---------------------------------------------------------------------------*/
+int
+xmem_pread(void *buf, int nbytes, unsigned long offset)
+{
+  memset(buf, 0, nbytes);
+  if(pread(storage, buf, nbytes, offset) < 0) {
+    perror("coffee-log-bench: pread");
+    exit(1);
+  }
+  return nbytes;
+}
+/*---------------------------------------------------------------------------*/
+int
+xmem_pwrite(const void *buf, int nbytes, unsigned long offset)
+{
+  if(pwrite(storage, buf, nbytes, offset) != nbytes) {
+    perror("coffee-log-bench: pwrite");
+    exit(1);
+  }
+  return nbytes;
+}
+/*---------------------------------------------------------------------------*/
+int
+xmem_erase(long nbytes, unsigned long offset)
+{
+  static const unsigned char zeroes[4096];
+  long done;
+
+  for(done = 0; done < nbytes; done += sizeof(zeroes)) {
+    xmem_pwrite(zeroes, sizeof(zeroes), offset + done);
+  }
+  return nbytes;
+}
+/*---------------------------------------------------------------------------*/
+static void
+random_write(void)
+{
+  unsigned char buf[IO_SIZE];
+  cfs_offset_t offset;
+  int i;
+
+  offset = (random() % (FILE_SIZE / RECORD_SIZE)) * RECORD_SIZE +
+    random() % (RECORD_SIZE - IO_SIZE + 1);
+  for(i = 0; i < IO_SIZE; i++) {
+    /* Coffee cannot tell zeroes at the end of a file from free space. */
+    buf[i] = 1 + random() % 255;
+  }
+
+  if(cfs_seek(fd, offset, CFS_SEEK_SET) != offset ||
+     cfs_write(fd, buf, IO_SIZE) != IO_SIZE) {
+    printf("coffee-log-bench: write failed\n");
+    exit(1);
+  }
+  memcpy(&shadow[offset], buf, IO_SIZE);
+  records++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+random_read(void)
+{
+  unsigned char buf[IO_SIZE];
+  cfs_offset_t offset;
+
+  offset = (random() % (FILE_SIZE / RECORD_SIZE)) * RECORD_SIZE +
+    random() % (RECORD_SIZE - IO_SIZE + 1);
+
+  if(cfs_seek(fd, offset, CFS_SEEK_SET) != offset ||
+     cfs_read(fd, buf, IO_SIZE) != IO_SIZE ||
+     memcmp(buf, &shadow[offset], IO_SIZE) != 0) {
+    printf("coffee-log-bench: read mismatch at offset %ld\n", (long)offset);
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+create_file(void)
+{
+  int i;
+
+  if(cfs_coffee_format() < 0 ||
+     cfs_coffee_reserve(FILE_NAME, FILE_SIZE) < 0 ||
+     cfs_coffee_configure_log(FILE_NAME, LOG_RECORDS * RECORD_SIZE,
+                              RECORD_SIZE) < 0) {
+    printf("coffee-log-bench: cannot create the file\n");
+    exit(1);
+  }
+
+  fd = cfs_open(FILE_NAME, CFS_READ | CFS_WRITE);
+  for(i = 0; i < FILE_SIZE; i++) {
+    shadow[i] = 1 + random() % 255;
+  }
+  if(fd < 0 || cfs_write(fd, shadow, FILE_SIZE) != FILE_SIZE) {
+    printf("coffee-log-bench: cannot write the file\n");
+    exit(1);
+  }
+  records = 0;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(coffee_log_bench_process, "Coffee micro log benchmark");
+AUTOSTART_PROCESSES(&coffee_log_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_log_bench_process, ev, data)
+{
+  static const int fill_levels[] = { 0, 25, 50, 75, 100 };
+  uint64_t start;
+  int i, level, target;
+
+  PROCESS_BEGIN();
+
+#if COFFEE_CONF_LOG_INDEX
+  printf("coffee-log-bench: in-RAM log index\n");
+#else
+  printf("coffee-log-bench: log search in storage\n");
+#endif
+
+  xmem_init();
+  srandom(1);
+  create_file();
+
+  for(level = 0; level < sizeof(fill_levels) / sizeof(fill_levels[0]); level++) {
+    /* Leave room for the timed writes, so that the log is not merged. */
+    target = LOG_RECORDS * fill_levels[level] / 100;
+    if(target > LOG_RECORDS - WRITES) {
+      target = LOG_RECORDS - WRITES;
+    }
+    while(records < target) {
+      random_write();
+    }
+
+    start = bench_now_ns();
+    for(i = 0; i < READS; i++) {
+      random_read();
+    }
+    bench_report("read", fill_levels[level], bench_now_ns() - start, READS);
+
+    start = bench_now_ns();
+    for(i = 0; i < WRITES; i++) {
+      random_write();
+    }
+    bench_report("write", fill_levels[level], bench_now_ns() - start, WRITES);
+  }
+
+  cfs_close(fd);
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for ip64_addrmap_lookup() and ip64_addrmap_lookup_port()
+ *         with 250 mappings, as on a busy NAT64 gateway. Hits, misses,
+ *         recycling and expiry are checked along the way, so both table
+ *         variants are held to the same results. Build with
+ *         MAKE_WITH_HASH=1 to measure the hash-indexed table.
+ */
+
+#include "contiki.h"
+#include "lib/list.h"
+#include "ip64-addrmap.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+/*---------------------------------------------------------------------------*/
+#define NUM_MAPPINGS 250
+#define LOOKUPS 20000
+#define EXPIRED 10
+
+#define PROTO_UDP 17
+#define LIFETIME(i) ((1000 + (i)) * CLOCK_SECOND)
+
+static struct ip64_addrmap_entry *mappings[NUM_MAPPINGS];
+/*---------------------------------------------------------------------------*/
+/* Flow i from a node in the 6LoWPAN to a server on the IPv4 side */
+static void
+flow(unsigned long i, uip_ip6addr_t *ip6addr, uint16_t *ip6port,
+     uip_ip4addr_t *ip4addr, uint16_t *ip4port)
+{
+  uip_ip6addr(ip6addr, 0xaaaa, 0, 0, 0, 0x0212, 0x7400, 0, (i % 50) + 1);
+  *ip6port = UIP_HTONS(5683 + i / 50);
+  uip_ipaddr(ip4addr, 192, 0, 2, 1 + i % 7);
+  *ip4port = UIP_HTONS(5683);
+}
+/*---------------------------------------------------------------------------*/
+static struct ip64_addrmap_entry *
+lookup(unsigned long i)
+{
+  uip_ip6addr_t ip6addr;
+  uip_ip4addr_t ip4addr;
+  uint16_t ip6port, ip4port;
+
+  flow(i, &ip6addr, &ip6port, &ip4addr, &ip4port);
+  return ip64_addrmap_lookup(&ip6addr, ip6port, &ip4addr, ip4port, PROTO_UDP);
+}
+/*---------------------------------------------------------------------------*/
+static struct ip64_addrmap_entry *
+create(unsigned long i)
+{
+  uip_ip6addr_t ip6addr;
+  uip_ip4addr_t ip4addr;
+  uint16_t ip6port, ip4port;
+  struct ip64_addrmap_entry *m;
+
+  flow(i, &ip6addr, &ip6port, &ip4addr, &ip4port);
+  m = ip64_addrmap_create(&ip6addr, ip6port, &ip4addr, ip4port, PROTO_UDP);
+  if(m == NULL) {
+    printf("ip64-addrmap-bench: could not create mapping %lu\n", i);
+    exit(1);
+  }
+  /* The oldest mapping is the first one */
+  ip64_addrmap_set_lifetime(m, LIFETIME(i));
+  ip64_addrmap_set_recycleble(m);
+  return m;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+count_mappings(void)
+{
+  struct ip64_addrmap_entry *m;
+  unsigned long n;
+
+  n = 0;
+  for(m = ip64_addrmap_list(); m != NULL; m = list_item_next(m)) {
+    n++;
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+check(int ok, const char *what)
+{
+  if(!ok) {
+    printf("ip64-addrmap-bench: %s\n", what);
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(ip64_addrmap_bench_process, "IP64 address map benchmark");
+AUTOSTART_PROCESSES(&ip64_addrmap_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ip64_addrmap_bench_process, ev, data)
+{
+  static struct etimer et;
+  static unsigned long i;
+  static unsigned long found;
+  static uint64_t start;
+  struct ip64_addrmap_entry *m;
+
+  PROCESS_BEGIN();
+
+  printf("ip64-addrmap-bench: %s\n",
+         IP64_ADDRMAP_HASH ? "hash index" : "linear scan");
+
+  ip64_addrmap_init();
+  for(i = 0; i < NUM_MAPPINGS; i++) {
+    mappings[i] = create(i);
+  }
+  check(count_mappings() == NUM_MAPPINGS, "wrong number of mappings");
+
+  /* Outgoing packets of known flows */
+  found = 0;
+  start = bench_now_ns();
+  for(i = 0; i < LOOKUPS; i++) {
+    if(lookup((i * 7919) % NUM_MAPPINGS) == mappings[(i * 7919) % NUM_MAPPINGS]) {
+      found++;
+    }
+  }
+  bench_report("lookup hit", NUM_MAPPINGS, bench_now_ns() - start, LOOKUPS);
+  check(found == LOOKUPS, "lookup of a known flow failed");
+
+  /* Incoming packets to mapped ports */
+  found = 0;
+  start = bench_now_ns();
+  for(i = 0; i < LOOKUPS; i++) {
+    m = mappings[(i * 7919) % NUM_MAPPINGS];
+    if(ip64_addrmap_lookup_port(m->mapped_port, PROTO_UDP) == m) {
+      found++;
+    }
+  }
+  bench_report("lookup port", NUM_MAPPINGS, bench_now_ns() - start, LOOKUPS);
+  check(found == LOOKUPS, "lookup of a mapped port failed");
+
+  /* Outgoing packets of new flows */
+  found = 0;
+  start = bench_now_ns();
+  for(i = 0; i < LOOKUPS; i++) {
+    if(lookup(NUM_MAPPINGS + i % 1000) != NULL) {
+      found++;
+    }
+  }
+  bench_report("lookup miss", NUM_MAPPINGS, bench_now_ns() - start, LOOKUPS);
+  check(found == 0, "lookup of an unknown flow succeeded");
+  check(ip64_addrmap_lookup_port(9999, PROTO_UDP) == NULL,
+        "lookup of an unmapped port succeeded");
+
+  check(ip64_addrmap_stats.hits == 2 * LOOKUPS &&
+        ip64_addrmap_stats.misses == LOOKUPS + 1,
+        "wrong lookup statistics");
+
+  /* A full table recycles the mapping with the least lifetime left */
+  mappings[0] = create(NUM_MAPPINGS);
+  check(ip64_addrmap_stats.recycled == 1, "no mapping recycled");
+  check(lookup(0) == NULL, "the oldest mapping was not recycled");
+  check(lookup(NUM_MAPPINGS) == mappings[0], "the new mapping is missing");
+  check(count_mappings() == NUM_MAPPINGS, "wrong number of mappings");
+
+  /* Expired mappings are not used, and are thrown away by the next
+     lookup or by the periodic check at the latest */
+  for(i = 1; i <= EXPIRED; i++) {
+    ip64_addrmap_set_lifetime(mappings[i], 0);
+  }
+  check(lookup(1) == NULL, "an expired mapping was used");
+  check(ip64_addrmap_lookup_port(mappings[2]->mapped_port, PROTO_UDP) == NULL,
+        "an expired mapped port was used");
+  etimer_set(&et, CLOCK_SECOND / 2);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  check(lookup(3) == NULL, "an expired mapping was used");
+  check(count_mappings() == NUM_MAPPINGS - EXPIRED,
+        "expired mappings were kept");
+  for(i = EXPIRED + 1; i < NUM_MAPPINGS; i++) {
+    check(lookup(i) == mappings[i], "a live mapping was thrown away");
+  }
+
+  printf("ip64-addrmap-bench: %lu hits, %lu misses, %lu recycled\n",
+         (unsigned long)ip64_addrmap_stats.hits,
+         (unsigned long)ip64_addrmap_stats.misses,
+         (unsigned long)ip64_addrmap_stats.recycled);
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
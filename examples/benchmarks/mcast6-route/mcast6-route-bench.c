@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for uip_mcast6_route_lookup() with 64 routes, for
+ *         datagrams to groups with and without a route. Every result is
+ *         checked against the groups that were added, also after half of
+ *         the routes have been removed. Build with MAKE_WITH_HASH=1 to
+ *         measure the hash index over the routing table.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/multicast/uip-mcast6-route.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+/*---------------------------------------------------------------------------*/
+#define NUM_ROUTES 64
+#define NUM_GROUPS (2 * NUM_ROUTES)
+#define LOOKUPS 20000
+
+static uip_mcast6_route_t *routes[NUM_GROUPS];
+/*---------------------------------------------------------------------------*/
+/* Site-local groups, the even ones get a route */
+static void
+group_addr(uip_ipaddr_t *addr, unsigned long i)
+{
+  uip_ip6addr(addr, 0xff15, 0, 0, 0, 0, 0, 0x89, 0xabc0 + i);
+}
+/*---------------------------------------------------------------------------*/
+/* Look up every group and compare with the routes that should exist */
+static void
+check_routes(const char *what)
+{
+  uip_ipaddr_t addr;
+  uip_mcast6_route_t *r;
+  int expected;
+  int i;
+
+  expected = 0;
+  for(i = 0; i < NUM_GROUPS; i++) {
+    group_addr(&addr, i);
+    r = uip_mcast6_route_lookup(&addr);
+    if(r != routes[i] ||
+       (r != NULL && !uip_ipaddr_cmp(&r->group, &addr))) {
+      printf("mcast6-route-bench: wrong route for group %d %s\n", i, what);
+      exit(1);
+    }
+    if(routes[i] != NULL) {
+      expected++;
+    }
+  }
+  if(uip_mcast6_route_count() != expected) {
+    printf("mcast6-route-bench: %d routes %s, expected %d\n",
+           uip_mcast6_route_count(), what, expected);
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(const char *name, int num_routes)
+{
+  uip_ipaddr_t addr;
+  uint64_t start;
+  unsigned long i;
+  unsigned long found;
+  unsigned long members;
+
+  /* Datagrams to all groups in turn, half of them with a route */
+  found = 0;
+  members = 0;
+  start = bench_now_ns();
+  for(i = 0; i < LOOKUPS; i++) {
+    group_addr(&addr, (i * 7919) % NUM_GROUPS);
+    if(uip_mcast6_route_lookup(&addr) != NULL) {
+      found++;
+    }
+  }
+  bench_report(name, num_routes, bench_now_ns() - start, LOOKUPS);
+
+  for(i = 0; i < LOOKUPS; i++) {
+    if(routes[(i * 7919) % NUM_GROUPS] != NULL) {
+      members++;
+    }
+  }
+  if(found != members) {
+    printf("mcast6-route-bench: %lu routes found, expected %lu\n",
+           found, members);
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(mcast6_route_bench_process, "Multicast route benchmark");
+AUTOSTART_PROCESSES(&mcast6_route_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mcast6_route_bench_process, ev, data)
+{
+  uip_ipaddr_t addr;
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("mcast6-route-bench: %s\n",
+         UIP_MCAST6_ROUTE_HASH ? "hash index" : "linear scan");
+
+  uip_mcast6_route_init();
+  for(i = 0; i < NUM_GROUPS; i += 2) {
+    group_addr(&addr, i);
+    routes[i] = uip_mcast6_route_add(&addr);
+    if(routes[i] == NULL) {
+      printf("mcast6-route-bench: could not add route %d\n", i);
+      exit(1);
+    }
+  }
+  group_addr(&addr, NUM_GROUPS);
+  if(uip_mcast6_route_add(&addr) != NULL) {
+    printf("mcast6-route-bench: added a route to a full table\n");
+    exit(1);
+  }
+  group_addr(&addr, 0);
+  if(uip_mcast6_route_add(&addr) != routes[0]) {
+    printf("mcast6-route-bench: added a route twice\n");
+    exit(1);
+  }
+  check_routes("after adding");
+  run("lookup", NUM_ROUTES);
+
+  /* Every other route expires */
+  for(i = 0; i < NUM_GROUPS; i += 4) {
+    uip_mcast6_route_rm(routes[i]);
+    routes[i] = NULL;
+  }
+  check_routes("after removing");
+  run("lookup", NUM_ROUTES / 2);
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Micro-benchmark for memb_alloc()/memb_free() at pool sizes
+ *         from 8 to 1024 blocks. Build with MAKE_WITH_BITMAP=1 to
+ *         measure the free-bitmap backend instead of the linear scan.
+ */
+
+#include "contiki.h"
+#include "lib/memb.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+/*---------------------------------------------------------------------------*/
+#define ROUNDS 20000
+
+struct block {
+  uint8_t payload[24];
+};
+
+MEMB(pool8, struct block, 8);
+MEMB(pool32, struct block, 32);
+MEMB(pool128, struct block, 128);
+MEMB(pool512, struct block, 512);
+MEMB(pool1024, struct block, 1024);
+
+static struct memb *pools[] = {
+  &pool8, &pool32, &pool128, &pool512, &pool1024
+};
+
+static void *blocks[1024];
+/*---------------------------------------------------------------------------*/
+static void
+run(struct memb *m)
+{
+  uint64_t start;
+  unsigned long i;
+  int n;
+
+  memb_init(m);
+
+  /* Fill the pool from empty. */
+  start = bench_now_ns();
+  for(n = 0; n < m->num; n++) {
+    blocks[n] = memb_alloc(m);
+  }
+  bench_report("fill", m->num, bench_now_ns() - start, m->num);
+
+  if(memb_alloc(m) != NULL || memb_numfree(m) != 0) {
+    printf("memb-bench: pool of %u not full after fill\n", m->num);
+    exit(1);
+  }
+
+  /* Steady state on a full pool: release one block and take it back.
+     The released block is at the end of the pool half of the time,
+     which is the worst case for a linear scan. */
+  start = bench_now_ns();
+  for(i = 0; i < ROUNDS; i++) {
+    n = (i & 1) ? m->num - 1 : (int)(i % m->num);
+    memb_free(m, blocks[n]);
+    blocks[n] = memb_alloc(m);
+  }
+  bench_report("free+alloc (full)", m->num, bench_now_ns() - start, ROUNDS);
+
+  /* Half-full pool with the free blocks at the end. */
+  for(n = m->num / 2; n < m->num; n++) {
+    memb_free(m, blocks[n]);
+  }
+  if(memb_numfree(m) != m->num - m->num / 2) {
+    printf("memb-bench: unexpected number of free blocks\n");
+    exit(1);
+  }
+  start = bench_now_ns();
+  for(i = 0; i < ROUNDS; i++) {
+    n = m->num / 2;
+    blocks[n] = memb_alloc(m);
+    memb_free(m, blocks[n]);
+  }
+  bench_report("alloc+free (half)", m->num, bench_now_ns() - start, ROUNDS);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(memb_bench_process, "memb benchmark");
+AUTOSTART_PROCESSES(&memb_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(memb_bench_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("memb-bench: %s backend\n",
+         MEMB_FREE_BITMAP ? "free bitmap" : "linear scan");
+
+  for(i = 0; i < sizeof(pools) / sizeof(pools[0]); i++) {
+    run(pools[i]);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
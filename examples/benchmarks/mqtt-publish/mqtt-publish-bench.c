@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for QoS 0 and QoS 1 mqtt_publish() with 16 byte to
+ *         4 kB payloads. The benchmark plays the part of uIP and of a
+ *         local broker that acknowledges every TCP segment at once, so
+ *         the MQTT engine and the TCP socket run unmodified. A PUBACK
+ *         is carried by the TCP ACK that completes its PUBLISH. Build
+ *         with MAKE_WITH_SCATTER_GATHER=1 to measure the segment list
+ *         path.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "mqtt.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define PUBLISHES 2000
+#define TOPIC "bench/publish"
+/* Steps without progress before a QoS 1 publish is given up */
+#define MAX_STEPS 100
+
+static const uint16_t payload_sizes[] = { 16, 256, 1024, 4096 };
+#define PAYLOAD_SIZES (sizeof(payload_sizes) / sizeof(payload_sizes[0]))
+
+static uint8_t payload[4096];
+static struct mqtt_connection conn;
+static unsigned long broker_bytes;
+static unsigned long puback_at;
+static uint8_t puback[4] = { 0x40, 0x02 };
+static unsigned long pubacks;
+
+PROCESS_NAME(tcp_socket_process);
+
+/* Internal to uIP, set up here the way uip_process() does */
+extern void *uip_sappdata;
+extern uint16_t uip_slen;
+/*---------------------------------------------------------------------------*/
+/* Run the socket's uIP callback as tcpip would for its connection */
+static void
+stack_call(uint8_t flags)
+{
+  uip_conn = conn.socket.c;
+  uip_flags = flags;
+  uip_slen = 0;
+  uip_sappdata = uip_appdata = &uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN];
+  if(flags & UIP_NEWDATA) {
+    memcpy(uip_appdata, puback, sizeof(puback));
+    uip_len = sizeof(puback);
+  }
+  process_post_synch(&tcp_socket_process, tcpip_event, &conn.socket);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Take everything the socket has to send and acknowledge it. The ACK that
+ * completes a QoS 1 PUBLISH also carries its PUBACK.
+ */
+static void
+broker_receive(void)
+{
+  stack_call(UIP_POLL);
+  while(uip_slen > 0) {
+    broker_bytes += uip_slen;
+    if(puback_at != 0 && broker_bytes >= puback_at) {
+      puback_at = 0;
+      stack_call(UIP_ACKDATA | UIP_NEWDATA);
+    } else {
+      stack_call(UIP_ACKDATA);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+broker_send(const uint8_t *data, int len)
+{
+  conn.socket.input_callback(&conn.socket, conn.socket.ptr, data, len);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+publish_len(uint32_t size, mqtt_qos_level_t qos)
+{
+  uint32_t remaining = 2 + strlen(TOPIC) + (qos > MQTT_QOS_LEVEL_0 ? 2 : 0) +
+    size;
+  unsigned long len = 1 + remaining;
+
+  do {
+    len++;
+    remaining /= 128;
+  } while(remaining > 0);
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
+{
+  if(event == MQTT_EVENT_PUBACK) {
+    pubacks++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Handle one event, then deliver what the MQTT process has sent. Events are
+ * dispatched here rather than by yielding to the main loop, which sleeps in
+ * select() between events on the native platform.
+ */
+static void
+step(void)
+{
+  process_run();
+  if(conn.socket.c != NULL) {
+    broker_receive();
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(mqtt_publish_bench_process, "MQTT publish benchmark");
+AUTOSTART_PROCESSES(&mqtt_publish_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mqtt_publish_bench_process, ev, data)
+{
+  static const uint8_t connack[] = { 0x20, 0x02, 0x00, 0x00 };
+  static unsigned i, j;
+  static uint64_t total;
+  static uint64_t start;
+  static unsigned long expected;
+  uint16_t mid;
+  unsigned steps;
+
+  PROCESS_BEGIN();
+
+  printf("mqtt-publish-bench: %s\n",
+         MQTT_SCATTER_GATHER ? "scatter-gather" : "output buffer copy");
+
+  for(i = 0; i < sizeof(payload); i++) {
+    payload[i] = i;
+  }
+
+  mqtt_register(&conn, PROCESS_CURRENT(), "bench", mqtt_event, UIP_TCP_MSS);
+  mqtt_connect(&conn, "fd00::1", 1883, 3600);
+  while(conn.socket.c == NULL) {
+    step();
+  }
+  stack_call(UIP_CONNECTED);
+  while(!conn.out_buffer_sent ||
+        conn.state != MQTT_CONN_STATE_CONNECTING_TO_BROKER) {
+    step();
+  }
+  broker_send(connack, sizeof(connack));
+  if(!mqtt_connected(&conn)) {
+    printf("mqtt-publish-bench: not connected\n");
+    exit(1);
+  }
+  /* mqtt_publish() must not run before connect_pt has seen the CONNACK */
+  for(i = 0; i < 4; i++) {
+    step();
+  }
+
+  for(i = 0; i < PAYLOAD_SIZES; i++) {
+    broker_bytes = 0;
+    expected = 0;
+    total = 0;
+    for(j = 0; j < PUBLISHES; j++) {
+      start = bench_now_ns();
+      mqtt_publish(&conn, &mid, TOPIC, payload, payload_sizes[i],
+                   MQTT_QOS_LEVEL_0, MQTT_RETAIN_OFF);
+      do {
+        step();
+      } while(!mqtt_ready(&conn) || !conn.out_buffer_sent);
+      total += bench_now_ns() - start;
+      expected += publish_len(payload_sizes[i], MQTT_QOS_LEVEL_0);
+    }
+    bench_report("publish", payload_sizes[i], total, PUBLISHES);
+    if(broker_bytes != expected) {
+      printf("mqtt-publish-bench: broker got %lu bytes, expected %lu\n",
+             broker_bytes, expected);
+    }
+  }
+
+  /* QoS 1, from mqtt_publish() until the PUBACK has been handled */
+  for(i = 0; i < PAYLOAD_SIZES; i++) {
+    broker_bytes = 0;
+    expected = 0;
+    total = 0;
+    pubacks = 0;
+    for(j = 0; j < PUBLISHES; j++) {
+      start = bench_now_ns();
+      if(mqtt_publish(&conn, &mid, TOPIC, payload, payload_sizes[i],
+                      MQTT_QOS_LEVEL_1, MQTT_RETAIN_OFF) != MQTT_STATUS_OK) {
+        printf("mqtt-publish-bench: QoS 1 publish %u refused\n", j);
+        exit(1);
+      }
+      expected += publish_len(payload_sizes[i], MQTT_QOS_LEVEL_1);
+      puback[2] = mid >> 8;
+      puback[3] = mid & 0xff;
+      puback_at = expected;
+      for(steps = 0; pubacks <= j || !mqtt_ready(&conn) ||
+          !conn.out_buffer_sent; steps++) {
+        if(steps == MAX_STEPS) {
+          printf("mqtt-publish-bench: no PUBACK for MID %u\n", mid);
+          exit(1);
+        }
+        step();
+      }
+      total += bench_now_ns() - start;
+    }
+    bench_report("publish-qos1", payload_sizes[i], total, PUBLISHES);
+    if(broker_bytes != expected) {
+      printf("mqtt-publish-bench: broker got %lu bytes, expected %lu\n",
+             broker_bytes, expected);
+    }
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
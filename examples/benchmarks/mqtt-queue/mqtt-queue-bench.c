@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Checks and timing of the MQTT in-flight window and outbound
+ *         queue. QoS 1 messages are published faster than a broker
+ *         stand-in acknowledges them, so they pile up in the queue file,
+ *         a Coffee ring that wraps around many times. The broker checks
+ *         that every message arrives once and in order, that queued
+ *         messages refill the whole window after the PUBACKs of a
+ *         segment, and that SUBSCRIBE never reuses the ID of a message in
+ *         the window. A second connection then recovers the queue that
+ *         was left in the file.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "mqtt.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define WINDOW MQTT_INFLIGHT_WINDOW
+#define TOPIC "bench/queue"
+#define ROUNDS 2000
+/* Steps without the engine going idle before the benchmark gives up */
+#define MAX_STEPS 100
+/* Sequence number in the first 4 bytes, then up to 21 bytes of padding */
+#define PAYLOAD_SIZE(seq) (4 + (seq) % 8 * 3)
+#define PAYLOADS 64
+
+static struct mqtt_connection conn;
+static struct mqtt_connection recovered;
+static uint8_t payloads[PAYLOADS][MQTT_QUEUE_PAYLOAD_SIZE];
+static uint32_t published;
+
+/* What the broker has received and not yet acknowledged */
+static uint8_t stream[UIP_BUFSIZE];
+static int stream_len;
+static uint32_t received;
+static uint16_t unacked[WINDOW];
+static int unacked_count;
+static uint16_t subscribe_mid;
+
+PROCESS_NAME(tcp_socket_process);
+
+/* Internal to uIP, set up here the way uip_process() does */
+extern void *uip_sappdata;
+extern uint16_t uip_slen;
+/*---------------------------------------------------------------------------*/
+static void
+fail(const char *msg, unsigned long value)
+{
+  printf("mqtt-queue-bench: %s (%lu)\n", msg, value);
+  exit(1);
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_unacked(uint16_t mid)
+{
+  int i;
+
+  for(i = 0; i < unacked_count; i++) {
+    if(unacked[i] == mid) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+broker_packet(uint8_t fhdr, const uint8_t *body)
+{
+  uint16_t topic_length;
+  uint16_t mid;
+  uint32_t seq;
+
+  switch(fhdr & 0xf0) {
+  case 0x30:
+    topic_length = (body[0] << 8) | body[1];
+    mid = (body[2 + topic_length] << 8) | body[3 + topic_length];
+    body += 4 + topic_length;
+    seq = ((uint32_t)body[0] << 24) | ((uint32_t)body[1] << 16) |
+      (body[2] << 8) | body[3];
+    if(((fhdr >> 1) & 3) != MQTT_QOS_LEVEL_1 || (fhdr & 0x08)) {
+      fail("unexpected PUBLISH flags", fhdr);
+    }
+    if(seq != received) {
+      fail("PUBLISH out of order", seq);
+    }
+    if(is_unacked(mid)) {
+      fail("MID reused while in flight", mid);
+    }
+    if(unacked_count == WINDOW) {
+      fail("more PUBLISHes in flight than the window", seq);
+    }
+    received++;
+    unacked[unacked_count++] = mid;
+    break;
+  case 0x80:
+    subscribe_mid = (body[0] << 8) | body[1];
+    if(is_unacked(subscribe_mid)) {
+      fail("SUBSCRIBE with the MID of a PUBLISH in flight", subscribe_mid);
+    }
+    break;
+  default:
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Split what the broker has received into MQTT packets */
+static void
+broker_parse(void)
+{
+  uint32_t remaining;
+  uint32_t multiplier;
+  int pos;
+
+  while(stream_len >= 2) {
+    remaining = 0;
+    multiplier = 1;
+    pos = 1;
+    do {
+      if(pos == stream_len) {
+        return;
+      }
+      remaining += (stream[pos] & 0x7f) * multiplier;
+      multiplier *= 128;
+    } while(stream[pos++] & 0x80);
+    if(pos + remaining > stream_len) {
+      return;
+    }
+    broker_packet(stream[0], &stream[pos]);
+    stream_len -= pos + remaining;
+    memmove(stream, &stream[pos + remaining], stream_len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Run the socket's uIP callback as tcpip would for its connection */
+static void
+stack_call(uint8_t flags)
+{
+  uip_conn = conn.socket.c;
+  uip_flags = flags;
+  uip_slen = 0;
+  uip_sappdata = uip_appdata = &uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN];
+  process_post_synch(&tcp_socket_process, tcpip_event, &conn.socket);
+}
+/*---------------------------------------------------------------------------*/
+/* Take everything the socket has to send and acknowledge it */
+static void
+broker_receive(void)
+{
+  stack_call(UIP_POLL);
+  while(uip_slen > 0) {
+    if(stream_len + uip_slen > sizeof(stream)) {
+      fail("broker stream overflow", uip_slen);
+    }
+    memcpy(&stream[stream_len], uip_sappdata, uip_slen);
+    stream_len += uip_slen;
+    broker_parse();
+    stack_call(UIP_ACKDATA);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+broker_send(const uint8_t *data, int len)
+{
+  conn.socket.input_callback(&conn.socket, conn.socket.ptr, data, len);
+}
+/*---------------------------------------------------------------------------*/
+/* PUBACK the oldest messages in flight, all in one segment */
+static void
+broker_ack(int count)
+{
+  uint8_t segment[4 * WINDOW];
+  int i;
+
+  for(i = 0; i < count; i++) {
+    segment[4 * i] = 0x40;
+    segment[4 * i + 1] = 0x02;
+    segment[4 * i + 2] = unacked[i] >> 8;
+    segment[4 * i + 3] = unacked[i] & 0xff;
+  }
+  unacked_count -= count;
+  memmove(unacked, &unacked[count], unacked_count * sizeof(unacked[0]));
+  broker_send(segment, 4 * count);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
+{
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Handle one event, then deliver what the MQTT process has sent. Events are
+ * dispatched here rather than by yielding to the main loop, which sleeps in
+ * select() between events on the native platform.
+ */
+static void
+step(void)
+{
+  process_run();
+  if(conn.socket.c != NULL) {
+    broker_receive();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+settle(void)
+{
+  int steps;
+
+  for(steps = 0; process_nevents() > 0; steps++) {
+    if(steps == MAX_STEPS) {
+      fail("the MQTT engine does not go idle", steps);
+    }
+    step();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static mqtt_status_t
+publish(uint16_t *mid)
+{
+  uint8_t *payload;
+  mqtt_status_t status;
+
+  payload = payloads[published % PAYLOADS];
+  payload[0] = published >> 24;
+  payload[1] = published >> 16;
+  payload[2] = published >> 8;
+  payload[3] = published;
+  status = mqtt_publish(&conn, mid, TOPIC, payload, PAYLOAD_SIZE(published),
+                        MQTT_QOS_LEVEL_1, MQTT_RETAIN_OFF);
+  if(status == MQTT_STATUS_OK) {
+    published++;
+  }
+  return status;
+}
+/*---------------------------------------------------------------------------*/
+/* The queue head as a restart would find it */
+static uint32_t
+saved_head(void)
+{
+  uint32_t head;
+  int fd;
+
+  fd = cfs_open(MQTT_QUEUE_FILE ".h", CFS_READ);
+  if(fd < 0) {
+    return (uint32_t)-1;
+  }
+  if(cfs_read(fd, &head, sizeof(head)) != sizeof(head)) {
+    head = (uint32_t)-1;
+  }
+  cfs_close(fd);
+  return head;
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_window(void)
+{
+  static const uint8_t suback[] = { 0x90, 0x03, 0x00, 0x00, 0x00 };
+  uint8_t ack[sizeof(suback)];
+  uint16_t mids[WINDOW];
+  uint16_t mid;
+  int steps;
+  int i;
+
+  for(i = 0; i < WINDOW + 3; i++) {
+    if(publish(&mid) != MQTT_STATUS_OK) {
+      fail("publish refused", i);
+    }
+    if(i < WINDOW) {
+      if(mid == 0 || (i > 0 && mid == mids[i - 1])) {
+        fail("bad MID for a message in the window", mid);
+      }
+      mids[i] = mid;
+    } else if(mid != 0) {
+      fail("queued message got a MID", mid);
+    }
+  }
+  if(conn.stats.queued != 3) {
+    fail("messages queued", conn.stats.queued);
+  }
+  settle();
+  if(received != WINDOW || unacked_count != WINDOW) {
+    fail("PUBLISHes received with a full window", received);
+  }
+
+  /* The next ID after the counter is held by the window */
+  conn.mid_counter = mids[0] - 2;
+  if(mqtt_subscribe(&conn, NULL, "bench/sub", MQTT_QOS_LEVEL_0) !=
+     MQTT_STATUS_OK) {
+    fail("subscribe refused", 0);
+  }
+  /* subscribe_pt() keeps the engine busy until the SUBACK */
+  for(steps = 0; subscribe_mid == 0; steps++) {
+    if(steps == MAX_STEPS) {
+      fail("SUBSCRIBE not received", steps);
+    }
+    step();
+  }
+  if(subscribe_mid != conn.out_packet.mid) {
+    fail("SUBSCRIBE with another MID", subscribe_mid);
+  }
+  memcpy(ack, suback, sizeof(ack));
+  ack[2] = subscribe_mid >> 8;
+  ack[3] = subscribe_mid & 0xff;
+  broker_send(ack, sizeof(ack));
+  settle();
+
+  /* Two PUBACKs free two entries, which both go to queued messages */
+  broker_ack(2);
+  settle();
+  if(received != WINDOW + 2 || unacked_count != WINDOW) {
+    fail("queued messages replayed after two PUBACKs", received - WINDOW);
+  }
+
+  /* Completing replayed messages moves the head, but does not save it */
+  broker_ack(WINDOW);
+  settle();
+  if(received != WINDOW + 3 || conn.queue_head == conn.queue_tail ||
+     saved_head() == conn.queue_head) {
+    fail("head saved while the queue is replayed", saved_head());
+  }
+
+  broker_ack(unacked_count);
+  settle();
+  if(conn.queue_head != conn.queue_tail || saved_head() != conn.queue_head) {
+    fail("head not saved once the queue ran empty", saved_head());
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Publish bursts faster than they are acknowledged. Messages refused while
+ * the ring is full are published again later.
+ */
+static void
+check_ring(void)
+{
+  static uint64_t total;
+  uint64_t start;
+  unsigned long refused;
+  unsigned long wraps;
+  uint32_t tail;
+  int round;
+  int i;
+
+  refused = 0;
+  wraps = 0;
+  total = 0;
+  for(round = 0; round < ROUNDS; round++) {
+    tail = conn.queue_tail;
+    start = bench_now_ns();
+    for(i = 0; i < 1 + round % (2 * WINDOW + 5); i++) {
+      if(publish(NULL) == MQTT_STATUS_OUT_QUEUE_FULL) {
+        refused++;
+      }
+    }
+    if(unacked_count > 0) {
+      broker_ack(1 + round % unacked_count);
+    }
+    settle();
+    total += bench_now_ns() - start;
+    if(conn.queue_tail < tail) {
+      wraps++;
+    }
+    if(conn.queue_replay != conn.queue_tail && unacked_count != WINDOW) {
+      fail("window not refilled from the queue", unacked_count);
+    }
+  }
+  while(unacked_count > 0) {
+    broker_ack(unacked_count);
+    settle();
+  }
+  bench_report("queued publish", MQTT_QUEUE_SIZE, total, published);
+
+  if(received != published) {
+    fail("messages lost", published - received);
+  }
+  if(conn.queue_head != conn.queue_tail) {
+    fail("queue not empty", conn.queue_tail);
+  }
+  if(refused == 0 || conn.stats.dropped != refused) {
+    fail("publishes refused while the queue was full", refused);
+  }
+  if(wraps < 10) {
+    fail("ring wrap-arounds", wraps);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Fill the ring while disconnected and pick it up with a new connection */
+static void
+check_recovery(void)
+{
+  unsigned long queued;
+
+  mqtt_disconnect(&conn);
+  settle();
+  if(conn.state != MQTT_CONN_STATE_NOT_CONNECTED ||
+     saved_head() != conn.queue_head) {
+    fail("head not saved on disconnect", saved_head());
+  }
+
+  queued = 0;
+  while(publish(NULL) == MQTT_STATUS_OK) {
+    queued++;
+  }
+  if(queued < MQTT_QUEUE_SIZE / (6 + sizeof(TOPIC) - 1 + PAYLOAD_SIZE(7))) {
+    fail("messages queued while disconnected", queued);
+  }
+
+  mqtt_register(&recovered, PROCESS_CURRENT(), "recovered", mqtt_event,
+                UIP_TCP_MSS);
+  if(recovered.queue_head != conn.queue_head ||
+     recovered.queue_tail != conn.queue_tail) {
+    fail("queue not recovered", recovered.queue_tail);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(mqtt_queue_bench_process, "MQTT queue benchmark");
+AUTOSTART_PROCESSES(&mqtt_queue_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mqtt_queue_bench_process, ev, data)
+{
+  static const uint8_t connack[] = { 0x20, 0x02, 0x00, 0x00 };
+
+  PROCESS_BEGIN();
+
+  if(cfs_coffee_format() < 0) {
+    fail("cannot format the file system", 0);
+  }
+
+  mqtt_register(&conn, PROCESS_CURRENT(), "bench", mqtt_event, UIP_TCP_MSS);
+  mqtt_connect(&conn, "fd00::1", 1883, 3600);
+  while(conn.socket.c == NULL) {
+    step();
+  }
+  stack_call(UIP_CONNECTED);
+  while(!conn.out_buffer_sent ||
+        conn.state != MQTT_CONN_STATE_CONNECTING_TO_BROKER) {
+    step();
+  }
+  stream_len = 0;
+  broker_send(connack, sizeof(connack));
+  if(!mqtt_connected(&conn)) {
+    fail("not connected", conn.state);
+  }
+  settle();
+
+  check_window();
+  check_ring();
+  check_recovery();
+
+  printf("mqtt-queue-bench: all checks passed\n");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
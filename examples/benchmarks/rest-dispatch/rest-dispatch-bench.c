@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for rest_invoke_restful_service() with 10 to 1000
+ *         activated resources. Build with MAKE_WITH_ROUTING_INDEX=1 to
+ *         measure the hashed resource routing index.
+ */
+
+#include "contiki.h"
+#include "rest-engine.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define MAX_RESOURCES 1000
+#define URL_SIZE 32
+#define DISPATCHES 20000
+
+#define STATUS_CONTENT 69
+#define STATUS_NOT_FOUND 132
+#define STATUS_METHOD_NOT_ALLOWED 133
+
+/* Minimal request and response, as seen through the REST stub below */
+struct request {
+  const char *url;
+  int url_len;
+};
+struct response {
+  unsigned int status;
+  resource_t *resource;
+};
+
+static const int resource_counts[] = { 10, 50, 200, 1000 };
+static resource_t resources[MAX_RESOURCES];
+static char urls[MAX_RESOURCES][URL_SIZE];
+static int num_activated;
+/*---------------------------------------------------------------------------*/
+static void
+stub_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+stub_set_service_callback(service_callback_t callback)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+stub_get_url(void *request, const char **url)
+{
+  *url = ((struct request *)request)->url;
+  return ((struct request *)request)->url_len;
+}
+/*---------------------------------------------------------------------------*/
+static rest_resource_flags_t
+stub_get_method_type(void *request)
+{
+  return METHOD_GET;
+}
+/*---------------------------------------------------------------------------*/
+static int
+stub_set_response_status(void *response, unsigned int code)
+{
+  ((struct response *)response)->status = code;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Called for observable resources, tells which resource was dispatched */
+static void
+stub_subscription_handler(resource_t *resource, void *request,
+                          void *response)
+{
+  ((struct response *)response)->resource = resource;
+}
+/*---------------------------------------------------------------------------*/
+const struct rest_implementation REST = {
+  .name = "bench",
+  .init = stub_init,
+  .set_service_callback = stub_set_service_callback,
+  .get_url = stub_get_url,
+  .get_method_type = stub_get_method_type,
+  .set_response_status = stub_set_response_status,
+  .subscription_handler = stub_subscription_handler,
+  .status = {
+    .OK = STATUS_CONTENT,
+    .NOT_FOUND = STATUS_NOT_FOUND,
+    .METHOD_NOT_ALLOWED = STATUS_METHOD_NOT_ALLOWED,
+  },
+};
+/*---------------------------------------------------------------------------*/
+static void
+get_handler(void *request, void *response, uint8_t *buffer,
+            uint16_t preferred_size, int32_t *offset)
+{
+  ((struct response *)response)->status = STATUS_CONTENT;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Every fourth resource is a parent with sub-resources, the others are
+ * leaves. Lookups go to leaves, below parents, and to unknown URLs.
+ */
+static void
+activate(int num_resources)
+{
+  resource_t *r;
+  int i;
+
+  for(i = num_activated; i < num_resources; i++) {
+    r = &resources[i];
+    r->flags = METHOD_GET | IS_OBSERVABLE;
+    if(i % 4 == 0) {
+      r->flags |= HAS_SUB_RESOURCES;
+      snprintf(urls[i], URL_SIZE, "sensors/%d", i);
+    } else {
+      snprintf(urls[i], URL_SIZE, "actuators/%d/state", i);
+    }
+    r->get_handler = get_handler;
+    rest_activate_resource(r, urls[i]);
+  }
+  num_activated = num_resources;
+}
+/*---------------------------------------------------------------------------*/
+static int
+dispatch(const char *url, struct response *response)
+{
+  struct request request;
+  int32_t offset;
+  uint8_t buffer[16];
+
+  request.url = url;
+  request.url_len = strlen(url);
+  response->status = 0;
+  response->resource = NULL;
+  offset = 0;
+  return rest_invoke_restful_service(&request, response, buffer,
+                                     sizeof(buffer), &offset);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_case(const char *name, int num_resources, int kind)
+{
+  char url[32];
+  struct response response;
+  uint64_t start;
+  uint64_t total;
+  unsigned long i;
+  int target;
+
+  total = 0;
+  for(i = 0; i < DISPATCHES; i++) {
+    target = (i * 7919) % num_resources;
+    if(kind == 0) {
+      target |= 1;
+      if(target >= num_resources) {
+        target = 1;
+      }
+      snprintf(url, sizeof(url), "actuators/%d/state", target);
+    } else if(kind == 1) {
+      target &= ~3;
+      snprintf(url, sizeof(url), "sensors/%d/%lu", target, i % 8);
+    } else {
+      snprintf(url, sizeof(url), "sensors/%lu", num_resources + i);
+    }
+
+    start = bench_now_ns();
+    dispatch(url, &response);
+    total += bench_now_ns() - start;
+
+    if(kind == 2 ? response.status != STATUS_NOT_FOUND
+       : response.resource != &resources[target]) {
+      printf("rest-dispatch-bench: wrong resource for %s\n", url);
+      exit(1);
+    }
+  }
+  bench_report(name, num_resources, total, DISPATCHES);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(rest_dispatch_bench_process, "REST dispatch benchmark");
+AUTOSTART_PROCESSES(&rest_dispatch_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(rest_dispatch_bench_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("rest-dispatch-bench: %s\n",
+         REST_ROUTING_INDEX ? "routing index" : "linear scan");
+
+  rest_init_engine();
+  for(i = 0; i < sizeof(resource_counts) / sizeof(resource_counts[0]); i++) {
+    activate(resource_counts[i]);
+    run_case("dispatch leaf", resource_counts[i], 0);
+    run_case("dispatch sub-resource", resource_counts[i], 1);
+    run_case("dispatch miss", resource_counts[i], 2);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
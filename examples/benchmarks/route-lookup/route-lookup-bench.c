@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for uip_ds6_route_lookup() with 1k and 10k downward
+ *         routes, as on a storing-mode RPL root. Build with
+ *         MAKE_WITH_HASH=1 to measure the hashed routing table index.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+/*---------------------------------------------------------------------------*/
+#define NUM_NEXTHOPS 8
+#define LOOKUPS 20000
+
+static const int route_counts[] = { 1000, 10000 };
+static uip_ipaddr_t nexthops[NUM_NEXTHOPS];
+/*---------------------------------------------------------------------------*/
+static void
+host_addr(uip_ipaddr_t *addr, unsigned long i)
+{
+  uip_ip6addr(addr, 0xaaaa, 0, 0, 0, 0x0212, 0x7400, (i >> 16) & 0xffff, i & 0xffff);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_nexthops(void)
+{
+  uip_lladdr_t lladdr;
+  int i;
+
+  for(i = 0; i < NUM_NEXTHOPS; i++) {
+    memset(&lladdr, 0, sizeof(lladdr));
+    lladdr.addr[sizeof(lladdr) - 1] = i + 1;
+    uip_ip6addr(&nexthops[i], 0xfe80, 0, 0, 0, 0, 0, 0, i + 1);
+    if(uip_ds6_nbr_add(&nexthops[i], &lladdr, 1, NBR_REACHABLE,
+                       NBR_TABLE_REASON_UNDEFINED, NULL) == NULL) {
+      printf("route-lookup-bench: could not add neighbor\n");
+      exit(1);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(int num_routes)
+{
+  uip_ipaddr_t addr;
+  uip_ds6_route_t *r;
+  uint64_t start;
+  unsigned long i;
+  unsigned long found;
+
+  while(uip_ds6_route_head() != NULL) {
+    uip_ds6_route_rm(uip_ds6_route_head());
+  }
+
+  start = bench_now_ns();
+  for(i = 0; i < num_routes - 1; i++) {
+    host_addr(&addr, i);
+    if(uip_ds6_route_add(&addr, 128, &nexthops[i % NUM_NEXTHOPS]) == NULL) {
+      printf("route-lookup-bench: could not add route %lu\n", i);
+      exit(1);
+    }
+  }
+  /* One covering prefix, so that misses on the /128s still resolve */
+  uip_ip6addr(&addr, 0xbbbb, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_route_add(&addr, 64, &nexthops[0]);
+  bench_report("route add", num_routes, bench_now_ns() - start, num_routes);
+
+  /* Forward to uniformly distributed known destinations */
+  found = 0;
+  start = bench_now_ns();
+  for(i = 0; i < LOOKUPS; i++) {
+    host_addr(&addr, (i * 7919) % (num_routes - 1));
+    r = uip_ds6_route_lookup(&addr);
+    if(r != NULL && uip_ipaddr_cmp(&r->ipaddr, &addr)) {
+      found++;
+    }
+  }
+  bench_report("lookup /128", num_routes, bench_now_ns() - start, LOOKUPS);
+  if(found != LOOKUPS) {
+    printf("route-lookup-bench: %lu of %u lookups failed\n",
+           LOOKUPS - found, LOOKUPS);
+    exit(1);
+  }
+
+  /* Forward to destinations covered only by the /64 */
+  found = 0;
+  start = bench_now_ns();
+  for(i = 0; i < LOOKUPS; i++) {
+    uip_ip6addr(&addr, 0xbbbb, 0, 0, 0, 0, 0, 0, i & 0xffff);
+    r = uip_ds6_route_lookup(&addr);
+    if(r != NULL && r->length == 64) {
+      found++;
+    }
+  }
+  bench_report("lookup /64", num_routes, bench_now_ns() - start, LOOKUPS);
+  if(found != LOOKUPS) {
+    printf("route-lookup-bench: prefix route not found\n");
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(route_lookup_bench_process, "Route lookup benchmark");
+AUTOSTART_PROCESSES(&route_lookup_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(route_lookup_bench_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("route-lookup-bench: %s\n",
+         UIP_DS6_ROUTE_HASH ? "hash index" : "linear scan");
+
+  add_nexthops();
+  for(i = 0; i < sizeof(route_counts) / sizeof(route_counts[0]); i++) {
+    run(route_counts[i]);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
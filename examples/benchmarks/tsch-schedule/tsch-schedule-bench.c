@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2026, Eistec AB - http://www.eistec.se
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for tsch_schedule_get_next_active_link() with 10 to
+ *         500 links, spread over slotframes as on an Orchestra
+ *         coordinator, also when the links just used are removed.
+ *         Both the average and the longest single lookup are reported.
+ *         Build with MAKE_WITH_SORTED_LINKS=1 to measure the sorted
+ *         links with lookup cursor.
+ */
+
+#include "contiki.h"
+#include "net/mac/tsch/tsch.h"
+#include "net/mac/tsch/tsch-queue.h"
+#include "net/mac/tsch/tsch-schedule.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+/*---------------------------------------------------------------------------*/
+#define LOOKUPS 20000
+/* Passes over the same ASNs, for the worst case of single lookups */
+#define PASSES 5
+
+/* EB and broadcast slotframes with one link each, plus a large
+   unicast slotframe holding all other links */
+#define SF_EB_SIZE 397
+#define SF_COMMON_SIZE 31
+#define SF_UNICAST_SIZE 1009
+
+static const int link_counts[] = { 10, 50, 100, 250, 500 };
+static uint64_t lookup_ns[LOOKUPS];
+/*---------------------------------------------------------------------------*/
+/* Symbols from the TSCH core, which is not linked in */
+const linkaddr_t tsch_broadcast_address = { { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff } };
+const linkaddr_t tsch_eb_address = { { 0, 0, 0, 0, 0, 0, 0, 0 } };
+int tsch_is_coordinator = 1;
+int tsch_is_associated = 0;
+struct tsch_link *current_link = NULL;
+
+int
+tsch_is_locked(void)
+{
+  return 0;
+}
+int
+tsch_get_lock(void)
+{
+  return 1;
+}
+void
+tsch_release_lock(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+/* Time to the next active link, computed the straightforward way */
+static uint16_t
+reference_time_offset(struct asn_t *asn)
+{
+  struct tsch_slotframe *sf;
+  struct tsch_link *l;
+  uint16_t best = 0xffff;
+  uint16_t timeslot;
+  uint16_t t;
+  uint16_t h;
+
+  for(h = 0; h < 3; h++) {
+    sf = tsch_schedule_get_slotframe_by_handle(h);
+    timeslot = ASN_MOD(*asn, sf->size);
+    for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+      t = l->timeslot > timeslot ? l->timeslot - timeslot :
+        sf->size.val + l->timeslot - timeslot;
+      if(t < best) {
+        best = t;
+      }
+    }
+  }
+  return best;
+}
+/*---------------------------------------------------------------------------*/
+static void
+build_schedule(int num_links)
+{
+  struct tsch_slotframe *sf_eb;
+  struct tsch_slotframe *sf_common;
+  struct tsch_slotframe *sf_unicast;
+  linkaddr_t addr;
+  int i;
+
+  tsch_schedule_remove_all_slotframes();
+  sf_eb = tsch_schedule_add_slotframe(0, SF_EB_SIZE);
+  sf_common = tsch_schedule_add_slotframe(1, SF_COMMON_SIZE);
+  sf_unicast = tsch_schedule_add_slotframe(2, SF_UNICAST_SIZE);
+
+  tsch_schedule_add_link(sf_eb, LINK_OPTION_TX, LINK_TYPE_ADVERTISING_ONLY,
+                         &tsch_broadcast_address, 0, 0);
+  tsch_schedule_add_link(sf_common, LINK_OPTION_RX | LINK_OPTION_TX | LINK_OPTION_SHARED,
+                         LINK_TYPE_ADVERTISING, &tsch_broadcast_address, 0, 1);
+
+  /* Per-neighbor Rx links, added in an order unrelated to timeslots */
+  memset(&addr, 0, sizeof(addr));
+  for(i = 0; i < num_links - 2; i++) {
+    addr.u8[LINKADDR_SIZE - 1] = i + 1;
+    if(tsch_schedule_add_link(sf_unicast, LINK_OPTION_RX, LINK_TYPE_NORMAL,
+                              &addr, (i * 397) % SF_UNICAST_SIZE, 2) == NULL) {
+      printf("tsch-schedule-bench: could not add link %d\n", i);
+      exit(1);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Follow the schedule from slot to slot as the slot operation does. With
+ * remove set, every unicast link is removed at the end of its slot, just
+ * before the lookup of the next link, and added back after it.
+ */
+static void
+follow_schedule(const char *name, int num_links, int remove)
+{
+  struct tsch_slotframe *sf_unicast;
+  struct asn_t asn;
+  struct tsch_link *link;
+  struct tsch_link *backup;
+  uint64_t start, elapsed, total, max;
+  uint16_t time_offset;
+  uint16_t removed_timeslot;
+  linkaddr_t removed_addr;
+  unsigned long i;
+  int removed;
+  int pass;
+
+  build_schedule(num_links);
+  sf_unicast = tsch_schedule_get_slotframe_by_handle(2);
+
+  /* Each pass restarts at ASN 0, which also resets the lookup cursors */
+  total = 0;
+  for(pass = 0; pass < PASSES; pass++) {
+    ASN_INIT(asn, 0, 0);
+    link = NULL;
+    for(i = 0; i < LOOKUPS; i++) {
+      removed = 0;
+      if(remove && link != NULL && link->slotframe_handle == 2) {
+        /* Leave the cursor on the link, as in the slot of the link */
+        tsch_schedule_get_next_active_link(&asn, NULL, &backup);
+        removed_timeslot = link->timeslot;
+        linkaddr_copy(&removed_addr, &link->addr);
+        tsch_schedule_remove_link(sf_unicast, link);
+        removed = 1;
+      }
+      start = bench_now_ns();
+      link = tsch_schedule_get_next_active_link(&asn, &time_offset, &backup);
+      elapsed = bench_now_ns() - start;
+      total += elapsed;
+      if(pass == 0 || elapsed < lookup_ns[i]) {
+        lookup_ns[i] = elapsed;
+      }
+      if(link == NULL || time_offset != reference_time_offset(&asn)) {
+        printf("tsch-schedule-bench: wrong next link at ASN %lu\n",
+               (unsigned long)asn.ls4b);
+        exit(1);
+      }
+      if(removed
+         && tsch_schedule_add_link(sf_unicast, LINK_OPTION_RX,
+                                   LINK_TYPE_NORMAL, &removed_addr,
+                                   removed_timeslot, 2) == NULL) {
+        printf("tsch-schedule-bench: could not add link back\n");
+        exit(1);
+      }
+      ASN_INC(asn, time_offset);
+    }
+  }
+
+  /* The same lookup is timed in every pass, so the fastest of its times
+     leaves out preemption by the host */
+  max = 0;
+  for(i = 0; i < LOOKUPS; i++) {
+    if(lookup_ns[i] > max) {
+      max = lookup_ns[i];
+    }
+  }
+
+  bench_report(name, num_links, total, PASSES * LOOKUPS);
+  bench_report_max(name, num_links, max, LOOKUPS);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(tsch_schedule_bench_process, "TSCH schedule benchmark");
+AUTOSTART_PROCESSES(&tsch_schedule_bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tsch_schedule_bench_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("tsch-schedule-bench: %s\n",
+         TSCH_SCHEDULE_SORTED_LINKS ? "sorted links" : "unsorted links");
+
+  tsch_queue_init();
+  tsch_schedule_init();
+  for(i = 0; i < sizeof(link_counts) / sizeof(link_counts[0]); i++) {
+    follow_schedule("next active link", link_counts[i], 0);
+  }
+  for(i = 0; i < sizeof(link_counts) / sizeof(link_counts[0]); i++) {
+    follow_schedule("after link removal", link_counts[i], 1);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/